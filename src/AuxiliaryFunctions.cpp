@@ -1,4 +1,5 @@
 #include "AuxiliaryFunctions.h"
+#include "Telemetry.h"
 #include "scai/partitioning/Partitioning.hpp"
 #include <numeric>
 
@@ -241,20 +242,10 @@ void aux<IndexType,ValueType>::redistributeInput(
     std::vector<DenseVector<ValueType>>& coordinates,
     std::vector<DenseVector<ValueType>>& nodeWeights){
 
-    for (IndexType d=0; d<coordinates.size(); d++) {
-        coordinates[d].redistribute( targetDistribution );
-    }
-
-    for(int w=0; w<nodeWeights.size(); w++){
-        nodeWeights[w].redistribute( targetDistribution );
-    }
+    //build the plan once and apply it to all inputs
+    const scai::dmemo::RedistributePlan redistributor = scai::dmemo::redistributePlanByNewDistribution( targetDistribution, graph.getRowDistributionPtr() );
 
-    //column are not distributed
-    const IndexType globalN = coordinates[0].getDistributionPtr()->getGlobalSize();
-    const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(globalN));
-
-    graph.redistribute( targetDistribution, noDist );
-    partition.redistribute( targetDistribution );
+    redistributeInput( redistributor, partition, graph, coordinates, nodeWeights );
 } 
 
 //---------------------------------------------------------------------------------------
@@ -267,25 +258,104 @@ void  aux<IndexType,ValueType>::redistributeInput(
     std::vector<DenseVector<ValueType>>& coordinates,
     std::vector<DenseVector<ValueType>>& nodeWeights){
 
+    SCAI_REGION("aux.redistributeInput");
+    Telemetry::ScopedTimer telemetryTimer("redistributeInput");
+
+    //column are not distributed
+    const IndexType globalN = graph.getRowDistributionPtr()->getGlobalSize();
+
+    const scai::dmemo::DistributionPtr sourceDist = redistributor.getSourceDistributionPtr();
+    const scai::dmemo::DistributionPtr targetDist = redistributor.getTargetDistributionPtr();
+
+    //coordinates and node weights with the source distribution of the plan are moved together in one exchange,
+    //the others are redistributed to the target distribution on their own
+    std::vector<DenseVector<ValueType>*> pointData;
     for (IndexType d=0; d<coordinates.size(); d++) {
-        coordinates[d].redistribute(redistributor);
+        if( coordinates[d].getDistribution().isEqual(*sourceDist) ) {
+            pointData.push_back( &coordinates[d] );
+        } else {
+            coordinates[d].redistribute( targetDist );
+        }
     }
     for(int w=0; w<nodeWeights.size(); w++){
-        nodeWeights[w].redistribute(redistributor);
+        if( nodeWeights[w].getDistribution().isEqual(*sourceDist) ) {
+            pointData.push_back( &nodeWeights[w] );
+        } else {
+            nodeWeights[w].redistribute( targetDist );
+        }
     }
+    redistributePacked( redistributor, pointData );
 
-    //column are not distributed
-    const IndexType globalN = coordinates[0].getDistributionPtr()->getGlobalSize();
     const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(globalN));
 
     graph.redistribute( redistributor, noDist );
-    partition.redistribute(redistributor);
+    if( partition.getDistribution().isEqual(*sourceDist) ) {
+        partition.redistribute(redistributor);
+    } else {
+        partition.redistribute( targetDist );
+    }
     //30/09/19: below is older code that seems wrong
     //partition = DenseVector<IndexType>( distFromPartition, comm->getRank());
 } 
 
 //---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+void aux<IndexType,ValueType>::redistributePacked(
+    const scai::dmemo::RedistributePlan& redistributor,
+    const std::vector<DenseVector<ValueType>*>& vectors){
+
+    SCAI_REGION("aux.redistributePacked");
+
+    const IndexType numVectors = vectors.size();
+    if (numVectors == 0) {
+        return;
+    }
+
+    const scai::dmemo::DistributionPtr sourceDist = redistributor.getSourceDistributionPtr();
+    const scai::dmemo::DistributionPtr targetDist = redistributor.getTargetDistributionPtr();
+    const IndexType sourceLocalN = sourceDist->getLocalSize();
+    const IndexType targetLocalN = targetDist->getLocalSize();
+
+    for (IndexType v = 0; v < numVectors; v++) {
+        SCAI_ASSERT_ERROR( vectors[v]->getDistribution().isEqual(*sourceDist), "Vector " << v << " does not have the source distribution of the plan" );
+    }
+
+    //pack the values of every vertex next to each other
+    scai::hmemo::HArray<ValueType> sendValues;
+    {
+        scai::hmemo::WriteOnlyAccess<ValueType> wSend(sendValues, sourceLocalN*numVectors);
+        for (IndexType v = 0; v < numVectors; v++) {
+            scai::hmemo::ReadAccess<ValueType> rValues(vectors[v]->getLocalValues());
+            #pragma omp parallel for
+            for (IndexType i = 0; i < sourceLocalN; i++) {
+                wSend[i*numVectors + v] = rValues[i];
+            }
+        }
+    }
+
+    scai::hmemo::HArray<ValueType> recvValues;
+    redistributor.redistributeN( recvValues, sendValues, numVectors );
+    Telemetry::countCollective( redistributor.getExchangeSourceSize()*numVectors*sizeof(ValueType) );
+    SCAI_ASSERT_EQ_ERROR( recvValues.size(), targetLocalN*numVectors, "Wrong size of the received values" );
+
+    //unpack into vectors with the target distribution
+    scai::hmemo::ReadAccess<ValueType> rRecv(recvValues);
+    for (IndexType v = 0; v < numVectors; v++) {
+        scai::hmemo::HArray<ValueType> localValues;
+        {
+            scai::hmemo::WriteOnlyAccess<ValueType> wValues(localValues, targetLocalN);
+            #pragma omp parallel for
+            for (IndexType i = 0; i < targetLocalN; i++) {
+                wValues[i] = rRecv[i*numVectors + v];
+            }
+        }
+        *vectors[v] = DenseVector<ValueType>( targetDist, std::move(localValues) );
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>
 IndexType aux<IndexType, ValueType>::toMetisInterface(
     const scai::lama::CSRSparseMatrix<ValueType> &graph,
@@ -340,7 +340,12 @@ public:
         std::vector<scai::lama::DenseVector<ValueType>>& coordinates,
         std::vector<scai::lama::DenseVector<ValueType>>& nodeWeights);
 
+    /** Redistribute the graph, partition, coordinates and node weights with the given plan.
 
+    	The graph must have the source distribution of the plan. The coordinates and node weights with the
+    	source distribution are moved in one packed exchange, the partition and all other vectors are
+    	redistributed to the target distribution on their own.
+    **/
     static void redistributeInput(
         const scai::dmemo::RedistributePlan redistributor,
         scai::lama::DenseVector<IndexType>& partition,
@@ -348,6 +353,19 @@ public:
         std::vector<scai::lama::DenseVector<ValueType>>& coordinates,
         std::vector<scai::lama::DenseVector<ValueType>>& nodeWeights);
 
+    /** Redistribute several vectors with the same plan in one exchange.
+
+    	The values of every vertex are packed next to each other and sent together,
+    	so the plan is applied once instead of once per vector. This is used for the
+    	coordinates and node weights, which always move with the graph.
+
+    	@param[in] redistributor The plan; all vectors must have its source distribution.
+    	@param[in,out] vectors The vectors to redistribute; afterwards they have the target distribution of the plan.
+    **/
+    static void redistributePacked(
+        const scai::dmemo::RedistributePlan& redistributor,
+        const std::vector<scai::lama::DenseVector<ValueType>*>& vectors);
+
 
     /** Function to convert lama data structures to raw pointers as used
         by the metis and parmetis interface. All const arguments are the
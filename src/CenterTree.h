@@ -0,0 +1,222 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <stdexcept>
+
+namespace ITI {
+
+/** @brief A k-d tree over the k-means centers, used to find the closest centers of a point in KMeans::assignBlocks.
+
+The centers of every father block get their own tree, so a query only visits centers of the father block of a point.
+Every node stores the bounding box of its centers and, for every node weight, the smallest influence value of its centers.
+The squared distance of a point to the box, multiplied with the smallest influence effect, is a lower bound
+of the effective distance to all centers of the node.
+
+The tree structure only depends on the center coordinates. If only the influence values change, as in the balance
+iterations of k-means, updateInfluence refreshes the bounds in O(k).
+*/
+template<typename IndexType, typename ValueType>
+class CenterTree {
+public:
+
+    /** Build the trees for the given centers.
+
+    @param[in] centers The centers in one contiguous array, centers[c*dim+d] is the d-th coordinate of center c.
+    @param[in] dim The dimension of the centers.
+    @param[in] blockSizesPrefixSum The centers of father block b are blockSizesPrefixSum[b] to blockSizesPrefixSum[b+1]-1.
+    @param[in] numWeights The number of node weights, i.e., of influence values per center.
+    */
+    void build(
+        const std::vector<ValueType>& centers,
+        const IndexType dim,
+        const std::vector<IndexType>& blockSizesPrefixSum,
+        const IndexType numWeights) {
+
+        const IndexType k = blockSizesPrefixSum.back();
+        if (IndexType(centers.size()) != k*dim) {
+            throw std::invalid_argument("Number of center coordinates " + std::to_string(centers.size()) + " does not fit the block sizes " + std::to_string(k) + " and the dimension " + std::to_string(dim));
+        }
+
+        this->dim = dim;
+        this->numWeights = numWeights;
+        perm.resize(k);
+        std::iota(perm.begin(), perm.end(), 0);
+        nodeBegin.clear();
+        nodeEnd.clear();
+        nodeLeft.clear();
+        nodeRight.clear();
+        boxMin.clear();
+        boxMax.clear();
+
+        const IndexType numFathers = blockSizesPrefixSum.size()-1;
+        roots.assign(numFathers, -1);
+        for (IndexType b = 0; b < numFathers; b++) {
+            if (blockSizesPrefixSum[b] < blockSizesPrefixSum[b+1]) {
+                roots[b] = buildNode(centers, blockSizesPrefixSum[b], blockSizesPrefixSum[b+1]);
+            }
+        }
+
+        minInfluence.assign(nodeBegin.size()*numWeights, std::numeric_limits<ValueType>::max());
+    }
+
+    /** Refresh the smallest influence value of every node.
+
+    @param[in] influence influence[w][c] is the influence value of center c for node weight w.
+    */
+    void updateInfluence(const std::vector<std::vector<ValueType>>& influence) {
+        // children always have larger node IDs than their parent
+        for (IndexType node = nodeBegin.size()-1; node >= 0; node--) {
+            for (IndexType w = 0; w < numWeights; w++) {
+                ValueType minValue = std::numeric_limits<ValueType>::max();
+                if (nodeLeft[node] < 0) {
+                    for (IndexType c = nodeBegin[node]; c < nodeEnd[node]; c++) {
+                        minValue = std::min(minValue, influence[w][perm[c]]);
+                    }
+                } else {
+                    minValue = std::min(minInfluence[nodeLeft[node]*numWeights+w], minInfluence[nodeRight[node]*numWeights+w]);
+                }
+                minInfluence[node*numWeights+w] = minValue;
+            }
+        }
+    }
+
+    /** Visit the centers of a father block that may have an effective distance below \p pruneValue.
+
+    The nodes are visited depth-first, the closer child first. Since \p pruneValue is read again
+    before every node, the caller can lower it in \p visit, e.g. to the second smallest distance found so far.
+
+    @param[in] father The father block of the point.
+    @param[in] point The coordinates of the point.
+    @param[in] pointWeights The normalized node weights of the point, to combine the influence values.
+    @param[in] pruneValue Nodes whose lower bound is not smaller than this value are skipped.
+    @param[in] visit Called with the ID of every center in a leaf that is not skipped.
+    @param[in,out] stack Reused as the stack of the search to avoid allocations.
+    */
+    template<typename Visitor>
+    void query(
+        const IndexType father,
+        const ValueType* point,
+        const ValueType* pointWeights,
+        const ValueType& pruneValue,
+        Visitor visit,
+        std::vector<IndexType>& stack) const {
+
+        if (roots[father] < 0) {
+            return;
+        }
+
+        stack.clear();
+        stack.push_back(roots[father]);
+
+        while (!stack.empty()) {
+            const IndexType node = stack.back();
+            stack.pop_back();
+
+            if (lowerBound(node, point, pointWeights) >= pruneValue) {
+                continue;
+            }
+
+            if (nodeLeft[node] < 0) {
+                for (IndexType c = nodeBegin[node]; c < nodeEnd[node]; c++) {
+                    visit(perm[c]);
+                }
+            } else {
+                const IndexType left = nodeLeft[node];
+                const IndexType right = nodeRight[node];
+                // the closer child is pushed last and visited first
+                if (lowerBound(left, point, pointWeights) < lowerBound(right, point, pointWeights)) {
+                    stack.push_back(right);
+                    stack.push_back(left);
+                } else {
+                    stack.push_back(left);
+                    stack.push_back(right);
+                }
+            }
+        }
+    }
+
+    /** The number of nodes of all trees. */
+    IndexType numNodes() const {
+        return nodeBegin.size();
+    }
+
+private:
+
+    /** Build the subtree over perm[begin] to perm[end-1] and return its node ID. */
+    IndexType buildNode(const std::vector<ValueType>& centers, const IndexType begin, const IndexType end) {
+        const IndexType node = nodeBegin.size();
+        nodeBegin.push_back(begin);
+        nodeEnd.push_back(end);
+        nodeLeft.push_back(-1);
+        nodeRight.push_back(-1);
+
+        std::vector<ValueType> minCoords(dim, std::numeric_limits<ValueType>::max());
+        std::vector<ValueType> maxCoords(dim, std::numeric_limits<ValueType>::lowest());
+        for (IndexType c = begin; c < end; c++) {
+            for (IndexType d = 0; d < dim; d++) {
+                minCoords[d] = std::min(minCoords[d], centers[perm[c]*dim+d]);
+                maxCoords[d] = std::max(maxCoords[d], centers[perm[c]*dim+d]);
+            }
+        }
+        boxMin.insert(boxMin.end(), minCoords.begin(), minCoords.end());
+        boxMax.insert(boxMax.end(), maxCoords.begin(), maxCoords.end());
+
+        if (end - begin > leafSize) {
+            // split at the median of the widest dimension
+            IndexType splitDim = 0;
+            for (IndexType d = 1; d < dim; d++) {
+                if (maxCoords[d] - minCoords[d] > maxCoords[splitDim] - minCoords[splitDim]) {
+                    splitDim = d;
+                }
+            }
+            const IndexType mid = begin + (end - begin)/2;
+            std::nth_element(perm.begin()+begin, perm.begin()+mid, perm.begin()+end,
+            [&](IndexType a, IndexType b) {
+                const ValueType coordA = centers[a*dim+splitDim];
+                const ValueType coordB = centers[b*dim+splitDim];
+                return coordA < coordB || (coordA == coordB && a < b);
+            });
+
+            const IndexType left = buildNode(centers, begin, mid);
+            const IndexType right = buildNode(centers, mid, end);
+            nodeLeft[node] = left;
+            nodeRight[node] = right;
+        }
+
+        return node;
+    }
+
+    ValueType lowerBound(const IndexType node, const ValueType* point, const ValueType* pointWeights) const {
+        ValueType sqDist = 0;
+        for (IndexType d = 0; d < dim; d++) {
+            const ValueType diff = std::max({boxMin[node*dim+d] - point[d], point[d] - boxMax[node*dim+d], ValueType(0)});
+            sqDist += diff*diff;
+        }
+
+        ValueType influenceEffect = 0;
+        for (IndexType w = 0; w < numWeights; w++) {
+            influenceEffect += minInfluence[node*numWeights+w]*pointWeights[w];
+        }
+
+        return sqDist*influenceEffect;
+    }
+
+    static const IndexType leafSize = 8;
+
+    IndexType dim = 0;
+    IndexType numWeights = 0;
+    std::vector<IndexType> perm;            ///< the center IDs, node n covers perm[nodeBegin[n]] to perm[nodeEnd[n]-1]
+    std::vector<IndexType> roots;           ///< the root node of every father block, -1 if it has no centers
+    std::vector<IndexType> nodeBegin;
+    std::vector<IndexType> nodeEnd;
+    std::vector<IndexType> nodeLeft;        ///< -1 for leaves
+    std::vector<IndexType> nodeRight;
+    std::vector<ValueType> boxMin;          ///< boxMin[n*dim+d], the bounding box of the centers of node n
+    std::vector<ValueType> boxMax;
+    std::vector<ValueType> minInfluence;    ///< minInfluence[n*numWeights+w], the smallest influence of the centers of node n
+};
+
+} /* namespace ITI */
@@ -6,12 +6,14 @@
  */
 
 #include "FileIO.h"
+#include "Telemetry.h"
 #include "quadtree/QuadTreeCartesianEuclid.h"
 
 #include <scai/lama.hpp>
 #include <scai/lama/matrix/all.hpp>
 #include <scai/lama/Vector.hpp>
 #include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/dmemo/mpi/MPICommunicator.hpp>
 #include <scai/common/Math.hpp>
 #include <scai/common/Settings.hpp>
 #include <scai/lama/storage/MatrixStorage.hpp>
@@ -25,6 +27,8 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstring>
 #include <iterator>
 #include <map>
 #include <tuple>
@@ -140,6 +144,61 @@ void FileIO<IndexType, ValueType>::writeGraphDistributed (const CSRSparseMatrix<
 
 //-------------------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+void FileIO<IndexType, ValueType>::writeGraphParallel (const CSRSparseMatrix<ValueType> &adjM, const std::string filename, const bool edgeWeights) {
+    SCAI_REGION("FileIO.writeGraphParallel")
+
+    const scai::dmemo::CommunicatorPtr comm = adjM.getRowDistributionPtr()->getCommunicatorPtr();
+    const IndexType globalN = adjM.getNumRows();
+
+    // the rows of every PE must be consecutive and in the order of the ranks
+    const scai::dmemo::DistributionPtr blockDist(new scai::dmemo::BlockDistribution( globalN, comm ));
+    const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution( adjM.getNumColumns() ));
+
+    CSRSparseMatrix<ValueType> maybeCopy;
+    const bool needsCopy = !adjM.getRowDistributionPtr()->isEqual(*blockDist) or !adjM.getColDistributionPtr()->isReplicated();
+    if (needsCopy) {
+        maybeCopy = adjM;
+        maybeCopy.redistribute( blockDist, noDist );
+    }
+    const CSRSparseMatrix<ValueType>& blockGraph = needsCopy ? maybeCopy : adjM;
+
+    // every PE formats its rows into a local buffer
+    std::ostringstream localText;
+    if (edgeWeights) {
+        localText.precision(15);
+    }
+
+    if (comm->getRank() == 0) {
+        // first line is number of nodes and edges
+        localText << blockGraph.getNumColumns() << " " << blockGraph.getNumValues()/2;
+        if (edgeWeights) {
+            localText << " 001";
+        }
+        localText << "\n";
+    }
+
+    const CSRStorage<ValueType>& localStorage = blockGraph.getLocalStorage();
+    const scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+    const scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+    const scai::hmemo::ReadAccess<ValueType> values(localStorage.getValues());
+
+    for (IndexType i = 0; i < ia.size()-1; i++) {
+        for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+            localText << ja[j]+1 << " ";
+            if (edgeWeights) {
+                localText << values[j] << " ";
+            }
+        }
+        localText << "\n";
+    }
+
+    const std::string localData = localText.str();
+    writeCollective( filename, localData.data(), localData.size(), comm );
+}
+
+//-------------------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>
 void FileIO<IndexType, ValueType>::writeVTKCentral (const CSRSparseMatrix<ValueType> &adjM, const std::vector<DenseVector<ValueType>> &coords, const DenseVector<IndexType> &part, const std::string filename) {
     SCAI_REGION( "FileIO.writeVTKCentral" )
@@ -239,6 +298,7 @@ void FileIO<IndexType, ValueType>::writeCoords (const std::vector<DenseVector<Va
  */
 template<typename IndexType, typename ValueType>
 void FileIO<IndexType, ValueType>::writeCoordsParallel(const std::vector<DenseVector<ValueType>> &coords, const std::string outFilename) {
+    SCAI_REGION( "FileIO.writeCoordsParallel" );
 
     const IndexType dimension = coords.size();
 
@@ -246,55 +306,30 @@ void FileIO<IndexType, ValueType>::writeCoordsParallel(const std::vector<DenseVe
     const IndexType globalN = coordDist->getGlobalSize();
     const IndexType localN = coordDist->getLocalSize();
     const scai::dmemo::CommunicatorPtr comm = coords[0].getDistributionPtr()->getCommunicatorPtr();
-    const IndexType numPEs = comm->getSize();
 
     IndexType beginLocalRange, endLocalRange;
     scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, globalN, comm->getRank(), comm->getSize());
 
-    PRINT( *comm << ": "<< beginLocalRange << " - " << endLocalRange );
     SCAI_ASSERT_EQ_ERROR( localN, endLocalRange-beginLocalRange, "Local ranges do not agree");
 
     //
-    // copy coords to a local vector<vector>
+    // copy coords to a local buffer, the coordinates of every point are consecutive
     //
 
-    std::vector< std::vector<double>> localPartOfCoords( localN, std::vector<double>( dimension, 0.0) );
+    std::vector<double> localPartOfCoords( localN*dimension );
 
     for(IndexType d=0; d<dimension; d++) {
         scai::hmemo::ReadAccess<ValueType> localCoords( coords[d].getLocalValues() );
         for( IndexType i=0; i<localN; i++) {
-            localPartOfCoords[i][d] = localCoords[i];
+            localPartOfCoords[i*dimension+d] = localCoords[i];
         }
     }
 
     //
-    //  one PE at a time, write to file TODO: would seekp work?
+    //  all PEs write their part at once, at the offset given by the ranges before them
     //
 
-    std::ofstream outfile;
-
-    for(IndexType p=0; p<numPEs; p++) { // numPE rounds, in each round only one PE writes its part
-        if( comm->getRank()==p ) {
-            if( p==0 ) {
-                outfile.open(outFilename.c_str(), std::ios::binary | std::ios::out);
-            } else {
-                // if not the first PE then append to file
-                outfile.open(outFilename.c_str(), std::ios::binary | std::ios::app);
-            }
-
-            for( IndexType i=0; i<localN; i++) {
-                for( IndexType d=0; d<dimension; d++) {
-                    outfile.write( (char *)(&localPartOfCoords[i][d]), sizeof(double) );
-                }
-            }
-
-            SCAI_ASSERT_EQ_ERROR( outfile.tellp(), endLocalRange*dimension*sizeof(double), "While writing coordinates in parallel: Position in file " << outFilename << " is not correct." );
-
-            outfile.close();
-        }
-        comm->synchronize();
-    }
-
+    writeCollective( outFilename, reinterpret_cast<const char*>(localPartOfCoords.data()), localPartOfCoords.size()*sizeof(double), comm );
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -397,7 +432,7 @@ void FileIO<IndexType, ValueType>::writeInputParallel (const std::vector<DenseVe
 }
 
 //-------------------------------------------------------------------------------------------------
-//TODO: unit test
+
 template<typename IndexType, typename ValueType>
 void FileIO<IndexType, ValueType>::writePartitionParallel(const DenseVector<IndexType> &part, const std::string filename) {
     SCAI_REGION( "FileIO.writePartitionParallel" );
@@ -405,93 +440,152 @@ void FileIO<IndexType, ValueType>::writePartitionParallel(const DenseVector<Inde
     scai::dmemo::DistributionPtr dist = part.getDistributionPtr();
     const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
 
-    const IndexType localN = dist->getLocalSize();
     const IndexType globalN = dist->getGlobalSize();
-    const IndexType numPEs = comm->getSize();
-
-    scai::hmemo::ReadAccess<IndexType> localPart( part.getLocalValues() );
-    SCAI_ASSERT_EQ_ERROR( localPart.size(), localN, "Local sizes do not agree");
 
-    std::ofstream outfile;
+    // the file is in the order of the global indices, so the PEs need consecutive ranges
+    const scai::dmemo::DistributionPtr blockDist( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, globalN) );
+    const DenseVector<IndexType> partBlock = dist->isEqual(*blockDist) ? part : scai::lama::distribute<DenseVector<IndexType>>( part, blockDist );
+    const IndexType localN = blockDist->getLocalSize();
 
-    for(IndexType p=0; p<numPEs; p++) { // numPE rounds, in each round only one PE writes its part
-
-        if( comm->getRank()==p ) {
-            if( p==0 ) {
-                outfile.open(filename.c_str(), std::ios::binary | std::ios::out);
-                outfile << "% " << globalN << std::endl;    // the first line has a comment with the number of nodes
-            } else {
-                // if not the first PE then append to file
-                outfile.open(filename.c_str(), std::ios::binary | std::ios::app);
-            }
-            if( outfile.fail() ) {
-                throw std::runtime_error("Could not write to file " + filename);
-            }
-
-            //write local part
-            for( IndexType i=0; i<localN; i++) {
-                outfile << localPart[i] << std::endl;
-            }
+    scai::hmemo::ReadAccess<IndexType> localPart( partBlock.getLocalValues() );
+    SCAI_ASSERT_EQ_ERROR( localPart.size(), localN, "Local sizes do not agree");
 
-            outfile.close();
-            //PRINT("PE " << p << " wrote its part");
-        }
-        comm->synchronize();    //TODO: takes huge time here
+    // every PE formats its part into a local buffer, then all write at once
+    std::ostringstream localText;
+    if( comm->getRank()==0 ) {
+        localText << "% " << globalN << "\n";    // the first line has a comment with the number of nodes
+    }
+    for( IndexType i=0; i<localN; i++) {
+        localText << localPart[i] << "\n";
     }
+
+    const std::string localData = localText.str();
+    writeCollective( filename, localData.data(), localData.size(), comm );
 }
 //-------------------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
 template<typename T>
-void FileIO<IndexType, ValueType>::writeDenseVectorParallel(const DenseVector<T> &dv, const std::string filename) {
+void FileIO<IndexType, ValueType>::writeDenseVectorParallel(const DenseVector<T> &dv, const std::string filename, const bool binary) {
     SCAI_REGION( "FileIO.writeDenseVectorParallel" );
 
     scai::dmemo::CommunicatorPtr comm = dv.getDistributionPtr()->getCommunicatorPtr();
 
     const IndexType globalN =dv.size();
-    const IndexType numPEs = comm->getSize();
 
-    const scai::dmemo::Distribution blockDist( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, globalN) );
+    const scai::dmemo::DistributionPtr blockDist( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, globalN) );
 
     // create a copy of the input and distribute with a block distribution
-    const scai::lama::DenseVector<T> dvBlock( dv, blockDist);
+    const scai::lama::DenseVector<T> dvBlock = scai::lama::distribute<scai::lama::DenseVector<T>>( dv, blockDist );
 
-    const IndexType localN = blockDist.getLocalSize();
+    const IndexType localN = blockDist->getLocalSize();
 
-    scai::hmemo::ReadAccess<IndexType> localPart( dvBlock.getLocalValues() );
+    scai::hmemo::ReadAccess<T> localPart( dvBlock.getLocalValues() );
     SCAI_ASSERT_EQ_ERROR( localPart.size(), localN, "Local sizes do not agree");
 
-    std::ofstream outfile;
+    if( binary ) {
+        writeCollective( filename, reinterpret_cast<const char*>(localPart.get()), localN*sizeof(T), comm );
+    } else {
+        std::ostringstream localText;
+        for( IndexType i=0; i<localN; i++) {
+            localText << localPart[i] << "\n";
+        }
+        const std::string localData = localText.str();
+        writeCollective( filename, localData.data(), localData.size(), comm );
+    }
+}
+//-------------------------------------------------------------------------------------------------
 
-    comm->synchronize();
+template<typename IndexType, typename ValueType>
+void FileIO<IndexType, ValueType>::writeCollective(const std::string filename, const char* localData, const std::size_t localBytes, const scai::dmemo::CommunicatorPtr comm) {
+    // MPI counts are of type int, large local parts are written in several collective calls
+    writeCollectiveChunks( filename, localBytes, std::size_t(1) << 30, [localData](std::size_t begin, std::size_t) {
+        return localData + begin;
+    }, comm );
+}
+//-------------------------------------------------------------------------------------------------
 
-    for(IndexType p=0; p<numPEs; p++) { // numPE rounds, in each round only one PE writes its part
-        if( comm->getRank()==p ) {
-            if( p==0 ) {
-                outfile.open(filename.c_str(), std::ios::binary | std::ios::out);
-            } else {
-                // if not the first PE then append to file
-                outfile.open(filename.c_str(), std::ios::binary | std::ios::app);
-            }
-            if( outfile.fail() ) {
-                throw std::runtime_error("Could not write to file " + filename);
-            }
+template<typename IndexType, typename ValueType>
+void FileIO<IndexType, ValueType>::writeCollective(const std::string filename, std::istream& localData, const std::size_t localBytes, const scai::dmemo::CommunicatorPtr comm, const std::size_t chunkBytes) {
+    SCAI_ASSERT_GT_ERROR( chunkBytes, 0, "Chunks must not be empty" );
+    SCAI_ASSERT_LE_ERROR( chunkBytes, std::size_t(INT_MAX), "MPI counts are of type int" );
 
-            for( IndexType i=0; i<localN; i++) {
-                outfile << localPart[i] << std::endl;
-            }
+    std::vector<char> buffer( std::min(localBytes, chunkBytes) );
+    bool readFailed = false;
+    writeCollectiveChunks( filename, localBytes, chunkBytes, [&](std::size_t, std::size_t count) {
+        localData.read( buffer.data(), count );
+        readFailed = readFailed or localData.gcount() != std::streamsize(count);
+        return buffer.data();
+    }, comm );
 
-            // because of the block distribution, the last PE maybe has less local values
-            if( p==numPEs-1 ) {
-                SCAI_ASSERT_EQ_ERROR( outfile.tellp(), globalN, "While writing DenseVector in parallel: Position in file " << filename << " is not correct." );
-            } else {
-                SCAI_ASSERT_EQ_ERROR( outfile.tellp(), localN*(comm->getRank()+1), "While writing DenseVector in parallel: Position in file " << filename << " is not correct for processor " << comm->getRank() );
-            }
+    if( comm->max( IndexType(readFailed) ) > 0 ) {
+        throw std::runtime_error("Could not read the local data for file " + filename);
+    }
+}
+//-------------------------------------------------------------------------------------------------
 
-            //PRINT("PE " << p << " wrote its part");
-            outfile.close();
+template<typename IndexType, typename ValueType>
+void FileIO<IndexType, ValueType>::writeCollectiveChunks(const std::string filename, const std::size_t localBytes, const std::size_t chunkBytes, const std::function<const char*(std::size_t, std::size_t)>& getChunk, const scai::dmemo::CommunicatorPtr comm) {
+    SCAI_REGION( "FileIO.writeCollective" );
+    Telemetry::ScopedTimer telemetryTimer("writeFile");
+    Telemetry::count("bytesWritten", localBytes);
+
+    if( comm->getType()!=scai::dmemo::CommunicatorType::MPI ) {
+        SCAI_ASSERT_EQ_ERROR( comm->getSize(), 1, "Collective writing needs an MPI communicator" );
+        std::ofstream outfile(filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+        if( outfile.fail() ) {
+            throw std::runtime_error("Could not write to file " + filename);
         }
-        comm->synchronize();    //TODO: takes huge time here
+        for( std::size_t written=0; written<localBytes; written+=chunkBytes ) {
+            const std::size_t count = std::min( chunkBytes, localBytes - written );
+            outfile.write( getChunk(written, count), count );
+        }
+        return;
+    }
+
+    const MPI_Comm mpiComm = static_cast<const scai::dmemo::MPICommunicator&>( *comm ).getMPIComm();
+
+    // the file offset of every PE is the exclusive prefix sum of the byte counts
+    unsigned long long localCount = localBytes;
+    unsigned long long offset = 0;
+    MPI_Exscan( &localCount, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, mpiComm );
+    if( comm->getRank()==0 ) {
+        offset = 0; // the result of MPI_Exscan is undefined on the first rank
+    }
+
+    MPI_File fileHandle;
+    int error = MPI_File_open( mpiComm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fileHandle );
+    if( comm->max( IndexType(error!=MPI_SUCCESS) ) > 0 ) {
+        throw std::runtime_error("Could not write to file " + filename);
+    }
+
+    // an older file may be longer than the new content
+    error = MPI_File_set_size( fileHandle, 0 );
+    if( comm->max( IndexType(error!=MPI_SUCCESS) ) > 0 ) {
+        MPI_File_close( &fileHandle );
+        throw std::runtime_error("Could not truncate file " + filename);
+    }
+
+    const unsigned long long maxChunk = chunkBytes;
+    const IndexType numRounds = comm->max( IndexType( (localCount + maxChunk - 1)/maxChunk ) );
+    unsigned long long written = 0;
+
+    for( IndexType r=0; r<numRounds; r++ ) {
+        const int count = std::min( maxChunk, localCount - written );
+        // a PE that is done takes part in the collective call with an empty piece
+        const char* chunk = count > 0 ? getChunk(written, count) : nullptr;
+        MPI_Status status;
+        const int roundError = MPI_File_write_at_all( fileHandle, MPI_Offset(offset + written), chunk, count, MPI_CHAR, &status );
+        if( roundError!=MPI_SUCCESS ) {
+            error = roundError;
+        }
+        written += count;
+    }
+
+    MPI_File_close( &fileHandle );
+
+    if( comm->max( IndexType(error!=MPI_SUCCESS) ) > 0 ) {
+        throw std::runtime_error("Error while writing to file " + filename);
     }
 }
 //-------------------------------------------------------------------------------------------------
@@ -1511,6 +1605,64 @@ std::vector<DenseVector<ValueType>> FileIO<IndexType, ValueType>::readCoordsBina
 }
 //-------------------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+std::vector<std::vector<ValueType>> FileIO<IndexType, ValueType>::readCoordsBinaryRange( const std::string filename, const IndexType beginPoint, const IndexType endPoint, const IndexType dimension) {
+    SCAI_REGION( "FileIO.readCoordsBinaryRange" );
+
+    typedef unsigned long int UINT; // maybe IndexType is not big enough for file position
+
+    //same as in readCoordsBinary, always 3 coordinates per point are stored
+    const IndexType maxDimension = 3;
+
+    if( dimension>maxDimension ) {
+        throw std::runtime_error("Number of dimensions not supported.");
+    }
+    SCAI_ASSERT_LE_ERROR( beginPoint, endPoint, "Wrong range of points to read");
+
+    const IndexType rangeN = endPoint - beginPoint;
+    const UINT numValues = UINT(rangeN)*maxDimension;
+
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::in);
+    if(file.fail())
+        throw std::runtime_error("File "+ filename+ " failed.");
+
+    std::vector<double> rangeCoords(numValues);
+    const UINT startPos = UINT(beginPoint)*maxDimension*sizeof(double);
+    file.seekg(startPos);
+    file.read( (char *)(rangeCoords.data()), numValues*sizeof(double) );
+
+    if( UINT(file.gcount())!=numValues*sizeof(double) ) {
+        throw std::runtime_error("Unexpected end of binary coordinate file " + filename + " while reading points " + std::to_string(beginPoint) + " to " + std::to_string(endPoint));
+    }
+
+    std::vector<std::vector<ValueType>> coords(dimension, std::vector<ValueType>(rangeN));
+    for(IndexType i=0; i<rangeN; i++) {
+        for(IndexType dim=0; dim<dimension; dim++) {
+            coords[dim][i] = rangeCoords[i*maxDimension+dim];
+        }
+    }
+
+    return coords;
+}
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+IndexType FileIO<IndexType, ValueType>::getNumCoordsBinary( const std::string filename ) {
+    std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+    if(file.fail())
+        throw std::runtime_error("File "+ filename+ " failed.");
+
+    const unsigned long int fileSize = file.tellg();
+    const unsigned long int pointSize = 3*sizeof(double);
+
+    if( fileSize%pointSize!=0 ) {
+        throw std::runtime_error("Size of binary coordinate file " + filename + " is not a multiple of " + std::to_string(pointSize) + " bytes.");
+    }
+
+    return fileSize/pointSize;
+}
+//-------------------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>
 std::vector<DenseVector<ValueType>> FileIO<IndexType, ValueType>::readCoordsMatrixMarket ( const std::string filename, const scai::dmemo::CommunicatorPtr comm) {
     std::ifstream file(filename);
@@ -2401,4 +2553,9 @@ void FileIO<IndexType, ValueType>::trim(std::string &s) {
 template class FileIO<IndexType, double>;
 template class FileIO<IndexType, float>;
 
+template void FileIO<IndexType, double>::writeDenseVectorParallel<IndexType>(const DenseVector<IndexType> &dv, const std::string filename, const bool binary);
+template void FileIO<IndexType, double>::writeDenseVectorParallel<double>(const DenseVector<double> &dv, const std::string filename, const bool binary);
+template void FileIO<IndexType, float>::writeDenseVectorParallel<IndexType>(const DenseVector<IndexType> &dv, const std::string filename, const bool binary);
+template void FileIO<IndexType, float>::writeDenseVectorParallel<float>(const DenseVector<float> &dv, const std::string filename, const bool binary);
+
 } /* namespace ITI */
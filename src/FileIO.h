@@ -19,6 +19,8 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <functional>
+#include <istream>
 #include <sys/stat.h>
 
 namespace ITI {
@@ -66,6 +68,15 @@ public:
      */
     static void writeGraphDistributed (const CSRSparseMatrix<ValueType> &adjM, const std::string filename);
 
+    /** Given an adjacency matrix and a filename writes the matrix in one file using the METIS format, like writeGraph.
+     * Every PE formats its rows locally and all PEs write at the same time with collective MPI-IO,
+     * so the graph is never gathered on one PE.
+     * @param[in] adjM The graph's adjacency matrix; if it is not block distributed, a block distributed copy is written.
+     * @param[in] filename The file's name to write to.
+     * @param[in] edgeWeights If true, the edge weights are written after every neighbor.
+     */
+    static void writeGraphParallel (const CSRSparseMatrix<ValueType> &adjM, const std::string filename, const bool edgeWeights = false);
+
     /** @brief Write graph and partition into a .vtk file; this can be opened by paraview.
      *
      * @param[in] adjM The graph with N vertices given as an NxN adjacency matrix.
@@ -86,9 +97,9 @@ public:
     */
     static void writeCoords (const std::vector<DenseVector<ValueType>> &coordinates, const std::string filename);
 
-    /** Given the vector of the coordinates and their dimension, writes them in file "filename".
-     * One by one the processors open the file and each PE writes its local part of the coordinates.
-     * Every line holds the coordinates of one point.
+    /** Given the vector of the coordinates and their dimension, writes them in the binary file "filename",
+     * in the format read by readCoordsBinary. All PEs write their local part at once with collective MPI-IO.
+     * The coordinates must have a block distribution.
      *
      * @param[in] coordinates The coordinates of the points.
      * @param[in] filename The file's name to write to
@@ -116,7 +127,9 @@ public:
     static void writeInputParallel (const std::vector<DenseVector<ValueType>> &coords,const scai::lama::DenseVector<ValueType> nodeWeights, const std::string filename);
 
 
-    /** Write a (possibly distributed) dense vector in a file. Each PE takes its turn and writes its local data to the file.
+    /** Write a (possibly distributed) partition in a file, one block ID per line after a comment line with the number of nodes.
+    Any distribution is allowed, the values are moved to a block distribution first if necessary. Every PE formats its part locally
+    and all PEs write at once with collective MPI-IO.
     @param[in] dv The dense vector to store.
     @param[] filename The file's name to write to.
     */
@@ -209,6 +222,23 @@ public:
     */
     static std::vector<DenseVector<ValueType>> readCoordsBinary( const std::string filename, const IndexType numberOfCoords, const IndexType dimension, const scai::dmemo::CommunicatorPtr comm);
 
+    /** @brief Read the coordinates of a consecutive range of points from a binary file, same format as in readCoordsBinary.
+     * The result is not distributed, every PE can read any range. This is used to read files that do not fit into memory in chunks.
+
+     * @param[in] filename The name of the file to read the coordinates from.
+     * @param[in] beginPoint The index of the first point to read.
+     * @param[in] endPoint The index after the last point to read.
+     * @param[in] dimension The dimension of the points
+     *
+     * @return The coordinates of the range. ret.size()=dimension, ret[i].size()=endPoint-beginPoint
+    */
+    static std::vector<std::vector<ValueType>> readCoordsBinaryRange( const std::string filename, const IndexType beginPoint, const IndexType endPoint, const IndexType dimension);
+
+    /** @brief The number of points stored in a binary coordinates file as written by writeCoordsParallel.
+     * The number is deduced from the file size, the file is not read.
+     */
+    static IndexType getNumCoordsBinary( const std::string filename );
+
 
     /** @brief  Read coordinates in Ocean format of Vadym Aizinger.
      */
@@ -327,6 +357,19 @@ public:
      */
     static bool fileExists(const std::string& filename);
 
+    /**
+     * Write the local data of every PE into one file, in the order of the ranks, with collective MPI-IO.
+     * The offset of a PE is the exclusive prefix sum of the byte counts of the PEs before it.
+     * Without MPI, the only PE writes the file directly.
+     */
+    static void writeCollective(const std::string filename, const char* localData, const std::size_t localBytes, const scai::dmemo::CommunicatorPtr comm);
+
+    /**
+     * As above, but the \p localBytes bytes of every PE are read from \p localData in pieces of at most \p chunkBytes,
+     * so the local data does not have to fit into memory.
+     */
+    static void writeCollective(const std::string filename, std::istream& localData, const std::size_t localBytes, const scai::dmemo::CommunicatorPtr comm, const std::size_t chunkBytes = std::size_t(1) << 26);
+
 private:
     /**
      * given the central coordinates of a cell and its level, compute the bounding corners
@@ -345,10 +388,17 @@ private:
     static std::vector<DenseVector<ValueType>> readCoordsMatrixMarket ( const std::string filename, const scai::dmemo::CommunicatorPtr comm);
 
     /**
-     * Write a DenseVector in parallel in the filename. Each PE, one after another, write its own part.
+     * Write a DenseVector in parallel in the filename. The vector is block distributed and all PEs write their part at once.
+     * In text format every line holds one value; in binary format the values are stored as raw T, without a header.
      */
     template<typename T>
-    static void writeDenseVectorParallel(const DenseVector<T> &dv, const std::string filename);
+    static void writeDenseVectorParallel(const DenseVector<T> &dv, const std::string filename, const bool binary = false);
+
+    /**
+     * The implementation of writeCollective. \p getChunk(begin, count) returns a pointer to the local bytes [begin, begin+count),
+     * it is called in increasing order with count at most \p chunkBytes.
+     */
+    static void writeCollectiveChunks(const std::string filename, const std::size_t localBytes, const std::size_t chunkBytes, const std::function<const char*(std::size_t, std::size_t)>& getChunk, const scai::dmemo::CommunicatorPtr comm);
 
     static void ltrim(std::string &s);
 
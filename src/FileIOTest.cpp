@@ -144,6 +144,64 @@ TYPED_TEST(FileIOTest, testReadAndWriteGraphFromFile) {
 }
 //-----------------------------------------------------------------
 
+TYPED_TEST(FileIOTest, testWriteGraphAndPartitionParallel) {
+    using ValueType = TypeParam;
+
+    std::string file = FileIOTest<ValueType>::graphPath + "delaunayTest.graph";
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file, comm);
+    const IndexType N = graph.getNumRows();
+
+    // every PE writes its rows at the same time into one file
+    std::string fileTo = file + "_parallel.graph";
+    FileIO<IndexType, ValueType>::writeGraphParallel( graph, fileTo );
+
+    CSRSparseMatrix<ValueType> graph2 = FileIO<IndexType, ValueType>::readGraph(fileTo, comm);
+    ASSERT_EQ( graph.getNumRows(), graph2.getNumRows() );
+    ASSERT_TRUE( graph.getRowDistribution().isEqual(graph2.getRowDistribution()) );
+    EXPECT_EQ( graph.getNumValues(), graph2.getNumValues() );
+
+    {
+        const CSRStorage<ValueType>& localStorage = graph.getLocalStorage();
+        const CSRStorage<ValueType>& localStorage2 = graph2.getLocalStorage();
+        scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+        scai::hmemo::ReadAccess<IndexType> ia2(localStorage2.getIA());
+        scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+        scai::hmemo::ReadAccess<IndexType> ja2(localStorage2.getJA());
+        ASSERT_EQ( ia.size(), ia2.size() );
+        ASSERT_EQ( ja.size(), ja2.size() );
+        for (IndexType i = 0; i < ia.size(); i++) {
+            EXPECT_EQ( ia[i], ia2[i] );
+        }
+        for (IndexType j = 0; j < ja.size(); j++) {
+            EXPECT_EQ( ja[j], ja2[j] );
+        }
+    }
+
+    // a partition is written in the order of the global indices, with the block distribution of the graph
+    // and with a cyclic distribution, where the local indices of a PE are not consecutive
+    scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    scai::dmemo::DistributionPtr cyclicDist( scai::dmemo::Distribution::getDistributionPtr( "CYCLIC", dist->getCommunicatorPtr(), N) );
+
+    for (scai::dmemo::DistributionPtr partDist : {dist, cyclicDist}) {
+        DenseVector<IndexType> partition( partDist, 0 );
+        for (IndexType i = 0; i < partDist->getLocalSize(); i++) {
+            partition.getLocalValues()[i] = partDist->local2Global(i) % 7;
+        }
+
+        std::string partFile = file + "_parallel.part";
+        FileIO<IndexType, ValueType>::writePartitionParallel( partition, partFile );
+
+        DenseVector<IndexType> partition2 = FileIO<IndexType, ValueType>::readPartition( partFile, N );
+        ASSERT_TRUE( partition2.getDistributionPtr()->isEqual(*dist) );
+        for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+            EXPECT_EQ( partition2.getLocalValues()[i], dist->local2Global(i) % 7 );
+        }
+    }
+}
+//-----------------------------------------------------------------
+
 TYPED_TEST(FileIOTest, testWriteGraphWithEdgeWeights) {
     using ValueType = TypeParam;
     const IndexType N = 10;
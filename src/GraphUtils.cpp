@@ -9,6 +9,8 @@
 #include <queue>
 #include <unordered_set>
 #include <chrono>
+#include <cstdint>
+#include <numeric>
 
 #include <scai/dmemo/mpi/MPICommunicator.hpp>
 #include <scai/hmemo/ReadAccess.hpp>
@@ -19,7 +21,6 @@
 #include <scai/lama/matrix/DIASparseMatrix.hpp>
 
 #include <scai/tracing.hpp>
-#include <JanusSort.hpp>
 
 #include "GraphUtils.h"
 
@@ -331,6 +332,7 @@ ValueType GraphUtils<IndexType,ValueType>::computeCut(const CSRSparseMatrix<Valu
     partHalo.updateHalo( haloData, localData, partDist->getCommunicator() );
 
     ValueType result = 0;
+    #pragma omp parallel for reduction(+:result) schedule(static)
     for (IndexType i = 0; i < localN; i++) {
         const IndexType beginCols = ia[i];
         const IndexType endCols = ia[i+1];
@@ -439,11 +441,20 @@ ValueType GraphUtils<IndexType,ValueType>::computeImbalance(
 
     //calculate weight of each block and global weight sum
     ValueType weightSum = 0.0;
-    for (IndexType i = 0; i < localN; i++) {
-        IndexType partID = localPart[i];
-        ValueType weight = weighted ? localWeight[i] : 1;
-        subsetSizes[partID] += weight;
-        weightSum += weight;
+    #pragma omp parallel reduction(+:weightSum)
+    {
+        std::vector<ValueType> threadSubsetSizes(k, 0.0);
+        #pragma omp for schedule(static)
+        for (IndexType i = 0; i < localN; i++) {
+            IndexType partID = localPart[i];
+            ValueType weight = weighted ? localWeight[i] : 1;
+            threadSubsetSizes[partID] += weight;
+            weightSum += weight;
+        }
+        #pragma omp critical
+        for (IndexType b = 0; b < k; b++) {
+            subsetSizes[b] += threadSubsetSizes[b];
+        }
     }
 
     std::vector<ValueType> globalSubsetSizes(k);
@@ -813,35 +824,55 @@ std::vector<IndexType> GraphUtils<IndexType, ValueType>::computeCommVolume( cons
     auto haloData = partHalo.updateHaloF( localPart, dist->getCommunicator() );
     auto rHaloData = scai::hmemo::hostReadAccess( haloData );
 
-    for(IndexType i=0; i<localN; i++) {   // for all local nodes
-        IndexType thisBlock = localPart[i];
-        SCAI_ASSERT_LE_ERROR( thisBlock, numBlocks, "Wrong block id." );
-        std::set<IndexType> allNeighborBlocks;
-
-        for(IndexType j=ia[i]; j<ia[i+1]; j++) {      // for all the edges of a node
-            IndexType neighbor = ja[j];
-            IndexType neighborBlock;
-            if (dist->isLocal(neighbor)) {
-                neighborBlock = partAccess[dist->global2Local(neighbor)];
-            } else {
-                neighborBlock = rHaloData[partHalo.global2Halo(neighbor)];
-            }
-            SCAI_ASSERT_LE_ERROR( neighborBlock, numBlocks, "Wrong block id." );
+    // check the block ids before the parallel region, exceptions must not leave it
+    for(IndexType i=0; i<localN; i++) {
+        SCAI_ASSERT_LT_ERROR( partAccess[i], numBlocks, "Wrong block id." );
+        SCAI_ASSERT_GE_ERROR( partAccess[i], 0, "Wrong block id." );
+    }
+    for(IndexType h=0; h<rHaloData.size(); h++) {
+        SCAI_ASSERT_LT_ERROR( rHaloData[h], numBlocks, "Wrong block id." );
+        SCAI_ASSERT_GE_ERROR( rHaloData[h], 0, "Wrong block id." );
+    }
 
-            // found a neighbor that belongs to a different block
-            if (thisBlock != neighborBlock) {
+    #pragma omp parallel
+    {
+        // every thread counts into its own vector, added up at the end
+        std::vector<IndexType> threadCommVolume( numBlocks, 0 );
 
-                typename std::set<IndexType>::iterator it = allNeighborBlocks.find( neighborBlock );
+        #pragma omp for schedule(static)
+        for(IndexType i=0; i<localN; i++) {   // for all local nodes
+            IndexType thisBlock = partAccess[i];
+            std::set<IndexType> allNeighborBlocks;
 
-                if( it==allNeighborBlocks.end() ) {  // this block has not been encountered before
-                    allNeighborBlocks.insert( neighborBlock );
-                    commVolumePerBlock[thisBlock]++;   //increase volume
+            for(IndexType j=ia[i]; j<ia[i+1]; j++) {      // for all the edges of a node
+                IndexType neighbor = ja[j];
+                IndexType neighborBlock;
+                if (dist->isLocal(neighbor)) {
+                    neighborBlock = partAccess[dist->global2Local(neighbor)];
                 } else {
-                    // if neighnor belongs to a different block but we have already found another neighbor
-                    // from that block, then do not increase volume
+                    neighborBlock = rHaloData[partHalo.global2Halo(neighbor)];
+                }
+
+                // found a neighbor that belongs to a different block
+                if (thisBlock != neighborBlock) {
+
+                    typename std::set<IndexType>::iterator it = allNeighborBlocks.find( neighborBlock );
+
+                    if( it==allNeighborBlocks.end() ) {  // this block has not been encountered before
+                        allNeighborBlocks.insert( neighborBlock );
+                        threadCommVolume[thisBlock]++;   //increase volume
+                    } else {
+                        // if neighnor belongs to a different block but we have already found another neighbor
+                        // from that block, then do not increase volume
+                    }
                 }
             }
         }
+
+        #pragma omp critical
+        for(IndexType b=0; b<numBlocks; b++) {
+            commVolumePerBlock[b] += threadCommVolume[b];
+        }
     }
 
     // sum local volume
@@ -898,43 +929,67 @@ std::tuple<std::vector<IndexType>, std::vector<IndexType>, std::vector<IndexType
     auto haloData = partHalo.updateHaloF( localPart, dist->getCommunicator() );
     auto rHaloData = scai::hmemo::hostReadAccess( haloData );
 
-    for(IndexType i=0; i<localN; i++) {   // for all local nodes
-        IndexType thisBlock = localPart[i];
-        SCAI_ASSERT_LT_ERROR( thisBlock, numBlocks, "Wrong block id." );
-        bool isBorderNode = false;
-        std::set<IndexType> allNeighborBlocks;
+    // check the block ids before the parallel region, exceptions must not leave it
+    for(IndexType i=0; i<localN; i++) {
+        SCAI_ASSERT_LT_ERROR( partAccess[i], numBlocks, "Wrong block id." );
+        SCAI_ASSERT_GE_ERROR( partAccess[i], 0, "Wrong block id." );
+    }
+    for(IndexType h=0; h<rHaloData.size(); h++) {
+        SCAI_ASSERT_LT_ERROR( rHaloData[h], numBlocks, "Wrong block id." );
+        SCAI_ASSERT_GE_ERROR( rHaloData[h], 0, "Wrong block id." );
+    }
 
-        for(IndexType j=ia[i]; j<ia[i+1]; j++) {       // for all the edges of a node
-            IndexType neighbor = ja[j];
-            IndexType neighborBlock;
-            if (dist->isLocal(neighbor)) {
-                neighborBlock = partAccess[dist->global2Local(neighbor)];
-            } else {
-                neighborBlock = rHaloData[partHalo.global2Halo(neighbor)];
-            }
-            SCAI_ASSERT_LT_ERROR( neighborBlock, numBlocks, "Wrong block id." );
+    #pragma omp parallel
+    {
+        // every thread counts into its own vectors, added up at the end
+        std::vector<IndexType> threadCommVolume( numBlocks, 0 );
+        std::vector<IndexType> threadBorderNodes( numBlocks, 0 );
+        std::vector<IndexType> threadInnerNodes( numBlocks, 0 );
 
-            // found a neighbor that belongs to a different block
-            if (thisBlock != neighborBlock) {
-                if( not isBorderNode) {
-                    borderNodesPerBlock[thisBlock]++;   //increase number of border nodes found
-                    isBorderNode = true;
+        #pragma omp for schedule(static)
+        for(IndexType i=0; i<localN; i++) {   // for all local nodes
+            IndexType thisBlock = partAccess[i];
+            bool isBorderNode = false;
+            std::set<IndexType> allNeighborBlocks;
+
+            for(IndexType j=ia[i]; j<ia[i+1]; j++) {       // for all the edges of a node
+                IndexType neighbor = ja[j];
+                IndexType neighborBlock;
+                if (dist->isLocal(neighbor)) {
+                    neighborBlock = partAccess[dist->global2Local(neighbor)];
+                } else {
+                    neighborBlock = rHaloData[partHalo.global2Halo(neighbor)];
                 }
 
-                typename std::set<IndexType>::iterator it = allNeighborBlocks.find( neighborBlock );
+                // found a neighbor that belongs to a different block
+                if (thisBlock != neighborBlock) {
+                    if( not isBorderNode) {
+                        threadBorderNodes[thisBlock]++;   //increase number of border nodes found
+                        isBorderNode = true;
+                    }
 
-                if( it==allNeighborBlocks.end() ) {  // this block has not been encountered before
-                    allNeighborBlocks.insert( neighborBlock );
-                    commVolumePerBlock[thisBlock]++;   //increase volume
-                } else {
-                    // if neighnor belongs to a different block but we have already found another neighbor
-                    // from that block, then do not increase volume
+                    typename std::set<IndexType>::iterator it = allNeighborBlocks.find( neighborBlock );
+
+                    if( it==allNeighborBlocks.end() ) {  // this block has not been encountered before
+                        allNeighborBlocks.insert( neighborBlock );
+                        threadCommVolume[thisBlock]++;   //increase volume
+                    } else {
+                        // if neighnor belongs to a different block but we have already found another neighbor
+                        // from that block, then do not increase volume
+                    }
                 }
             }
+            //if all neighbors are in the same block then this is an inner node
+            if( !isBorderNode ) {
+                threadInnerNodes[thisBlock]++;
+            }
         }
-        //if all neighbors are in the same block then this is an inner node
-        if( !isBorderNode ) {
-            innerNodesPerBlock[thisBlock]++;
+
+        #pragma omp critical
+        for(IndexType b=0; b<numBlocks; b++) {
+            commVolumePerBlock[b] += threadCommVolume[b];
+            borderNodesPerBlock[b] += threadBorderNodes[b];
+            innerNodesPerBlock[b] += threadInnerNodes[b];
         }
     }
 
@@ -1422,271 +1477,155 @@ scai::lama::CSRSparseMatrix<ValueType> GraphUtils<IndexType, ValueType>::getCSRm
 
 template<typename IndexType, typename ValueType>
 scai::lama::CSRSparseMatrix<ValueType> GraphUtils<IndexType, ValueType>::edgeList2CSR( std::vector< std::pair<IndexType, IndexType>> &edgeList, const scai::dmemo::CommunicatorPtr comm ) {
+    SCAI_REGION( "GraphUtils.edgeList2CSR" )
 
-    const IndexType thisPE = comm->getRank();
-    IndexType localM = edgeList.size();
-
-    //Cannot use this, getMPIDatatype() does not work. Look into RBC/SortingDataType.hpp
-    //typedef std::pair<int,int> int_pair;
-
-    int typesize;
-    MPI_Type_size(MPI_2INT, &typesize);
-    //SCAI_ASSERT_EQ_ERROR(typesize, sizeof(int_pair), "Wrong size"); //not valid for int_double, presumably due to padding
-
-    //-------------------------------------------------------------------
-    //
-    // add edges to the local_pairs vector for sorting
-    //
-
-    //TODO: not filling with dummy values, each localPairs can have different sizes
-    std::vector<int_pair> localPairs(localM*2);
-
-    // duplicate and reverse all edges before sorting to ensure matrix will be symmetric
-    // TODO: any better way to avoid edge duplication?
-
-    IndexType maxLocalVertex=0;
-    IndexType minLocalVertex=std::numeric_limits<IndexType>::max();
-
-    for(IndexType i=0; i<localM; i++) {
-        IndexType v1 = edgeList[i].first;
-        IndexType v2 = edgeList[i].second;
-        localPairs[2*i].first = v1;
-        localPairs[2*i].second = v2;
-
-        //insert also reversed edge to keep matrix symmetric
-        localPairs[2*i+1].first = v2;
-        localPairs[2*i+1].second = v1;
-
-        IndexType minV = std::min(v1,v2);
-        IndexType maxV = std::max(v1,v2);
-
-        if( minV<minLocalVertex ) {
-            minLocalVertex = minV;
-        }
-        if( maxV>maxLocalVertex ) {
-            maxLocalVertex = maxV;
-        }
-    }
-    //PRINT(thisPE << ": vertices range from "<< minLocalVertex << " to " << maxLocalVertex);
-
-    const IndexType N = comm->max( maxLocalVertex );
-    localM *=2 ;	// for the duplicated edges
-
-    //
-    // globally sort edges
-    //
-    std::chrono::time_point<std::chrono::steady_clock> beforeSort =  std::chrono::steady_clock::now();
-    MPI_Comm mpi_comm = MPI_COMM_WORLD;
-
-    // as MPI communicator might have been splitted, take the one used by comm
-    if ( comm->getType() == scai::dmemo::CommunicatorType::MPI ){
-        const auto& mpiComm = static_cast<const scai::dmemo::MPICommunicator&>( *comm );
-        mpi_comm = mpiComm.getMPIComm();
-    }
-
-    JanusSort::sort(mpi_comm, localPairs, MPI_2INT);
-
-    std::chrono::duration<double> sortTmpTime = std::chrono::steady_clock::now() - beforeSort;
-    ValueType sortTime = comm->max( sortTmpTime.count() );
-    PRINT0("time to sort edges: " << sortTime);
+    const IndexType numPEs = comm->getSize();
+    const IndexType localM = edgeList.size();
 
-    //check for isolated nodes and wrong conversions
-    IndexType lastNode = localPairs[0].first;
-    for (int_pair edge : localPairs) {
-        //TODO: should we allow isolated vertices? (see also below)
-        //not necessarilly an error
-        SCAI_ASSERT_LE_ERROR(edge.first, lastNode + 1, "Gap in sorted node IDs before edge exchange in PE " << comm->getRank() );
-        //if( edge.first>lastNode+1 /* and settings.verbose */ ){
-        //	std::cout<< "WARNING, node " << lastNode+1 << " has no edges" << std::endl;
-        //}
-        lastNode = edge.first;
+    IndexType maxLocalVertex = 0;
+    for (const std::pair<IndexType, IndexType>& edge : edgeList) {
+        SCAI_ASSERT_GE_ERROR( std::min(edge.first, edge.second), 0, "Negative vertex ID" );
+        maxLocalVertex = std::max(maxLocalVertex, std::max(edge.first, edge.second));
     }
+    const IndexType globalN = comm->max( maxLocalVertex ) + 1;
 
-
-    //PRINT(thisPE << ": "<< localPairs.back().first << " - " << localPairs.back().second << " in total " <<  localPairs.size() );
-
-    //-------------------------------------------------------------------
     //
-    // communicate so each PE have all the edges of the last node
-    // each PE just collect the edges of it last node and sends them to its +1 neighbor
+    // every edge goes to the owners of both of its vertices under a block distribution,
+    // the reversed edge keeps the matrix symmetric
     //
+    const scai::dmemo::DistributionPtr blockDist( new scai::dmemo::BlockDistribution(globalN, comm) );
 
-    // get vertex with max local id
-    IndexType newMaxLocalVertex = localPairs.back().first;
-
-    //TODO: communicate first to see if you need to send. now, just send to your +1 the your last vertex
-    // store the edges you must send
-    std::vector<IndexType> sendEdgeList;
-
-    IndexType numEdgesToRemove = 0;
-    for( std::vector<int_pair>::reverse_iterator edgeIt = localPairs.rbegin(); edgeIt->first==newMaxLocalVertex; ++edgeIt) {
-        sendEdgeList.push_back( edgeIt->first);
-        sendEdgeList.push_back( edgeIt->second);
-        ++numEdgesToRemove;
+    std::vector<IndexType> rangeBegin(numPEs+1);
+    for (IndexType p = 0; p < numPEs; p++) {
+        IndexType endRange;
+        scai::dmemo::BlockDistribution::getLocalRange(rangeBegin[p], endRange, globalN, p, numPEs);
     }
+    rangeBegin[numPEs] = globalN;
+    auto owner = [&rangeBegin](const IndexType v) -> IndexType {
+        return std::upper_bound(rangeBegin.begin(), rangeBegin.end(), v) - rangeBegin.begin() - 1;
+    };
 
-    if( thisPE!= comm->getSize()-1) {
-        for( int i=0; i<numEdgesToRemove; i++ ) {
-            localPairs.pop_back();
+    std::vector<IndexType> quantities(numPEs, 0);
+    std::vector<IndexType> sendEdges(4*localM);
+    {
+        SCAI_REGION( "GraphUtils.edgeList2CSR.prepareSend" )
+
+        //histogram pass, two entries per directed edge
+        std::vector<IndexType> edgeOwner(2*localM);
+        for (IndexType i = 0; i < localM; i++) {
+            edgeOwner[2*i] = owner(edgeList[i].first);
+            edgeOwner[2*i+1] = owner(edgeList[i].second);
+            quantities[edgeOwner[2*i]] += 2;
+            quantities[edgeOwner[2*i+1]] += 2;
         }
-    }
 
-    // make communication plan
-    std::vector<IndexType> quantities(comm->getSize(), 0);
-
-    if( thisPE==comm->getSize()-1 ) {	//the last PE will only receive
-        // do nothing, quantities is 0 for all
-    } else {
-        quantities[thisPE+1] = sendEdgeList.size();		// will only send to your +1 neighbor
-    }
-
-    scai::dmemo::CommunicationPlan sendPlan( quantities.data(), comm->getSize() );
-
-    PRINT0("allocated send plan");
-
-    scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
-
-    IndexType recvEdgesSize = recvPlan.totalQuantity();
-    SCAI_ASSERT_EQ_ERROR(recvEdgesSize % 2, 0, "List of received edges must have even length.");
-    scai::hmemo::HArray<IndexType> recvEdges(recvEdgesSize, -1);		// the edges to be received
-    //PRINT(thisPE <<": received  " << recvEdgesSize << " edges");
-
-    PRINT0("allocated communication plans");
-
-    {
-        scai::hmemo::WriteOnlyAccess<IndexType> recvVals( recvEdges, recvEdgesSize );
-        comm->exchangeByPlan( recvVals.get(), recvPlan, sendEdgeList.data(), sendPlan );
+        std::vector<IndexType> offsets(numPEs+1, 0);
+        std::partial_sum(quantities.begin(), quantities.end(), offsets.begin()+1);
+        for (IndexType i = 0; i < localM; i++) {
+            IndexType& pos = offsets[edgeOwner[2*i]];
+            sendEdges[pos++] = edgeList[i].first;
+            sendEdges[pos++] = edgeList[i].second;
+            IndexType& revPos = offsets[edgeOwner[2*i+1]];
+            sendEdges[revPos++] = edgeList[i].second;
+            sendEdges[revPos++] = edgeList[i].first;
+        }
     }
 
-    PRINT0("exchanged edges");
+    std::chrono::time_point<std::chrono::steady_clock> beforeExchange =  std::chrono::steady_clock::now();
 
-    // insert all the received edges to your local edges
+    std::vector<IndexType> recvEdges;
     {
-        scai::hmemo::ReadAccess<IndexType> rRecvEdges(recvEdges);
-        SCAI_ASSERT_EQ_ERROR(rRecvEdges.size(), recvEdgesSize, "mismatch");
-        for( IndexType i=0; i<recvEdgesSize; i+=2) {
-            SCAI_ASSERT_LT_ERROR(i+1, rRecvEdges.size(), "index mismatch");
-            int_pair sp;
-            sp.first = rRecvEdges[i];
-            sp.second = rRecvEdges[i+1];
-            localPairs.insert( localPairs.begin(), sp);//this is horribly expensive! Will move the entire list of local edges with each insertion!
-            //PRINT( thisPE << ": recved edge: "<< recvEdges[i] << " - " << recvEdges[i+1] );
-        }
+        SCAI_REGION( "GraphUtils.edgeList2CSR.exchange" )
+        scai::dmemo::CommunicationPlan sendPlan( quantities.data(), numPEs );
+        scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
+        recvEdges.resize( recvPlan.totalQuantity() );
+        comm->exchangeByPlan( recvEdges.data(), recvPlan, sendEdges.data(), sendPlan );
     }
+    std::vector<IndexType>().swap(sendEdges);
 
-    PRINT0("rebuild local edge list");
-
-    //IndexType numEdges = localPairs.size() ;
-
-    SCAI_ASSERT_ERROR(std::is_sorted(localPairs.begin(), localPairs.end()), "Disorder after insertion of received edges." );
+    std::chrono::duration<double> exchangeTmpTime = std::chrono::steady_clock::now() - beforeExchange;
+    ValueType exchangeTime = comm->max( exchangeTmpTime.count() );
+    PRINT0("time to exchange edges: " << exchangeTime);
 
     //
-    //remove duplicates
+    // local sort: radix sort by target, then a stable counting sort by source row,
+    // so every row ends up sorted by target
     //
-    localPairs.erase(unique(localPairs.begin(), localPairs.end(), [](int_pair p1, int_pair p2) {
-        return ( (p1.second==p2.second) and (p1.first==p2.first));
-    }), localPairs.end() );
-    //PRINT( thisPE <<": removed " << numEdges - localPairs.size() << " duplicate edges" );
-
-    PRINT0("removed duplicates");
-
-    //
-    // check that all is correct
-    //
-    newMaxLocalVertex = localPairs.back().first;
-    IndexType newMinLocalVertex = localPairs[0].first;
-    IndexType checkSum = newMaxLocalVertex - newMinLocalVertex;
-    IndexType globCheckSum = comm->sum( checkSum ) + comm->getSize() -1;
-
-    //TODO: should we allow isolated vertices?
-    //this assertion triggers when the graph has isolated (with no edges) vertices
-    SCAI_ASSERT_EQ_ERROR( globCheckSum, N, "Checksum mismatch, maybe some node id missing." );
-    //if( globCheckSum!=N ){
-    //	std::cout<<"WARNING, there is at least one node with no edges." << std::endl;
-    //}
-
-    //PRINT( *comm << ": from "<< newMinLocalVertex << " to " << newMaxLocalVertex );
-
-    localM = localPairs.size();					// after sorting, exchange and removing duplicates
-
-    IndexType localN = newMaxLocalVertex-newMinLocalVertex+1;
-    IndexType globalN = comm->sum( localN );
-    //IndexType globalM = comm->sum( localM );
-    //PRINT(thisPE << ": N: localN, global= " << localN << ", " << globalN << ", \tM: local, global= " << localM  << ", " << globalM );
-
-    //
-    // create local indices and general distribution
-    //
-    scai::hmemo::HArray<IndexType> localIndices( localN, -1);
-    IndexType index = 1;
-    PRINT0("prepared data structure for local indices");
+    const IndexType beginLocal = rangeBegin[comm->getRank()];
+    const IndexType localN = blockDist->getLocalSize();
+    const IndexType recvM = recvEdges.size()/2;
 
+    std::vector<IndexType> ia(localN+1, 0);
+    std::vector<IndexType> ja(recvM);
     {
-        scai::hmemo::WriteAccess<IndexType> wLocalIndices(localIndices);
-        IndexType oldVertex = localPairs[0].first;
-        wLocalIndices[0] = oldVertex;
-
-        // go through all local edges and add a local index if it is not already added
-        for(IndexType i=1; i<localPairs.size(); i++) {
-            IndexType newVertex = localPairs[i].first;
-            if( newVertex!=wLocalIndices[index-1] ) {
-                wLocalIndices[index++] = newVertex;
-                SCAI_ASSERT_LE_ERROR( index, localN,"Too large index for localIndices array.");
+        SCAI_REGION( "GraphUtils.edgeList2CSR.localSort" )
+
+        std::vector<IndexType> order(recvM), tmpOrder(recvM);
+        std::iota(order.begin(), order.end(), 0);
+
+        // the digits are taken from an unsigned 64 bit copy of the key, the last pass may cover fewer bits than radixBits
+        const int radixBits = 11;
+        const int keyBits = 64;
+        const std::uint64_t maxKey = globalN-1;
+        const std::uint64_t numBuckets = std::uint64_t(1) << radixBits;
+        auto digit = [&recvEdges, numBuckets](const IndexType e, const int shift) -> IndexType {
+            return (std::uint64_t(recvEdges[2*e+1]) >> shift) & (numBuckets-1);
+        };
+        for (int shift = 0; shift < keyBits and (maxKey >> shift) > 0; shift += radixBits) {
+            std::vector<IndexType> bucketStart(numBuckets+1, 0);
+            for (IndexType e = 0; e < recvM; e++) {
+                bucketStart[digit(e, shift) + 1]++;
+            }
+            std::partial_sum(bucketStart.begin(), bucketStart.end(), bucketStart.begin());
+            for (IndexType e : order) {
+                tmpOrder[bucketStart[digit(e, shift)]++] = e;
             }
-            // newVertex-oldVertex should be either 0 or 1, either are the same or differ by 1
-            SCAI_ASSERT_LE_ERROR( newVertex-oldVertex, 1, "Vertex with id " << newVertex-1 <<" is missing. Error in edge list, vertex should be contunious");
-            oldVertex = newVertex;
+            order.swap(tmpOrder);
         }
-        SCAI_ASSERT_NE_ERROR( wLocalIndices[localN-1], -1, "localIndices array not full");
-    }
 
-    PRINT0("assembled local indices");
+        for (IndexType e = 0; e < recvM; e++) {
+            const IndexType row = recvEdges[2*e] - beginLocal;
+            SCAI_ASSERT_VALID_INDEX_DEBUG( row, localN, "Edge sent to the wrong PE" );
+            ia[row+1]++;
+        }
+        std::partial_sum(ia.begin(), ia.end(), ia.begin());
 
+        std::vector<IndexType> rowPos(ia.begin(), ia.end()-1);
+        for (IndexType e : order) {
+            ja[rowPos[recvEdges[2*e] - beginLocal]++] = recvEdges[2*e+1];
+        }
+    }
+    std::vector<IndexType>().swap(recvEdges);
 
-    //-------------------------------------------------------------------
     //
-    // turn the local edge list to a CSRSparseMatrix
+    // remove duplicate edges, in place
     //
-
-    // the CSRSparseMatrix vectors
-    std::vector<IndexType> ia(localN+1);
-    ia[0] = 0;
-    index = 0;
-    std::vector<IndexType> ja;
-
-    for( IndexType e=0; e<localM; ) {
-        IndexType v1 = localPairs[e].first;		//the vertices of this edge
-        IndexType v1Degree = 0;
-        // for all edges of v1
-        for( std::vector<int_pair>::iterator edgeIt = localPairs.begin()+e; edgeIt->first==v1 and edgeIt!=localPairs.end(); ++edgeIt) {
-            ja.push_back( edgeIt->second );	// the neighbor of v1
-            //PRINT( thisPE << ": " << v1 << " -- " << 	edgeIt->second );
-            ++v1Degree;
-            ++e;
+    {
+        SCAI_REGION( "GraphUtils.edgeList2CSR.removeDuplicates" )
+        IndexType nnz = 0;
+        IndexType rowBegin = ia[0];
+        for (IndexType row = 0; row < localN; row++) {
+            const IndexType rowEnd = ia[row+1];
+            const IndexType newRowBegin = nnz;
+            for (IndexType j = rowBegin; j < rowEnd; j++) {
+                if (nnz == newRowBegin || ja[nnz-1] != ja[j]) {
+                    ja[nnz++] = ja[j];
+                }
+            }
+            rowBegin = rowEnd;
+            ia[row+1] = nnz;
         }
-        index++;
-        //TODO: can remove the assertion if we do not initialise ia and use push_back
-        SCAI_ASSERT_LE_ERROR( index, localN, thisPE << ": Wrong ia size and localN.");
-        ia[index] = ia[index-1] + v1Degree;
+        ja.resize(nnz);
     }
-    SCAI_ASSERT_EQ_ERROR( ja.size(), localM, thisPE << ": Wrong ja size and localM.");
-    std::vector<ValueType> values(ja.size(), 1);
 
-    PRINT0("assembled CSR arrays");
+    std::vector<ValueType> values(ja.size(), 1);
 
-    //assign/assemble the matrix
     scai::lama::CSRStorage<ValueType> myStorage ( localN, globalN,
             scai::hmemo::HArray<IndexType>(ia.size(), ia.data()),
             scai::hmemo::HArray<IndexType>(ja.size(), ja.data()),
-            scai::hmemo::HArray<ValueType>(values.size(), values.data()));//no longer allowed. TODO: change
-
-    //const scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(globalN, comm));
-    const auto genDist = scai::dmemo::generalDistributionUnchecked(globalN, localIndices, comm);//this could be a GenBlockDistribution, right?
-
-    PRINT0("assembled CSR storage");
-
-    return scai::lama::CSRSparseMatrix<ValueType>(genDist, std::move(myStorage));
+            scai::hmemo::HArray<ValueType>(values.size(), values.data()));
 
+    return scai::lama::CSRSparseMatrix<ValueType>(blockDist, std::move(myStorage));
 }
 
 //---------------------------------------------------------------------------------------
@@ -2052,6 +1991,128 @@ std::vector< std::vector<IndexType>> GraphUtils<IndexType, ValueType>::mecGraphC
 }
 //---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> GraphUtils<IndexType, ValueType>::distributedEdgeColoring( const CSRSparseMatrix<ValueType> &peGraph, IndexType &colors) {
+    SCAI_REGION("GraphUtils.distributedEdgeColoring");
+
+    const scai::dmemo::DistributionPtr dist = peGraph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType rank = comm->getRank();
+
+    SCAI_ASSERT_EQ_ERROR( peGraph.getNumRows(), comm->getSize(), "The PE graph must have one row per process" );
+    if (dist->getLocalSize() != 1 or dist->local2Global(0) != rank) {
+        throw std::runtime_error("In distributedEdgeColoring, row " + std::to_string(rank) + " of the PE graph must be owned by process " + std::to_string(rank));
+    }
+
+    // the uncolored edges of this process, sorted by neighbor so that the order matches the communication plans
+    std::vector<std::pair<IndexType,ValueType>> edges;
+    {
+        const CSRStorage<ValueType>& storage = peGraph.getLocalStorage();
+        const scai::hmemo::ReadAccess<IndexType> ia(storage.getIA());
+        const scai::hmemo::ReadAccess<IndexType> ja(storage.getJA());
+        const scai::hmemo::ReadAccess<ValueType> values(storage.getValues());
+        for (IndexType j = ia[0]; j < ia[1]; j++) {
+            if (ja[j] != rank) {
+                edges.push_back( std::make_pair(ja[j], values[j]) );
+            }
+        }
+    }
+    std::sort( edges.begin(), edges.end() );
+
+    std::vector<IndexType> neighbors(edges.size());
+    std::vector<ValueType> weights(edges.size());
+    for (IndexType i = 0; i < IndexType(edges.size()); i++) {
+        neighbors[i] = edges[i].first;
+        weights[i] = edges[i].second;
+    }
+    std::vector<std::pair<IndexType,ValueType>>().swap(edges);
+
+    // symmetric plan: one value to and from every neighbor in the list
+    auto neighborPlan = [](const std::vector<IndexType>& neighbors) {
+        std::vector<IndexType> quantities(neighbors.empty() ? 0 : neighbors.back()+1, 0);
+        for (IndexType n : neighbors) {
+            quantities[n] = 1;
+        }
+        return scai::dmemo::CommunicationPlan( quantities );
+    };
+
+    // both endpoints must agree on the order of the edges, so make the weights symmetric
+    {
+        const scai::dmemo::CommunicationPlan plan = neighborPlan(neighbors);
+        std::vector<ValueType> otherWeights(weights.size());
+        comm->exchangeByPlan( otherWeights.data(), plan, weights.data(), plan );
+        for (IndexType i = 0; i < IndexType(weights.size()); i++) {
+            weights[i] = std::max( weights[i], otherWeights[i] );
+        }
+    }
+
+    // strict total order on the edges: heavier first, ties broken by the endpoint IDs
+    auto heavier = [&](const IndexType i, const IndexType j) {
+        if (weights[i] != weights[j]) {
+            return weights[i] > weights[j];
+        }
+        return std::make_pair( std::min(rank, neighbors[i]), std::max(rank, neighbors[i]) )
+               < std::make_pair( std::min(rank, neighbors[j]), std::max(rank, neighbors[j]) );
+    };
+
+    std::vector<IndexType> partnerPerRound;
+    std::vector<char> available;
+    std::vector<IndexType> sendProposal;
+    std::vector<IndexType> recvProposal;
+
+    while (comm->sum( IndexType(neighbors.size()) ) > 0) {
+        const IndexType degree = neighbors.size();
+        const scai::dmemo::CommunicationPlan plan = neighborPlan(neighbors);
+
+        available.assign(degree, 1);
+        recvProposal.resize(degree);
+        IndexType partner = rank;
+        IndexType active;
+
+        // every iteration matches at least the heaviest edge between two unmatched processes
+        do {
+            IndexType candidate = -1;
+            if (partner == rank) {
+                for (IndexType i = 0; i < degree; i++) {
+                    if (available[i] and (candidate < 0 or heavier(i, candidate))) {
+                        candidate = i;
+                    }
+                }
+            }
+
+            // processes that are matched or have no candidate send -1 and are not available any more
+            sendProposal.assign(degree, candidate < 0 ? -1 : neighbors[candidate]);
+            comm->exchangeByPlan( recvProposal.data(), plan, sendProposal.data(), plan );
+
+            for (IndexType i = 0; i < degree; i++) {
+                if (recvProposal[i] == -1) {
+                    available[i] = 0;
+                }
+            }
+            if (candidate >= 0 and recvProposal[candidate] == rank) {
+                partner = neighbors[candidate];
+                available[candidate] = 0;
+            }
+
+            active = partner == rank and std::find(available.begin(), available.end(), 1) != available.end();
+        } while (comm->sum(active) > 0);
+
+        partnerPerRound.push_back(partner);
+
+        if (partner != rank) {
+            const IndexType pos = std::lower_bound(neighbors.begin(), neighbors.end(), partner) - neighbors.begin();
+            SCAI_ASSERT_EQ_ERROR( neighbors[pos], partner, "Partner is not a neighbor" );
+            neighbors.erase(neighbors.begin()+pos);
+            weights.erase(weights.begin()+pos);
+        }
+    }
+
+    colors = partnerPerRound.size();
+
+    return partnerPerRound;
+}
+//---------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>
 ValueType GraphUtils<IndexType, ValueType>::localSumOutgoingEdges(const CSRSparseMatrix<ValueType> &input, const bool weighted) {
     SCAI_REGION( "ParcoRepart.localSumOutgoingEdges" )
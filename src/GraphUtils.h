@@ -278,10 +278,11 @@ public:
     static scai::lama::CSRSparseMatrix<ValueType> getCSRmatrixFromAdjList_NoEgdeWeights( const std::vector<std::set<IndexType>>& adjList);
 
     /** Given a list of edges (i.e., a graph in edge list format), convert to CSR adjacency matrix.
-     Go over the vector of the local edges, sort the edges, construct the local part of CSR sparse matrix and
-     build the global matrix in the end.
+     Every edge and its reverse are sent to the owners of their source vertex under a block distribution,
+     in one exchange. Then every PE sorts its edges locally with a radix sort, removes duplicates and
+     builds its rows of the CSR matrix. Vertices without edges get empty rows.
      * @param[in] edgeList The local list of edges for this PE; edgeList[i].first is one vertex of the edge and .second the other.
-     * @return The distributed adjacency matrix.
+     * @return The adjacency matrix, block distributed. The number of vertices is the largest vertex ID plus one.
      */
     static scai::lama::CSRSparseMatrix<ValueType> edgeList2CSR( std::vector< std::pair<IndexType, IndexType>>& edgeList, const scai::dmemo::CommunicatorPtr comm );
 
@@ -333,6 +334,22 @@ public:
     */
     static std::vector< std::vector<IndexType>> mecGraphColoring( const scai::lama::CSRSparseMatrix<ValueType> &adjM, IndexType &colors);
 
+    /** Distributed edge coloring of the PE graph, used as the communication schedule of the local refinement.
+
+    Every color is a maximal matching computed with locally dominant edges: a process proposes to its
+    heaviest neighbor that is not yet matched in this round and two processes are matched if they propose
+    to each other. Heavier edges thus get lower colors, as in mecGraphColoring. At most 2*maxDegree-1 colors
+    are used. Only the neighbors of every process are stored and communication happens only between
+    neighbors in the PE graph, apart from a global reduction per iteration.
+
+     * @param[in] peGraph The PE graph as returned by getPEGraph: row i is owned by process i.
+     * @param[out] colors The number of colors (i.e. communication rounds), equal on all processes.
+
+     * @return A vector of size colors; ret[c] is the partner of this process in round c,
+     or the rank of this process if it is idle in this round.
+    */
+    static std::vector<IndexType> distributedEdgeColoring( const scai::lama::CSRSparseMatrix<ValueType> &peGraph, IndexType &colors);
+
 
     /**
     * @brief Sum of weights of local outgoing edges. An edge (u,v) is an outgoing if u is
@@ -13,6 +13,12 @@
 
 //remove
 #include "HilbertCurve.h"
+#include "MPIDataTypes.h"
+
+#include <random>
+#include <chrono>
+#include <map>
+#include <unistd.h>
 
 namespace ITI {
 
@@ -364,6 +370,256 @@ TYPED_TEST (GraphUtilsTest,testEdgeList2CSR) {
     EXPECT_TRUE( graph.checkSymmetry() );
 }
 
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (GraphUtilsTest, testEdgeList2CSR_ManyRadixPasses) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    //more than 2^22 vertices need three passes of the radix sort, the last one shifts by 22 bits
+    const IndexType N = (IndexType(1) << 22) + 1000;
+    const std::vector<IndexType> neighbors = { N-1, IndexType(1) << 22, (IndexType(1) << 22) + 7, 5, IndexType(1) << 11,
+                                               (IndexType(1) << 21) + 3, N-1, IndexType(1) << 22, (IndexType(1) << 11) + 1 };
+
+    //every PE inserts the same edges of vertex 0, so there are duplicates within and across PEs
+    std::vector< std::pair<IndexType, IndexType>> localEdgeList;
+    for (IndexType v : neighbors) {
+        localEdgeList.push_back( std::make_pair(IndexType(0), v) );
+    }
+
+    CSRSparseMatrix<ValueType> graph = GraphUtils<IndexType, ValueType>::edgeList2CSR( localEdgeList, comm );
+    ASSERT_EQ( graph.getNumRows(), N );
+    EXPECT_TRUE( graph.isConsistent() );
+
+    std::vector<IndexType> expected(neighbors);
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+    EXPECT_EQ( graph.getNumValues(), 2*IndexType(expected.size()) );
+
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    if (dist->isLocal(0)) {
+        const IndexType localZero = dist->global2Local(0);
+        scai::hmemo::ReadAccess<IndexType> ia(graph.getLocalStorage().getIA());
+        scai::hmemo::ReadAccess<IndexType> ja(graph.getLocalStorage().getJA());
+        std::vector<IndexType> row(ja.get()+ia[localZero], ja.get()+ia[localZero+1]);
+        EXPECT_EQ( row, expected );
+    }
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (GraphUtilsTest, testEdgeList2CSR_RoundTrip) {
+    using ValueType = TypeParam;
+
+    std::string file = GraphUtilsTest<ValueType>::graphPath + "trace-00008.graph";
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph( file );
+    const IndexType N = graph.getNumRows();
+
+    scai::dmemo::CommunicatorPtr comm = graph.getRowDistributionPtr()->getCommunicatorPtr();
+    const IndexType thisPE = comm->getRank();
+    const IndexType numPEs = comm->getSize();
+
+    //every PE gets a strided part of the edges, in one direction only, and some duplicates
+    IndexType maxDegree;
+    std::vector<std::tuple<IndexType,IndexType,ValueType>> allEdges = GraphUtils<IndexType, ValueType>::CSR2EdgeList_local( graph, maxDegree );
+    std::vector< std::pair<IndexType, IndexType>> localEdgeList;
+    for (IndexType e = thisPE; e < IndexType(allEdges.size()); e += numPEs) {
+        localEdgeList.push_back( std::make_pair(std::get<0>(allEdges[e]), std::get<1>(allEdges[e])) );
+        if (e % 7 == 0) {
+            localEdgeList.push_back( std::make_pair(std::get<1>(allEdges[e]), std::get<0>(allEdges[e])) );
+        }
+    }
+
+    CSRSparseMatrix<ValueType> converted = GraphUtils<IndexType, ValueType>::edgeList2CSR( localEdgeList, comm );
+    ASSERT_EQ( converted.getNumRows(), N );
+    EXPECT_TRUE( converted.isConsistent() );
+    EXPECT_EQ( converted.getNumValues(), graph.getNumValues() );
+
+    //same rows as the original graph
+    const scai::dmemo::DistributionPtr dist = converted.getRowDistributionPtr();
+    graph.redistribute( dist, graph.getColDistributionPtr() );
+
+    const CSRStorage<ValueType>& convertedStorage = converted.getLocalStorage();
+    const CSRStorage<ValueType>& origStorage = graph.getLocalStorage();
+    scai::hmemo::ReadAccess<IndexType> convIA(convertedStorage.getIA());
+    scai::hmemo::ReadAccess<IndexType> convJA(convertedStorage.getJA());
+    scai::hmemo::ReadAccess<IndexType> origIA(origStorage.getIA());
+    scai::hmemo::ReadAccess<IndexType> origJA(origStorage.getJA());
+    ASSERT_EQ( convIA.size(), origIA.size() );
+
+    for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+        std::vector<IndexType> convRow(convJA.get()+convIA[i], convJA.get()+convIA[i+1]);
+        std::vector<IndexType> origRow(origJA.get()+origIA[i], origJA.get()+origIA[i+1]);
+        std::sort(origRow.begin(), origRow.end());
+        EXPECT_TRUE( std::is_sorted(convRow.begin(), convRow.end()) );
+        EXPECT_EQ( convRow, origRow ) << "row of vertex " << dist->local2Global(i);
+    }
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (GraphUtilsTest, testSortEdgePairsLargeIDs) {
+    if (sizeof(IndexType) < 8) {
+        GTEST_SKIP() << "Needs a 64-bit IndexType, configure with USE_64BIT_INDEX";
+    }
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType localM = 1000;
+    //larger than 2^34 for a 64-bit IndexType
+    const IndexType offset = std::numeric_limits<IndexType>::max() >> 29;
+
+    //vertex IDs above 2^32 that do not fit into 32 bits
+    std::mt19937_64 generator(comm->getRank());
+    std::uniform_int_distribution<IndexType> idDist(offset, 2*offset);
+    std::vector<int_pair> localPairs(localM);
+    unsigned long localSum = 0;
+    for (IndexType i = 0; i < localM; i++) {
+        localPairs[i].first = idDist(generator);
+        localPairs[i].second = idDist(generator);
+        localSum += localPairs[i].first + 3*localPairs[i].second;
+    }
+
+    const MPI_Datatype pairType = getMPIPairType<int_pair, IndexType, IndexType>(offsetof(int_pair, first), offsetof(int_pair, second));
+    JanusSort::sort(MPI_COMM_WORLD, localPairs, pairType);
+
+    EXPECT_TRUE( std::is_sorted(localPairs.begin(), localPairs.end()) );
+
+    //no ID was truncated
+    unsigned long sortedSum = 0;
+    for (const int_pair& edge : localPairs) {
+        EXPECT_GE( edge.first, offset );
+        EXPECT_GE( edge.second, offset );
+        sortedSum += edge.first + 3*edge.second;
+    }
+    EXPECT_EQ( comm->sum(sortedSum), comm->sum(localSum) );
+    EXPECT_EQ( comm->sum(IndexType(localPairs.size())), localM*comm->getSize() );
+
+    //sorted across PEs
+    if (!localPairs.empty()) {
+        const IndexType rank = comm->getRank();
+        std::vector<IndexType> firstIDs(comm->getSize(), 0);
+        std::vector<IndexType> lastIDs(comm->getSize(), 0);
+        firstIDs[rank] = localPairs.front().first;
+        lastIDs[rank] = localPairs.back().first;
+        comm->sumImpl(firstIDs.data(), firstIDs.data(), firstIDs.size(), scai::common::TypeTraits<IndexType>::stype);
+        comm->sumImpl(lastIDs.data(), lastIDs.data(), lastIDs.size(), scai::common::TypeTraits<IndexType>::stype);
+        if (rank + 1 < comm->getSize() && firstIDs[rank+1] != 0) {
+            EXPECT_LE( lastIDs[rank], firstIDs[rank+1] );
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (GraphUtilsTest, testEdgeList2CSR_LargeIDs) {
+    using ValueType = TypeParam;
+
+    if (sizeof(IndexType) < 8) {
+        GTEST_SKIP() << "Needs a 64-bit IndexType, configure with USE_64BIT_INDEX";
+    }
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    //the matrix has a row for every ID up to the largest one, ia and its copies take about three IndexTypes per row in total
+    const IndexType twoTo32 = IndexType(1) << 32;
+    const IndexType N = twoTo32 + 1000;
+    const double neededBytes = 3.0 * sizeof(IndexType) * N;
+    const double physicalBytes = double(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+    if (comm->min(physicalBytes) < neededBytes) {
+        GTEST_SKIP() << "Needs " << neededBytes/(1 << 30) << " GB of memory for " << N << " rows";
+    }
+
+    //a path through the IDs around 2^32 and edges from small IDs to IDs whose lower 32 bits are the small ID again
+    std::vector< std::pair<IndexType, IndexType>> allEdges;
+    for (IndexType v = twoTo32 - 10; v < twoTo32 + 10; v++) {
+        allEdges.push_back( std::make_pair(v, v+1) );
+    }
+    for (IndexType v = 1; v < 10; v++) {
+        allEdges.push_back( std::make_pair(v, twoTo32 + 2*v) );
+    }
+    allEdges.push_back( std::make_pair(IndexType(0), N-1) );
+
+    //every PE gets a strided part of the edges, some of them reversed and some twice
+    std::vector< std::pair<IndexType, IndexType>> localEdgeList;
+    for (IndexType e = comm->getRank(); e < IndexType(allEdges.size()); e += comm->getSize()) {
+        localEdgeList.push_back( e % 2 == 0 ? allEdges[e] : std::make_pair(allEdges[e].second, allEdges[e].first) );
+        if (e % 3 == 0) {
+            localEdgeList.push_back( allEdges[e] );
+        }
+    }
+
+    CSRSparseMatrix<ValueType> graph = GraphUtils<IndexType, ValueType>::edgeList2CSR( localEdgeList, comm );
+    ASSERT_EQ( graph.getNumRows(), N );
+    EXPECT_TRUE( graph.isConsistent() );
+    EXPECT_EQ( graph.getNumValues(), 2*IndexType(allEdges.size()) );
+
+    //the expected row of every vertex with an edge, no ID may be truncated to its lower 32 bits
+    std::map<IndexType, std::vector<IndexType>> expectedRows;
+    for (const std::pair<IndexType, IndexType>& edge : allEdges) {
+        expectedRows[edge.first].push_back(edge.second);
+        expectedRows[edge.second].push_back(edge.first);
+    }
+
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    scai::hmemo::ReadAccess<IndexType> ia(graph.getLocalStorage().getIA());
+    scai::hmemo::ReadAccess<IndexType> ja(graph.getLocalStorage().getJA());
+    for (std::pair<const IndexType, std::vector<IndexType>>& expected : expectedRows) {
+        if (dist->isLocal(expected.first)) {
+            const IndexType localRow = dist->global2Local(expected.first);
+            std::vector<IndexType> row(ja.get()+ia[localRow], ja.get()+ia[localRow+1]);
+            std::sort(expected.second.begin(), expected.second.end());
+            EXPECT_EQ( row, expected.second ) << "row of vertex " << expected.first;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------
+
+/* Compares the time to sort edge pairs with 32-bit and with IndexType vertex IDs.
+*/
+TYPED_TEST (GraphUtilsTest, DISABLED_benchSortEdgePairWidth) {
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType localM = 1 << 22;
+    const int repetitions = 5;
+
+    struct narrow_pair {
+        int32_t first;
+        int32_t second;
+        bool operator<(const narrow_pair& rhs ) const {
+            return first < rhs.first || (first == rhs.first && second < rhs.second);
+        }
+    };
+
+    std::mt19937 generator(comm->getRank());
+    std::uniform_int_distribution<int32_t> idDist(0, std::numeric_limits<int32_t>::max());
+
+    double narrowTime = 0, wideTime = 0;
+    for (int r = 0; r < repetitions; r++) {
+        std::vector<narrow_pair> narrowPairs(localM);
+        std::vector<int_pair> widePairs(localM);
+        for (IndexType i = 0; i < localM; i++) {
+            narrowPairs[i].first = idDist(generator);
+            narrowPairs[i].second = idDist(generator);
+            widePairs[i].first = narrowPairs[i].first;
+            widePairs[i].second = narrowPairs[i].second;
+        }
+
+        comm->synchronize();
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        JanusSort::sort(MPI_COMM_WORLD, narrowPairs, MPI_2INT);
+        narrowTime += comm->max( std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() );
+
+        comm->synchronize();
+        start = std::chrono::steady_clock::now();
+        JanusSort::sort(MPI_COMM_WORLD, widePairs, getMPIPairType<int_pair, IndexType, IndexType>(offsetof(int_pair, first), offsetof(int_pair, second)));
+        wideTime += comm->max( std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() );
+    }
+
+    if (comm->getRank() == 0) {
+        std::cout << "sorting " << localM << " pairs per PE: 32-bit IDs " << narrowTime/repetitions << "s, "
+                  << 8*sizeof(IndexType) << "-bit IDs " << wideTime/repetitions << "s" << std::endl;
+    }
+}
+
 //---------------------------------------------------------------------------------------
 // trancated function
 /*
@@ -490,6 +746,52 @@ TYPED_TEST(GraphUtilsTest, testMEColoring_local) {
 }
 //------------------------------------------------------------------------------------
 
+TYPED_TEST(GraphUtilsTest, testDistributedEdgeColoring) {
+    using ValueType = TypeParam;
+
+    std::string file = GraphUtilsTest<ValueType>::graphPath + "trace-00008.graph";
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType rank = comm->getRank();
+
+    //the block distribution of the graph induces the PE graph
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph( file );
+    CSRSparseMatrix<ValueType> peGraph = GraphUtils<IndexType, ValueType>::getPEGraph( graph );
+
+    IndexType colors;
+    std::vector<IndexType> partners = GraphUtils<IndexType,ValueType>::distributedEdgeColoring( peGraph, colors);
+    ASSERT_EQ( IndexType(partners.size()), colors );
+    EXPECT_EQ( comm->min(colors), comm->max(colors) );
+
+    std::vector<IndexType> neighbors;
+    {
+        const CSRStorage<ValueType>& storage = peGraph.getLocalStorage();
+        const scai::hmemo::ReadAccess<IndexType> ja(storage.getJA());
+        for (IndexType j = 0; j < ja.size(); j++) {
+            if (ja[j] != rank) neighbors.push_back(ja[j]);
+        }
+    }
+    const IndexType maxDegree = comm->max( IndexType(neighbors.size()) );
+    EXPECT_LE( colors, std::max(2*maxDegree-1, IndexType(0)) );
+
+    //every edge of the PE graph is colored exactly once
+    for (IndexType neighbor : neighbors) {
+        EXPECT_EQ( std::count(partners.begin(), partners.end(), neighbor), 1 );
+    }
+    for (IndexType partner : partners) {
+        EXPECT_TRUE( partner == rank or std::find(neighbors.begin(), neighbors.end(), partner) != neighbors.end() );
+    }
+
+    //the partner of my partner is me
+    const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution( comm->getSize() ));
+    for (IndexType c = 0; c < colors; c++) {
+        DenseVector<IndexType> roundPartners( peGraph.getRowDistributionPtr(), partners[c] );
+        roundPartners.redistribute( noDist );
+        scai::hmemo::ReadAccess<IndexType> rPartners( roundPartners.getLocalValues() );
+        EXPECT_EQ( rPartners[partners[c]], rank );
+    }
+}
+//------------------------------------------------------------------------------------
+
 TYPED_TEST(GraphUtilsTest, testImbalance) {
     using ValueType = TypeParam;
 
@@ -50,7 +50,9 @@ scai::dmemo::HaloExchangePlan coarsenHalo(
                 SCAI_ASSERT(j < providedIndices.size(), "Communication plan does not fit provided indices.");
                 IndexType provIndex = providedIndices[j];
                 SCAI_ASSERT(provIndex < rFineToCoarse.size(), "Provided index " << provIndex << " seemingly not local.");
-                sendSet.insert(coarseDistribution.global2Local(rFineToCoarse[providedIndices[j]]));
+                const IndexType coarseIndex = coarseDistribution.global2Local(rFineToCoarse[providedIndices[j]]);
+                SCAI_ASSERT(coarseIndex != invalidIndex, "Coarse node " << rFineToCoarse[providedIndices[j]] << " of provided index " << provIndex << " is not local, build the halo from the coarse graph instead.");
+                sendSet.insert(coarseIndex);
             }
 
             newProvidedIndices.insert(newProvidedIndices.end(), sendSet.begin(), sendSet.end());
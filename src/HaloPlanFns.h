@@ -4,6 +4,9 @@
 
 namespace ITI {
 
+/** The halo of a coarse graph from the halo of the fine graph and the fine to coarse map of the local and the halo nodes.
+ *  Every coarse node must be on the process of its fine nodes, which does not hold after matching across processes.
+ */
 scai::dmemo::HaloExchangePlan coarsenHalo(
     const scai::dmemo::Distribution& coarseDistribution,
     const scai::dmemo::HaloExchangePlan& halo,
@@ -9,26 +9,25 @@
 
 #include <scai/dmemo/mpi/MPICommunicator.hpp>
 
+#include <cstdint>
+#include <numeric>
+
 
 namespace ITI {
 
 
-//TODO: take node weights into account
 template<typename IndexType, typename ValueType>
-DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(const std::vector<DenseVector<ValueType>> &coordinates, const DenseVector<ValueType> &nodeWeights, Settings settings) {
+DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(const std::vector<DenseVector<ValueType>> &coordinates, Settings settings) {
 
-    //auto uniformWeights = fill<DenseVector<ValueType>>(coordinates[0].getDistributionPtr(), 1);
-    return computePartition( coordinates, settings);
+    auto uniformWeights = scai::lama::fill<DenseVector<ValueType>>(coordinates[0].getDistributionPtr(), 1);
+    return computePartition( coordinates, uniformWeights, settings);
 }
 //---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
-DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(const std::vector<DenseVector<ValueType>> &coordinates, Settings settings) {
+DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(const std::vector<DenseVector<ValueType>> &coordinates, const DenseVector<ValueType> &nodeWeights, Settings settings) {
     SCAI_REGION( "HilbertCurve.computePartition" )
 
-    std::chrono::time_point<std::chrono::steady_clock> start, afterSFC;
-    start = std::chrono::steady_clock::now();
-
     const scai::dmemo::DistributionPtr coordDist = coordinates[0].getDistributionPtr();
     const scai::dmemo::CommunicatorPtr comm = coordDist->getCommunicatorPtr();
 
@@ -36,6 +35,7 @@ DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(cons
     const IndexType dimensions = coordinates.size();
     assert(dimensions == settings.dimensions);
     const IndexType globalN = coordDist->getGlobalSize();
+    const IndexType localN = coordDist->getLocalSize();
 
     if (k != comm->getSize() && comm->getRank() == 0) {
         throw std::logic_error("Hilbert curve partition only implemented for same number of blocks and processes.");
@@ -45,27 +45,7 @@ DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(cons
         return scai::lama::DenseVector<IndexType>(globalN, 0);
     }
 
-    //
-    // vector of size k, each element represents the size of each block
-    //
-    //TODO: either adapt hilbert partition to consider node weights and block
-    // sizes or add checks when used with nodeweights outside the function
-
-    /*
-        std::vector<ValueType> blockSizes;
-    	//TODO: for now assume uniform nodeweights
-        IndexType weightSum = globalN;// = nodeWeights.sum();
-        if( settings.blockSizes.empty() ){
-            blockSizes.assign( settings.numBlocks, weightSum/settings.numBlocks );
-        }else{
-        	if (settings.blockSizes.size() > 1) {
-        		throw std::logic_error("Hilbert partition not implemented for node weights or multiple block sizes.");
-        	}
-            blockSizes = settings.blockSizes[0];
-        }
-        SCAI_ASSERT( blockSizes.size()==settings.numBlocks , "Wrong size of blockSizes vector: " << blockSizes.size() );
-
-    */
+    SCAI_ASSERT_ERROR( nodeWeights.getDistributionPtr()->isEqual(*coordDist), "Node weights and coordinates must have the same distribution." );
 
     /*
      * Several possibilities exist for choosing the recursion depth.
@@ -73,42 +53,81 @@ DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(cons
      */
     const IndexType recursionDepth = settings.sfcResolution > 0 ? settings.sfcResolution : std::min(ValueType(std::log2(globalN)), ValueType(21));
 
-    /*
-     *	create space filling curve indices.
-     */
+    //the global indices of the points that will be local after the partition
+    std::vector<IndexType> newLocalIndices;
 
-    scai::lama::DenseVector<double> hilbertIndices(coordDist, 0);
-    std::vector<double> localHilberIndices = HilbertCurve<IndexType,ValueType>::getHilbertIndexVector(coordinates, recursionDepth, dimensions);
-    hilbertIndices.assign( scai::hmemo::HArray<double>( localHilberIndices.size(), localHilberIndices.data()), coordDist);
+    if (settings.sfcSort) {
+        /*
+         * sort the global indices by where they are on the space-filling curve.
+         * The node weights are ignored, every block gets the same number of points.
+         */
 
-    //TODO: use the blockSizes vector
-    //TODO: take into account node weights: just sorting will create imbalanced blocks, not in number of node but in the total weight of each block
+        std::vector<sort_pair<ValueType>> localPairs= getSortedHilbertIndices( coordinates, settings );
 
-    /*
-     * now sort the global indices by where they are on the space-filling curve.
-     */
+        //copy indices into array
+        const IndexType newLocalN = localPairs.size();
+        newLocalIndices.resize(newLocalN);
 
-    std::vector<sort_pair<ValueType>> localPairs= getSortedHilbertIndices( coordinates, settings );
+        for (IndexType i = 0; i < newLocalN; i++) {
+            newLocalIndices[i] = localPairs[i].index;
+        }
+    } else {
+        /*
+         * find the splitters of the curve, then send every global index to the PE of its block.
+         * This needs one exchange instead of a distributed sort.
+         */
+
+        std::vector<double> localHilbertIndices = HilbertCurve<IndexType,ValueType>::getHilbertIndexVector(coordinates, recursionDepth, dimensions);
+        SCAI_ASSERT_EQ_ERROR(localHilbertIndices.size(), localN, "Size mismatch");
+
+        std::vector<ValueType> localWeights(localN);
+        {
+            scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
+            std::copy(rWeights.get(), rWeights.get()+localN, localWeights.begin());
+        }
+        std::vector<IndexType> localIDs(localN);
+        {
+            scai::hmemo::HArray<IndexType> myGlobalIndices;
+            coordDist->getOwnedIndexes(myGlobalIndices);
+            scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
+            std::copy(rIndices.get(), rIndices.get()+localN, localIDs.begin());
+        }
 
-    //copy indices into array
-    const IndexType newLocalN = localPairs.size();
-    std::vector<IndexType> newLocalIndices(newLocalN);
+        //ties of the hilbert index are broken by the global ID
+        const std::vector<std::pair<double,IndexType>> thresholds = getWeightedSplitters( localHilbertIndices, localIDs, localWeights, k, comm );
 
-    for (IndexType i = 0; i < newLocalN; i++) {
-        newLocalIndices[i] = localPairs[i].index;
+        std::vector<IndexType> targetBlock(localN);
+        std::vector<IndexType> quantities(k, 0);
+        for (IndexType i = 0; i < localN; i++) {
+            const std::pair<double,IndexType> key(localHilbertIndices[i], localIDs[i]);
+            targetBlock[i] = std::upper_bound(thresholds.begin()+1, thresholds.end(), key) - (thresholds.begin()+1);
+            quantities[targetBlock[i]]++;
+        }
+
+        //group the global indices by target block
+        std::vector<IndexType> offsets(k+1, 0);
+        std::partial_sum(quantities.begin(), quantities.end(), offsets.begin()+1);
+        std::vector<IndexType> sendIndices(localN);
+        for (IndexType i = 0; i < localN; i++) {
+            sendIndices[offsets[targetBlock[i]]++] = localIDs[i];
+        }
+
+        SCAI_REGION_START("HilbertCurve.computePartition.exchange")
+        scai::dmemo::CommunicationPlan sendPlan(quantities.data(), k);
+        scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
+        newLocalIndices.resize(recvPlan.totalQuantity());
+        comm->exchangeByPlan(newLocalIndices.data(), recvPlan, sendIndices.data(), sendPlan);
+        SCAI_REGION_END("HilbertCurve.computePartition.exchange")
     }
 
     //sort local indices for general distribution
     std::sort(newLocalIndices.begin(), newLocalIndices.end());
 
     //check size and sanity
-    SCAI_ASSERT_LT_ERROR( *std::max_element(newLocalIndices.begin(), newLocalIndices.end()), globalN, "Too large index (possible IndexType overflow?).");
+    if (!newLocalIndices.empty()) {
+        SCAI_ASSERT_LT_ERROR( newLocalIndices.back(), globalN, "Too large index (possible IndexType overflow?).");
+    }
     SCAI_ASSERT_EQ_ERROR( comm->sum(newLocalIndices.size()), globalN, "distribution mismatch");
-    SCAI_ASSERT_EQ_ERROR( comm->sum(newLocalIndices.size()), globalN, "distribution mismatch");      
-
-
-    //possible optimization: remove dummy values during first copy, then directly copy into HArray and sort with pointers. Would save one copy.
-    
 
     DenseVector<IndexType> result;
 
@@ -130,6 +149,168 @@ DenseVector<IndexType> HilbertCurve<IndexType, ValueType>::computePartition(cons
 
 //-------------------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+std::vector<std::pair<double,IndexType>> HilbertCurve<IndexType, ValueType>::getWeightedSplitters(
+    const std::vector<double> &localIndices,
+    const std::vector<IndexType> &localIDs,
+    const std::vector<ValueType> &localWeights,
+    const IndexType numParts,
+    const scai::dmemo::CommunicatorPtr comm) {
+    SCAI_REGION( "HilbertCurve.getWeightedSplitters" )
+
+    typedef std::pair<double,IndexType> Key;
+
+    const IndexType localN = localIndices.size();
+    SCAI_ASSERT_EQ_ERROR( localWeights.size(), localN, "Size mismatch" );
+    SCAI_ASSERT_EQ_ERROR( localIDs.size(), localN, "Size mismatch" );
+    SCAI_ASSERT_GE_ERROR( numParts, 1, "Need at least one part" );
+
+    //sort locally, then the weight below any key is a binary search
+    std::vector<Key> sortedKeys(localN);
+    std::vector<double> prefixWeights(localN+1, 0);
+    IndexType localMaxID = 0;
+    {
+        std::vector<IndexType> permutation(localN);
+        std::iota(permutation.begin(), permutation.end(), 0);
+        std::sort(permutation.begin(), permutation.end(), [&localIndices, &localIDs](IndexType i, IndexType j) {
+            return std::make_pair(localIndices[i], localIDs[i]) < std::make_pair(localIndices[j], localIDs[j]);
+        });
+        for (IndexType i = 0; i < localN; i++) {
+            sortedKeys[i] = Key(localIndices[permutation[i]], localIDs[permutation[i]]);
+            prefixWeights[i+1] = prefixWeights[i] + localWeights[permutation[i]];
+            SCAI_ASSERT_GE_ERROR( localIDs[i], 0, "Negative global ID" );
+            localMaxID = std::max(localMaxID, localIDs[i]);
+        }
+    }
+    auto weightBelow = [&sortedKeys, &prefixWeights](const Key& key) {
+        return prefixWeights[std::lower_bound(sortedKeys.begin(), sortedKeys.end(), key) - sortedKeys.begin()];
+    };
+
+    const double totalWeight = comm->sum(prefixWeights[localN]);
+    const IndexType maxID = comm->max(localMaxID);
+    const IndexType numSplitters = numParts-1;
+    const IndexType numBuckets = 64;
+    const IndexType maxRounds = 32;
+
+    std::vector<double> target(numSplitters);
+    for (IndexType b = 0; b < numSplitters; b++) {
+        target[b] = totalWeight*(b+1)/numParts;
+    }
+
+    /*
+     * Every round sums the weights below numBuckets-1 probe keys per active splitter over all PEs,
+     * then every splitter continues in the bucket containing its target.
+     */
+    auto histogramRound = [&](const std::vector<Key>& probes) {
+        std::vector<double> histogram(probes.size());
+        for (IndexType i = 0; i < IndexType(probes.size()); i++) {
+            histogram[i] = weightBelow(probes[i]);
+        }
+        comm->sumImpl(histogram.data(), histogram.data(), histogram.size(), scai::common::TypeTraits<double>::stype);
+        return histogram;
+    };
+
+    //first the hilbert index of every splitter: it is in [lower[b], upper[b]], the global weight below these bounds is known
+    std::vector<double> lower(numSplitters, 0), upper(numSplitters, 1);
+    std::vector<double> lowerWeight(numSplitters, 0), upperWeight(numSplitters, totalWeight);
+
+    for (IndexType round = 0; round < maxRounds; round++) {
+        //all PEs have the same bounds, so they agree on the active splitters
+        std::vector<IndexType> active;
+        std::vector<Key> probes;
+        for (IndexType b = 0; b < numSplitters; b++) {
+            if (upperWeight[b] > lowerWeight[b] && std::nextafter(lower[b], upper[b]) < upper[b]) {
+                active.push_back(b);
+                for (IndexType j = 1; j < numBuckets; j++) {
+                    probes.push_back(Key(lower[b] + (upper[b] - lower[b])*j/numBuckets, 0));
+                }
+            }
+        }
+        if (active.empty()) {
+            break;
+        }
+
+        const std::vector<double> histogram = histogramRound(probes);
+        for (IndexType a = 0; a < IndexType(active.size()); a++) {
+            const IndexType b = active[a];
+            double newLower = lower[b], newUpper = upper[b];
+            double newLowerWeight = lowerWeight[b], newUpperWeight = upperWeight[b];
+            for (IndexType j = 1; j < numBuckets; j++) {
+                const IndexType i = a*(numBuckets-1) + j-1;
+                if (histogram[i] <= target[b]) {
+                    newLower = probes[i].first;
+                    newLowerWeight = histogram[i];
+                } else {
+                    newUpper = probes[i].first;
+                    newUpperWeight = histogram[i];
+                    break;
+                }
+            }
+            lower[b] = newLower;
+            upper[b] = newUpper;
+            lowerWeight[b] = newLowerWeight;
+            upperWeight[b] = newUpperWeight;
+        }
+    }
+
+    /*
+     * Then the global ID: points with the same hilbert index as the splitter are split by their global ID,
+     * so a run of equal indices can be shared by several blocks.
+     * The splitter is the key (lower[b], lowerID[b]) or (lower[b], upperID[b]); upperID[b] = maxID+1 stands for the key (upper[b], 0),
+     * whose weight upperWeight[b] is known from the first search.
+     */
+    std::vector<IndexType> lowerID(numSplitters, 0), upperID(numSplitters, maxID+1);
+
+    for (IndexType round = 0; round < maxRounds; round++) {
+        std::vector<IndexType> active;
+        std::vector<Key> probes;
+        for (IndexType b = 0; b < numSplitters; b++) {
+            if (upperWeight[b] > lowerWeight[b] && upperID[b] - lowerID[b] > 1) {
+                active.push_back(b);
+                for (IndexType j = 1; j < numBuckets; j++) {
+                    const IndexType probeID = lowerID[b] + IndexType((std::int64_t(upperID[b] - lowerID[b])*j)/numBuckets);
+                    probes.push_back(Key(lower[b], probeID));
+                }
+            }
+        }
+        if (active.empty()) {
+            break;
+        }
+
+        const std::vector<double> histogram = histogramRound(probes);
+        for (IndexType a = 0; a < IndexType(active.size()); a++) {
+            const IndexType b = active[a];
+            for (IndexType j = 1; j < numBuckets; j++) {
+                const IndexType i = a*(numBuckets-1) + j-1;
+                if (histogram[i] <= target[b]) {
+                    lowerID[b] = probes[i].second;
+                    lowerWeight[b] = histogram[i];
+                } else {
+                    upperID[b] = probes[i].second;
+                    upperWeight[b] = histogram[i];
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Key> thresholds(numParts, Key(0, 0));
+    for (IndexType b = 0; b < numSplitters; b++) {
+        const bool takeLower = target[b] - lowerWeight[b] <= upperWeight[b] - target[b];
+        Key splitter;
+        if (takeLower) {
+            splitter = Key(lower[b], lowerID[b]);
+        } else {
+            splitter = upperID[b] > maxID ? Key(upper[b], 0) : Key(lower[b], upperID[b]);
+        }
+        thresholds[b+1] = std::max(thresholds[b], splitter);
+    }
+
+    return thresholds;
+}
+
+//-------------------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>//TODO: template this to help branch prediction
 double HilbertCurve<IndexType, ValueType>::getHilbertIndex(ValueType const * point, const IndexType dimensions, const IndexType recursionDepth, const std::vector<ValueType> &minCoords, const std::vector<ValueType> &maxCoords) {
     SCAI_REGION( "HilbertCurve.getHilbertIndex_newVersion")
@@ -369,8 +550,6 @@ std::vector<double> HilbertCurve<IndexType, ValueType>::getHilbertIndex2DVector
     ValueType dim0Extent = maxCoords[0] - minCoords[0];
     ValueType dim1Extent = maxCoords[1] - minCoords[1];
 
-    ValueType scaledPoint[2];
-    unsigned long integerIndex = 0;//TODO: also check whether this data type is long enough
     const IndexType localN = coordinates[0].getLocalValues().size();
 
     // the vector to be returned
@@ -385,11 +564,14 @@ std::vector<double> HilbertCurve<IndexType, ValueType>::getHilbertIndex2DVector
         const unsigned long divisor = size_t(1) << size_t(2*int(recursionDepth));
         const double dDivisor = double(divisor);
 
+        // every point is independent
+        #pragma omp parallel for schedule(static)
         for (IndexType i = 0; i < localN; i++) {
+            ValueType scaledPoint[2];
             scaledPoint[0] = (coordAccess0[i]-minCoords[0])/dim0Extent;
             scaledPoint[1] = (coordAccess1[i]-minCoords[1])/dim1Extent;
 
-            integerIndex = 0;
+            unsigned long integerIndex = 0;//TODO: also check whether this data type is long enough
             for (IndexType j = 0; j < recursionDepth; j++) {
                 int subSquare;
                 if (scaledPoint[0] < 0.5) {
@@ -464,8 +646,6 @@ std::vector<double> HilbertCurve<IndexType, ValueType>::getHilbertIndex3DVector
     ValueType dim1Extent = maxCoords[1] - minCoords[1];
     ValueType dim2Extent = maxCoords[2] - minCoords[2];
 
-    ValueType x,y,z;
-    unsigned long integerIndex = 0;	//TODO: also check whether this data type is long enough
     const IndexType localN = coordinates[0].getLocalValues().size();
 
     // the DV to be returned
@@ -480,12 +660,14 @@ std::vector<double> HilbertCurve<IndexType, ValueType>::getHilbertIndex3DVector
         
         const unsigned long long divisor = size_t(1) << size_t(3*int(recursionDepth));
 
+        // every point is independent
+        #pragma omp parallel for schedule(static)
         for (IndexType i = 0; i < localN; i++) {
-            x = (coordAccess0[i]-minCoords[0])/dim0Extent;
-            y = (coordAccess1[i]-minCoords[1])/dim1Extent;
-            z = (coordAccess2[i]-minCoords[2])/dim2Extent;
+            ValueType x = (coordAccess0[i]-minCoords[0])/dim0Extent;
+            ValueType y = (coordAccess1[i]-minCoords[1])/dim1Extent;
+            ValueType z = (coordAccess2[i]-minCoords[2])/dim2Extent;
 
-            integerIndex = 0;
+            unsigned long integerIndex = 0;	//TODO: also check whether this data type is long enough
             for (IndexType j = 0; j < recursionDepth; j++) {
                 int subSquare;
                 if (z < 0.5) {
@@ -738,11 +920,6 @@ std::vector<sort_pair<ValueType>> HilbertCurve<IndexType, ValueType>::getSortedH
     {
         SCAI_REGION( "HilbertCurve.getSortedHilbertIndices.sorting" );
 
-        int typesize;
-        MPI_Type_size(MPI_DOUBLE_INT, &typesize);
-        //MPI_Type_size(getMPITypePair<double,IndexType>(), &typesize);
-        //assert(typesize == sizeof(sort_pair)); does not have to be true anymore due to padding
-
         //call distributed sort
         //sfc index is hardcoded to double to allow better precision
 
@@ -767,12 +944,14 @@ std::vector<sort_pair<ValueType>> HilbertCurve<IndexType, ValueType>::getSortedH
         if( settings.debugMode) {
             PRINT0("******** in debug mode");
             unsigned long indexSumAfter = 0;
-            unsigned int newLocalN = localPairs.size();
+            const IndexType newLocalN = localPairs.size();
             for (IndexType i=0; i<newLocalN; i++) {
                 indexSumAfter += localPairs[i].index;
             }
-            unsigned long checkSum = globalN*(globalN-1)/2;
-            const long newCheckSum = comm->sum(indexSumAfter);
+            //halve the even factor first, so that the product does not overflow for large IndexType values
+            const unsigned long n = globalN;
+            const unsigned long checkSum = (n % 2 == 0) ? (n/2)*(n-1) : n*((n-1)/2);
+            const unsigned long newCheckSum = comm->sum(indexSumAfter);
             SCAI_ASSERT_EQ_ERROR( newCheckSum, checkSum, "Old checksum: " << checkSum << ", new checksum: " << newCheckSum );
         }
 
@@ -808,66 +987,98 @@ void HilbertCurve<IndexType, ValueType>::redistribute(std::vector<DenseVector<Va
 
     std::vector<double> hilbertIndices = HilbertCurve<IndexType, ValueType>::getHilbertIndexVector(coordinates, settings.sfcResolution, settings.dimensions);
     SCAI_REGION_END("HilbertCurve.redistribute.sfc")
-    SCAI_REGION_START("HilbertCurve.redistribute.sort")
-    /*
-     * fill sort pair
-     */
 
     scai::hmemo::HArray<IndexType> myGlobalIndices(localN, IndexType(0) );
     inputDist->getOwnedIndexes(myGlobalIndices);
-    std::vector<sort_pair<ValueType>> localPairs(localN);
-    {
-        scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
-        for (IndexType i = 0; i < localN; i++) {
-            localPairs[i].value = hilbertIndices[i];
-            localPairs[i].index = rIndices[i];
+
+    // the first key of every PE, i.e., its first hilbert index and the smallest global ID with this index
+    std::vector<std::pair<double,IndexType>> recvThresholds(comm->getSize());
+
+    if (settings.sfcSort) {
+        SCAI_REGION_START("HilbertCurve.redistribute.sort")
+        /*
+         * fill sort pair
+         */
+
+        std::vector<sort_pair<ValueType>> localPairs(localN);
+        {
+            scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
+            for (IndexType i = 0; i < localN; i++) {
+                localPairs[i].value = hilbertIndices[i];
+                localPairs[i].index = rIndices[i];
+            }
         }
-    }
 
-    MPI_Comm mpi_comm = MPI_COMM_WORLD; //TODO: cast the communicator ptr to a MPI communicator and get getMPIComm()?
+        MPI_Comm mpi_comm = MPI_COMM_WORLD; //TODO: cast the communicator ptr to a MPI communicator and get getMPIComm()?
 
-    // as MPI communicator might have been splitted, take the one used by comm
-    if ( comm->getType() == scai::dmemo::CommunicatorType::MPI ){
-        const auto& mpiComm = static_cast<const scai::dmemo::MPICommunicator&>( *comm );
-        mpi_comm = mpiComm.getMPIComm();
-    }
+        // as MPI communicator might have been splitted, take the one used by comm
+        if ( comm->getType() == scai::dmemo::CommunicatorType::MPI ){
+            const auto& mpiComm = static_cast<const scai::dmemo::MPICommunicator&>( *comm );
+            mpi_comm = mpiComm.getMPIComm();
+        }
+
+        //JanusSort::sort(mpi_comm, localPairs, MPI_DOUBLE_INT);
+        JanusSort::sort(mpi_comm, localPairs, getMPITypePair<ValueType,IndexType>() );
+        assert(localPairs.size() > 0);
 
-    //JanusSort::sort(mpi_comm, localPairs, MPI_DOUBLE_INT);
-    JanusSort::sort(mpi_comm, localPairs, getMPITypePair<ValueType,IndexType>() );
+        SCAI_REGION_END("HilbertCurve.redistribute.sort")
+
+        sort_pair<ValueType> minLocalIndex = localPairs[0];
+        std::vector<double> sendThresholds(comm->getSize(), minLocalIndex.value);
+        std::vector<IndexType> sendThresholdIDs(comm->getSize(), minLocalIndex.index);
+        std::vector<double> recvValues(comm->getSize());
+        std::vector<IndexType> recvIDs(comm->getSize());
+
+        comm->all2all(recvValues.data(), sendThresholds.data());//TODO: maybe speed up with hypercube
+        comm->all2all(recvIDs.data(), sendThresholdIDs.data());
+        for (IndexType p = 0; p < comm->getSize(); p++) {
+            recvThresholds[p] = std::make_pair(recvValues[p], recvIDs[p]);
+        }
+    } else {
+        // balance the number of points, as the distributed sort; ties of the hilbert index are broken by the global ID
+        const std::vector<ValueType> unitWeights(localN, 1);
+        std::vector<IndexType> localIDs(localN);
+        {
+            scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
+            std::copy(rIndices.get(), rIndices.get()+localN, localIDs.begin());
+        }
+        recvThresholds = getWeightedSplitters( hilbertIndices, localIDs, unitWeights, comm->getSize(), comm );
+    }
 
     migrationCalculation = std::chrono::steady_clock::now() - beforeInitPart;
     metrics.MM["timeMigrationAlgo"] = migrationCalculation.count();
     std::chrono::time_point < std::chrono::steady_clock > beforeMigration = std::chrono::steady_clock::now();
-    assert(localPairs.size() > 0);
-
-    SCAI_REGION_END("HilbertCurve.redistribute.sort")
 
-    sort_pair<ValueType> minLocalIndex = localPairs[0];
-    std::vector<double> sendThresholds(comm->getSize(), minLocalIndex.value);
-    std::vector<double> recvThresholds(comm->getSize());
-
-    comm->all2all(recvThresholds.data(), sendThresholds.data());//TODO: maybe speed up with hypercube
-    SCAI_ASSERT_LT_ERROR(recvThresholds[comm->getSize() - 1], 1, "invalid hilbert index");
-    SCAI_ASSERT_GE_ERROR(recvThresholds[comm->getSize() - 1], 0, "invalid hilbert index");
+    SCAI_ASSERT_LT_ERROR(recvThresholds[comm->getSize() - 1].first, 1, "invalid hilbert index");
+    SCAI_ASSERT_GE_ERROR(recvThresholds[comm->getSize() - 1].first, 0, "invalid hilbert index");
     // merge to get quantities //Problem: nodes are not sorted according to their hilbert indices, so accesses are not aligned.
     // Need to sort before and after communication
     assert(std::is_sorted(recvThresholds.begin(), recvThresholds.end()));
 
     std::vector<IndexType> permutation(localN);
     std::iota(permutation.begin(), permutation.end(), 0);
-    std::sort(permutation.begin(), permutation.end(), [&](IndexType i, IndexType j) {
-        return hilbertIndices[i] < hilbertIndices[j];
-    });
+    {
+        scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
+        std::sort(permutation.begin(), permutation.end(), [&](IndexType i, IndexType j) {
+            return std::make_pair(hilbertIndices[i], rIndices[i]) < std::make_pair(hilbertIndices[j], rIndices[j]);
+        });
+    }
 
-    //now sorting hilbert indices themselves
-    std::sort(hilbertIndices.begin(), hilbertIndices.end());
+    //now the keys themselves, in the same order
+    std::vector<std::pair<double,IndexType>> sortedKeys(localN);
+    {
+        scai::hmemo::ReadAccess<IndexType> rIndices(myGlobalIndices);
+        for (IndexType i = 0; i < localN; i++) {
+            sortedKeys[i] = std::make_pair(hilbertIndices[permutation[i]], rIndices[permutation[i]]);
+        }
+    }
     std::vector<IndexType> quantities(comm->getSize(), 0);
     {
         IndexType p = 0;
         for (IndexType i = 0; i < localN; i++) {
             //increase target block counter if threshold is reached. Skip empty blocks if necessary.
             while (p + 1 < comm->getSize()
-                    && recvThresholds[p + 1] <= hilbertIndices[i]) {
+                    && recvThresholds[p + 1] <= sortedKeys[i]) {
                 p++;
             }
             assert(p < comm->getSize());
@@ -925,52 +1136,65 @@ void HilbertCurve<IndexType, ValueType>::redistribute(std::vector<DenseVector<Va
 
     {
         SCAI_REGION("HilbertCurve.redistribute.redistribute");
-        // for each dimension: define DenseVector with new distribution, get write access to local values, call exchangeByPlan
-        std::vector<ValueType> sendBuffer(localN);
-        std::vector<ValueType> recvBuffer(newLocalN);
+        // pack the coordinates and, if not uniform, the node weights of every point and send them in one exchange
+        const IndexType numWeightsToSend = nodesUnweighted ? 0 : numNodeWeights;
+        const IndexType valuesPerPoint = settings.dimensions + numWeightsToSend;
+
+        std::vector<ValueType> sendBuffer(localN*valuesPerPoint);
+        std::vector<ValueType> recvBuffer(newLocalN*valuesPerPoint);
 
-        for (IndexType d = 0; d < settings.dimensions; d++) {
-            {
-                SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
+        {
+            SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
+            for (IndexType d = 0; d < settings.dimensions; d++) {
                 scai::hmemo::ReadAccess<ValueType> rCoords(coordinates[d].getLocalValues());
-                for (IndexType i = 0; i < localN; i++) { //TODO:maybe extract into lambda?
-                    sendBuffer[i] = rCoords[permutation[i]]; //TODO: how to make this more cache-friendly? (Probably by using pairs and sorting them.)
+                for (IndexType i = 0; i < localN; i++) {
+                    sendBuffer[i*valuesPerPoint + d] = rCoords[permutation[i]];
                 }
             }
+            for (IndexType w = 0; w < numWeightsToSend; w++) {
+                scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights[w].getLocalValues());
+                for (IndexType i = 0; i < localN; i++) {
+                    sendBuffer[i*valuesPerPoint + settings.dimensions + w] = rWeights[permutation[i]];
+                }
+            }
+        }
+
+        // the plans count points, every point has valuesPerPoint entries
+        auto scalePlan = [&comm, valuesPerPoint](const scai::dmemo::CommunicationPlan& plan) {
+            std::vector<IndexType> valueQuantities(comm->getSize(), 0);
+            for (IndexType i = 0; i < plan.size(); i++) {
+                valueQuantities[plan[i].partitionId] = plan[i].quantity*valuesPerPoint;
+            }
+            return scai::dmemo::CommunicationPlan(valueQuantities.data(), valueQuantities.size());
+        };
+        const scai::dmemo::CommunicationPlan sendValuesPlan = scalePlan(sendPlan);
+        const scai::dmemo::CommunicationPlan recvValuesPlan = scalePlan(recvPlan);
+        comm->exchangeByPlan(recvBuffer.data(), recvValuesPlan, sendBuffer.data(), sendValuesPlan);
+
+        //the position of every received point in the new local values
+        std::vector<IndexType> newLocalPos(newLocalN);
+        for (IndexType i = 0; i < newLocalN; i++) {
+            newLocalPos[i] = newDist->global2Local(recvIndices[i]);
+        }
 
-            comm->exchangeByPlan(recvBuffer.data(), recvPlan, sendBuffer.data(), sendPlan);
-            coordinates[d] = DenseVector<ValueType>(newDist, 0);
-            {
-                SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
+        {
+            SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
+            for (IndexType d = 0; d < settings.dimensions; d++) {
+                coordinates[d] = DenseVector<ValueType>(newDist, 0);
                 scai::hmemo::WriteAccess<ValueType> wCoords(coordinates[d].getLocalValues());
                 assert(wCoords.size() == newLocalN);
                 for (IndexType i = 0; i < newLocalN; i++) {
-                    wCoords[newDist->global2Local(recvIndices[i])] =
-                        recvBuffer[i];
+                    wCoords[newLocalPos[i]] = recvBuffer[i*valuesPerPoint + d];
                 }
             }
-        }
-        // same for node weights
-        for (IndexType w = 0; w < numNodeWeights; w++) {
-            if (nodesUnweighted) {
-                nodeWeights[w] = DenseVector<ValueType>(newDist, nodeWeights[w].getLocalValues()[0]);
-            }
-            else
-            {
-                {
-                    SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
-                    scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights[w].getLocalValues());
-                    for (IndexType i = 0; i < localN; i++) {
-                        sendBuffer[i] = rWeights[permutation[i]]; //TODO: how to make this more cache-friendly? (Probably by using pairs and sorting them.)
-                    }
-                }
-                comm->exchangeByPlan(recvBuffer.data(), recvPlan, sendBuffer.data(), sendPlan);
-                nodeWeights[w] = DenseVector<ValueType>(newDist, 0);
-                {
-                    SCAI_REGION("HilbertCurve.redistribute.redistribute.permute");
+            for (IndexType w = 0; w < numNodeWeights; w++) {
+                if (nodesUnweighted) {
+                    nodeWeights[w] = DenseVector<ValueType>(newDist, nodeWeights[w].getLocalValues()[0]);
+                } else {
+                    nodeWeights[w] = DenseVector<ValueType>(newDist, 0);
                     scai::hmemo::WriteAccess<ValueType> wWeights(nodeWeights[w].getLocalValues());
                     for (IndexType i = 0; i < newLocalN; i++) {
-                        wWeights[newDist->global2Local(recvIndices[i])] = recvBuffer[i];
+                        wWeights[newLocalPos[i]] = recvBuffer[i*valuesPerPoint + settings.dimensions + w];
                     }
                 }
             }
@@ -1048,30 +1272,6 @@ bool HilbertCurve<IndexType, ValueType>::confirmHilbertDistribution(
 }
 //-------------------------------------------------------------------------------------------------
 
-//template function to get a MPI datatype. These are on purpose outside
-// the class because we cannot specialize them without specializing
-// the whole class. Maybe doing so it not a problem...
-
-template<>
-MPI_Datatype getMPIType<float>(){
- return MPI_FLOAT;
-}
-
-template<>
-MPI_Datatype getMPIType<double>(){
-    return MPI_DOUBLE ;
-}
-
-template<>
-MPI_Datatype getMPITypePair<double,IndexType>(){
-    return MPI_DOUBLE_INT;
-}
-
-template<>
-MPI_Datatype getMPITypePair<float,IndexType>(){
-    return MPI_FLOAT_INT;
-}
-
 //-------------------------------------------------------------------------------------------------
 
 template class HilbertCurve<IndexType, double>;
@@ -12,6 +12,7 @@
 #include <climits>
 #include <queue>
 #include <algorithm>
+#include <type_traits>
 
 #include <scai/lama.hpp>
 #include <scai/lama/matrix/all.hpp>
@@ -30,6 +31,7 @@
 
 #include "Settings.h"
 #include "Metrics.h"
+#include "MPIDataTypes.h"
 
 
 namespace ITI {
@@ -42,7 +44,7 @@ using scai::lama::DenseVector;
 template <typename ValueType>
 struct sort_pair {
     ValueType value;
-    int32_t index;
+    IndexType index;
     bool operator<(const sort_pair<ValueType>& rhs ) const {
         return value < rhs.value || (value == rhs.value && index < rhs.index);
     }
@@ -81,11 +83,8 @@ public:
     static scai::lama::DenseVector<IndexType> computePartition(const std::vector<DenseVector<ValueType>> &coordinates, Settings settings);
 
     /** \overload
-    @param[in] nodeWeights Weights for the points
-    */
-    /*
-    * Get an initial partition using the Hilbert curve.
-    * TODO: This currently does nothing and isn't used. Remove?
+    @param[in] nodeWeights Weights for the points. The blocks are balanced according to these weights,
+     unless settings.sfcSort is set; then all blocks get the same number of points.
     */
     static scai::lama::DenseVector<IndexType> computePartition(const std::vector<DenseVector<ValueType>> &coordinates, const DenseVector<ValueType> &nodeWeights, Settings settings);
 
@@ -153,6 +152,32 @@ public:
      */
     static std::vector<sort_pair<ValueType>> getSortedHilbertIndices( const std::vector<DenseVector<ValueType>> &coordinates, Settings settings);
 
+    /** Splits the space filling curve into \p numParts ranges of (almost) equal weight, without sorting
+     * the points globally.
+     *
+     * Every splitter is searched with a distributed histogram: the range of possible positions is divided
+     * into buckets, the weight of every bucket is summed over all PEs and the search continues in the bucket
+     * containing the weighted quantile. All splitters are refined at the same time, so every round costs one
+     * global sum of (numParts-1)*63 values; about ten rounds reach the resolution of a double.
+     * Points are ordered by the pair (hilbert index, global ID), so a run of points with the same index is
+     * split between blocks by a second search over the global IDs, which takes a few more rounds.
+     *
+     * @param[in] localIndices The hilbert indices of the local points, in [0,1).
+     * @param[in] localIDs The global IDs of the local points, non-negative and unique.
+     * @param[in] localWeights The weights of the local points.
+     * @param[in] numParts The number of ranges.
+     * @param[in] comm The communicator.
+     *
+     * @return A sorted vector of size numParts: range b contains the keys (index, ID) in [return[b], return[b+1]),
+     *  return[0]=(0,0) and the last range is open to the right.
+     */
+    static std::vector<std::pair<double,IndexType>> getWeightedSplitters(
+        const std::vector<double> &localIndices,
+        const std::vector<IndexType> &localIDs,
+        const std::vector<ValueType> &localWeights,
+        const IndexType numParts,
+        const scai::dmemo::CommunicatorPtr comm);
+
     /** Redistribute coordinates and weights according to an implicit hilberPartition.
      * Equivalent to (but faster):
      *  partition = hilbertPartition(coordinates, settings)
@@ -164,7 +189,12 @@ public:
      *  @param[in,out] coordinates Coordinates of input points, will be redistributed
      *  @param[in,out] nodeWeights NodeWeights of input points, will be redistributed
      *  @param[in] settings Settings struct, effectively only needed for the hilbert curve resolution
+     *      and settings.sfcSort
      *  @param[out] metrics
+     *
+     *  The ranges of the curve are found with getWeightedSplitters, balancing the number of points, and
+     *  coordinates and weights are sent in one exchange. With settings.sfcSort, the ranges are found with
+     *  a distributed sort instead.
      */
     static void redistribute(std::vector<DenseVector<ValueType> >& coordinates, std::vector<DenseVector<ValueType>>& nodeWeights, Settings settings, Metrics<ValueType>& metrics);
 
@@ -252,11 +282,13 @@ private:
 };
 
 
-template<typename T>
-MPI_Datatype getMPIType();
-
+/** The MPI datatype of sort_pair<T1>; T2 must be the IndexType.
+*/
 template<typename T1, typename T2>
-MPI_Datatype getMPITypePair();
+MPI_Datatype getMPITypePair() {
+    static_assert(std::is_same<T2, IndexType>::value, "The index of a sort_pair is always an IndexType");
+    return getMPIPairType<sort_pair<T1>, T1, T2>(offsetof(sort_pair<T1>, value), offsetof(sort_pair<T1>, index));
+}
 
 
 }//namespace ITI
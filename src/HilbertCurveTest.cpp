@@ -16,6 +16,7 @@
 #include <iostream>
 #include <chrono>
 #include <type_traits>
+#include <random>
 
 #include "GraphUtils.h"
 #include "gtest/gtest.h"
@@ -500,6 +501,220 @@ TYPED_TEST(HilbertCurveTest, testHilbertRedistribution) {
 }
 //-------------------------------------------------------------------------------------------------
 
+TYPED_TEST(HilbertCurveTest, testWeightedSplitters_Distributed) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType localN = 1000 + 100*comm->getRank();
+    const IndexType numParts = 2*comm->getSize() + 1;
+    const ValueType maxWeight = 10;
+
+    std::mt19937 generator(comm->getRank());
+    std::uniform_real_distribution<double> indexDist(0.0, 1.0);
+    std::uniform_real_distribution<ValueType> weightDist(1.0, maxWeight);
+
+    //skewed indices, so the splitters are not equidistant
+    std::vector<double> localIndices(localN);
+    std::vector<IndexType> localIDs(localN);
+    std::vector<ValueType> localWeights(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        localIndices[i] = std::pow(indexDist(generator), 3);
+        localIDs[i] = i*comm->getSize() + comm->getRank();
+        localWeights[i] = weightDist(generator);
+    }
+
+    const std::vector<std::pair<double,IndexType>> thresholds = HilbertCurve<IndexType, ValueType>::getWeightedSplitters( localIndices, localIDs, localWeights, numParts, comm );
+    ASSERT_EQ( thresholds.size(), numParts );
+    EXPECT_EQ( thresholds[0].first, 0 );
+    EXPECT_TRUE( std::is_sorted(thresholds.begin(), thresholds.end()) );
+
+    std::vector<double> blockWeights(numParts, 0);
+    double totalWeight = 0;
+    for (IndexType i = 0; i < localN; i++) {
+        const std::pair<double,IndexType> key(localIndices[i], localIDs[i]);
+        const IndexType block = std::upper_bound(thresholds.begin()+1, thresholds.end(), key) - (thresholds.begin()+1);
+        blockWeights[block] += localWeights[i];
+        totalWeight += localWeights[i];
+    }
+    comm->sumImpl(blockWeights.data(), blockWeights.data(), numParts, scai::common::TypeTraits<double>::stype);
+    totalWeight = comm->sum(totalWeight);
+
+    //a block can only be off by the weight of the points at its borders
+    for (IndexType b = 0; b < numParts; b++) {
+        EXPECT_NEAR( blockWeights[b], totalWeight/numParts, 2*maxWeight ) << "for block " << b;
+    }
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(HilbertCurveTest, testWeightedSplittersTiedIndices_Distributed) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType localN = 1000;
+    const IndexType numParts = 2*comm->getSize() + 1;
+
+    //half of all points have the same index, this run is larger than the points of several blocks
+    std::mt19937 generator(comm->getRank());
+    std::uniform_real_distribution<double> indexDist(0.0, 1.0);
+    std::vector<double> localIndices(localN);
+    std::vector<IndexType> localIDs(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        localIndices[i] = i % 2 == 0 ? 0.25 : indexDist(generator);
+        localIDs[i] = comm->getRank()*localN + i;
+    }
+    const std::vector<ValueType> localWeights(localN, 1);
+
+    const std::vector<std::pair<double,IndexType>> thresholds = HilbertCurve<IndexType, ValueType>::getWeightedSplitters( localIndices, localIDs, localWeights, numParts, comm );
+    ASSERT_EQ( thresholds.size(), numParts );
+    EXPECT_TRUE( std::is_sorted(thresholds.begin(), thresholds.end()) );
+
+    std::vector<double> blockWeights(numParts, 0);
+    for (IndexType i = 0; i < localN; i++) {
+        const std::pair<double,IndexType> key(localIndices[i], localIDs[i]);
+        const IndexType block = std::upper_bound(thresholds.begin()+1, thresholds.end(), key) - (thresholds.begin()+1);
+        blockWeights[block] += localWeights[i];
+    }
+    comm->sumImpl(blockWeights.data(), blockWeights.data(), numParts, scai::common::TypeTraits<double>::stype);
+
+    //unit weights, so every block is off by at most one point
+    const double optWeight = double(localN)*comm->getSize()/numParts;
+    for (IndexType b = 0; b < numParts; b++) {
+        EXPECT_NEAR( blockWeights[b], optWeight, 1 ) << "for block " << b;
+    }
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(HilbertCurveTest, testPartitionDuplicatePoints_Distributed) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType k = comm->getSize();
+    if (k == 1) {
+        GTEST_SKIP() << "Needs more than one process";
+    }
+
+    //a quarter of the points lie on the same spot, more than N/k for k > 4, the rest on a grid
+    const IndexType N = 4000;
+    const IndexType dimensions = 2;
+    const scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(N, comm));
+    std::vector<DenseVector<ValueType>> coords(dimensions, DenseVector<ValueType>(dist, 0));
+    for (IndexType d = 0; d < dimensions; d++) {
+        scai::hmemo::WriteAccess<ValueType> wCoords(coords[d].getLocalValues());
+        for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+            const IndexType globalI = dist->local2Global(i);
+            wCoords[i] = globalI % 4 == 0 ? 0.5 : (d == 0 ? globalI % 60 : globalI / 60);
+        }
+    }
+
+    //the default resolution, the grid points also share indices
+    Settings settings;
+    settings.dimensions = dimensions;
+    settings.numBlocks = k;
+    ASSERT_EQ( settings.sfcResolution, 9 );
+
+    const DenseVector<ValueType> nodeWeights(dist, 1);
+    DenseVector<IndexType> partition = HilbertCurve<IndexType, ValueType>::computePartition( coords, nodeWeights, settings );
+    EXPECT_EQ( partition.size(), N );
+
+    //every block gets N/k points, up to rounding
+    const IndexType localN = partition.getDistributionPtr()->getLocalSize();
+    EXPECT_GE( localN, N/k - 1 );
+    EXPECT_LE( localN, N/k + 2 );
+
+    //the redistribution splits the ties as well
+    std::vector<DenseVector<ValueType>> redistCoords(coords);
+    std::vector<DenseVector<ValueType>> redistWeights(1, nodeWeights);
+    Metrics<ValueType> metrics(settings);
+    HilbertCurve<IndexType, ValueType>::redistribute( redistCoords, redistWeights, settings, metrics );
+    const IndexType redistLocalN = redistCoords[0].getDistributionPtr()->getLocalSize();
+    EXPECT_GE( redistLocalN, N/k - 1 );
+    EXPECT_LE( redistLocalN, N/k + 2 );
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(HilbertCurveTest, testWeightedPartition_Distributed) {
+    using ValueType = TypeParam;
+
+    std::string file = HilbertCurveTest<ValueType>::graphPath + "bigtrace-00000.graph";
+    Settings settings;
+    settings.dimensions = 2;
+    settings.sfcResolution = 19;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    settings.numBlocks = comm->getSize();
+
+    scai::lama::CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file );
+    const IndexType N = graph.getNumRows();
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, settings.dimensions);
+
+    const scai::dmemo::DistributionPtr dist = coords[0].getDistributionPtr();
+    scai::lama::DenseVector<ValueType> nodeWeights(dist, 1);
+    {
+        scai::hmemo::WriteAccess<ValueType> wWeights(nodeWeights.getLocalValues());
+        for (IndexType i = 0; i < wWeights.size(); i++) {
+            wWeights[i] = 1 + dist->local2Global(i) % 3;
+        }
+    }
+
+    DenseVector<IndexType> partition = HilbertCurve<IndexType, ValueType>::computePartition( coords, nodeWeights, settings );
+    EXPECT_EQ( partition.size(), N );
+
+    //every PE owns exactly its block
+    {
+        scai::hmemo::ReadAccess<IndexType> rPart(partition.getLocalValues());
+        for (IndexType i = 0; i < rPart.size(); i++) {
+            EXPECT_EQ( rPart[i], comm->getRank() );
+        }
+    }
+
+    nodeWeights.redistribute( partition.getDistributionPtr() );
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks, nodeWeights );
+    EXPECT_LT( imbalance, 0.01 );
+
+    //the distributed sort balances the number of points only
+    settings.sfcSort = true;
+    DenseVector<IndexType> sortPartition = HilbertCurve<IndexType, ValueType>::computePartition( coords, settings );
+    EXPECT_EQ( sortPartition.size(), N );
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(HilbertCurveTest, testSortPairsLargeIDs_Distributed) {
+    using ValueType = TypeParam;
+
+    if (sizeof(IndexType) < 8) {
+        GTEST_SKIP() << "Needs a 64-bit IndexType, configure with USE_64BIT_INDEX";
+    }
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType localN = 1000;
+    //larger than 2^34 for a 64-bit IndexType
+    const IndexType offset = std::numeric_limits<IndexType>::max() >> 29;
+
+    std::mt19937 generator(comm->getRank());
+    std::uniform_real_distribution<ValueType> sfcDist(0.0, 1.0);
+
+    //global indices above 2^32, as for points of a very large mesh
+    std::vector<sort_pair<ValueType>> localPairs(localN);
+    unsigned long localSum = 0;
+    for (IndexType i = 0; i < localN; i++) {
+        localPairs[i].value = sfcDist(generator);
+        localPairs[i].index = offset + comm->getRank()*localN + i;
+        localSum += localPairs[i].index;
+    }
+
+    JanusSort::sort(MPI_COMM_WORLD, localPairs, getMPITypePair<ValueType,IndexType>());
+
+    EXPECT_TRUE( std::is_sorted(localPairs.begin(), localPairs.end()) );
+    unsigned long sortedSum = 0;
+    for (const sort_pair<ValueType>& pair : localPairs) {
+        EXPECT_GE( pair.index, offset );
+        EXPECT_LT( pair.index, offset + comm->getSize()*localN );
+        sortedSum += pair.index;
+    }
+    EXPECT_EQ( comm->sum(sortedSum), comm->sum(localSum) );
+}
+//-------------------------------------------------------------------------------------------------
+
 TYPED_TEST(HilbertCurveTest, testGetSortedHilbertIndices_Distributed) {
     using ValueType = TypeParam;
 
@@ -9,6 +9,7 @@
 #include <cmath>
 #include <assert.h>
 #include <algorithm>
+#include <omp.h>
 
 #include <scai/dmemo/NoDistribution.hpp>
 #include <scai/dmemo/GenBlockDistribution.hpp>
@@ -17,8 +18,10 @@
 #include "HilbertCurve.h"
 #include "MultiLevel.h"
 #include "quadtree/QuadNodeCartesianEuclid.h"
+#include "CenterTree.h"
 // temporary, for debugging
 #include "FileIO.h"
+#include "Telemetry.h"
 
 namespace ITI {
 
@@ -426,53 +429,57 @@ std::vector<point<ValueType>> KMeans<IndexType,ValueType>::findCenters(
 
     // TODO: check that distributions align
 
-    std::vector<std::vector<ValueType> > result(dim);
-    std::vector<ValueType> weightSum(k, 0.0);
-
     scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
     scai::hmemo::ReadAccess<IndexType> rPartition(partition.getLocalValues());
-
-    // compute weight sums
-    for (Iterator it = firstIndex; it != lastIndex; it++) {
-        const IndexType i = *it;
-        const IndexType part = rPartition[i];
-        const ValueType weight = rWeights[i];
-        weightSum[part] += weight;
-        // the lines above are equivalent to: weightSum[rPartition[*it]] += rWeights[*it];
+    std::vector<scai::hmemo::ReadAccess<ValueType>> rCoords;
+    rCoords.reserve(dim);
+    for (IndexType d = 0; d < dim; d++) {
+        rCoords.emplace_back(coordinates[d].getLocalValues());
     }
 
-    // find local centers
-    for (IndexType d = 0; d < dim; d++) {
-        result[d].resize(k,0);
-        scai::hmemo::ReadAccess<ValueType> rCoords(coordinates[d].getLocalValues());
+    const IndexType sampleN = std::distance(firstIndex, lastIndex);
+    const IndexType numThreads = omp_get_max_threads();
+
+    // the weight sums of all blocks, followed by the weighted coordinate sums of block j at k + j*dim;
+    // packing them allows a single reduction.
+    // Every thread sums into its own slice; the slices are added in thread order
+    // afterwards so the result does not depend on the scheduling
+    const IndexType sumSize = k*(dim+1);
+    std::vector<ValueType> threadSums(numThreads*sumSize, 0);
 
-        for (Iterator it = firstIndex; it != lastIndex; it++) {
-            const IndexType i = *it;
+    #pragma omp parallel
+    {
+        ValueType* mySums = threadSums.data() + omp_get_thread_num()*sumSize;
+        #pragma omp for schedule(static)
+        for (IndexType s = 0; s < sampleN; s++) {
+            const IndexType i = firstIndex[s];
             const IndexType part = rPartition[i];
-            result[d][part] += rCoords[i]*rWeights[i] / weightSum[part];// this is more expensive than summing first and dividing later, but avoids overflows
+            const ValueType weight = rWeights[i];
+            mySums[part] += weight;
+            ValueType* myCoordSums = mySums + k + part*dim;
+            for (IndexType d = 0; d < dim; d++) {
+                myCoordSums[d] += rCoords[d][i]*weight;
+            }
         }
     }
 
-    // communicate local centers and weight sums
-    std::vector<ValueType> totalWeight(k, 0);
-    comm->sumImpl(totalWeight.data(), weightSum.data(), k, scai::common::TypeTraits<ValueType>::stype);
-
-    // compute updated centers as weighted average
-    for (IndexType d = 0; d < dim; d++) {
-        for (IndexType j = 0; j < k; j++) {
-            ValueType weightRatio = (ValueType(weightSum[j]) / totalWeight[j]);
+    std::vector<ValueType> sums(sumSize, 0);
+    for (IndexType t = 0; t < numThreads; t++) {
+        for (IndexType j = 0; j < sumSize; j++) {
+            sums[j] += threadSums[t*sumSize+j];
+        }
+    }
 
-            ValueType weightedCoord = weightSum[j] == 0 ? 0 : result[d][j] * weightRatio;
-            result[d][j] = weightedCoord;
-            assert(std::isfinite(result[d][j]));
+    comm->sumImpl(sums.data(), sums.data(), sumSize, scai::common::TypeTraits<ValueType>::stype);
 
-            // make empty clusters explicit
-            if (totalWeight[j] == 0) {
-                result[d][j] = NAN;
-            }
+    // compute updated centers as weighted average, make empty clusters explicit
+    std::vector<std::vector<ValueType> > result(dim, std::vector<ValueType>(k));
+    for (IndexType j = 0; j < k; j++) {
+        const ValueType totalWeight = sums[j];
+        for (IndexType d = 0; d < dim; d++) {
+            result[d][j] = totalWeight == 0 ? NAN : sums[k + j*dim + d] / totalWeight;
+            assert(totalWeight == 0 or std::isfinite(result[d][j]));
         }
-
-        comm->sumImpl(result[d].data(), result[d].data(), k, scai::common::TypeTraits<ValueType>::stype);
     }
 
     return result;
@@ -498,11 +505,49 @@ std::vector<point<ValueType>> KMeans<IndexType,ValueType>::vectorTranspose(const
     return retPoints;
 }
 
+template<typename IndexType, typename ValueType>
+CenterGroups<IndexType,ValueType> KMeans<IndexType,ValueType>::groupCenters(
+    const std::vector<IndexType>& blockSizesPrefixSum,
+    const IndexType numGroups,
+    const IndexType localN) {
+    SCAI_ASSERT_GT_ERROR(numGroups, 0, "Number of center groups must be positive");
+
+    const IndexType numOldBlocks = blockSizesPrefixSum.size()-1;
+    const IndexType k = blockSizesPrefixSum.back();
+
+    CenterGroups<IndexType,ValueType> groups;
+    groups.groupOffsets.push_back(0);
+    groups.fatherGroupOffsets.push_back(0);
+    groups.centerGroup.resize(k);
+
+    for (IndexType b = 0; b < numOldBlocks; b++) {
+        const IndexType rangeStart = blockSizesPrefixSum[b];
+        const IndexType numCenters = blockSizesPrefixSum[b+1] - rangeStart;
+        const IndexType myGroups = std::min(numCenters, std::max(IndexType(1), IndexType(std::round(ValueType(numGroups)*numCenters/k))));
+
+        // contiguous groups of (almost) equal size
+        for (IndexType g = 0; g < myGroups; g++) {
+            const IndexType groupEnd = rangeStart + ((g+1)*numCenters)/myGroups;
+            for (IndexType c = groups.groupOffsets.back(); c < groupEnd; c++) {
+                groups.centerGroup[c] = groups.groupOffsets.size()-1;
+            }
+            groups.groupOffsets.push_back(groupEnd);
+        }
+        groups.fatherGroupOffsets.push_back(groups.groupOffsets.size()-1);
+        groups.stride = std::max(groups.stride, myGroups);
+    }
+
+    groups.lowerBound.assign(std::size_t(localN)*groups.stride, 0);
+
+    return groups;
+}
+
 template<typename IndexType, typename ValueType>
 template<typename Iterator>
 DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     const std::vector<std::vector<ValueType>>& coordinates,
-    const std::vector<point<ValueType>>& centers,
+    const CoordinateCache<ValueType>& coordCache,
+    const std::vector<ValueType>& centers,
     const std::vector<IndexType>& blockSizesPrefixSum,
     const Iterator firstIndex,
     const Iterator lastIndex,
@@ -514,8 +559,11 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     const SpatialCell<ValueType> &boundingBox,
     std::vector<ValueType> &upperBoundOwnCenter,
     std::vector<ValueType> &lowerBoundNextCenter,
+    CenterGroups<IndexType,ValueType> &groups,
     std::vector<std::vector<ValueType>> &influence,
     std::vector<ValueType> &imbalance,
+    std::vector<ValueType> &newCenters,
+    std::vector<std::vector<ValueType>> &finalBlockWeights,
     Settings settings,
     Metrics<ValueType>& metrics) {
     SCAI_REGION("KMeans.assignBlocks");
@@ -530,10 +578,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
         throw std::runtime_error("currentLocalN: " + std::to_string(currentLocalN));
     }
 
-    if (currentLocalN == 0) {
-        PRINT("Process " + std::to_string(comm->getRank()) + " has no local points!");
-        return previousAssignment;
-    }
+    // a process without points in the current sample still takes part in all collectives, with zero contributions
 
     // if repartition, numOldBlocks=1
     // number of blocks from the previous hierarchy
@@ -551,16 +596,31 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     }
 
     // numNewBlocks is equivalent to 'k' in the classic version
-    IndexType numNewBlocks = centers.size();
+    IndexType numNewBlocks = centers.size() / dim;
 
     SCAI_ASSERT_EQ_ERROR(blockSizesPrefixSum.back(), numNewBlocks, "Total number of new blocks mismatch");
 
-    // centers are given as a 1D vector alongside with a prefix sum vector
-    const std::vector<point<ValueType>>& centers1DVector = centers;
+    // centers are given as one contiguous array, center j is centers1DVector[j*dim] to centers1DVector[j*dim+dim-1],
+    // alongside with a prefix sum vector
+    const std::vector<ValueType>& centers1DVector = centers;
 
-    SCAI_ASSERT_EQ_ERROR(centers1DVector.size(), numNewBlocks, "Vector size mismatch");
-    SCAI_ASSERT_EQ_ERROR(centers1DVector[0].size(), dim, "Center dimensions mismatch");
+    SCAI_ASSERT_EQ_ERROR(centers1DVector.size(), numNewBlocks*dim, "Center dimensions mismatch");
     SCAI_ASSERT_EQ_ERROR(influence.size(), numNodeWeights, "Vector size mismatch");
+
+    // with the packed coordinate cache, points and centers are compared relative to the origin of the cache
+    const bool useCache = not coordCache.empty();
+    std::vector<ValueType> shiftedCenters;
+    if (useCache) {
+        SCAI_ASSERT_EQ_ERROR(coordCache.coords.size(), std::size_t(localN)*dim, "Coordinate cache does not fit the points");
+        SCAI_ASSERT_EQ_ERROR(coordCache.origin.size(), dim, "Coordinate cache does not fit the dimension");
+        shiftedCenters = centers1DVector;
+        for (IndexType j = 0; j < numNewBlocks; j++) {
+            for (IndexType d = 0; d < dim; d++) {
+                shiftedCenters[j*dim+d] -= coordCache.origin[d];
+            }
+        }
+    }
+    const ValueType* centerCoords = useCache ? shiftedCenters.data() : centers1DVector.data();
     for (IndexType i = 0; i < numNodeWeights; i++) {
         SCAI_ASSERT_EQ_ERROR(influence[i].size(), numNewBlocks, "Vector size mismatch");
     }
@@ -573,7 +633,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     for (IndexType newB=0; newB<numNewBlocks; newB++) {
         SCAI_REGION("KMeans.assignBlocks.filterCenters");
 
-        point<ValueType> center = centers1DVector[newB];
+        point<ValueType> center(centers1DVector.begin()+newB*dim, centers1DVector.begin()+(newB+1)*dim);
         ValueType influenceMin = std::numeric_limits<ValueType>::max();
         for (IndexType i = 0; i < numNodeWeights; i++) {
             influenceMin = std::min(influenceMin, influence[i][newB]);
@@ -622,10 +682,71 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     std::vector<ValueType> influenceChangeUpperBound(numNewBlocks, 1+settings.influenceChangeCap);
     std::vector<ValueType> influenceChangeLowerBound(numNewBlocks, 1-settings.influenceChangeCap);
 
+    // Yinyang bounds: one lower bound per group of centers of the father block
+    const bool useGroups = not groups.empty();
+    const IndexType numGroups = useGroups ? groups.groupOffsets.size()-1 : 0;
+    const IndexType groupStride = groups.stride;
+    if (useGroups) {
+        SCAI_ASSERT_EQ_ERROR(groups.groupOffsets.back(), numNewBlocks, "Center groups do not fit the centers");
+        SCAI_ASSERT_EQ_ERROR(groups.lowerBound.size(), std::size_t(localN)*groupStride, "Group bounds do not fit the points");
+    }
+
+    // bounded migration when repartitioning: the effective distance to every block except the current block of a point,
+    // given by oldBlock, is multiplied with migrationFactor, and only the influence of overloaded blocks and their neighbors changes
+    const ValueType migrationFactor = settings.repartition ? 1 + settings.migrationPenalty : 1;
+    const bool restrictInfluence = settings.repartition and (settings.migrationPenalty > 0 or settings.migrationBudget > 0);
+    // blocks closer to an overloaded block than twice its distance to the closest other center count as its neighbors.
+    // Both the closest centers and the neighbors are found with a k-d tree over all centers and unit influence,
+    // so its lower bounds are plain squared distances
+    std::vector<ValueType> neighborRadius;
+    CenterTree<IndexType,ValueType> neighborTree;
+    const ValueType unitWeight = 1;
+    std::vector<IndexType> neighborStack;
+    if (restrictInfluence) {
+        SCAI_REGION("KMeans.assignBlocks.neighborRadius");
+        neighborTree.build(centers1DVector, dim, {0, numNewBlocks}, 1);
+        neighborTree.updateInfluence(std::vector<std::vector<ValueType>>(1, std::vector<ValueType>(numNewBlocks, 1)));
+
+        neighborRadius.assign(numNewBlocks, std::numeric_limits<ValueType>::max());
+        for (IndexType a = 0; a < numNewBlocks; a++) {
+            const ValueType* centerA = centers1DVector.data() + a*dim;
+            ValueType closestSqDist = std::numeric_limits<ValueType>::max();
+            neighborTree.query(0, centerA, &unitWeight, closestSqDist,
+            [&](IndexType b) {
+                if (a == b) return;
+                ValueType sqDist = 0;
+                for (IndexType d = 0; d < dim; d++) {
+                    sqDist += std::pow(centerA[d] - centers1DVector[b*dim+d], 2);
+                }
+                closestSqDist = std::min(closestSqDist, sqDist);
+            }, neighborStack);
+            neighborRadius[a] = std::min(neighborRadius[a], 4*closestSqDist);
+        }
+    }
+    std::vector<bool> mobileBlock(numNewBlocks, true);
+
+    // k-d tree over the centers, the influence bounds are refreshed in every balance iteration
+    const bool useTree = settings.centerTree and not useGroups;
+    CenterTree<IndexType,ValueType> centerTree;
+    if (useTree) {
+        SCAI_REGION("KMeans.assignBlocks.buildCenterTree");
+        centerTree.build(useCache ? shiftedCenters : centers1DVector, dim, blockSizesPrefixSum, numNodeWeights);
+    }
+
     // compute assignment and balance
     DenseVector<IndexType> assignment = previousAssignment;
     bool allWeightsBalanced = false; // balance over all weights and all blocks
 
+    // block weights and weighted coordinate sums computed by every thread, merged in thread order after the assignment.
+    // The weight of block b for node weight j is at j*numNewBlocks+b, the coordinate sums of block b,
+    // weighted with the first node weight, start at numNodeWeights*numNewBlocks + b*dim.
+    // Packing them allows a single reduction per balance iteration, and the sums of the last iteration give the new centers.
+    const IndexType numThreads = omp_get_max_threads();
+    const IndexType coordSumOffset = numNodeWeights*numNewBlocks;
+    const IndexType packedSize = coordSumOffset + numNewBlocks*dim;
+    std::vector<ValueType> threadBlockWeights(numThreads*packedSize);
+    std::vector<ValueType> packedSums(packedSize);
+
 
     // iterate if necessary to achieve balance
     do
@@ -642,126 +763,292 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
         skippedLoops = 0;
         IndexType balancedBlocks = 0;
 
+        if (useTree) {
+            centerTree.updateInfluence(influence);
+        }
+
         scai::hmemo::ReadAccess<IndexType> rOldBlock(oldBlock.getLocalValues());
         scai::hmemo::WriteAccess<IndexType> wAssignment(assignment.getLocalValues());
         {
             SCAI_REGION("KMeans.assignBlocks.balanceLoop.assign");
-            // for the sampled range
-            for (Iterator it = firstIndex; it != lastIndex; it++) {
-                const IndexType i = *it;
-                const IndexType oldCluster = wAssignment[i];
-                const IndexType fatherBlock = rOldBlock[i];
-                const IndexType veryLocalI = std::distance(firstIndex, it);
-
-                if (not settings.repartition) {
-                    SCAI_ASSERT_LT_ERROR(fatherBlock, numOldBlocks, "Wrong father block index");
-                } else {
-                    // numOldBlocks=1 but father block<numNewBlocks
-                    SCAI_ASSERT_LT_ERROR(fatherBlock, numNewBlocks, "Wrong father block index");
-                }
+            std::fill(threadBlockWeights.begin(), threadBlockWeights.end(), 0);
 
-                assert(influenceEffectOfOwn[veryLocalI] == 0);
-                for (IndexType j = 0; j < numNodeWeights; j++) {
-                    influenceEffectOfOwn[veryLocalI] += influence[j][oldCluster]*normalizedNodeWeights[j][i];
-                }
+            // prefix sums are non-decreasing, so this bounds the center range of every father block
+            SCAI_ASSERT_LE_ERROR(blockSizesPrefixSum.back(), clusterIndicesAllBlocks.size(), "Range out of bounds");
 
-                if (lowerBoundNextCenter[i] > upperBoundOwnCenter[i]) {
-                    // cluster assignment cannot have changed.
-                    // wAssignment[i] = wAssignment[i];
-                    skippedLoops++;
-                } else {
-                    ValueType sqDistToOwn = 0;
-                    const point<ValueType>& myCenter = centers1DVector[oldCluster];
-                    for (IndexType d = 0; d < dim; d++) {
-                        sqDistToOwn += std::pow(myCenter[d]-coordinates[d][i], 2);
+            // exceptions must not leave the parallel region, failed checks are counted and reported after it
+            IndexType wrongFatherBlocks = 0;
+            IndexType wrongBounds = 0;
+
+            // for the sampled range. Static scheduling, so every thread always gets the same points
+            // and the per-thread block weights are reproducible
+            #pragma omp parallel reduction(+:totalComps,skippedLoops,wrongFatherBlocks,wrongBounds)
+            {
+                ValueType* myBlockWeights = threadBlockWeights.data() + omp_get_thread_num()*packedSize;
+
+                // the coordinates of the current point, read once from the coordinates or the cache
+                std::vector<ValueType> pointCoords(dim);
+
+                // buffers for the center tree; the closest centers of the previous point are tried first
+                std::vector<ValueType> pointWeights(numNodeWeights);
+                std::vector<IndexType> treeStack;
+                IndexType previousBest = -1;
+                IndexType previousSecond = -1;
+
+                // best and second best center of every scanned group of a point
+                std::vector<IndexType> groupBest(groupStride, -1);
+                std::vector<ValueType> groupBestValue(groupStride);
+                std::vector<ValueType> groupSecondValue(groupStride);
+
+                #pragma omp for schedule(static)
+                for (IndexType veryLocalI = 0; veryLocalI < currentLocalN; veryLocalI++) {
+                    const IndexType i = firstIndex[veryLocalI];
+                    const IndexType oldCluster = wAssignment[i];
+                    const IndexType fatherBlock = rOldBlock[i];
+
+                    if (useCache) {
+                        const float* cachedPoint = coordCache.coords.data() + std::size_t(i)*dim;
+                        for (IndexType d = 0; d < dim; d++) {
+                            pointCoords[d] = cachedPoint[d];
+                        }
+                    } else {
+                        for (IndexType d = 0; d < dim; d++) {
+                            pointCoords[d] = coordinates[d][i];
+                        }
+                    }
+
+                    // if repartition, numOldBlocks=1 but father block<numNewBlocks
+                    if (fatherBlock < 0 or fatherBlock >= (settings.repartition ? numNewBlocks : numOldBlocks)) {
+                        wrongFatherBlocks++;
+                        continue;
+                    }
+
+                    // with repartitioning, leaving the current block costs the migration penalty
+                    const IndexType homeBlock = settings.repartition ? fatherBlock : -1;
+
+                    assert(influenceEffectOfOwn[veryLocalI] == 0);
+                    for (IndexType j = 0; j < numNodeWeights; j++) {
+                        influenceEffectOfOwn[veryLocalI] += influence[j][oldCluster]*normalizedNodeWeights[j][i];
+                    }
+                    if (oldCluster != homeBlock) {
+                        influenceEffectOfOwn[veryLocalI] *= migrationFactor;
                     }
 
-                    ValueType newEffectiveDistance = sqDistToOwn*influenceEffectOfOwn[veryLocalI];
-                    SCAI_ASSERT_LE_ERROR(newEffectiveDistance, upperBoundOwnCenter[i], "Distance upper bound was wrong");
-                    upperBoundOwnCenter[i] = newEffectiveDistance;
                     if (lowerBoundNextCenter[i] > upperBoundOwnCenter[i]) {
                         // cluster assignment cannot have changed.
                         // wAssignment[i] = wAssignment[i];
                         skippedLoops++;
                     } else {
-                        // check the centers of this old block to find the closest one
-                        IndexType bestBlock = 0;
-                        ValueType bestValue = std::numeric_limits<ValueType>::max();
-                        ValueType influenceEffectOfBestBlock = -1;
-                        IndexType secondBest = 0;
-                        ValueType secondBestValue = std::numeric_limits<ValueType>::max();
-
-                        // if repartition, blockSizesPrefixSum only has two elements and the fatherBlock index is wrong
-                        // where the range of indices starts for the father block
-                        const IndexType rangeStart = settings.repartition ? 0 : blockSizesPrefixSum[fatherBlock];
-                        const IndexType rangeEnd =  settings.repartition ? blockSizesPrefixSum.back() : blockSizesPrefixSum[fatherBlock+1];
-                        SCAI_ASSERT_LE_ERROR(rangeEnd, clusterIndicesAllBlocks.size(), "Range out of bounds");
-
-                        // start with the first center index
-                        IndexType c = rangeStart;
-
-                        // check all centers belonging to the father block to find the closest
-                        while (c < rangeEnd && secondBestValue > effectMinDistAllBlocks[c]) {
-                            totalComps++;
-                            // remember: cluster centers are sorted according to their distance from the bounding box of this PE
-                            // also, the cluster indices go from 0 till numNewBlocks
-                            IndexType j = clusterIndicesAllBlocks[c];// maybe it would be useful to sort the whole centers array, aligning memory accesses.
-
-                            // squared distance from previous assigned center
-                            ValueType sqDist = 0;
-                            const point<ValueType>& myCenter = centers1DVector[j];
-                            // TODO: restructure arrays to align memory accesses better in inner loop
-                            for (IndexType d = 0; d < dim; d++) {
-                                sqDist += std::pow(myCenter[d]-coordinates[d][i], 2);
+                        ValueType sqDistToOwn = 0;
+                        const ValueType* myCenter = centerCoords + oldCluster*dim;
+                        for (IndexType d = 0; d < dim; d++) {
+                            sqDistToOwn += std::pow(myCenter[d]-pointCoords[d], 2);
+                        }
+
+                        ValueType newEffectiveDistance = sqDistToOwn*influenceEffectOfOwn[veryLocalI];
+                        if (newEffectiveDistance > upperBoundOwnCenter[i]) {
+                            wrongBounds++;
+                        }
+                        upperBoundOwnCenter[i] = newEffectiveDistance;
+                        if (lowerBoundNextCenter[i] > upperBoundOwnCenter[i]) {
+                            // cluster assignment cannot have changed.
+                            // wAssignment[i] = wAssignment[i];
+                            skippedLoops++;
+                        } else if (useGroups) {
+                            // only scan the groups whose lower bound is below the best distance found so far
+                            ValueType* myBounds = groups.lowerBound.data() + std::size_t(i)*groupStride;
+                            const IndexType father = settings.repartition ? 0 : fatherBlock;
+                            const IndexType firstGroup = groups.fatherGroupOffsets[father];
+                            const IndexType numMyGroups = groups.fatherGroupOffsets[father+1] - firstGroup;
+
+                            IndexType bestBlock = oldCluster;
+                            ValueType bestValue = upperBoundOwnCenter[i];
+                            ValueType influenceEffectOfBestBlock = influenceEffectOfOwn[veryLocalI];
+
+                            for (IndexType g = 0; g < numMyGroups; g++) {
+                                groupBest[g] = -1;
+                                if (myBounds[g] > bestValue) {
+                                    continue;
+                                }
+                                groupBestValue[g] = std::numeric_limits<ValueType>::max();
+                                groupSecondValue[g] = std::numeric_limits<ValueType>::max();
+
+                                for (IndexType j = groups.groupOffsets[firstGroup+g]; j < groups.groupOffsets[firstGroup+g+1]; j++) {
+                                    totalComps++;
+                                    ValueType sqDist = 0;
+                                    const ValueType* myCenter = centerCoords + j*dim;
+                                    for (IndexType d = 0; d < dim; d++) {
+                                        sqDist += std::pow(myCenter[d]-pointCoords[d], 2);
+                                    }
+
+                                    ValueType influenceEffect = 0;
+                                    for (IndexType w = 0; w < numNodeWeights; w++) {
+                                        influenceEffect += influence[w][j]*normalizedNodeWeights[w][i];
+                                    }
+                                    if (j != homeBlock) {
+                                        influenceEffect *= migrationFactor;
+                                    }
+                                    const ValueType effectiveDistance = sqDist*influenceEffect;
+
+                                    if (effectiveDistance < groupBestValue[g]) {
+                                        groupSecondValue[g] = groupBestValue[g];
+                                        groupBestValue[g] = effectiveDistance;
+                                        groupBest[g] = j;
+                                    } else if (effectiveDistance < groupSecondValue[g]) {
+                                        groupSecondValue[g] = effectiveDistance;
+                                    }
+
+                                    if (effectiveDistance < bestValue) {
+                                        bestBlock = j;
+                                        bestValue = effectiveDistance;
+                                        influenceEffectOfBestBlock = influenceEffect;
+                                    }
+                                }
                             }
 
-                            ValueType influenceEffect = 0;
-                            for (IndexType w = 0; w < numNodeWeights; w++) {
-                                influenceEffect += influence[w][j]*normalizedNodeWeights[w][i];
+                            if (bestBlock != oldCluster and bestValue < lowerBoundNextCenter[i]) {
+                                wrongBounds++;
                             }
-                            const ValueType effectiveDistance = sqDist*influenceEffect;
-
-                            // update best and second-best centers
-                            if (effectiveDistance < bestValue) {
-                                secondBest = bestBlock;
-                                secondBestValue = bestValue;
-                                bestBlock = j;
-                                bestValue = effectiveDistance;
-                                influenceEffectOfBestBlock = influenceEffect;
-                            } else if (effectiveDistance < secondBestValue) {
-                                secondBest = j;
-                                secondBestValue = effectiveDistance;
+
+                            // new group bounds: exact for scanned groups, the old own center joins the bound of its group
+                            ValueType nextValue = std::numeric_limits<ValueType>::max();
+                            for (IndexType g = 0; g < numMyGroups; g++) {
+                                if (groupBest[g] >= 0) {
+                                    myBounds[g] = groupBest[g] == bestBlock ? groupSecondValue[g] : groupBestValue[g];
+                                } else if (bestBlock != oldCluster and groups.centerGroup[oldCluster] == firstGroup+g) {
+                                    myBounds[g] = std::min(myBounds[g], upperBoundOwnCenter[i]);
+                                }
+                                nextValue = std::min(nextValue, myBounds[g]);
                             }
-                            c++;
-                        } // while
 
-                        if (rangeEnd - rangeStart > 1) {
-                            SCAI_ASSERT_NE_ERROR(bestBlock, secondBest, "Best and second best should be different");
-                        }
+                            upperBoundOwnCenter[i] = bestValue;
+                            lowerBoundNextCenter[i] = nextValue;
+                            influenceEffectOfOwn[veryLocalI] = influenceEffectOfBestBlock;
+                            wAssignment[i] = bestBlock;
+                        } else {
+                            // check the centers of this old block to find the closest one
+                            IndexType bestBlock = 0;
+                            ValueType bestValue = std::numeric_limits<ValueType>::max();
+                            ValueType influenceEffectOfBestBlock = -1;
+                            IndexType secondBest = 0;
+                            ValueType secondBestValue = std::numeric_limits<ValueType>::max();
+
+                            // if repartition, blockSizesPrefixSum only has two elements and the fatherBlock index is wrong
+                            // where the range of indices starts for the father block
+                            const IndexType rangeStart = settings.repartition ? 0 : blockSizesPrefixSum[fatherBlock];
+                            const IndexType rangeEnd =  settings.repartition ? blockSizesPrefixSum.back() : blockSizesPrefixSum[fatherBlock+1];
+
+                            // update best and second-best centers with center j
+                            auto evaluateCenter = [&](const IndexType j) {
+                                totalComps++;
+                                // squared distance from previous assigned center
+                                ValueType sqDist = 0;
+                                const ValueType* myCenter = centerCoords + j*dim;
+                                for (IndexType d = 0; d < dim; d++) {
+                                    sqDist += std::pow(myCenter[d]-pointCoords[d], 2);
+                                }
+
+                                ValueType influenceEffect = 0;
+                                for (IndexType w = 0; w < numNodeWeights; w++) {
+                                    influenceEffect += influence[w][j]*normalizedNodeWeights[w][i];
+                                }
+                                if (j != homeBlock) {
+                                    influenceEffect *= migrationFactor;
+                                }
+                                const ValueType effectiveDistance = sqDist*influenceEffect;
+
+                                // update best and second-best centers
+                                if (effectiveDistance < bestValue) {
+                                    secondBest = bestBlock;
+                                    secondBestValue = bestValue;
+                                    bestBlock = j;
+                                    bestValue = effectiveDistance;
+                                    influenceEffectOfBestBlock = influenceEffect;
+                                } else if (effectiveDistance < secondBestValue) {
+                                    secondBest = j;
+                                    secondBestValue = effectiveDistance;
+                                }
+                            };
+
+                            if (useTree) {
+                                // start with the own center and the closest centers of the previous point of this thread;
+                                // the sampled indices are sorted, so consecutive points are usually close
+                                const IndexType hints[3] = {oldCluster, previousBest, previousSecond};
+                                for (IndexType h = 0; h < 3; h++) {
+                                    const IndexType j = hints[h];
+                                    if (j >= rangeStart and j < rangeEnd and std::find(hints, hints+h, j) == hints+h) {
+                                        evaluateCenter(j);
+                                    }
+                                }
+
+                                for (IndexType w = 0; w < numNodeWeights; w++) {
+                                    pointWeights[w] = normalizedNodeWeights[w][i];
+                                }
+
+                                const IndexType father = settings.repartition ? 0 : fatherBlock;
+                                centerTree.query(father, pointCoords.data(), pointWeights.data(), secondBestValue,
+                                [&](const IndexType j) {
+                                    if (std::find(hints, hints+3, j) == hints+3) {
+                                        evaluateCenter(j);
+                                    }
+                                }, treeStack);
+
+                                previousBest = bestBlock;
+                                previousSecond = secondBest;
+                            } else {
+                                // start with the first center index
+                                IndexType c = rangeStart;
+
+                                // check all centers belonging to the father block to find the closest
+                                while (c < rangeEnd && secondBestValue > effectMinDistAllBlocks[c]) {
+                                    // remember: cluster centers are sorted according to their distance from the bounding box of this PE
+                                    // also, the cluster indices go from 0 till numNewBlocks
+                                    evaluateCenter(clusterIndicesAllBlocks[c]);// maybe it would be useful to sort the whole centers array, aligning memory accesses.
+                                    c++;
+                                } // while
+                            }
 
-                        assert(secondBestValue >= bestValue);
+                            // best and second best should be different
+                            if (rangeEnd - rangeStart > 1 and bestBlock == secondBest) {
+                                wrongBounds++;
+                            }
 
-                        // this point has a new center
-                        if (bestBlock != oldCluster) {
-                            // assert(bestValue >= lowerBoundNextCenter[i]);
-                            SCAI_ASSERT_GE_ERROR(bestValue, lowerBoundNextCenter[i], \
-                                                 "PE " << comm->getRank() << ": difference " << std::abs(bestValue - lowerBoundNextCenter[i]) << \
-                                                 " for i= " << i << ", oldCluster: " << oldCluster << ", newCluster: " << bestBlock << \
-                                                 ", influenceEffect: " << influenceEffectOfBestBlock);
-                        }
+                            assert(secondBestValue >= bestValue);
 
-                        upperBoundOwnCenter[i] = bestValue;
-                        lowerBoundNextCenter[i] = secondBestValue;
-                        influenceEffectOfOwn[veryLocalI] = influenceEffectOfBestBlock;
-                        wAssignment[i] = bestBlock;
+                            // this point has a new center, it cannot be closer than the lower bound
+                            if (bestBlock != oldCluster and bestValue < lowerBoundNextCenter[i]) {
+                                wrongBounds++;
+                            }
+
+                            upperBoundOwnCenter[i] = bestValue;
+                            lowerBoundNextCenter[i] = secondBestValue;
+                            influenceEffectOfOwn[veryLocalI] = influenceEffectOfBestBlock;
+                            wAssignment[i] = bestBlock;
+                        }
                     }
-                }
-                // we found the best block for this point; increase the weight of this block
-                for (IndexType j = 0; j <numNodeWeights; j++) {
-                    blockWeights[j][wAssignment[i]] += nodeWeights[j][i];
-                }
+                    // we found the best block for this point; increase the weight and coordinate sums of this block
+                    const IndexType ownBlock = wAssignment[i];
+                    for (IndexType j = 0; j <numNodeWeights; j++) {
+                        myBlockWeights[j*numNewBlocks + ownBlock] += nodeWeights[j][i];
+                    }
+                    ValueType* myCoordSums = myBlockWeights + coordSumOffset + ownBlock*dim;
+                    for (IndexType d = 0; d < dim; d++) {
+                        myCoordSums[d] += pointCoords[d]*nodeWeights[0][i];
+                    }
+
+                }// for sampled indices
+            }// omp parallel
 
-            }// for sampled indices
+            SCAI_ASSERT_EQ_ERROR(wrongFatherBlocks, 0, "PE " << comm->getRank() << ": wrong father block index for " << wrongFatherBlocks << " points");
+            SCAI_ASSERT_EQ_ERROR(wrongBounds, 0, "PE " << comm->getRank() << ": distance bounds were wrong for " << wrongBounds << " points");
+
+            std::fill(packedSums.begin(), packedSums.end(), 0);
+            for (IndexType t = 0; t < numThreads; t++) {
+                const ValueType* tSums = threadBlockWeights.data() + t*packedSize;
+                for (IndexType x = 0; x < packedSize; x++) {
+                    packedSums[x] += tSums[x];
+                }
+            }
 
             std::chrono::duration<ValueType,std::ratio<1>> balanceTime = std::chrono::high_resolution_clock::now() - balanceStart;
             // timePerPE[comm->getRank()] += balanceTime.count();
@@ -769,10 +1056,13 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
             comm->synchronize();
         }// assignment block
 
-        for (IndexType j = 0; j < numNodeWeights; j++)
         {
             SCAI_REGION("KMeans.assignBlocks.balanceLoop.blockWeightSum");
-            comm->sumImpl(blockWeights[j].data(), blockWeights[j].data(), numNewBlocks, scai::common::TypeTraits<ValueType>::stype);
+            comm->sumImpl(packedSums.data(), packedSums.data(), packedSize, scai::common::TypeTraits<ValueType>::stype);
+            Telemetry::countCollective(packedSize*sizeof(ValueType));
+            for (IndexType j = 0; j < numNodeWeights; j++) {
+                std::copy(packedSums.begin() + j*numNewBlocks, packedSums.begin() + (j+1)*numNewBlocks, blockWeights[j].begin());
+            }
         }
 
         // calculate imbalance for every new block and every weight
@@ -795,9 +1085,40 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
             }
         }
 
+        // with bounded migration, only overloaded blocks and their neighbors may change their influence
+        if (restrictInfluence) {
+            std::vector<IndexType> overloaded;
+            for (IndexType j = 0; j < numNewBlocks; j++) {
+                for (IndexType i = 0; i < numNodeWeights; i++) {
+                    if (blockWeights[i][j] > targetBlockWeights[i][j]) {
+                        overloaded.push_back(j);
+                        break;
+                    }
+                }
+            }
+            std::fill(mobileBlock.begin(), mobileBlock.end(), false);
+            for (IndexType o : overloaded) {
+                const ValueType* centerO = centers1DVector.data() + o*dim;
+                mobileBlock[o] = true;
+                // the tree skips nodes whose lower bound is not smaller than the prune value, but the radius is inclusive
+                const ValueType pruneValue = std::nextafter(neighborRadius[o], std::numeric_limits<ValueType>::max());
+                neighborTree.query(0, centerO, &unitWeight, pruneValue,
+                [&](IndexType j) {
+                    ValueType sqDist = 0;
+                    for (IndexType d = 0; d < dim; d++) {
+                        sqDist += std::pow(centers1DVector[j*dim+d] - centerO[d], 2);
+                    }
+                    if (sqDist <= neighborRadius[o]) {
+                        mobileBlock[j] = true;
+                    }
+                }, neighborStack);
+            }
+        }
+
         // adapt influence values
         ValueType minRatio = std::numeric_limits<ValueType>::max();
         ValueType maxRatio = -std::numeric_limits<ValueType>::min();
+        std::vector<ValueType> groupMinRatio(numGroups, std::numeric_limits<ValueType>::max());
         std::vector<std::vector<ValueType>> oldInfluence = influence;// size=numNewBlocks
         for (IndexType i = 0; i < numNodeWeights; i++) {
             assert(oldInfluence[i].size()== numNewBlocks);
@@ -806,11 +1127,24 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
                 SCAI_REGION("KMeans.assignBlocks.balanceLoop.influence");
 
                 ValueType ratio = ValueType(blockWeights[i][j])/targetBlockWeights[i][j];
+                if (not mobileBlock[j]) {
+                    if (1 < minRatio) minRatio = 1;
+                    if (1 > maxRatio) maxRatio = 1;
+                    if (useGroups) {
+                        ValueType& groupRatio = groupMinRatio[groups.centerGroup[j]];
+                        groupRatio = std::min(groupRatio, ValueType(1));
+                    }
+                    continue;
+                }
                 if (std::abs(ratio - 1) < settings.epsilon) {
                     balancedBlocks++; // TODO: update for multiple weights
                     if (settings.freezeBalancedInfluence) {
                         if (1 < minRatio) minRatio = 1;
                         if (1 > maxRatio) maxRatio = 1;
+                        if (useGroups) {
+                            ValueType& groupRatio = groupMinRatio[groups.centerGroup[j]];
+                            groupRatio = std::min(groupRatio, ValueType(1));
+                        }
                         continue;
                     }
                 }
@@ -828,6 +1162,10 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
                 assert(influenceRatio >= influenceChangeLowerBound[j] - 1e-6);
                 if (influenceRatio < minRatio) minRatio = influenceRatio;
                 if (influenceRatio > maxRatio) maxRatio = influenceRatio;
+                if (useGroups) {
+                    ValueType& groupRatio = groupMinRatio[groups.centerGroup[j]];
+                    groupRatio = std::min(groupRatio, influenceRatio);
+                }
 
                 if (settings.tightenBounds && iter > 0 && (static_cast<bool>(ratio > 1) != influenceGrew[i][j])) {
                     // influence change switched direction
@@ -843,21 +1181,41 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
         // update bounds
         {
             SCAI_REGION("KMeans.assignBlocks.balanceLoop.updateBounds");
-            for (Iterator it = firstIndex; it != lastIndex; it++) {
-                const IndexType i = *it;
+            IndexType wrongInfluenceEffects = 0;
+            #pragma omp parallel for schedule(static) reduction(+:wrongInfluenceEffects)
+            for (IndexType veryLocalI = 0; veryLocalI < currentLocalN; veryLocalI++) {
+                const IndexType i = firstIndex[veryLocalI];
                 const IndexType cluster = wAssignment[i];
-                const IndexType veryLocalI = std::distance(firstIndex, it);// maybe optimize?
                 ValueType newInfluenceEffect = 0;
                 for (IndexType j = 0; j < numNodeWeights; j++) {
                     newInfluenceEffect += influence[j][cluster]*normalizedNodeWeights[j][i];
                 }
+                if (settings.repartition and cluster != rOldBlock[i]) {
+                    newInfluenceEffect *= migrationFactor;
+                }
 
-                SCAI_ASSERT_LE_ERROR((newInfluenceEffect / influenceEffectOfOwn[veryLocalI]), maxRatio + 1e-5, "Error in calculation of influence effect");
-                SCAI_ASSERT_GE_ERROR((newInfluenceEffect / influenceEffectOfOwn[veryLocalI]), minRatio - 1e-5, "Error in calculation of influence effect");
+                const ValueType effectRatio = newInfluenceEffect / influenceEffectOfOwn[veryLocalI];
+                if (effectRatio > maxRatio + 1e-5 or effectRatio < minRatio - 1e-5) {
+                    wrongInfluenceEffects++;
+                }
 
                 upperBoundOwnCenter[i] *= (newInfluenceEffect / influenceEffectOfOwn[veryLocalI]) + 1e-5;
                 lowerBoundNextCenter[i] *= minRatio - 1e-5;
+
+                if (useGroups) {
+                    // every group bound only depends on the influence change within the group
+                    ValueType* myBounds = groups.lowerBound.data() + std::size_t(i)*groupStride;
+                    const IndexType father = settings.repartition ? 0 : rOldBlock[i];
+                    const IndexType firstGroup = groups.fatherGroupOffsets[father];
+                    ValueType nextValue = std::numeric_limits<ValueType>::max();
+                    for (IndexType g = 0; g < groups.fatherGroupOffsets[father+1] - firstGroup; g++) {
+                        myBounds[g] = std::min(myBounds[g]*(groupMinRatio[firstGroup+g] - ValueType(1e-5)), std::numeric_limits<ValueType>::max());
+                        nextValue = std::min(nextValue, myBounds[g]);
+                    }
+                    lowerBoundNextCenter[i] = nextValue;
+                }
             }
+            SCAI_ASSERT_EQ_ERROR(wrongInfluenceEffects, 0, "Error in calculation of influence effect for " << wrongInfluenceEffects << " points");
         }
 
         // update possible closest centers
@@ -900,7 +1258,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
 
         if (settings.verbose) {
             const IndexType takenLoops = currentLocalN - skippedLoops;
-            const ValueType averageComps = ValueType(totalComps) / currentLocalN;
+            const ValueType averageComps = currentLocalN > 0 ? ValueType(totalComps) / currentLocalN : 0;
             std::vector<ValueType> influenceSpread(numNodeWeights);
             for (IndexType i = 0; i < numNodeWeights; i++) {
                 const auto pair = std::minmax_element(influence[i].begin(), influence[i].end());
@@ -918,7 +1276,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
 
             auto oldprecision = std::cout.precision(3);
             if (comm->getRank() == 0) {
-                std::cout << "Iter " << iter << ", loop: " << 100*ValueType(takenLoops) / currentLocalN << "%, average comparisons: "
+                std::cout << "Iter " << iter << ", loop: " << (currentLocalN > 0 ? 100*ValueType(takenLoops) / currentLocalN : 0) << "%, average comparisons: "
                           << averageComps << ", balanced blocks: " << 100*ValueType(balancedBlocks) / numNewBlocks << "%, influence spread: ";
                 for (IndexType i = 0; i < numNodeWeights; i++) {
                     std::cout << influenceSpread[i] << " ";
@@ -939,7 +1297,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     } while ((!allWeightsBalanced) && iter < settings.balanceIterations);
 
     if (settings.verbose) {
-        ValueType percentageSkipped = ValueType(skippedLoops*100) / (iter*localN);
+        ValueType percentageSkipped = localN > 0 ? ValueType(skippedLoops*100) / (iter*localN) : 0;
         ValueType maxSkipped = comm->max(percentageSkipped);
         ValueType minSkipped = comm->min(percentageSkipped);
         ValueType avgSkipped = comm->sum(percentageSkipped) / comm->getSize();
@@ -951,6 +1309,24 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::assignBlocks(
     // for kmeans profiling
     metrics.numBalanceIter.push_back(iter);
 
+    // the sums of the last iteration belong to the returned assignment
+    finalBlockWeights.resize(numNodeWeights);
+    for (IndexType j = 0; j < numNodeWeights; j++) {
+        finalBlockWeights[j].assign(packedSums.begin() + j*numNewBlocks, packedSums.begin() + (j+1)*numNewBlocks);
+    }
+
+    newCenters.resize(numNewBlocks*dim);
+    for (IndexType b = 0; b < numNewBlocks; b++) {
+        const ValueType totalWeight = packedSums[b];
+        for (IndexType d = 0; d < dim; d++) {
+            // make empty clusters explicit
+            newCenters[b*dim+d] = totalWeight == 0 ? NAN : packedSums[coordSumOffset + b*dim + d] / totalWeight;
+            if (useCache) {
+                newCenters[b*dim+d] += coordCache.origin[d];
+            }
+        }
+    }
+
     return assignment;
 }// assignBlocks
 
@@ -1020,7 +1396,8 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computeRepartition(
     const std::vector<DenseVector<ValueType>>& nodeWeights,
     const std::vector<std::vector<ValueType>>& blockSizes,
     const DenseVector<IndexType>& previous,
-    const Settings settings) {
+    const Settings settings,
+    Metrics<ValueType>& metrics) {
 
     const IndexType localN = previous.getLocalValues().size();
     scai::dmemo::CommunicatorPtr comm = coordinates[0].getDistributionPtr()->getCommunicatorPtr();
@@ -1049,8 +1426,6 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computeRepartition(
     Settings tmpSettings = settings;
     tmpSettings.repartition = true;
 
-    Metrics<ValueType> metrics(settings);
-
     return computePartition(coordinates, nodeWeights, blockSizes, previous, groupOfCenters, tmpSettings, metrics);
 }
 
@@ -1070,6 +1445,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     Metrics<ValueType>& metrics) {
 
     SCAI_REGION("KMeans.computePartition");
+    Telemetry::ScopedTimer telemetryTimer("kMeans");
     std::chrono::time_point<std::chrono::high_resolution_clock> KMeansStart = std::chrono::high_resolution_clock::now();
 
     // if repartition, by convention, numOldBlocks=1=center.size()
@@ -1108,26 +1484,28 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     // if repartition, centers1DVector=centers[0] (remember, centers.size()=1)
     // Basically, one vector with all the centers and the blockSizesPrefixSum is "useless"
 
-    // convert to a 1D vector
-    std::vector<point<ValueType>> centers1DVector;
+    const IndexType dim = coordinates.size();
+    assert(dim > 0);
+    SCAI_ASSERT_EQ_ERROR(centers[0][0].size(), dim, "Center dimensions mismatch");
+
+    // convert to one contiguous array, center j is centers1DVector[j*dim] to centers1DVector[j*dim+dim-1]
+    std::vector<ValueType> centers1DVector;
+    centers1DVector.reserve(totalNumNewBlocks*dim);
     for (int b=0; b<numOldBlocks; b++) {
         const unsigned int k = blockSizesPrefixSum[b+1]-blockSizesPrefixSum[b];
         assert(k==centers[b].size()); // not really needed, TODO: remove?
         for (IndexType i=0; i<k; i++) {
-            centers1DVector.push_back(centers[b][i]);
+            SCAI_ASSERT_EQ_ERROR(centers[b][i].size(), dim, "Center dimensions mismatch");
+            centers1DVector.insert(centers1DVector.end(), centers[b][i].begin(), centers[b][i].end());
         }
     }
-    SCAI_ASSERT_EQ_ERROR(centers1DVector.size(), totalNumNewBlocks, "Vector size mismatch");
+    SCAI_ASSERT_EQ_ERROR(centers1DVector.size(), totalNumNewBlocks*dim, "Vector size mismatch");
 
-    const IndexType dim = coordinates.size();
-    assert(dim > 0);
     const IndexType localN = coordinates[0].getLocalValues().size();
     const IndexType globalN = coordinates[0].size();
     for (IndexType i = 0; i < numNodeWeights; i++) {
         SCAI_ASSERT_EQ_ERROR(nodeWeights[i].getLocalValues().size(), localN, "Mismatch between node weights and coordinate size.");
     }
-    SCAI_ASSERT_EQ_ERROR(centers[0][0].size(), dim, "Center dimensions mismatch");
-    SCAI_ASSERT_EQ_ERROR(centers1DVector[0].size(), dim, "Center dimensions mismatch");
 
     scai::dmemo::CommunicatorPtr comm = coordinates[0].getDistributionPtr()->getCommunicatorPtr();
 
@@ -1174,9 +1552,9 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     // copy coordinates
     //
 
-    // min and max for local part of the coordinates
-    std::vector<ValueType> minCoords(dim);
-    std::vector<ValueType> maxCoords(dim);
+    // min and max for local part of the coordinates, neutral for the global reduction on processes without points
+    std::vector<ValueType> minCoords(dim, std::numeric_limits<ValueType>::max());
+    std::vector<ValueType> maxCoords(dim, std::numeric_limits<ValueType>::lowest());
 
     std::vector<std::vector<ValueType> > convertedCoords(dim);
     {
@@ -1184,8 +1562,10 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
             scai::hmemo::ReadAccess<ValueType> rAccess(coordinates[d].getLocalValues());
             convertedCoords[d] = std::vector<ValueType>(rAccess.get(), rAccess.get()+localN);
 
-            minCoords[d] = *std::min_element(convertedCoords[d].begin(), convertedCoords[d].end());
-            maxCoords[d] = *std::max_element(convertedCoords[d].begin(), convertedCoords[d].end());
+            if (localN > 0) {
+                minCoords[d] = *std::min_element(convertedCoords[d].begin(), convertedCoords[d].end());
+                maxCoords[d] = *std::max_element(convertedCoords[d].begin(), convertedCoords[d].end());
+            }
 
             assert(convertedCoords[d].size() == localN);
         }
@@ -1196,6 +1576,29 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     comm->minImpl(globalMinCoords.data(), minCoords.data(), dim, scai::common::TypeTraits<ValueType>::stype);
     comm->maxImpl(globalMaxCoords.data(), maxCoords.data(), dim, scai::common::TypeTraits<ValueType>::stype);
 
+    // the distance bounds of a process without points are never used, but must be finite
+    if (localN == 0) {
+        minCoords = globalMinCoords;
+        maxCoords = globalMaxCoords;
+    }
+
+    // packed single-precision copy relative to the global bounding box; the double copy is not needed anymore
+    CoordinateCache<ValueType> coordCache;
+    if (settings.mixedPrecision) {
+        SCAI_REGION("KMeans.computePartition.fillCoordinateCache");
+        coordCache.origin = globalMinCoords;
+        coordCache.coords.resize(std::size_t(localN)*dim);
+        #pragma omp parallel for schedule(static)
+        for (IndexType i = 0; i < localN; i++) {
+            for (IndexType d = 0; d < dim; d++) {
+                coordCache.coords[std::size_t(i)*dim+d] = convertedCoords[d][i] - globalMinCoords[d];
+            }
+        }
+        for (IndexType d = 0; d < dim; d++) {
+            std::vector<ValueType>().swap(convertedCoords[d]);
+        }
+    }
+
     ValueType diagonalLength = 0;
     ValueType volume = 1;
     ValueType localVolume = 1;
@@ -1221,6 +1624,15 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     std::vector<ValueType> upperBoundOwnCenter(localN, std::numeric_limits<ValueType>::max());
     std::vector<ValueType> lowerBoundNextCenter(localN, 0);
 
+    // one lower bound per group of centers, for large k
+    CenterGroups<IndexType,ValueType> groups;
+    if (settings.yinyangGroups > 0) {
+        groups = groupCenters(blockSizesPrefixSum, settings.yinyangGroups, localN);
+        if (settings.verbose) {
+            PRINT0("Using " << groups.groupOffsets.size()-1 << " center groups, at most " << groups.stride << " per father block");
+        }
+    }
+
     //
     // prepare sampling
     //
@@ -1282,6 +1694,26 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     ValueType delta = 0;
     bool balanced = false;
     const ValueType threshold = 0.002*diagonalLength;// TODO: take global point density into account
+
+    // the current entry of samples; without adaptive sampling, the sample grows in every round
+    IndexType sampleRound = 0;
+    IndexType roundsWithSampleSize = 0;
+    IndexType fullPasses = 0;
+    // rounds that repeat a sample size with adaptive sampling; they do not count towards maxKMeansIterations,
+    // so adaptive sampling does not leave fewer rounds for the full point set
+    IndexType reusedSampleRounds = 0;
+    // with adaptive sampling, the sampled solution already met the bounds and only one full pass is done
+    bool skipToFull = false;
+    const IndexType maxRoundsPerSampleSize = 3;
+
+    // settings for assignBlocks; when repartitioning with a migration budget, the migration penalty grows
+    // until the fraction of moved points is within the budget
+    Settings assignSettings = settings;
+    const bool useMigrationBudget = settings.repartition and settings.migrationBudget > 0;
+    if (useMigrationBudget and assignSettings.migrationPenalty <= 0) {
+        assignSettings.migrationPenalty = 0.1;
+    }
+    bool withinBudget = true;
     const IndexType maxIterations = settings.maxKMeansIterations;
     const typename std::vector<IndexType>::iterator firstIndex = localIndices.begin();
     typename std::vector<IndexType>::iterator lastIndex = localIndices.end();
@@ -1301,11 +1733,13 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
 
     do {
         std::chrono::time_point<std::chrono::high_resolution_clock> iterStart = std::chrono::high_resolution_clock::now();
-        if (iter < samplingRounds) {
-            SCAI_ASSERT_LE_ERROR(samples[iter], localN, "invalid number of samples");
-            lastIndex = localIndices.begin() + samples[iter];
-            std::sort(localIndices.begin(), lastIndex);// sorting not really necessary, but increases locality
-            [[maybe_unused]] ValueType ratio = ValueType(comm->sum(samples[iter])) / globalN;
+        if (sampleRound < samplingRounds) {
+            SCAI_ASSERT_LE_ERROR(samples[sampleRound], localN, "invalid number of samples");
+            if (roundsWithSampleSize == 0) {
+                lastIndex = localIndices.begin() + samples[sampleRound];
+                std::sort(localIndices.begin(), lastIndex);// sorting not really necessary, but increases locality
+            }
+            [[maybe_unused]] ValueType ratio = ValueType(comm->sum(samples[sampleRound])) / globalN;
             assert(ratio <= 1);
 
         } else {
@@ -1339,7 +1773,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
 
             for (IndexType j = 0; j < targetBlockWeights[i].size(); j++) {
                 adjustedBlockSizes[i][j] = ValueType(targetBlockWeights[i][j]) * ratio;
-                if (settings.verbose && iter < samplingRounds) {
+                if (settings.verbose && sampleRound < samplingRounds) {
                     if (j == 0 || heterogeneousBlockSizes[i]) {
                         PRINT0("Adjusted " + std::to_string(targetBlockWeights[i][j]) + " down to " + std::to_string(adjustedBlockSizes[i][j]));
                     }
@@ -1349,7 +1783,10 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
 
         std::vector<ValueType> timePerPE(comm->getSize(), 0.0);
 
-        result = assignBlocks(convertedCoords, centers1DVector, blockSizesPrefixSum, firstIndex, lastIndex, convertedNodeWeights, normalizedNodeWeights, result, partition, adjustedBlockSizes, boundingBox, upperBoundOwnCenter, lowerBoundNextCenter, influence, imbalances, settings, metrics);
+        // the new centers and the block weights are accumulated during the last assignment sweep
+        std::vector<ValueType> newCenters;
+        std::vector<std::vector<ValueType>> currentBlockWeights;
+        result = assignBlocks(convertedCoords, coordCache, centers1DVector, blockSizesPrefixSum, firstIndex, lastIndex, convertedNodeWeights, normalizedNodeWeights, result, partition, adjustedBlockSizes, boundingBox, upperBoundOwnCenter, lowerBoundNextCenter, groups, influence, imbalances, newCenters, currentBlockWeights, assignSettings, metrics);
 
         scai::hmemo::ReadAccess<IndexType> rResult(result.getLocalValues());
 
@@ -1371,21 +1808,13 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
             }
         }
 
-        // TODO: adapt for multiple weights
-        std::vector<std::vector<ValueType>> newCenters = findCenters(coordinates, result, totalNumNewBlocks, firstIndex, lastIndex, nodeWeights[0]);
-
-        // newCenters have reversed order of the vectors
-        // maybe turn centers to a 1D vector already in computePartition?
-
-        std::vector<point<ValueType>> transCenters = vectorTranspose(newCenters);
-        assert(transCenters.size()==totalNumNewBlocks);
-        assert(transCenters[0].size()==dim);
+        assert(newCenters.size()==totalNumNewBlocks*dim);
 
         // keep centroids of empty blocks at their last known position
         for (IndexType j = 0; j <totalNumNewBlocks; j++) {
             // center for block j is empty
-            if (std::isnan(transCenters[j][0])) {
-                transCenters[j] = centers1DVector[j];
+            if (std::isnan(newCenters[j*dim])) {
+                std::copy(centers1DVector.begin()+j*dim, centers1DVector.begin()+(j+1)*dim, newCenters.begin()+j*dim);
             }
         }
         std::vector<ValueType> squaredDeltas(totalNumNewBlocks,0);
@@ -1395,9 +1824,9 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
 
         for (IndexType j = 0; j < totalNumNewBlocks; j++) {
             for (int d = 0; d < dim; d++) {
-                SCAI_ASSERT_LE_ERROR(transCenters[j][d], globalMaxCoords[d]+ 1e-6, "New center coordinate out of bounds");
-                SCAI_ASSERT_GE_ERROR(transCenters[j][d], globalMinCoords[d]- 1e-6, "New center coordinate out of bounds");
-                ValueType diff = (centers1DVector[j][d] - transCenters[j][d]);
+                SCAI_ASSERT_LE_ERROR(newCenters[j*dim+d], globalMaxCoords[d]+ 1e-6, "New center coordinate out of bounds");
+                SCAI_ASSERT_GE_ERROR(newCenters[j*dim+d], globalMinCoords[d]- 1e-6, "New center coordinate out of bounds");
+                ValueType diff = (centers1DVector[j*dim+d] - newCenters[j*dim+d]);
                 squaredDeltas[j] += diff*diff;
             }
             deltas[j] = std::sqrt(squaredDeltas[j]);
@@ -1410,20 +1839,44 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
             }
         }
 
-        centers1DVector = transCenters;
+        centers1DVector.swap(newCenters);
 
         delta = *std::max_element(deltas.begin(), deltas.end());
         assert(delta >= 0);
         const ValueType deltaSq = delta*delta;
+        // the migration penalty scales the effective distance to all other blocks
+        const ValueType migrationFactor = settings.repartition ? 1 + assignSettings.migrationPenalty : 1;
         ValueType maxInfluence = 0;
         for (IndexType w = 0; w < numNodeWeights; w++) {
             maxInfluence = std::max(maxInfluence, *std::max_element(influence[w].begin(), influence[w].end()));
         }
+        maxInfluence *= migrationFactor;
+
+        // the largest center movement and influence value of every group
+        const IndexType numGroups = groups.empty() ? 0 : groups.groupOffsets.size()-1;
+        std::vector<ValueType> groupDelta(numGroups, 0);
+        std::vector<ValueType> groupMaxInfluence(numGroups, 0);
+        for (IndexType g = 0; g < numGroups; g++) {
+            for (IndexType j = groups.groupOffsets[g]; j < groups.groupOffsets[g+1]; j++) {
+                groupDelta[g] = std::max(groupDelta[g], deltas[j]);
+                for (IndexType w = 0; w < numNodeWeights; w++) {
+                    groupMaxInfluence[g] = std::max(groupMaxInfluence[g], influence[w][j]*migrationFactor);
+                }
+            }
+        }
 
         {
             SCAI_REGION("KMeans.computePartition.updateBounds");
-            for (auto it = firstIndex; it != lastIndex; it++) {
-                const IndexType i = *it;
+            // checked outside of the parallel loop, an exception cannot leave an omp region
+            if (settings.erodeInfluence and numNodeWeights > 0) {
+                throw std::logic_error("Influence erosion not yet implemented for multiple weights.");
+            }
+            const IndexType sampleN = std::distance(firstIndex, lastIndex);
+            scai::hmemo::ReadAccess<IndexType> rFather(partition.getLocalValues());
+
+            #pragma omp parallel for schedule(static)
+            for (IndexType s = 0; s < sampleN; s++) {
+                const IndexType i = firstIndex[s];
                 IndexType cluster = rResult[i];
                 assert(cluster<totalNumNewBlocks);
 
@@ -1431,13 +1884,14 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
                 for (IndexType w = 0; w < numNodeWeights; w++) {
                     influenceEffect += influence[w][cluster]*normalizedNodeWeights[w][i];
                 }
+                if (settings.repartition and cluster != rFather[i]) {
+                    influenceEffect *= migrationFactor;
+                }
 
                 if (settings.erodeInfluence) {
                     // WARNING: erodeInfluence not supported for hierarchical version
                     // TODO: or it is?? or should it be??
 
-                    if (numNodeWeights > 0) throw std::logic_error("Influence erosion not yet implemented for multiple weights.");
-
                     // update due to erosion
                     upperBoundOwnCenter[i] *= (influence[0][cluster] / oldInfluence[0][cluster]) + 1e-6;
                     lowerBoundNextCenter[i] *= minRatio - 1e-6;
@@ -1456,18 +1910,57 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
                     if (!(lowerBoundNextCenter[i] > 0)) lowerBoundNextCenter[i] = 0;
                 }
 
+                // same update per group, with the movement and influence of the group only
+                if (numGroups > 0) {
+                    ValueType* myBounds = groups.lowerBound.data() + std::size_t(i)*groups.stride;
+                    const IndexType father = settings.repartition ? 0 : rFather[i];
+                    const IndexType firstGroup = groups.fatherGroupOffsets[father];
+                    ValueType nextValue = std::numeric_limits<ValueType>::max();
+
+                    for (IndexType g = 0; g < groups.fatherGroupOffsets[father+1] - firstGroup; g++) {
+                        const ValueType gDelta = groupDelta[firstGroup+g];
+                        const ValueType gInfluence = groupMaxInfluence[firstGroup+g];
+                        if (settings.erodeInfluence) {
+                            myBounds[g] *= minRatio - 1e-6;
+                        }
+
+                        ValueType groupSqrt(std::sqrt(myBounds[g]/gInfluence));
+                        if (groupSqrt < gDelta) {
+                            myBounds[g] = 0;
+                        } else {
+                            myBounds[g] += (-2*gDelta*groupSqrt + gDelta*gDelta)*(gInfluence + 1e-6);
+                            if (!(myBounds[g] > 0)) myBounds[g] = 0;
+                        }
+                        nextValue = std::min(nextValue, myBounds[g]);
+                    }
+                    lowerBoundNextCenter[i] = std::max(lowerBoundNextCenter[i], nextValue);
+                }
+
                 assert(std::isfinite(lowerBoundNextCenter[i]));
             }
         }
 
-        // find local weight of each block
-        std::vector<std::vector<ValueType>> currentBlockWeights(numNodeWeights, std::vector<ValueType>(totalNumNewBlocks,0.0));
-        for (IndexType j = 0; j < numNodeWeights; j++) {
-            scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights[j].getLocalValues());
+        if (useMigrationBudget) {
+            SCAI_REGION("KMeans.computePartition.migrationBudget");
+            scai::hmemo::ReadAccess<IndexType> rHome(partition.getLocalValues());
+            IndexType localMoved = 0;
             for (auto it = firstIndex; it != lastIndex; it++) {
-                const IndexType i = *it;
-                IndexType cluster = rResult[i];
-                currentBlockWeights[j][cluster] += rWeights[i];
+                if (rResult[*it] != rHome[*it]) {
+                    localMoved++;
+                }
+            }
+            const ValueType movedFraction = ValueType(comm->sum(localMoved)) / comm->sum(IndexType(lastIndex - firstIndex));
+            withinBudget = movedFraction <= settings.migrationBudget;
+
+            if (not withinBudget) {
+                // the effective distances change, so the bounds are not valid anymore
+                assignSettings.migrationPenalty *= 2;
+                std::fill(upperBoundOwnCenter.begin(), upperBoundOwnCenter.end(), std::numeric_limits<ValueType>::max());
+                std::fill(lowerBoundNextCenter.begin(), lowerBoundNextCenter.end(), 0);
+                std::fill(groups.lowerBound.begin(), groups.lowerBound.end(), 0);
+            }
+            if (settings.verbose) {
+                PRINT0("moved points: " << movedFraction*100 << "%, budget: " << settings.migrationBudget*100 << "%, migration penalty: " << assignSettings.migrationPenalty);
             }
         }
 
@@ -1480,13 +1973,6 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
             PRINT0(*comm <<": in computePartition, iteration time: " << time);
         }
 
-        {
-            SCAI_REGION("KMeans.computePartition.currentBlockWeightSum");
-            for (IndexType i = 0; i < numNodeWeights; i++) {
-                comm->sumImpl(currentBlockWeights[i].data(), currentBlockWeights[i].data(), totalNumNewBlocks, scai::common::TypeTraits<ValueType>::stype);
-            }
-        }
-
         // check if all blocks are balanced
         balanced = true;
         for (IndexType i = 0; i < numNodeWeights; i++) {
@@ -1497,11 +1983,9 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
             }
         }
 
-        ValueType maxTime=0;
-        if (settings.verbose) {
-            balanceTime = std::chrono::high_resolution_clock::now() - iterStart;
-            maxTime = comm->max(balanceTime.count());
-        }
+        // the time of every round is recorded in the profiling
+        balanceTime = std::chrono::high_resolution_clock::now() - iterStart;
+        const ValueType maxTime = comm->max(balanceTime.count());
 
         if (comm->getRank() == 0) {
             std::cout << "i: " << iter<< ", delta: " << delta << ", imbalance=";
@@ -1516,9 +2000,78 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
 
         metrics.kmeansProfiling.push_back(std::make_tuple(delta, maxTime, imbalances[0]));
 
+        // decided globally, a small process may see all its points already in an earlier round
+        const bool fullPass = sampleRound >= samplingRounds-1;
+        if (fullPass) {
+            fullPasses++;
+        }
+
         iter++;
 
-    } while (iter < samplingRounds or (iter < maxIterations && (delta > threshold || !balanced)));
+        // choose the sample of the next round
+        if (sampleRound < samplingRounds) {
+            roundsWithSampleSize++;
+            if (not settings.adaptiveSampling or fullPass) {
+                sampleRound++;
+                roundsWithSampleSize = 0;
+            } else {
+                // centers estimated from s points per block scatter by about blockDiameter*sqrt(dim/(12*s)),
+                // as for uniformly distributed points; smaller movements cannot be distinguished from sampling noise
+                const ValueType samplesPerBlock = ValueType(comm->sum(IndexType(lastIndex - firstIndex))) / totalNumNewBlocks;
+                const ValueType samplingNoise = expectedBlockDiameter*std::sqrt(dim/(12*samplesPerBlock));
+                const bool sampleConverged = delta <= std::max(threshold, samplingNoise);
+
+                if (sampleConverged and delta <= threshold and balanced) {
+                    // the sampled solution meets the bounds, larger samples would barely move the centers
+                    sampleRound = samplingRounds-1;
+                    skipToFull = true;
+                    roundsWithSampleSize = 0;
+                } else if (sampleConverged or roundsWithSampleSize >= maxRoundsPerSampleSize) {
+                    sampleRound++;
+                    roundsWithSampleSize = 0;
+                } else {
+                    reusedSampleRounds++;
+                }
+
+                if (settings.verbose) {
+                    PRINT0("sampling noise: " << samplingNoise << ", converged on sample: " << sampleConverged << ", next sample round: " << sampleRound);
+                }
+            }
+        }
+
+        // the assignment of the skipped rounds is done by this full pass, stop if it is balanced
+        if (skipToFull and fullPass and balanced and withinBudget) {
+            break;
+        }
+
+    } while (sampleRound < samplingRounds or (iter - reusedSampleRounds < maxIterations && (delta > threshold || !balanced || !withinBudget)));
+
+    metrics.MM["kmeansFullPasses"] = fullPasses;
+    metrics.MM["kmeansReusedSampleRounds"] = reusedSampleRounds;
+
+    // the migration volume of the new partition, known before the data is moved.
+    // As in Metrics::getRedistributionVol, the maximum is taken over the points sent and received by a block
+    if (settings.repartition) {
+        SCAI_REGION("KMeans.computePartition.plannedMigration");
+        std::vector<IndexType> sentAndReceived(2*totalNumNewBlocks, 0);
+        {
+            scai::hmemo::ReadAccess<IndexType> rResult(result.getLocalValues());
+            scai::hmemo::ReadAccess<IndexType> rHome(partition.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                if (rResult[i] != rHome[i]) {
+                    sentAndReceived[rHome[i]]++;
+                    sentAndReceived[totalNumNewBlocks + rResult[i]]++;
+                }
+            }
+        }
+        comm->sumImpl(sentAndReceived.data(), sentAndReceived.data(), 2*totalNumNewBlocks, scai::common::TypeTraits<IndexType>::stype);
+
+        metrics.MM["plannedMaxRedistVol"] = *std::max_element(sentAndReceived.begin(), sentAndReceived.end());
+        metrics.MM["plannedTotRedistVol"] = std::accumulate(sentAndReceived.begin(), sentAndReceived.begin()+totalNumNewBlocks, IndexType(0));
+        if (settings.verbose) {
+            PRINT0("planned migration: " << metrics.MM["plannedTotRedistVol"] << " points in total, at most " << metrics.MM["plannedMaxRedistVol"] << " per block");
+        }
+    }
 
 
     std::chrono::duration<ValueType,std::ratio<1>> KMeansTime = std::chrono::high_resolution_clock::now() - KMeansStart;
@@ -1528,6 +2081,31 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computePartition(
     //special time for the core kmeans
     metrics.MM["timeKmeans"] = time;
 
+    if (settings.mixedPrecision and settings.validateMixedPrecision) {
+        SCAI_REGION("KMeans.computePartition.validateMixedPrecision");
+        // same input in full precision, with separate metrics to keep the profiling of this run
+        Settings referenceSettings = settings;
+        referenceSettings.mixedPrecision = false;
+        Metrics<ValueType> referenceMetrics(referenceSettings);
+        const DenseVector<IndexType> reference = computePartition(coordinates, nodeWeights, targetBlockWeights, partition, centers, referenceSettings, referenceMetrics);
+
+        IndexType localDifferent = 0;
+        {
+            scai::hmemo::ReadAccess<IndexType> rResult(result.getLocalValues());
+            scai::hmemo::ReadAccess<IndexType> rReference(reference.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                if (rResult[i] != rReference[i]) {
+                    localDifferent++;
+                }
+            }
+        }
+        const ValueType differentFraction = ValueType(comm->sum(localDifferent)) / globalN;
+
+        PRINT0("mixed precision: " << differentFraction*100 << "% of the points are assigned differently than with full precision");
+        metrics.MM["mixedPrecisionDifference"] = differentFraction;
+        metrics.MM["timeKmeansFullPrecision"] = referenceMetrics.MM["timeKmeans"];
+    }
+
     return result;
 }// computePartition
 
@@ -1772,7 +2350,7 @@ DenseVector<IndexType> KMeans<IndexType,ValueType>::computeHierPlusRepart(
     // refine using a repartition step
 
     std::chrono::time_point<std::chrono::high_resolution_clock> repartStart = std::chrono::high_resolution_clock::now();
-    DenseVector<IndexType> result2 = computeRepartition(coordinates, nodeWeights, blockSizes, result, settings);
+    DenseVector<IndexType> result2 = computeRepartition(coordinates, nodeWeights, blockSizes, result, settings, metrics);
     std::chrono::duration<ValueType,std::ratio<1>> repartTime = std::chrono::high_resolution_clock::now() - repartStart;
     metrics.MM["timeKmeans"] += repartTime.count();
 
@@ -27,6 +27,42 @@ namespace ITI {
 
 using scai::lama::DenseVector;
 
+/** Groups of k-means centers with one distance lower bound per group and point, as in Yinyang k-means.
+
+The centers of a group are contiguous in the center vector and belong to the same father block.
+Since the initial centers are ordered along the space-filling curve, contiguous centers are also
+close in space, so every group covers a compact region.
+*/
+template<typename IndexType, typename ValueType>
+struct CenterGroups {
+    std::vector<IndexType> groupOffsets;        ///< the centers of group g are groupOffsets[g] to groupOffsets[g+1]-1
+    std::vector<IndexType> fatherGroupOffsets;  ///< the groups of father block b are fatherGroupOffsets[b] to fatherGroupOffsets[b+1]-1
+    std::vector<IndexType> centerGroup;         ///< the group of every center
+    IndexType stride = 0;                       ///< the maximum number of groups of a father block
+    std::vector<ValueType> lowerBound;          ///< lowerBound[i*stride+g] is a lower bound of the effective distance of point i to the centers of the g-th group of its father block, not counting its own center
+
+    bool empty() const {
+        return groupOffsets.empty();
+    }
+};
+
+/** A packed single-precision copy of the local coordinates, read by the assignment loop of k-means instead of the
+separate double vectors of every dimension.
+
+Point i occupies coords[i*dim] to coords[i*dim+dim-1]. The coordinates are stored relative to \p origin,
+the lower corner of the global bounding box, so they keep their relative precision even if all points are
+far away from zero. Distances are not changed by the shift.
+*/
+template<typename ValueType>
+struct CoordinateCache {
+    std::vector<float> coords;
+    std::vector<ValueType> origin;
+
+    bool empty() const {
+        return coords.empty();
+    }
+};
+
 /** K-means related algorithms for partitioning a point set
 */
 
@@ -137,6 +173,7 @@ static DenseVector<IndexType> computeHierPlusRepart(
  * @param[in] blockSizes target block sizes, not maximum sizes. blockSizes.size()== number of weights
  * @param[in] previous Previous partition
  * @param[in] settings Settings struct
+ * @param[out] metrics Receives the k-means timings and the planned migration volume
  *
  * @return partition
  */
@@ -146,7 +183,8 @@ static DenseVector<IndexType> computeRepartition(
     const std::vector<DenseVector<ValueType>>& nodeWeights,
     const std::vector<std::vector<ValueType>>& blockSizes,
     const DenseVector<IndexType> &previous,
-    const Settings settings);
+    const Settings settings,
+    Metrics<ValueType>& metrics);
 
 //template<typename IndexType, typename ValueType>
 static DenseVector<IndexType> computeRepartition(
@@ -288,7 +326,8 @@ static ValueType computeEffectiveDistance(
  * The returned vector has always as many entries as local points, even if only some of them are non-zero.
  *
  * @param[in] coordinates input points
- * @param[in] centers block centers
+ * @param[in] coordCache if not empty, the coordinates are read from this packed copy instead of \p coordinates
+ * @param[in] centers block centers in one contiguous array, center j is centers[j*dim] to centers[j*dim+dim-1]
  * @param[in] firstIndex begin of local node indices
  * @param[in] lastIndex end local node indices
  * @param[in] nodeWeights node weights
@@ -305,7 +344,11 @@ static ValueType computeEffectiveDistance(
  * @param[in] boundingBox min and max coordinates of local points, used to compute distance bounds
  * @param[in,out] upperBoundOwnCenter for each point, an upper bound of the effective distance to its own center
  * @param[in,out] lowerBoundNextCenter for each point, a lower bound of the effective distance to the next-closest center
+ * @param[in,out] groups if not empty, the per-group lower bounds are used to skip groups of centers and are updated; see groupCenters
  * @param[in,out] influence a multiplier for each block to compute the effective distance
+ * @param[out] imbalance the imbalance of every node weight
+ * @param[out] newCenters the centers of the returned assignment, weighted with the first node weight and in the same layout as \p centers; NaN for empty blocks
+ * @param[out] finalBlockWeights the global weight of every block in the returned assignment, finalBlockWeights[w][b]
  * @param[in] settings
  *
  * @return assignment of points to blocks
@@ -314,7 +357,8 @@ static ValueType computeEffectiveDistance(
 template< typename Iterator>
 static DenseVector<IndexType> assignBlocks(
     const std::vector<std::vector<ValueType>> &coordinates,
-    const std::vector< std::vector<ValueType> >& centers,
+    const CoordinateCache<ValueType> &coordCache,
+    const std::vector<ValueType>& centers,
     const std::vector<IndexType>& blockSizesPrefixSum,
     const Iterator firstIndex,
     const Iterator lastIndex,
@@ -326,11 +370,29 @@ static DenseVector<IndexType> assignBlocks(
     const SpatialCell<ValueType> &boundingBox,
     std::vector<ValueType> &upperBoundOwnCenter,
     std::vector<ValueType> &lowerBoundNextCenter,
+    CenterGroups<IndexType,ValueType> &groups,
     std::vector<std::vector<ValueType>> &influence,
     std::vector<ValueType> &imbalance,
+    std::vector<ValueType> &newCenters,
+    std::vector<std::vector<ValueType>> &finalBlockWeights,
     Settings settings,
     Metrics<ValueType>& metrics);
 
+/**
+ * Split the centers of every father block into contiguous groups for the Yinyang bounds of assignBlocks.
+ * Every father block gets a share of \p numGroups proportional to its number of centers, at least one group.
+ *
+ * @param[in] blockSizesPrefixSum the centers of father block b are blockSizesPrefixSum[b] to blockSizesPrefixSum[b+1]-1
+ * @param[in] numGroups the total number of groups
+ * @param[in] localN the number of local points; the lower bounds are initialized with zero
+ *
+ * @return the groups
+ */
+static CenterGroups<IndexType,ValueType> groupCenters(
+    const std::vector<IndexType>& blockSizesPrefixSum,
+    const IndexType numGroups,
+    const IndexType localN);
+
 
 /** Reverse the order of the vectors: given a 2D vector of size
 dimension*numPoints, reverse it and return a vector of points
@@ -1,5 +1,13 @@
 #include "FileIO.h"
 #include "KMeans.h"
+#include "MeshGenerator.h"
+#include "GraphUtils.h"
+#include "CenterTree.h"
+
+#include <scai/dmemo/GenBlockDistribution.hpp>
+
+#include <chrono>
+#include <random>
 
 #include "gtest/gtest.h"
 
@@ -378,6 +386,294 @@ TYPED_TEST(KMeansTest, testComputePartitionWithMultipleWeights) {
     //check for correct error messages: block sizes not aligned to node weights, different distributions in coordinates and weights, weights not fitting into blocks, balance
 }
 
+TYPED_TEST(KMeansTest, testMixedPrecision) {
+    using ValueType = TypeParam;
+
+    std::string fileName = "bubbles-00010.graph";
+    std::string graphFile = KMeansTest<ValueType>::graphPath + fileName;
+    std::string coordFile = graphFile + ".xyz";
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(graphFile );
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType globalN = graph.getNumRows();
+
+    struct Settings settings;
+    settings.dimensions = 2;
+    settings.epsilon = 0.05;
+    settings.numBlocks = 16;
+    settings.mixedPrecision = true;
+    settings.validateMixedPrecision = true;
+
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(coordFile), globalN, settings.dimensions);
+
+    //move the points far away from the origin, the cache must stay accurate
+    for (IndexType d = 0; d < settings.dimensions; d++) {
+        scai::hmemo::WriteAccess<ValueType> wCoords(coords[d].getLocalValues());
+        for (IndexType i = 0; i < wCoords.size(); i++) {
+            wCoords[i] += 1000;
+        }
+    }
+
+    const scai::lama::DenseVector<ValueType> unitNodeWeights = scai::lama::DenseVector<ValueType>( dist, 1);
+    const std::vector<scai::lama::DenseVector<ValueType>> nodeWeights = {unitNodeWeights};
+    const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(settings.numBlocks, std::ceil(ValueType(globalN)/settings.numBlocks)));
+
+    Metrics<ValueType> metrics(settings);
+    scai::lama::DenseVector<IndexType> partition = KMeans<IndexType, ValueType>::computePartition( coords, nodeWeights, blockSizes, settings, metrics);
+
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks );
+    EXPECT_LE( imbalance, settings.epsilon );
+
+    ASSERT_EQ( metrics.MM.count("mixedPrecisionDifference"), 1 );
+    EXPECT_LE( metrics.MM["mixedPrecisionDifference"], 0.05 );
+}
+//------------------------------------------------------------------------
+
+TYPED_TEST(KMeansTest, testProcessWithoutPoints) {
+    using ValueType = TypeParam;
+
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    if (comm->getSize() == 1) {
+        GTEST_SKIP() << "Needs more than one process";
+    }
+
+    std::string fileName = "bubbles-00010.graph";
+    std::string graphFile = KMeansTest<ValueType>::graphPath + fileName;
+    std::string coordFile = graphFile + ".xyz";
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(graphFile );
+    const IndexType globalN = graph.getNumRows();
+
+    struct Settings settings;
+    settings.dimensions = 2;
+    settings.epsilon = 0.05;
+    settings.numBlocks = 16;
+
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(coordFile), globalN, settings.dimensions);
+
+    //the last process has no points, the others share them evenly
+    const IndexType numFilled = comm->getSize()-1;
+    const IndexType rank = comm->getRank();
+    const IndexType localN = rank < numFilled ? (globalN*(rank+1))/numFilled - (globalN*rank)/numFilled : 0;
+    const scai::dmemo::DistributionPtr dist = scai::dmemo::genBlockDistributionBySize(globalN, localN, comm);
+    for (IndexType d = 0; d < settings.dimensions; d++) {
+        coords[d].redistribute(dist);
+    }
+
+    const scai::lama::DenseVector<ValueType> unitNodeWeights = scai::lama::DenseVector<ValueType>( dist, 1);
+    const std::vector<scai::lama::DenseVector<ValueType>> nodeWeights = {unitNodeWeights};
+    const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(settings.numBlocks, std::ceil(ValueType(globalN)/settings.numBlocks)));
+
+    Metrics<ValueType> metrics(settings);
+    scai::lama::DenseVector<IndexType> partition = KMeans<IndexType, ValueType>::computePartition( coords, nodeWeights, blockSizes, settings, metrics);
+
+    ASSERT_TRUE( partition.getDistributionPtr()->isEqual(*dist) );
+    EXPECT_GE( partition.min(), 0 );
+    EXPECT_LT( partition.max(), settings.numBlocks );
+
+    //the empty process takes part in every reduction, otherwise the processes would disagree on the centers and the balance
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks );
+    EXPECT_LE( imbalance, settings.epsilon );
+}
+//------------------------------------------------------------------------
+
+TYPED_TEST(KMeansTest, testAdaptiveSampling) {
+    using ValueType = TypeParam;
+
+    const IndexType dimensions = 3;
+    const IndexType sideLen = 40;
+    const IndexType N = sideLen*sideLen*sideLen;
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>( dist, noDistPointer );
+
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist( graph, coords, maxCoord, numPoints, dimensions );
+
+    Settings settings;
+    settings.numBlocks = 8;
+    settings.dimensions = dimensions;
+    settings.epsilon = 0.05;
+    settings.minSamplingNodes = 100;
+
+    const std::vector<DenseVector<ValueType>> nodeWeights = {DenseVector<ValueType>(dist, 1)};
+    const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(settings.numBlocks, std::ceil(ValueType(N)/settings.numBlocks)));
+
+    std::vector<ValueType> fullPasses;
+    for (bool adaptive : {false, true}) {
+        settings.adaptiveSampling = adaptive;
+        Metrics<ValueType> metrics(settings);
+        DenseVector<IndexType> partition = KMeans<IndexType, ValueType>::computePartition( coords, nodeWeights, blockSizes, settings, metrics );
+
+        const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks );
+        EXPECT_LE( imbalance, settings.epsilon );
+
+        //one profiling entry per round
+        ASSERT_EQ( metrics.kmeansProfiling.size(), metrics.numBalanceIter.size() );
+        if (not adaptive) {
+            EXPECT_EQ( metrics.MM["kmeansReusedSampleRounds"], 0 );
+        }
+
+        EXPECT_GE( metrics.MM["kmeansFullPasses"], 1 );
+        fullPasses.push_back( metrics.MM["kmeansFullPasses"] );
+        PRINT0( "adaptive sampling: " << adaptive << ", rounds: " << metrics.kmeansProfiling.size() << ", reused sample rounds: " << metrics.MM["kmeansReusedSampleRounds"] << ", full passes: " << fullPasses.back() << ", imbalance: " << imbalance );
+    }
+
+    // the rounds on samples replace most of the expensive rounds on all points
+    EXPECT_LT( fullPasses[1], fullPasses[0] );
+}
+//------------------------------------------------------------------------
+
+TYPED_TEST(KMeansTest, testBoundedMigration) {
+    using ValueType = TypeParam;
+
+    std::string fileName = "bubbles-00010.graph";
+    std::string graphFile = KMeansTest<ValueType>::graphPath + fileName;
+    std::string coordFile = graphFile + ".xyz";
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(graphFile );
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType globalN = graph.getNumRows();
+
+    struct Settings settings;
+    settings.dimensions = 2;
+    settings.epsilon = 0.05;
+    settings.numBlocks = 8;
+
+    const std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(coordFile), globalN, settings.dimensions);
+    const DenseVector<IndexType> previous = KMeans<IndexType, ValueType>::computePartition( coords, settings );
+
+    //the first tenth of the points becomes heavier, as after a local refinement
+    DenseVector<ValueType> weights(dist, 1);
+    {
+        scai::hmemo::WriteAccess<ValueType> wWeights(weights.getLocalValues());
+        for (IndexType i = 0; i < wWeights.size(); i++) {
+            if (dist->local2Global(i) < globalN/10) {
+                wWeights[i] = 3;
+            }
+        }
+    }
+    const std::vector<DenseVector<ValueType>> nodeWeights = {weights};
+    const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(settings.numBlocks, weights.sum()/settings.numBlocks));
+
+    std::vector<ValueType> movedFraction;
+    for (ValueType budget : {ValueType(0), ValueType(0.1)}) {
+        settings.migrationBudget = budget;
+        Metrics<ValueType> metrics(settings);
+        DenseVector<IndexType> partition = KMeans<IndexType, ValueType>::computeRepartition( coords, nodeWeights, blockSizes, previous, settings, metrics );
+
+        IndexType localMoved = 0;
+        {
+            scai::hmemo::ReadAccess<IndexType> rPartition(partition.getLocalValues());
+            scai::hmemo::ReadAccess<IndexType> rPrevious(previous.getLocalValues());
+            for (IndexType i = 0; i < rPartition.size(); i++) {
+                if (rPartition[i] != rPrevious[i]) localMoved++;
+            }
+        }
+        const IndexType globalMoved = comm->sum(localMoved);
+        movedFraction.push_back( ValueType(globalMoved) / globalN );
+
+        // the planned migration reaches the caller and agrees with the points that actually changed their block
+        EXPECT_EQ( metrics.MM["plannedTotRedistVol"], globalMoved );
+        EXPECT_LE( metrics.MM["plannedMaxRedistVol"], globalMoved );
+        if (budget > 0) {
+            EXPECT_LE( movedFraction.back(), budget );
+        }
+
+        const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks, weights );
+        EXPECT_LE( imbalance, settings.epsilon );
+        PRINT0( "migration budget: " << budget << ", moved points: " << movedFraction.back() << ", imbalance: " << imbalance );
+    }
+
+    EXPECT_LE( movedFraction[1], movedFraction[0] );
+}
+//------------------------------------------------------------------------
+
+TYPED_TEST(KMeansTest, testCenterTreeQuery) {
+    using ValueType = TypeParam;
+
+    const IndexType dimensions = 3;
+    const IndexType k = 300;
+    const IndexType numPoints = 200;
+
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<ValueType> coordDist(0, 10);
+    std::uniform_real_distribution<ValueType> influenceDist(0.5, 2);
+
+    std::vector<ValueType> centers(k*dimensions);
+    for (IndexType c = 0; c < k*dimensions; c++) {
+        centers[c] = coordDist(gen);
+    }
+    std::vector<std::vector<ValueType>> influence(1, std::vector<ValueType>(k));
+    for (IndexType c = 0; c < k; c++) {
+        influence[0][c] = influenceDist(gen);
+    }
+
+    // two father blocks
+    const std::vector<IndexType> blockSizesPrefixSum = {0, 100, k};
+
+    CenterTree<IndexType, ValueType> tree;
+    tree.build(centers, dimensions, blockSizesPrefixSum, 1);
+    tree.updateInfluence(influence);
+    EXPECT_GT( tree.numNodes(), 2 );
+
+    const ValueType pointWeight = 1;
+    std::vector<IndexType> stack;
+
+    for (IndexType p = 0; p < numPoints; p++) {
+        std::vector<ValueType> point(dimensions);
+        for (IndexType d = 0; d < dimensions; d++) {
+            point[d] = coordDist(gen);
+        }
+        const IndexType father = p % 2;
+
+        auto effectiveDistance = [&](IndexType c) {
+            ValueType sqDist = 0;
+            for (IndexType d = 0; d < dimensions; d++) {
+                sqDist += (centers[c*dimensions+d] - point[d])*(centers[c*dimensions+d] - point[d]);
+            }
+            return sqDist*influence[0][c];
+        };
+
+        // brute force
+        std::vector<ValueType> distances;
+        for (IndexType c = blockSizesPrefixSum[father]; c < blockSizesPrefixSum[father+1]; c++) {
+            distances.push_back(effectiveDistance(c));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        ValueType bestValue = std::numeric_limits<ValueType>::max();
+        ValueType secondValue = std::numeric_limits<ValueType>::max();
+        IndexType visited = 0;
+        tree.query(father, point.data(), &pointWeight, secondValue, [&](IndexType c) {
+            EXPECT_GE( c, blockSizesPrefixSum[father] );
+            EXPECT_LT( c, blockSizesPrefixSum[father+1] );
+            const ValueType value = effectiveDistance(c);
+            if (value < bestValue) {
+                secondValue = bestValue;
+                bestValue = value;
+            } else if (value < secondValue) {
+                secondValue = value;
+            }
+            visited++;
+        }, stack);
+
+        EXPECT_EQ( bestValue, distances[0] );
+        EXPECT_EQ( secondValue, distances[1] );
+        EXPECT_LT( visited, IndexType(distances.size()) );
+    }
+}
+//-----------------------------------------------
+
 TYPED_TEST(KMeansTest, testGetGlobalMinMax) {
     using ValueType = TypeParam;
 
@@ -468,5 +764,121 @@ TYPED_TEST(KMeansTest, testPartitionWithNodeWeights) {
 }
 */
 
+//-----------------------------------------------
+
+/* Compare the Yinyang group bounds with the single lower bound per point for a large k.
+ * Both find the closest center whenever a point is checked, so the partitions should agree
+ * up to ties; the group bounds should need fewer distance computations and less time.
+ */
+TYPED_TEST(KMeansTest, benchYinyangBounds) {
+    using ValueType = TypeParam;
+
+    const IndexType dimensions = 3;
+    const IndexType sideLen = 40;
+    const IndexType N = sideLen*sideLen*sideLen;
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>( dist, noDistPointer );
+
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist( graph, coords, maxCoord, numPoints, dimensions );
+
+    Settings settings;
+    settings.numBlocks = 512;
+    settings.dimensions = dimensions;
+    settings.epsilon = 0.05;
+
+    std::vector<DenseVector<IndexType>> partitions;
+    for (IndexType groups : {0, 64}) {
+        settings.yinyangGroups = groups;
+
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        partitions.push_back( KMeans<IndexType, ValueType>::computePartition( coords, settings ) );
+        std::chrono::duration<double> kmeansTime = std::chrono::steady_clock::now() - start;
+
+        const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partitions.back(), settings.numBlocks );
+        EXPECT_LE( imbalance, settings.epsilon );
+
+        const double maxKMeansTime = comm->max( kmeansTime.count() );
+        PRINT0( "k: " << settings.numBlocks << ", groups: " << groups << ", N: " << N << ", imbalance: " << imbalance << ", kmeans time: " << maxKMeansTime );
+    }
+
+    IndexType localAgree = 0;
+    {
+        scai::hmemo::ReadAccess<IndexType> rPlain( partitions[0].getLocalValues() );
+        scai::hmemo::ReadAccess<IndexType> rGroups( partitions[1].getLocalValues() );
+        for (IndexType i = 0; i < rPlain.size(); i++) {
+            if (rPlain[i] == rGroups[i]) localAgree++;
+        }
+    }
+    const ValueType agreement = ValueType(comm->sum(localAgree)) / N;
+    PRINT0( "points in the same block: " << agreement );
+    EXPECT_GE( agreement, 0.9 );
+}
+//-----------------------------------------------
+
+/* Compare the k-d tree over the centers with the single lower bound per point and the centers
+ * sorted by their distance to the bounding box for a large k. Both find the closest center of every checked point,
+ * so the partitions should agree up to ties; the tree should prune more centers and need less time.
+ */
+TYPED_TEST(KMeansTest, benchCenterTree) {
+    using ValueType = TypeParam;
+
+    const IndexType dimensions = 3;
+    const IndexType sideLen = 40;
+    const IndexType N = sideLen*sideLen*sideLen;
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>( dist, noDistPointer );
+
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist( graph, coords, maxCoord, numPoints, dimensions );
+
+    Settings settings;
+    settings.numBlocks = 512;
+    settings.dimensions = dimensions;
+    settings.epsilon = 0.05;
+
+    std::vector<DenseVector<IndexType>> partitions;
+    for (bool tree : {false, true}) {
+        settings.centerTree = tree;
+
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        partitions.push_back( KMeans<IndexType, ValueType>::computePartition( coords, settings ) );
+        std::chrono::duration<double> kmeansTime = std::chrono::steady_clock::now() - start;
+
+        const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partitions.back(), settings.numBlocks );
+        EXPECT_LE( imbalance, settings.epsilon );
+
+        const double maxKMeansTime = comm->max( kmeansTime.count() );
+        PRINT0( "k: " << settings.numBlocks << ", tree: " << tree << ", N: " << N << ", imbalance: " << imbalance << ", kmeans time: " << maxKMeansTime );
+    }
+
+    IndexType localAgree = 0;
+    {
+        scai::hmemo::ReadAccess<IndexType> rPlain( partitions[0].getLocalValues() );
+        scai::hmemo::ReadAccess<IndexType> rTree( partitions[1].getLocalValues() );
+        for (IndexType i = 0; i < rPlain.size(); i++) {
+            if (rPlain[i] == rTree[i]) localAgree++;
+        }
+    }
+    const ValueType agreement = ValueType(comm->sum(localAgree)) / N;
+    PRINT0( "points in the same block: " << agreement );
+    EXPECT_GE( agreement, 0.9 );
+}
 
 }
@@ -1,5 +1,8 @@
 
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <omp.h>
 
 #include "LocalRefinement.h"
 #include "GraphUtils.h"
@@ -23,6 +26,48 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
     const std::vector<DenseVector<IndexType>>& communicationScheme,
     Settings settings) {
 
+    scai::dmemo::CommunicatorPtr comm = input.getRowDistributionPtr()->getCommunicatorPtr();
+
+    //extract the partner of this process in every round
+    std::vector<IndexType> partnerPerRound(communicationScheme.size());
+    for (IndexType color = 0; color < communicationScheme.size(); color++) {
+        const scai::dmemo::DistributionPtr commDist = communicationScheme[color].getDistributionPtr();
+
+        if (!commDist->isLocal(comm->getRank())) {
+            throw std::runtime_error("Scheme value for " + std::to_string(comm->getRank()) + " must be local.");
+        }
+
+        scai::hmemo::ReadAccess<IndexType> commAccess(communicationScheme[color].getLocalValues());
+        const IndexType partner = commAccess[commDist->global2Local(comm->getRank())];
+
+        //check symmetry of communication scheme
+        assert(partner < comm->getSize());
+        if (commDist->isLocal(partner)) {
+            IndexType partnerOfPartner = commAccess[commDist->global2Local(partner)];
+            if (partnerOfPartner != comm->getRank()) {
+                throw std::runtime_error("Process " + std::to_string(comm->getRank()) + ": Partner " + std::to_string(partner) + " has partner "
+                                         + std::to_string(partnerOfPartner) + ".");
+            }
+        }
+        partnerPerRound[color] = partner;
+    }
+
+    return distributedFMStep(input, part, nodesWithNonLocalNeighbors, nodeWeights, coordinates, distances, origin, partnerPerRound, settings);
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFMStep(
+    CSRSparseMatrix<ValueType>& input,
+    DenseVector<IndexType>& part,
+    std::vector<IndexType>& nodesWithNonLocalNeighbors,
+    DenseVector<ValueType> &nodeWeights,
+    std::vector<DenseVector<ValueType>> &coordinates,
+    std::vector<ValueType> &distances,
+    DenseVector<IndexType> &origin,
+    const std::vector<IndexType>& partnerPerRound,
+    Settings settings) {
+
     std::chrono::time_point<std::chrono::steady_clock> startTime =  std::chrono::steady_clock::now();
 
     SCAI_REGION( "LocalRefinement.distributedFMStep" )
@@ -69,7 +114,7 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
     }
 
     ValueType gainSum = 0;
-    std::vector<ValueType> gainPerRound(communicationScheme.size(), 0);
+    std::vector<ValueType> gainPerRound(partnerPerRound.size(), 0);
 
     //copy into usable data structure with iterators
     std::vector<IndexType> myGlobalIndices(input.getRowDistributionPtr()->getLocalSize());
@@ -87,38 +132,23 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
     if(settings.verbose or settings.debugMode) {
         ValueType t1 = comm->max(beforeLoop.count());
         PRINT0("time elapsed before main loop: " << t1 );
-        PRINT0("number of rounds/loops: " << communicationScheme.size() );
+        PRINT0("number of rounds/loops: " << partnerPerRound.size() );
     }
 
     //main loop, one iteration for each color of the graph coloring
-    for (IndexType color = 0; color < communicationScheme.size(); color++) {
+    for (IndexType color = 0; color < partnerPerRound.size(); color++) {
         SCAI_REGION( "LocalRefinement.distributedFMStep.loop" )
         std::chrono::time_point<std::chrono::steady_clock> startColor =  std::chrono::steady_clock::now();
 
         const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
         const scai::dmemo::DistributionPtr partDist = part.getDistributionPtr();
-        const scai::dmemo::DistributionPtr commDist = communicationScheme[color].getDistributionPtr();
 
         const IndexType localN = inputDist->getLocalSize();
 
-        if (!communicationScheme[color].getDistributionPtr()->isLocal(comm->getRank())) {
-            throw std::runtime_error("Scheme value for " + std::to_string(comm->getRank()) + " must be local.");
-        }
-
-        scai::hmemo::ReadAccess<IndexType> commAccess(communicationScheme[color].getLocalValues());
-        IndexType partner = commAccess[commDist->global2Local(comm->getRank())];
-
-        //check symmetry of communication scheme
-        assert(partner < comm->getSize());
-        if (commDist->isLocal(partner)) {
-            IndexType partnerOfPartner = commAccess[commDist->global2Local(partner)];
-            if (partnerOfPartner != comm->getRank()) {
-                throw std::runtime_error("Process " + std::to_string(comm->getRank()) + ": Partner " + std::to_string(partner) + " has partner "
-                                         + std::to_string(partnerOfPartner) + ".");
-            }
-            if(settings.debugMode){
-                std::cout<< "Comm round "<< color <<": PE " << comm->getRank() << " is paired with " << partner << std::endl;
-            }
+        const IndexType partner = partnerPerRound[color];
+        assert(partner >= 0 and partner < comm->getSize());
+        if(settings.debugMode){
+            std::cout<< "Comm round "<< color <<": PE " << comm->getRank() << " is paired with " << partner << std::endl;
         }
 
         /*
@@ -154,7 +184,6 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
             std::tie(interfaceNodes, roundMarkers)= getInterfaceNodes(input, part, nodesWithNonLocalNeighbors, partner, settings.minBorderNodes);
 
             const IndexType lastRoundMarker = roundMarkers[roundMarkers.size()-1];
-            const IndexType secondRoundMarker = roundMarkers[1];
 
             /*
              * now swap indices of nodes in border region with partner processor.
@@ -167,20 +196,18 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
 
             const ValueType blockWeightSum = scai::utilskernel::HArrayUtils::sum(nodeWeights.getLocalValues());
 
-            ValueType swapField[5];
+            ValueType swapField[4];
             swapField[0] = interfaceNodes.size();
-            swapField[1] = secondRoundMarker;
-            swapField[2] = lastRoundMarker;
-            swapField[3] = blockSize;
-            swapField[4] = blockWeightSum;
-            comm->swap(swapField, 5, partner);
+            swapField[1] = lastRoundMarker;
+            swapField[2] = blockSize;
+            swapField[3] = blockWeightSum;
+            comm->swap(swapField, 4, partner);
             //want to isolate raw array accesses as much as possible, define named variables and only use these from now
             const IndexType otherSize = swapField[0];
-            const IndexType otherSecondRoundMarker = swapField[1];
-            const IndexType otherLastRoundMarker = swapField[2];
-            //const IndexType otherBlockSize = swapField[3];
+            const IndexType otherLastRoundMarker = swapField[1];
+            //const IndexType otherBlockSize = swapField[2];
 //WARNING/TODO: this assumes that node weights (and thus block weights) are integers
-            const IndexType otherBlockWeightSum = swapField[4];
+            const IndexType otherBlockWeightSum = swapField[3];
 
             if (interfaceNodes.size() == 0) {
                 if (otherSize != 0) {
@@ -289,9 +316,6 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
             std::pair<IndexType, IndexType> blockSizes = {blockWeightSum, otherBlockWeightSum};
             std::pair<IndexType, IndexType> maxBlockSizes = {maxAllowableBlockSize, maxAllowableBlockSize};
 
-            //second round markers
-            std::pair<IndexType, IndexType> secondRoundMarkers = {secondRoundMarker, otherSecondRoundMarker};
-
             //tie breaking keys
             std::vector<ValueType> tieBreakingKeys(borderRegionSize, 0);
 
@@ -305,7 +329,7 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distributedFM
             }
 
             if (settings.useDiffusionTieBreaking) {
-                std::vector<ValueType> load = twoWayLocalDiffusion(input, haloMatrix, graphHalo, borderRegionIDs, secondRoundMarkers, assignedToSecondBlock, settings);
+                std::vector<ValueType> load = twoWayLocalDiffusion(input, haloMatrix, graphHalo, borderRegionIDs, assignedToSecondBlock, settings);
                 for (IndexType i = 0; i < borderRegionSize; i++) {
                     tieBreakingKeys[i] = std::abs(load[i]);
                 }
@@ -823,21 +847,16 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::twoWayLocalDi
     const CSRStorage<ValueType> &haloStorage,
     const scai::dmemo::HaloExchangePlan &matrixHalo,
     const std::vector<IndexType>& borderRegionIDs,
-    std::pair<IndexType,
-    IndexType> secondRoundMarkers,
     const std::vector<bool>& assignedToSecondBlock,
     Settings settings) {
 
     SCAI_REGION( "LocalRefinement.twoWayLocalDiffusion" )
     //settings and constants
     const IndexType magicNumberDiffusionSteps = settings.diffusionRounds;
-    //const ValueType degreeEstimate = ValueType(haloStorage.getNumValues()) / matrixHalo.getHaloSize();
 
     const ValueType magicNumberDiffusionLoad = 1;
     const IndexType veryLocalN = borderRegionIDs.size();
 
-    const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
-
     const IndexType firstBlockSize = std::distance(assignedToSecondBlock.begin(), std::lower_bound(assignedToSecondBlock.begin(), assignedToSecondBlock.end(), 1));
     const IndexType secondBlockSize = veryLocalN - firstBlockSize;
     const ValueType initialLoadPerNodeInFirstBlock = magicNumberDiffusionLoad / firstBlockSize;
@@ -849,98 +868,133 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::twoWayLocalDi
         result[i] = assignedToSecondBlock[i] ? initialLoadPerNodeInSecondBlock : initialLoadPerNodeInFirstBlock;
     }
 
-    //mark nodes in border as active, rest as inactive
-    std::vector<bool> active(veryLocalN, false);
-    for (IndexType i = 0; i < secondRoundMarkers.first; i++) {
-        active[i] = true;
-    }
-    for (IndexType i = firstBlockSize; i < firstBlockSize+secondRoundMarkers.second; i++) {
-        active[i] = true;
-    }
+    // reused across calls, like the buffers of growBorderRegion
+    static thread_local BorderRegionGraph graph;
+    buildBorderRegionGraph(input, haloStorage, matrixHalo, borderRegionIDs, graph);
+    diffuseInBorderRegion(graph, 1, magicNumberDiffusionSteps, result);
 
-    //this map provides an index from 0 to b-1 for each of the b indices in borderRegionIDs
-    //globalToVeryLocal[borderRegionIDs[i]] = i
-    std::map<IndexType, IndexType> globalToVeryLocal;
+    return result;
+}
+//---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+void ITI::LocalRefinement<IndexType, ValueType>::buildBorderRegionGraph(
+    const CSRSparseMatrix<ValueType> &input,
+    const CSRStorage<ValueType> &haloStorage,
+    const scai::dmemo::HaloExchangePlan &matrixHalo,
+    const std::vector<IndexType>& borderRegionIDs,
+    BorderRegionGraph& graph) {
+
+    SCAI_REGION( "LocalRefinement.buildBorderRegionGraph" )
+    const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
+    const IndexType localN = inputDist->getLocalSize();
+    const IndexType veryLocalN = borderRegionIDs.size();
+
+    graph.globalToVeryLocal.clear();
+    graph.globalToVeryLocal.reserve(veryLocalN);
+    graph.rows.resize(veryLocalN);
     for (IndexType i = 0; i < veryLocalN; i++) {
-        IndexType globalIndex = borderRegionIDs[i];
-        globalToVeryLocal[globalIndex] = i;
-    }
+        const IndexType globalID = borderRegionIDs[i];
+        graph.globalToVeryLocal[globalID] = i;
 
-    IndexType maxDegree = 0;
-    {
-        const scai::hmemo::ReadAccess<IndexType> localIa(input.getLocalStorage().getIA());
-        for (IndexType i = 0; i < firstBlockSize; i++) {
-            const IndexType localI = inputDist->global2Local(borderRegionIDs[i]);
-            if (localIa[localI+1]-localIa[localI] > maxDegree) maxDegree = localIa[localI+1]-localIa[localI];
+        const IndexType localID = inputDist->global2Local(globalID);
+        if (localID != scai::invalidIndex) {
+            graph.rows[i] = localID;
+        } else {
+            const IndexType haloID = matrixHalo.global2Halo(globalID);
+            assert(haloID != scai::invalidIndex);
+            graph.rows[i] = localN + haloID;
         }
     }
-    {
-        const scai::hmemo::ReadAccess<IndexType> localIa(haloStorage.getIA());
-        for (IndexType i = 0; i < localIa.size()-1; i++) {
-            if (localIa[i+1]-localIa[i] > maxDegree) maxDegree = localIa[i+1]-localIa[i];
+    //assert that all indices were unique
+    assert(graph.globalToVeryLocal.size() == veryLocalN);
+
+    const scai::hmemo::ReadAccess<IndexType> localIa(input.getLocalStorage().getIA());
+    const scai::hmemo::ReadAccess<IndexType> localJa(input.getLocalStorage().getJA());
+    const scai::hmemo::ReadAccess<ValueType> localValues(input.getLocalStorage().getValues());
+    const scai::hmemo::ReadAccess<IndexType> haloIa(haloStorage.getIA());
+    const scai::hmemo::ReadAccess<IndexType> haloJa(haloStorage.getJA());
+    const scai::hmemo::ReadAccess<ValueType> haloValues(haloStorage.getValues());
+
+    // calls f(position of the neighbor, weight) for every neighbor of node i inside the border region
+    auto forNeighbors = [&](const IndexType i, auto f) {
+        const bool isLocal = graph.rows[i] < localN;
+        const IndexType row = isLocal ? graph.rows[i] : graph.rows[i] - localN;
+        const IndexType* ia = isLocal ? localIa.get() : haloIa.get();
+        const IndexType* ja = isLocal ? localJa.get() : haloJa.get();
+        const ValueType* values = isLocal ? localValues.get() : haloValues.get();
+
+        for (IndexType j = ia[row]; j < ia[row+1]; j++) {
+            const auto it = graph.globalToVeryLocal.find(ja[j]);
+            if (it != graph.globalToVeryLocal.end() and it->second != i) {
+                f(it->second, values[j]);
+            }
         }
+    };
+
+    graph.ia.assign(veryLocalN+1, 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (IndexType i = 0; i < veryLocalN; i++) {
+        IndexType degree = 0;
+        forNeighbors(i, [&degree](IndexType, ValueType) {
+            degree++;
+        });
+        graph.ia[i+1] = degree;
     }
+    std::partial_sum(graph.ia.begin(), graph.ia.end(), graph.ia.begin());
 
+    graph.ja.resize(graph.ia[veryLocalN]);
+    graph.values.resize(graph.ia[veryLocalN]);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (IndexType i = 0; i < veryLocalN; i++) {
+        IndexType pos = graph.ia[i];
+        forNeighbors(i, [&](IndexType neighbor, ValueType weight) {
+            graph.ja[pos] = neighbor;
+            graph.values[pos] = weight;
+            pos++;
+        });
+    }
+}
+//---------------------------------------------------------------------------------------
 
-    const ValueType magicNumberAlpha = 1.0/(maxDegree+1);
+template<typename IndexType, typename ValueType>
+void ITI::LocalRefinement<IndexType, ValueType>::diffuseInBorderRegion(BorderRegionGraph& graph, const IndexType numSources, const IndexType rounds, std::vector<ValueType>& load) {
+    SCAI_REGION( "LocalRefinement.diffuseInBorderRegion" )
+    const IndexType veryLocalN = graph.ia.size()-1;
+    assert(IndexType(load.size()) == veryLocalN*numSources);
 
-    //assert that all indices were unique
-    assert(globalToVeryLocal.size() == veryLocalN);
+    const std::vector<IndexType>& ia = graph.ia;
+    const std::vector<IndexType>& ja = graph.ja;
+    const std::vector<ValueType>& values = graph.values;
 
-    auto isInBorderRegion = [&](IndexType globalID) {
-        return globalToVeryLocal.count(globalID) > 0;
-    };
+    ValueType maxDegree = 0;
+    #pragma omp parallel for schedule(static) reduction(max:maxDegree)
+    for (IndexType i = 0; i < veryLocalN; i++) {
+        ValueType degree = 0;
+        for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+            degree += values[j];
+        }
+        maxDegree = std::max(maxDegree, degree);
+    }
+    const ValueType alpha = 1.0/(maxDegree+1);
 
-    //perform diffusion
-    for (IndexType round = 0; round < magicNumberDiffusionSteps; round++) {
-        std::vector<ValueType> nextDiffusionValues(result);
-        std::vector<bool> nextActive(veryLocalN, false);
+    std::vector<ValueType>& nextLoad = graph.nextLoad;
+    nextLoad.resize(load.size());
 
-        //diffusion update
+    for (IndexType round = 0; round < rounds; round++) {
+        #pragma omp parallel for schedule(static)
         for (IndexType i = 0; i < veryLocalN; i++) {
-            if (!active[i]) {
-                continue;
-            }
-            nextActive[i] = active[i];
-
-            const ValueType oldDiffusionValue = result[i];
-            const IndexType globalID = borderRegionIDs[i];
-            const CSRStorage<ValueType>& storage = inputDist->isLocal(globalID) ? input.getLocalStorage() : haloStorage;
-            const IndexType localID = inputDist->isLocal(globalID) ? inputDist->global2Local(globalID) : matrixHalo.global2Halo(globalID);
-            assert(localID != scai::invalidIndex);
-
-            const scai::hmemo::ReadAccess<IndexType> localIa(storage.getIA());
-            const scai::hmemo::ReadAccess<IndexType> localJa(storage.getJA());
-
-            const IndexType beginCols = localIa[localID];
-            const IndexType endCols = localIa[localID+1];
-
-            double delta = 0.0;
-            for (IndexType j = beginCols; j < endCols; j++) {
-                const IndexType neighbor = localJa[j];
-                if (isInBorderRegion(neighbor)) {
-                    const IndexType veryLocalNeighbor = globalToVeryLocal.at(neighbor);
-                    const ValueType difference = result[veryLocalNeighbor] - oldDiffusionValue;
-                    delta += difference;
-                    if (difference != 0 && !active[veryLocalNeighbor]) {
-                        throw std::logic_error("Round " + std::to_string(round) + ": load["+std::to_string(i)+"]="+std::to_string(oldDiffusionValue)
-                                               +", load["+std::to_string(veryLocalNeighbor)+"]="+std::to_string(result[veryLocalNeighbor])
-                                               +", but "+std::to_string(veryLocalNeighbor)+" marked as inactive.");
-                    }
-                    nextActive[veryLocalNeighbor] = true;
+            for (IndexType s = 0; s < numSources; s++) {
+                const ValueType oldLoad = load[i*numSources + s];
+                double delta = 0.0;
+                for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+                    delta += values[j]*(load[ja[j]*numSources + s] - oldLoad);
                 }
+                nextLoad[i*numSources + s] = oldLoad + alpha*delta;
             }
-
-            nextDiffusionValues[i] = oldDiffusionValue + delta * magicNumberAlpha;
-            assert (std::abs(nextDiffusionValues[i]) <= magicNumberDiffusionLoad);
         }
-
-        result.swap(nextDiffusionValues);
-        active.swap(nextActive);
+        load.swap(nextLoad);
     }
-
-    return result;
 }
 //---------------------------------------------------------------------------------------
 
@@ -1167,7 +1221,7 @@ std::pair<std::vector<IndexType>, std::vector<IndexType>> ITI::LocalRefinement<I
      * send nodes with non-local neighbors to partner process.
      * here we assume a 1-to-1-mapping of blocks to processes and a symmetric matrix
      */
-    std::unordered_set<IndexType> foreignNodes;
+    std::vector<IndexType> foreignNodes;
     {
         SCAI_REGION( "LocalRefinement.getInterfaceNodes.communication" )
         IndexType swapField[1];
@@ -1179,18 +1233,13 @@ std::pair<std::vector<IndexType>, std::vector<IndexType>> ITI::LocalRefinement<I
         }
         const IndexType otherSize = swapField[0];
         const IndexType swapLength = std::max(otherSize, IndexType(nodesWithNonLocalNeighbors.size()));
-        IndexType swapList[swapLength];
-        for (IndexType i = 0; i < nodesWithNonLocalNeighbors.size(); i++) {
-            swapList[i] = nodesWithNonLocalNeighbors[i];
-        }
-        comm->swap(swapList, swapLength, otherBlock);
-
-        foreignNodes.reserve(otherSize);
+        std::vector<IndexType> swapList(swapLength);
+        std::copy(nodesWithNonLocalNeighbors.begin(), nodesWithNonLocalNeighbors.end(), swapList.begin());
+        comm->swap(swapList.data(), swapLength, otherBlock);
 
         //the swapList array is only partially filled, the number of received nodes is found in swapField[0]
-        for (IndexType i = 0; i < otherSize; i++) {
-            foreignNodes.insert(swapList[i]);
-        }
+        foreignNodes.assign(swapList.begin(), swapList.begin() + otherSize);
+        std::sort(foreignNodes.begin(), foreignNodes.end());
     }
 
     /*
@@ -1204,7 +1253,7 @@ std::pair<std::vector<IndexType>, std::vector<IndexType>> ITI::LocalRefinement<I
         assert(localI != scai::invalidIndex);
 
         for (IndexType j = ia[localI]; j < ia[localI+1]; j++) {
-            if (foreignNodes.count(ja[j])> 0) {
+            if (std::binary_search(foreignNodes.begin(), foreignNodes.end(), ja[j])) {
                 interfaceNodes.push_back(node);
                 break;
             }
@@ -1213,58 +1262,227 @@ std::pair<std::vector<IndexType>, std::vector<IndexType>> ITI::LocalRefinement<I
 
     assert(interfaceNodes.size() <= localN);
 
-    //keep track of which nodes were added at each BFS round
-    std::vector<IndexType> roundMarkers({0});
-
     /*
      * now gather buffer zone with breadth-first search
      */
+    const std::vector<IndexType> roundMarkers = growBorderRegion(ia, ja, inputDist, interfaceNodes, minBorderNodes);
+
+    assert(interfaceNodes.size() <= localN);
+    assert(interfaceNodes.size() >= minBorderNodes || interfaceNodes.size() == localN || roundMarkers[roundMarkers.size()-2] == roundMarkers.back());
+    return {interfaceNodes, roundMarkers};
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<std::pair<std::vector<IndexType>, std::vector<IndexType>>> LocalRefinement<IndexType, ValueType>::getInterfaceNodesBatched(
+    const CSRSparseMatrix<ValueType> &input,
+    const DenseVector<IndexType> &part,
+    const std::vector<IndexType>& nodesWithNonLocalNeighbors,
+    const std::vector<IndexType>& partners,
+    IndexType minBorderNodes) {
+
+    SCAI_REGION( "LocalRefinement.getInterfaceNodesBatched" )
+    const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = inputDist->getCommunicatorPtr();
+    const IndexType numPEs = comm->getSize();
+    const IndexType thisBlock = comm->getRank();
+    const IndexType numPartners = partners.size();
+
+    if (part.getDistributionPtr()->getLocalSize() != inputDist->getLocalSize()) {
+        throw std::runtime_error("Partition has " + std::to_string(part.getDistributionPtr()->getLocalSize()) + " local nodes, but matrix has " + std::to_string(inputDist->getLocalSize()) + ".");
+    }
+
+    if (minBorderNodes <= 0) {
+        throw std::runtime_error("Minimum number of nodes must be positive");
+    }
+
+    // the slot of every partner process in the list of distinct partners
+    std::vector<IndexType> slotOfProcess(numPEs, -1);
+    std::vector<IndexType> distinctPartners;
+    for (IndexType partner : partners) {
+        if (partner < 0 or partner >= numPEs) {
+            throw std::runtime_error("Currently only implemented with one block per process, block " + std::to_string(partner) + " invalid for " + std::to_string(numPEs) + " processes.");
+        }
+        if (partner != thisBlock and slotOfProcess[partner] < 0) {
+            slotOfProcess[partner] = distinctPartners.size();
+            distinctPartners.push_back(partner);
+        }
+    }
+    const IndexType numSlots = distinctPartners.size();
+
+    /*
+     * send the nodes with non-local neighbors to all partners in one exchange.
+     * The partners must be symmetric: if process a lists b, then b lists a.
+     */
+    std::vector<std::pair<IndexType, IndexType>> foreignNodes;     // global ID and owning process, sorted by ID
     {
-        SCAI_REGION( "LocalRefinement.getInterfaceNodes.breadthFirstSearch" )
-        std::vector<bool> touched(localN, false);
-
-        std::queue<IndexType> bfsQueue;
-        for (IndexType node : interfaceNodes) {
-            bfsQueue.push(node);
-            const IndexType localID = inputDist->global2Local(node);
-            assert(localID != scai::invalidIndex);
-            touched[localID] = true;
+        SCAI_REGION( "LocalRefinement.getInterfaceNodesBatched.communication" )
+        const IndexType borderSize = nodesWithNonLocalNeighbors.size();
+        std::vector<IndexType> quantities(numPEs, 0);
+        for (IndexType partner : distinctPartners) {
+            quantities[partner] = borderSize;
         }
-        assert(bfsQueue.size() == interfaceNodes.size());
-        bool active = true;
-
-        while (active) {
-            //if the target number is reached, complete this round and then stop
-            if (interfaceNodes.size() >= minBorderNodes || interfaceNodes.size() == roundMarkers.back()) active = false;
-            roundMarkers.push_back(interfaceNodes.size());
-            std::queue<IndexType> nextQueue;
-            while (!bfsQueue.empty()) {
-                IndexType nextNode = bfsQueue.front();
-                bfsQueue.pop();
-                const IndexType localI = inputDist->global2Local(nextNode);
-                assert(localI != scai::invalidIndex);
-                assert(touched[localI]);
-                const IndexType beginCols = ia[localI];
-                const IndexType endCols = ia[localI+1];
+        scai::dmemo::CommunicationPlan sendPlan(quantities.data(), numPEs);
+        scai::dmemo::CommunicationPlan recvPlan = comm->transpose(sendPlan);
+
+        // the plan lists the partners in increasing order
+        std::vector<IndexType> sendNodes;
+        sendNodes.reserve(sendPlan.totalQuantity());
+        for (IndexType q = 0; q < numPEs; q++) {
+            if (quantities[q] > 0) {
+                sendNodes.insert(sendNodes.end(), nodesWithNonLocalNeighbors.begin(), nodesWithNonLocalNeighbors.end());
+            }
+        }
+        std::vector<IndexType> recvNodes(recvPlan.totalQuantity());
+        comm->exchangeByPlan(recvNodes.data(), recvPlan, sendNodes.data(), sendPlan);
+
+        foreignNodes.reserve(recvNodes.size());
+        for (IndexType i = 0; i < recvPlan.size(); i++) {
+            const scai::dmemo::CommunicationPlan::Entry entry = recvPlan[i];
+            SCAI_ASSERT_GE_ERROR(slotOfProcess[entry.partitionId], 0, "Process " << entry.partitionId << " sent its border to " << thisBlock << ", but is not a partner; the partners must be symmetric.");
+            for (IndexType j = entry.offset; j < entry.offset + entry.quantity; j++) {
+                foreignNodes.push_back(std::make_pair(recvNodes[j], IndexType(entry.partitionId)));
+            }
+        }
+        std::sort(foreignNodes.begin(), foreignNodes.end());
+    }
+
+    /*
+     * one sweep over the local border nodes finds the interface to every partner
+     */
+    const CSRStorage<ValueType>& localStorage = input.getLocalStorage();
+    const scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+    const scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+
+    std::vector<std::vector<IndexType>> interfaceNodes(numSlots);
+    {
+        SCAI_REGION( "LocalRefinement.getInterfaceNodesBatched.getBorderToPartners" )
+        for (IndexType node : nodesWithNonLocalNeighbors) {
+            const IndexType localI = inputDist->global2Local(node);
+            assert(localI != scai::invalidIndex);
+
+            for (IndexType j = ia[localI]; j < ia[localI+1]; j++) {
+                auto it = std::lower_bound(foreignNodes.begin(), foreignNodes.end(), std::make_pair(ja[j], IndexType(0)));
+                if (it != foreignNodes.end() and it->first == ja[j]) {
+                    std::vector<IndexType>& slotNodes = interfaceNodes[slotOfProcess[it->second]];
+                    if (slotNodes.empty() or slotNodes.back() != node) {
+                        slotNodes.push_back(node);
+                    }
+                }
+            }
+        }
+    }
+
+    /*
+     * the border regions are independent, grow them in parallel
+     */
+    std::vector<std::vector<IndexType>> roundMarkers(numSlots);
+    #pragma omp parallel for schedule(dynamic)
+    for (IndexType slot = 0; slot < numSlots; slot++) {
+        roundMarkers[slot] = growBorderRegion(ia, ja, inputDist, interfaceNodes[slot], minBorderNodes);
+    }
+
+    std::vector<std::pair<std::vector<IndexType>, std::vector<IndexType>>> result(numPartners);
+    for (IndexType i = 0; i < numPartners; i++) {
+        if (partners[i] != thisBlock) {
+            const IndexType slot = slotOfProcess[partners[i]];
+            result[i] = std::make_pair(interfaceNodes[slot], roundMarkers[slot]);
+        }
+    }
+    return result;
+}
+//---------------------------------------------------------------------------------------
 
-                for (IndexType j = beginCols; j < endCols; j++) {
-                    IndexType neighbor = ja[j];
-                    IndexType localNeighbor = inputDist->global2Local(neighbor);
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> LocalRefinement<IndexType, ValueType>::growBorderRegion(
+    const scai::hmemo::ReadAccess<IndexType>& ia,
+    const scai::hmemo::ReadAccess<IndexType>& ja,
+    const scai::dmemo::DistributionPtr inputDist,
+    std::vector<IndexType>& nodes,
+    const IndexType minNodes) {
+
+    SCAI_REGION( "LocalRefinement.growBorderRegion" )
+    const IndexType localN = inputDist->getLocalSize();
+
+    // reused across calls; the visited mask is all zero between calls
+    static thread_local BorderRegionBuffers buffers;
+    if (IndexType(buffers.visited.size()) < localN) {
+        buffers.visited.resize(localN, 0);
+    }
+    std::vector<unsigned char>& visited = buffers.visited;
+    std::vector<IndexType>& frontier = buffers.frontier;
+    std::vector<IndexType>& nextFrontier = buffers.nextFrontier;
+    std::vector<std::vector<IndexType>>& candidates = buffers.candidates;
+
+    frontier.clear();
+    for (IndexType node : nodes) {
+        const IndexType localID = inputDist->global2Local(node);
+        assert(localID != scai::invalidIndex);
+        visited[localID] = 1;
+        frontier.push_back(localID);
+    }
+
+    //keep track of which nodes were added at each BFS round
+    std::vector<IndexType> roundMarkers({0});
+    bool active = true;
+
+    while (active) {
+        //if the target number is reached, complete this round and then stop
+        if (IndexType(nodes.size()) >= minNodes || IndexType(nodes.size()) == roundMarkers.back()) active = false;
+        roundMarkers.push_back(nodes.size());
+
+        /*
+         * Every thread collects the unvisited local neighbors of a contiguous part of the frontier.
+         * The candidates are then claimed in frontier order, so the result is the same as for a sequential queue.
+         */
+        const IndexType frontierSize = frontier.size();
+        const IndexType numThreads = frontierSize >= parallelFrontierSize ? omp_get_max_threads() : 1;
+        if (IndexType(candidates.size()) < numThreads) {
+            candidates.resize(numThreads);
+        }
+        // inside another parallel region, the team may be smaller than numThreads
+        for (IndexType thread = 0; thread < numThreads; thread++) {
+            candidates[thread].clear();
+        }
+
+        #pragma omp parallel num_threads(numThreads) if(numThreads > 1)
+        {
+            const IndexType thread = omp_get_thread_num();
+            const IndexType threadBegin = (std::int64_t(frontierSize)*thread)/omp_get_num_threads();
+            const IndexType threadEnd = (std::int64_t(frontierSize)*(thread+1))/omp_get_num_threads();
+            std::vector<IndexType>& threadCandidates = candidates[thread];
+
+            for (IndexType f = threadBegin; f < threadEnd; f++) {
+                const IndexType localI = frontier[f];
+                for (IndexType j = ia[localI]; j < ia[localI+1]; j++) {
+                    const IndexType localNeighbor = inputDist->global2Local(ja[j]);
                     //assume k=p
-                    if (localNeighbor != scai::invalidIndex && !touched[localNeighbor]) {
-                        nextQueue.push(neighbor);
-                        interfaceNodes.push_back(neighbor);
-                        touched[localNeighbor] = true;
+                    if (localNeighbor != scai::invalidIndex && !visited[localNeighbor]) {
+                        threadCandidates.push_back(localNeighbor);
                     }
                 }
             }
-            bfsQueue = nextQueue;
         }
+
+        nextFrontier.clear();
+        for (IndexType thread = 0; thread < numThreads; thread++) {
+            for (IndexType localNeighbor : candidates[thread]) {
+                if (!visited[localNeighbor]) {
+                    visited[localNeighbor] = 1;
+                    nextFrontier.push_back(localNeighbor);
+                    nodes.push_back(inputDist->local2Global(localNeighbor));
+                }
+            }
+        }
+        std::swap(frontier, nextFrontier);
     }
 
-    assert(interfaceNodes.size() <= localN);
-    assert(interfaceNodes.size() >= minBorderNodes || interfaceNodes.size() == localN || roundMarkers[roundMarkers.size()-2] == roundMarkers.back());
-    return {interfaceNodes, roundMarkers};
+    // reset the mask for the next call
+    for (IndexType node : nodes) {
+        visited[inputDist->global2Local(node)] = 0;
+    }
+
+    return roundMarkers;
 }
 //---------------------------------------------------------------------------------------
 
@@ -1275,7 +1493,9 @@ IndexType LocalRefinement<IndexType, ValueType>::localBlockSize(const DenseVecto
     scai::hmemo::ReadAccess<IndexType> localPart(part.getLocalValues());
 
     //possibly shorten with std::count(localPart.get(), localPart.get()+localPart.size(), blockID);
-    for (IndexType i = 0; i < localPart.size(); i++) {
+    const IndexType localN = localPart.size();
+    #pragma omp parallel for reduction(+:result) schedule(static)
+    for (IndexType i = 0; i < localN; i++) {
         if (localPart[i] == blockID) {
             result++;
         }
@@ -1291,10 +1511,13 @@ IndexType ITI::LocalRefinement<IndexType, ValueType>::getDegreeSum(const CSRSpar
     const CSRStorage<ValueType>& localStorage = input.getLocalStorage();
     const scai::hmemo::ReadAccess<IndexType> localIa(localStorage.getIA());
 
+    const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
+    const IndexType numNodes = nodes.size();
     IndexType result = 0;
 
-    for (IndexType node : nodes) {
-        IndexType localID = input.getRowDistributionPtr()->global2Local(node);
+    #pragma omp parallel for reduction(+:result) schedule(static)
+    for (IndexType i = 0; i < numNodes; i++) {
+        IndexType localID = inputDist->global2Local(nodes[i]);
         result += localIa[localID+1] - localIa[localID];
     }
     return result;
@@ -1316,20 +1539,210 @@ std::vector<ValueType> ITI::LocalRefinement<IndexType, ValueType>::distancesFrom
         geometricCenter[dim] = scai::utilskernel::HArrayUtils::sum(localValues) / localN;
     }
 
-    std::vector<ValueType> result(localN);
-    for (IndexType i = 0; i < localN; i++) {
-        ValueType distanceSquared = 0;
-        for (IndexType dim = 0; dim < dimensions; dim++) {
-            const ValueType diff = coordinates[dim].getLocalValues()[i] - geometricCenter[dim];
-            distanceSquared += diff*diff;
+    std::vector<ValueType> result(localN, 0);
+    for (IndexType dim = 0; dim < dimensions; dim++) {
+        scai::hmemo::ReadAccess<ValueType> rCoords(coordinates[dim].getLocalValues());
+        #pragma omp parallel for schedule(static)
+        for (IndexType i = 0; i < localN; i++) {
+            const ValueType diff = rCoords[i] - geometricCenter[dim];
+            result[i] += diff*diff;
         }
-        result[i] = pow(distanceSquared, 0.5);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (IndexType i = 0; i < localN; i++) {
+        result[i] = pow(result[i], 0.5);
     }
     return result;
 }
 
 //---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+ValueType ITI::LocalRefinement<IndexType, ValueType>::greedyRefinement(
+    const CSRSparseMatrix<ValueType> &input,
+    DenseVector<IndexType> &part,
+    const DenseVector<ValueType> &nodeWeights,
+    const scai::dmemo::HaloExchangePlan &halo,
+    const IndexType maxRounds,
+    Settings settings) {
+    SCAI_REGION("LocalRefinement.greedyRefinement");
+
+    const scai::dmemo::DistributionPtr inputDist = input.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = inputDist->getCommunicatorPtr();
+    const IndexType localN = inputDist->getLocalSize();
+    const IndexType k = settings.numBlocks;
+    const scai::common::ScalarType stype = scai::common::TypeTraits<ValueType>::stype;
+
+    SCAI_ASSERT_ERROR(part.getDistributionPtr()->isEqual(*inputDist), "Distribution mismatch");
+    SCAI_ASSERT_ERROR(nodeWeights.getDistributionPtr()->isEqual(*inputDist), "Distribution mismatch");
+
+    const CSRStorage<ValueType>& localStorage = input.getLocalStorage();
+    scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+    scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+    scai::hmemo::ReadAccess<ValueType> values(localStorage.getValues());
+    scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
+
+    //the neighbors as positions in blocks, local nodes come first and then the halo
+    std::vector<IndexType> neighbors(ja.size());
+    #pragma omp parallel for schedule(static)
+    for (IndexType j = 0; j < ja.size(); j++) {
+        const IndexType localNeighbor = inputDist->global2Local(ja[j]);
+        neighbors[j] = localNeighbor != scai::invalidIndex ? localNeighbor : localN + halo.global2Halo(ja[j]);
+    }
+
+    std::vector<IndexType> blocks(localN + halo.getHaloSize());
+    {
+        scai::hmemo::ReadAccess<IndexType> rPart(part.getLocalValues());
+        std::copy(rPart.get(), rPart.get() + localN, blocks.begin());
+    }
+
+    std::vector<ValueType> blockWeights(k, 0);
+    for (IndexType i = 0; i < localN; i++) {
+        blockWeights[blocks[i]] += rWeights[i];
+    }
+    comm->sumImpl(blockWeights.data(), blockWeights.data(), k, stype);
+    const ValueType totalWeight = std::accumulate(blockWeights.begin(), blockWeights.end(), ValueType(0));
+    const ValueType maxBlockWeight = (1 + settings.epsilon) * std::ceil(totalWeight / k);
+
+    std::vector<ValueType> connectivity(k, 0);
+    std::vector<char> isAdjacent(k, 0);
+    std::vector<IndexType> adjacentBlocks;
+
+    //the adjacent block with the highest connectivity among those accepted by canMoveTo, in the direction of this sub-round, or -1
+    auto bestTarget = [&](const IndexType i, const IndexType direction, const auto& canMoveTo, ValueType& gain) {
+        const IndexType ownBlock = blocks[i];
+        for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+            if (neighbors[j] == i) {
+                continue;
+            }
+            const IndexType block = blocks[neighbors[j]];
+            if (!isAdjacent[block]) {
+                isAdjacent[block] = 1;
+                adjacentBlocks.push_back(block);
+            }
+            connectivity[block] += values[j];
+        }
+
+        IndexType target = -1;
+        for (const IndexType block : adjacentBlocks) {
+            const bool rightDirection = direction == 0 ? block > ownBlock : block < ownBlock;
+            if (rightDirection and canMoveTo(block) and (target < 0 or connectivity[block] > connectivity[target])) {
+                target = block;
+            }
+        }
+        gain = target >= 0 ? connectivity[target] - connectivity[ownBlock] : 0;
+
+        for (const IndexType block : adjacentBlocks) {
+            connectivity[block] = 0;
+            isAdjacent[block] = 0;
+        }
+        adjacentBlocks.clear();
+        return target;
+    };
+
+    HArray<IndexType> haloBlocks;
+    ValueType totalGain = 0;
+
+    for (IndexType round = 0; round < maxRounds; round++) {
+        IndexType roundMoves = 0;
+
+        for (IndexType direction = 0; direction < 2; direction++) {
+            //get the current blocks of the non-local neighbors
+            {
+                scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+                std::copy(blocks.begin(), blocks.begin() + localN, wPart.get());
+            }
+            halo.updateHalo(haloBlocks, part.getLocalValues(), *comm);
+            {
+                scai::hmemo::ReadAccess<IndexType> rHalo(haloBlocks);
+                std::copy(rHalo.get(), rHalo.get() + rHalo.size(), blocks.begin() + localN);
+            }
+
+            //candidates that reduce the cut or leave an overloaded block, and the weight they would move into and out of every block
+            std::vector<std::pair<ValueType, IndexType>> candidates;
+            std::vector<ValueType> demand(2*k, 0);
+            for (IndexType i = 0; i < localN; i++) {
+                const IndexType ownBlock = blocks[i];
+                const ValueType weight = rWeights[i];
+                const bool overloaded = blockWeights[ownBlock] > maxBlockWeight;
+
+                ValueType gain;
+                const IndexType target = bestTarget(i, direction, [&](const IndexType block) {
+                    return blockWeights[block] + weight <= maxBlockWeight;
+                }, gain);
+
+                if (target >= 0 and (gain > 0 or overloaded)) {
+                    candidates.push_back(std::make_pair(gain, i));
+                    demand[target] += weight;
+                    if (gain <= 0) {
+                        demand[k + ownBlock] += weight;
+                    }
+                }
+            }
+
+            std::vector<ValueType> globalDemand(2*k);
+            comm->sumImpl(globalDemand.data(), demand.data(), 2*k, stype);
+
+            //the share of this process of the free capacity and of the excess weight of every block
+            std::vector<ValueType> capacity(k, 0);
+            std::vector<ValueType> excess(k, 0);
+            for (IndexType b = 0; b < k; b++) {
+                if (demand[b] > 0) {
+                    capacity[b] = (maxBlockWeight - blockWeights[b]) * demand[b] / globalDemand[b];
+                }
+                if (demand[k + b] > 0) {
+                    excess[b] = (blockWeights[b] - maxBlockWeight) * demand[k + b] / globalDemand[k + b];
+                }
+            }
+
+            //the gains may have changed by earlier moves of local neighbors and are computed again
+            std::sort(candidates.begin(), candidates.end(), [](const std::pair<ValueType, IndexType>& a, const std::pair<ValueType, IndexType>& b) {
+                return a.first > b.first or (a.first == b.first and a.second < b.second);
+            });
+
+            std::vector<ValueType> weightChange(k, 0);
+            for (const std::pair<ValueType, IndexType>& candidate : candidates) {
+                const IndexType i = candidate.second;
+                const IndexType ownBlock = blocks[i];
+                const ValueType weight = rWeights[i];
+
+                ValueType gain;
+                const IndexType target = bestTarget(i, direction, [&](const IndexType block) {
+                    return capacity[block] >= weight;
+                }, gain);
+
+                if (target >= 0 and (gain > 0 or excess[ownBlock] > 0)) {
+                    blocks[i] = target;
+                    capacity[target] -= weight;
+                    excess[ownBlock] -= weight;
+                    weightChange[ownBlock] -= weight;
+                    weightChange[target] += weight;
+                    totalGain += gain;
+                    roundMoves++;
+                }
+            }
+
+            comm->sumImpl(weightChange.data(), weightChange.data(), k, stype);
+            for (IndexType b = 0; b < k; b++) {
+                blockWeights[b] += weightChange[b];
+            }
+        }
+
+        if (comm->sum(roundMoves) == 0) {
+            break;
+        }
+    }
+
+    {
+        scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+        std::copy(blocks.begin(), blocks.begin() + localN, wPart.get());
+    }
+
+    return comm->sum(totalGain);
+}
+//---------------------------------------------------------------------------------------
+
 
 template class LocalRefinement<IndexType, double>;
 template class LocalRefinement<IndexType, float>;
@@ -12,6 +12,7 @@
 #include <scai/tracing.hpp>
 
 #include <assert.h>
+#include <unordered_map>
 
 #include "Settings.h"
 #include "PrioQueue.h"
@@ -74,6 +75,22 @@ public:
         Settings settings
     );
 
+    /**
+     * Same as above, but the communication scheme is given as the partner of this process in every round,
+     * as returned by ParcoRepart::getCommunicationPartners. The vector must have the same size on all processes.
+     */
+    static std::vector<ValueType> distributedFMStep(
+        CSRSparseMatrix<ValueType> &input,
+        DenseVector<IndexType> &part,
+        std::vector<IndexType>& nodesWithNonLocalNeighbors,
+        DenseVector<ValueType> &nodeWeights,
+        std::vector<DenseVector<ValueType>> &coordinates,
+        std::vector<ValueType> &distances,
+        DenseVector<IndexType> &origin,
+        const std::vector<IndexType>& partnerPerRound,
+        Settings settings
+    );
+
     /**
      * Computes the border region to another block, i.e. those local nodes that have a short distance to it.
      *
@@ -98,6 +115,29 @@ public:
                 IndexType minNodes
             );
 
+    /**
+     * Computes the border regions to several other blocks at once, as getInterfaceNodes does for one block.
+     * The border nodes are exchanged with all partners in one communication step and the interfaces to all partners
+     * are found in one sweep over the local border nodes; the breadth-first searches then run in parallel.
+     *
+     * This is collective. The partners must be symmetric: if process a lists b as a partner, then b also lists a.
+     *
+     * @param[in] input Adjacency matrix of the input graph
+     * @param[in] part Partition vector
+     * @param[in] nodesWithNonLocalNeighbors Nodes directly adjacent to other blocks
+     * @param[in] partners The blocks to which the border regions should be adjacent. Entries equal to this process are skipped.
+     * @param[in] minNodes Minimum number nodes in every border region.
+     *
+     * @return for every entry of \p partners, the pair of interfaceNodes and roundMarkers as returned by getInterfaceNodes; empty for skipped entries
+     */
+    static std::vector<std::pair<std::vector<IndexType>, std::vector<IndexType>>> getInterfaceNodesBatched(
+                const CSRSparseMatrix<ValueType> &input,
+                const DenseVector<IndexType> &part,
+                const std::vector<IndexType>& nodesWithNonLocalNeighbors,
+                const std::vector<IndexType>& partners,
+                IndexType minNodes
+            );
+
     /**
      * Redistributes a matrix from a local halo object without communication.
      * Requires that all elements that are local in the new distribution are either local in the old distribution or present in the halo.
@@ -129,6 +169,72 @@ public:
     */
     static std::vector<ValueType> distancesFromBlockCenter(const std::vector<DenseVector<ValueType>> &coordinates);
 
+    /**
+     * Improves the cut of an arbitrary partition of a distributed graph by greedily moving border nodes to neighboring blocks.
+     * Unlike distributedFMStep, the partition does not need to coincide with the distribution and nothing is redistributed.
+     *
+     * Every round has two sub-rounds; in the first one, nodes only move to blocks with a higher ID, in the second one to blocks with a lower ID,
+     * so two neighbors on different processes cannot swap their blocks at the same time. A node moves if this reduces the cut,
+     * or if its block is heavier than (1+epsilon) times the average block weight. The free capacity of every block is split among
+     * the processes in proportion to the weight they want to move into it, the blocks of non-local neighbors are updated after every sub-round.
+     *
+     * @param[in] input Adjacency matrix of the input graph; self loops are ignored
+     * @param[in,out] part Partition, distributed like the rows of \p input
+     * @param[in] nodeWeights Weights of the nodes, distributed like the rows of \p input
+     * @param[in] halo Halo of all non-local neighbors, as built by GraphUtils::buildNeighborHalo
+     * @param[in] maxRounds Maximum number of rounds, the refinement stops earlier if no node moved in a round
+     * @param[in] settings Uses numBlocks and epsilon
+     *
+     * @return The sum of the local gains of all moves; moves of neighbors on different processes in the same sub-round may make the actual gain smaller
+     */
+    static ValueType greedyRefinement(
+        const CSRSparseMatrix<ValueType> &input,
+        DenseVector<IndexType> &part,
+        const DenseVector<ValueType> &nodeWeights,
+        const scai::dmemo::HaloExchangePlan &halo,
+        const IndexType maxRounds,
+        Settings settings);
+
+    /** The subgraph induced by a border region in compact CSR form, kept between calls to avoid allocations. */
+    struct BorderRegionGraph {
+        std::unordered_map<IndexType, IndexType> globalToVeryLocal; ///< globalToVeryLocal[borderRegionIDs[i]] = i
+        std::vector<IndexType> rows;        ///< the row of every node in the local storage, or localN + its row in the halo storage
+        std::vector<IndexType> ia;
+        std::vector<IndexType> ja;          ///< positions in borderRegionIDs; self loops and edges leaving the region are dropped
+        std::vector<ValueType> values;      ///< the edge weights
+        std::vector<ValueType> nextLoad;    ///< buffer of diffuseInBorderRegion
+    };
+
+    /**
+     * @brief Build the subgraph induced by the nodes of a border region.
+     *
+     * @param[in] input Adjacency matrix of local subgraph
+     * @param[in] haloStorage Adjacency matrix of non-local border region
+     * @param[in] halo Halo object to translate global IDs to elements in haloStorage
+     * @param[in] borderRegionIDs global IDs of nodes in local and non-local border regions, must be unique
+     * @param[out] graph The compact graph, node i is borderRegionIDs[i]
+     */
+    static void buildBorderRegionGraph(
+        const CSRSparseMatrix<ValueType> &input,
+        const CSRStorage<ValueType> &haloStorage,
+        const scai::dmemo::HaloExchangePlan &halo,
+        const std::vector<IndexType>& borderRegionIDs,
+        BorderRegionGraph& graph
+    );
+
+    /**
+     * @brief Diffuse several loads at once on a border region graph with Jacobi sweeps.
+     *
+     * Every round sets load[i] += alpha * sum_j w_ij*(load[j] - load[i]) for all nodes in parallel, with alpha = 1/(maxWeightedDegree+1).
+     * Every new load is a convex combination of the old loads, so the sum of every source is kept and the values stay in their initial range.
+     *
+     * @param[in,out] graph The graph from buildBorderRegionGraph, its nextLoad buffer is overwritten
+     * @param[in] numSources The number of loads diffused in the same sweeps
+     * @param[in] rounds The number of Jacobi sweeps
+     * @param[in,out] load numSources values per node, node after node, i.e., load[i*numSources + s] is the load of source s on node i
+     */
+    static void diffuseInBorderRegion(BorderRegionGraph& graph, const IndexType numSources, const IndexType rounds, std::vector<ValueType>& load);
+
 private:
 
     /**
@@ -168,11 +274,13 @@ private:
     /**
      * @brief Perform a two way diffusion step, useful to generate tie breaking keys for local refinement
      *
+     * The first block starts with a total load of 1, the second with -1, spread evenly over their nodes.
+     * Then settings.diffusionRounds rounds of diffuseInBorderRegion are done on the border region graph.
+     *
      * @param[in] input Adjacency matrix of local subgraph
      * @param[in] haloStorage Adjacency matrix of non-local border region
      * @param[in] halo Halo object to translate global IDs to elements in haloStorage
      * @param[in] borderRegionIDs global IDs of nodes in local and non-local border regions
-     * @param[in] secondRoundMarkers The number of nodes directly adjacent to the other block, for the local and non-local block
      * @param[in] assignedToSecondBlock boolean array, false if node is in first (local) block, true if in second (non-local) block
      * @param[in] settings Settings struct
      *
@@ -183,11 +291,39 @@ private:
         const CSRStorage<ValueType> &haloStorage,
         const scai::dmemo::HaloExchangePlan &halo,
         const std::vector<IndexType>& borderRegionIDs,
-        std::pair<IndexType, IndexType> secondRoundMarkers,
         const std::vector<bool>& assignedToSecondBlock,
         Settings settings
     );
 
+    /** Buffers of growBorderRegion, kept between calls to avoid allocations. */
+    struct BorderRegionBuffers {
+        std::vector<unsigned char> visited;             ///< one byte per local node, all zero between calls
+        std::vector<IndexType> frontier;                ///< local IDs of the current BFS level
+        std::vector<IndexType> nextFrontier;
+        std::vector<std::vector<IndexType>> candidates; ///< unvisited neighbors found by every thread
+    };
+
+    /** BFS levels with at least this many nodes are expanded with all OpenMP threads. */
+    static const IndexType parallelFrontierSize = 1024;
+
+    /**
+     * @brief Extend a set of local nodes by breadth-first search until it has at least minNodes nodes, completing the last BFS round.
+     *
+     * @param[in] ia Row offsets of the local adjacency matrix
+     * @param[in] ja Global column indices of the local adjacency matrix
+     * @param[in] inputDist Row distribution of the adjacency matrix
+     * @param[in,out] nodes The global IDs of the start nodes; the found nodes are appended in BFS order
+     * @param[in] minNodes Minimum number of nodes
+     *
+     * @return roundMarkers, roundMarkers[i] is the position in \p nodes where the nodes of BFS round i begin
+     */
+    static std::vector<IndexType> growBorderRegion(
+        const scai::hmemo::ReadAccess<IndexType>& ia,
+        const scai::hmemo::ReadAccess<IndexType>& ja,
+        const scai::dmemo::DistributionPtr inputDist,
+        std::vector<IndexType>& nodes,
+        const IndexType minNodes);
+
     /**
      * @brief Count local nodes in block blockID
      *
@@ -15,6 +15,8 @@
 #include <memory>
 #include <cstdlib>
 #include <numeric>
+#include <map>
+#include <random>
 
 #include "ParcoRepart.h"
 #include "MeshGenerator.h"
@@ -371,6 +373,66 @@ TYPED_TEST(LocalRefinementTest, testGetInterfaceNodesDistributed) {
 }
 //----------------------------------------------------------
 
+TYPED_TEST(LocalRefinementTest, testGetInterfaceNodesBatched) {
+    using ValueType = TypeParam;
+
+    const IndexType dimX = 12;
+    const IndexType dimY = 12;
+    const IndexType dimZ = 12;
+    const IndexType n = dimX*dimY*dimZ;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType k = comm->getSize();
+
+    auto a = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>(n,n);
+    scai::lama::MatrixCreator::buildPoisson(a, 3, 19, dimX,dimY,dimZ);
+    scai::dmemo::DistributionPtr dist = a.getRowDistributionPtr();
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(n));
+    a.redistribute(dist, noDistPointer);
+
+    //slabs along the node IDs, so every block has up to two neighbors
+    scai::lama::DenseVector<IndexType> part(dist, 0);
+    for (IndexType i = 0; i < n; i++) {
+        part.setValue(i, (i*k)/n);
+    }
+    scai::dmemo::DistributionPtr newDist = scai::dmemo::generalDistributionByNewOwners( *dist, part.getLocalValues() );
+    a.redistribute(newDist, a.getColDistributionPtr());
+    part.redistribute(newDist);
+
+    Settings settings;
+    settings.numBlocks = k;
+    scai::lama::CSRSparseMatrix<ValueType> blockGraph = GraphUtils<IndexType,ValueType>::getBlockGraph( a, part, k);
+    std::vector<DenseVector<IndexType>> scheme = ParcoRepart<IndexType, ValueType>::getCommunicationPairs_local( blockGraph, settings );
+    std::vector<IndexType> localBorder = GraphUtils<IndexType,ValueType>::getNodesWithNonLocalNeighbors(a);
+
+    std::vector<IndexType> partners(scheme.size());
+    for (IndexType round = 0; round < scheme.size(); round++) {
+        scai::hmemo::ReadAccess<IndexType> commAccess(scheme[round].getLocalValues());
+        partners[round] = commAccess[scheme[round].getDistributionPtr()->global2Local(comm->getRank())];
+    }
+
+    //a large minimum size, so the breadth-first searches run over several rounds
+    const IndexType minNodes = n/(2*k);
+    std::vector<std::pair<std::vector<IndexType>, std::vector<IndexType>>> batched = LocalRefinement<IndexType, ValueType>::getInterfaceNodesBatched(a, part, localBorder, partners, minNodes);
+    ASSERT_EQ(batched.size(), partners.size());
+
+    //the same border regions, in the same order, as one call per partner
+    for (IndexType round = 0; round < partners.size(); round++) {
+        if (partners[round] == comm->getRank()) {
+            EXPECT_TRUE(batched[round].first.empty());
+            continue;
+        }
+        std::vector<IndexType> interfaceNodes;
+        std::vector<IndexType> roundMarkers;
+        std::tie(interfaceNodes, roundMarkers) = LocalRefinement<IndexType, ValueType>::getInterfaceNodes(a, part, localBorder, partners[round], minNodes);
+
+        EXPECT_EQ(interfaceNodes, batched[round].first);
+        EXPECT_EQ(roundMarkers, batched[round].second);
+        EXPECT_TRUE(interfaceNodes.size() >= minNodes || roundMarkers[roundMarkers.size()-2] == roundMarkers.back());
+    }
+}
+//----------------------------------------------------------
+
 TYPED_TEST(LocalRefinementTest, testDistancesFromBlockCenter) {
     using ValueType = TypeParam;
 
@@ -409,6 +471,283 @@ TYPED_TEST(LocalRefinementTest, testDistancesFromBlockCenter) {
 }
 //---------------------------------------------------------------------------------------
 
+TYPED_TEST(LocalRefinementTest, testGreedyRefinement) {
+    using ValueType = TypeParam;
+
+    const IndexType nroot = 16;
+    const IndexType n = nroot * nroot * nroot;
+    const IndexType dimensions = 3;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, n) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(n));
+
+    auto graph = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>(dist, noDistPointer);
+    std::vector<ValueType> maxCoord(dimensions, nroot);
+    std::vector<IndexType> numPoints(dimensions, nroot);
+    std::vector<DenseVector<ValueType>> coordinates(dimensions);
+    for(IndexType i=0; i<dimensions; i++) {
+        coordinates[i] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(graph, coordinates, maxCoord, numPoints, dimensions);
+
+    const IndexType localN = dist->getLocalSize();
+    const DenseVector<ValueType> nodeWeights(dist, 1);
+    scai::dmemo::HaloExchangePlan halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(graph);
+
+    Settings settings;
+    settings.numBlocks = 4;
+    settings.epsilon = 0.05;
+
+    //a pseudorandom partition that does not depend on the number of processes, the refinement must reduce the cut a lot
+    {
+        DenseVector<IndexType> part(dist, 0);
+        {
+            scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                wPart[i] = (dist->local2Global(i)*7919 + 13) % settings.numBlocks;
+            }
+        }
+        const ValueType cutBefore = GraphUtils<IndexType, ValueType>::computeCut(graph, part);
+
+        const ValueType gain = LocalRefinement<IndexType, ValueType>::greedyRefinement(graph, part, nodeWeights, halo, 20, settings);
+        const ValueType cutAfter = GraphUtils<IndexType, ValueType>::computeCut(graph, part);
+
+        EXPECT_GT(gain, 0);
+        EXPECT_LT(cutAfter, 0.5*cutBefore);
+        EXPECT_GE(part.min(), 0);
+        EXPECT_LT(part.max(), settings.numBlocks);
+        EXPECT_LE(GraphUtils<IndexType, ValueType>::computeImbalance(part, settings.numBlocks), settings.epsilon + 0.01);
+    }
+
+    //slabs in the order 1, 0, 2, 3; block 0 has 30% of the nodes and must give some of them to its neighbors
+    {
+        const std::vector<IndexType> slabBlocks = {1, 0, 2, 3};
+        const std::vector<IndexType> slabEnds = {7*n/30, 16*n/30, 23*n/30, n};
+        DenseVector<IndexType> part(dist, 0);
+        {
+            scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                const IndexType globalI = dist->local2Global(i);
+                IndexType slab = 0;
+                while (globalI >= slabEnds[slab]) {
+                    slab++;
+                }
+                wPart[i] = slabBlocks[slab];
+            }
+        }
+        EXPECT_GT(GraphUtils<IndexType, ValueType>::computeImbalance(part, settings.numBlocks), 0.15);
+
+        LocalRefinement<IndexType, ValueType>::greedyRefinement(graph, part, nodeWeights, halo, 20, settings);
+
+        EXPECT_LE(GraphUtils<IndexType, ValueType>::computeImbalance(part, settings.numBlocks), settings.epsilon + 0.01);
+        EXPECT_LT(part.max(), settings.numBlocks);
+    }
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST(LocalRefinementTest, testFiducciaMattheysesDiffusionTieBreaking) {
+    using ValueType = TypeParam;
+
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType k = comm->getSize();
+    if (k == 1) {
+        GTEST_SKIP() << "distributedFMStep needs a neighboring process";
+    }
+
+    const IndexType nroot = 16;
+    const IndexType n = nroot * nroot * nroot;
+    const IndexType dimensions = 3;
+
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, n) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(n));
+
+    auto graph = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>(dist, noDistPointer);
+    std::vector<ValueType> maxCoord(dimensions, nroot);
+    std::vector<IndexType> numPoints(dimensions, nroot);
+    std::vector<DenseVector<ValueType>> coordinates(dimensions);
+    for(IndexType i=0; i<dimensions; i++) {
+        coordinates[i] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(graph, coordinates, maxCoord, numPoints, dimensions);
+
+    //every process is one block
+    DenseVector<IndexType> part(dist, comm->getRank());
+
+    Settings settings;
+    settings.numBlocks = k;
+    settings.epsilon = 0.05;
+    settings.useDiffusionTieBreaking = true;
+
+    scai::lama::CSRSparseMatrix<ValueType> blockGraph = GraphUtils<IndexType,ValueType>::getBlockGraph( graph, part, settings.numBlocks);
+    std::vector<DenseVector<IndexType>> communicationScheme = ParcoRepart<IndexType,ValueType>::getCommunicationPairs_local(blockGraph, settings);
+
+    DenseVector<ValueType> weights(dist, 1);
+    std::vector<IndexType> localBorder = GraphUtils<IndexType,ValueType>::getNodesWithNonLocalNeighbors(graph);
+    std::vector<ValueType> distances = LocalRefinement<IndexType,ValueType>::distancesFromBlockCenter(coordinates);
+    DenseVector<IndexType> origin(dist, comm->getRank());
+
+    ValueType cut = GraphUtils<IndexType,ValueType>::computeCut(graph, part, true);
+    for (IndexType i = 0; i < 5; i++) {
+        std::vector<ValueType> gainPerRound = LocalRefinement<IndexType, ValueType>::distributedFMStep(graph, part, localBorder, weights, coordinates, distances, origin, communicationScheme, settings);
+        IndexType gain = 0;
+        for (IndexType roundGain : gainPerRound) gain += roundGain;
+
+        const ValueType newCut = GraphUtils<IndexType,ValueType>::computeCut(graph, part, true);
+        EXPECT_EQ(cut - gain, newCut) << "Old cut " << cut << ", gain " << gain << " newCut " << newCut;
+        EXPECT_LE(newCut, cut);
+        cut = newCut;
+    }
+
+    EXPECT_LE(GraphUtils<IndexType,ValueType>::computeImbalance(part, k, weights), settings.epsilon);
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST(LocalRefinementTest, testDiffuseInBorderRegion) {
+    using ValueType = TypeParam;
+    using BorderRegionGraph = typename LocalRefinement<IndexType, ValueType>::BorderRegionGraph;
+
+    const IndexType nroot = 12;
+    const IndexType n = nroot * nroot * nroot;
+    const IndexType dimensions = 3;
+    const IndexType rounds = 20;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, n) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(n));
+
+    auto graph = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>(dist, noDistPointer);
+    std::vector<ValueType> maxCoord(dimensions, nroot);
+    std::vector<IndexType> numPoints(dimensions, nroot);
+    std::vector<DenseVector<ValueType>> coordinates(dimensions);
+    for(IndexType i=0; i<dimensions; i++) {
+        coordinates[i] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(graph, coordinates, maxCoord, numPoints, dimensions);
+
+    //the border region are all local nodes in reverse order, so no halo is needed
+    const IndexType localN = dist->getLocalSize();
+    std::vector<IndexType> borderRegionIDs(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        borderRegionIDs[i] = dist->local2Global(localN-1-i);
+    }
+    CSRStorage<ValueType> haloStorage;
+    scai::dmemo::HaloExchangePlan halo;
+
+    BorderRegionGraph regionGraph;
+    LocalRefinement<IndexType, ValueType>::buildBorderRegionGraph(graph, haloStorage, halo, borderRegionIDs, regionGraph);
+    ASSERT_EQ(IndexType(regionGraph.ia.size()), localN+1);
+
+    //the reference is the unweighted update of the former implementation: a map from global IDs to positions
+    //and alpha = 1/(maxDegree+1); the degree of a node in the region is its number of local neighbors
+    std::vector<std::vector<IndexType>> neighbors(localN);
+    {
+        std::map<IndexType, IndexType> globalToVeryLocal;
+        for (IndexType i = 0; i < localN; i++) {
+            globalToVeryLocal[borderRegionIDs[i]] = i;
+        }
+        const scai::hmemo::ReadAccess<IndexType> ia(graph.getLocalStorage().getIA());
+        const scai::hmemo::ReadAccess<IndexType> ja(graph.getLocalStorage().getJA());
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType localID = dist->global2Local(borderRegionIDs[i]);
+            for (IndexType j = ia[localID]; j < ia[localID+1]; j++) {
+                if (ja[j] != borderRegionIDs[i] and globalToVeryLocal.count(ja[j]) > 0) {
+                    neighbors[i].push_back(globalToVeryLocal.at(ja[j]));
+                }
+            }
+        }
+    }
+    IndexType maxDegree = 0;
+    for (IndexType i = 0; i < localN; i++) {
+        std::vector<IndexType> compactNeighbors(regionGraph.ja.begin()+regionGraph.ia[i], regionGraph.ja.begin()+regionGraph.ia[i+1]);
+        std::sort(compactNeighbors.begin(), compactNeighbors.end());
+        std::vector<IndexType> expected = neighbors[i];
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(compactNeighbors, expected);
+        maxDegree = std::max(maxDegree, IndexType(neighbors[i].size()));
+    }
+
+    //first block +1, second block -1, as in twoWayLocalDiffusion
+    const IndexType firstBlockSize = localN/2;
+    std::vector<ValueType> initialLoad(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        initialLoad[i] = i < firstBlockSize ? ValueType(1)/firstBlockSize : ValueType(-1)/(localN-firstBlockSize);
+    }
+
+    std::vector<ValueType> reference(initialLoad);
+    const ValueType alpha = 1.0/(maxDegree+1);
+    for (IndexType round = 0; round < rounds; round++) {
+        std::vector<ValueType> next(reference);
+        for (IndexType i = 0; i < localN; i++) {
+            double delta = 0.0;
+            for (IndexType neighbor : neighbors[i]) {
+                delta += reference[neighbor] - reference[i];
+            }
+            next[i] = reference[i] + delta*alpha;
+        }
+        reference.swap(next);
+    }
+
+    std::vector<ValueType> load(initialLoad);
+    LocalRefinement<IndexType, ValueType>::diffuseInBorderRegion(regionGraph, 1, rounds, load);
+    for (IndexType i = 0; i < localN; i++) {
+        EXPECT_NEAR(load[i], reference[i], std::is_same<ValueType, float>::value ? 1e-6 : 1e-12);
+    }
+
+    //several sources with random edge weights: every source is diffused as if alone, keeps its sum and stays in its initial range
+    std::mt19937 gen(comm->getRank()+1);
+    std::uniform_real_distribution<ValueType> weightDist(0.5, 3);
+    std::uniform_real_distribution<ValueType> loadDist(-2, 5);
+    for (IndexType i = 0; i < localN; i++) {
+        for (IndexType j = regionGraph.ia[i]; j < regionGraph.ia[i+1]; j++) {
+            const IndexType neighbor = regionGraph.ja[j];
+            if (neighbor < i) {
+                continue;
+            }
+            //symmetric weights
+            const ValueType weight = weightDist(gen);
+            regionGraph.values[j] = weight;
+            for (IndexType r = regionGraph.ia[neighbor]; r < regionGraph.ia[neighbor+1]; r++) {
+                if (regionGraph.ja[r] == i) {
+                    regionGraph.values[r] = weight;
+                }
+            }
+        }
+    }
+
+    const IndexType numSources = 3;
+    const ValueType tolerance = std::is_same<ValueType, float>::value ? 1e-4 : 1e-10;
+    std::vector<ValueType> multiLoad(localN*numSources);
+    for (ValueType& value : multiLoad) {
+        value = loadDist(gen);
+    }
+    const std::vector<ValueType> initialMultiLoad(multiLoad);
+    LocalRefinement<IndexType, ValueType>::diffuseInBorderRegion(regionGraph, numSources, rounds, multiLoad);
+
+    for (IndexType s = 0; s < numSources; s++) {
+        std::vector<ValueType> singleLoad(localN);
+        for (IndexType i = 0; i < localN; i++) {
+            singleLoad[i] = initialMultiLoad[i*numSources + s];
+        }
+        const ValueType minLoad = *std::min_element(singleLoad.begin(), singleLoad.end());
+        const ValueType maxLoad = *std::max_element(singleLoad.begin(), singleLoad.end());
+        const double initialSum = std::accumulate(singleLoad.begin(), singleLoad.end(), 0.0);
+
+        LocalRefinement<IndexType, ValueType>::diffuseInBorderRegion(regionGraph, 1, rounds, singleLoad);
+
+        double sum = 0;
+        for (IndexType i = 0; i < localN; i++) {
+            EXPECT_EQ(multiLoad[i*numSources + s], singleLoad[i]);
+            EXPECT_GE(singleLoad[i], minLoad - tolerance);
+            EXPECT_LE(singleLoad[i], maxLoad + tolerance);
+            sum += singleLoad[i];
+        }
+        EXPECT_NEAR(sum, initialSum, localN*tolerance);
+    }
+}
+//---------------------------------------------------------------------------------------
+
 
 
 }// namespace ITI
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mpi.h>
+#include <cstddef>
+
+namespace ITI {
+
+/** @brief The MPI datatype of a fundamental type.
+
+ Used to derive the MPI types from IndexType and ValueType, so that
+ changing scai::IndexType to a 64-bit type does not need changes in the MPI calls.
+*/
+template<typename T>
+MPI_Datatype getMPIType();
+
+template<> inline MPI_Datatype getMPIType<float>() {
+    return MPI_FLOAT;
+}
+
+template<> inline MPI_Datatype getMPIType<double>() {
+    return MPI_DOUBLE;
+}
+
+template<> inline MPI_Datatype getMPIType<int>() {
+    return MPI_INT;
+}
+
+template<> inline MPI_Datatype getMPIType<unsigned int>() {
+    return MPI_UNSIGNED;
+}
+
+template<> inline MPI_Datatype getMPIType<long>() {
+    return MPI_LONG;
+}
+
+template<> inline MPI_Datatype getMPIType<unsigned long>() {
+    return MPI_UNSIGNED_LONG;
+}
+
+template<> inline MPI_Datatype getMPIType<long long>() {
+    return MPI_LONG_LONG;
+}
+
+template<> inline MPI_Datatype getMPIType<unsigned long long>() {
+    return MPI_UNSIGNED_LONG_LONG;
+}
+
+/** @brief The MPI datatype of a struct with two members, e.g., the pairs sorted with JanusSort.
+
+ The type is created and committed on the first call for every PairType. Its extent is
+ sizeof(PairType), so arrays of PairType with padding are sent correctly.
+
+ @param[in] firstOffset The offset of the first member, use offsetof.
+ @param[in] secondOffset The offset of the second member.
+*/
+template<typename PairType, typename FirstType, typename SecondType>
+MPI_Datatype getMPIPairType(const MPI_Aint firstOffset, const MPI_Aint secondOffset) {
+    static const MPI_Datatype pairType = [firstOffset, secondOffset]() {
+        int blockLengths[2] = {1, 1};
+        MPI_Aint displacements[2] = {firstOffset, secondOffset};
+        MPI_Datatype types[2] = {getMPIType<FirstType>(), getMPIType<SecondType>()};
+
+        MPI_Datatype structType, resizedType;
+        MPI_Type_create_struct(2, blockLengths, displacements, types, &structType);
+        MPI_Type_create_resized(structType, 0, sizeof(PairType), &resizedType);
+        MPI_Type_commit(&resizedType);
+        MPI_Type_free(&structType);
+        return resizedType;
+    }();
+    return pairType;
+}
+
+} // namespace ITI
@@ -7,6 +7,9 @@
 
 #include "MeshGenerator.h"
 #include <chrono>
+#include <cstdint>
+
+#include <scai/dmemo/NoDistribution.hpp>
 
 #include <scai/common/macros/assert.hpp>
 
@@ -847,7 +850,9 @@ void MeshGenerator<IndexType, ValueType>::createQuadMesh( CSRSparseMatrix<ValueT
     // the quad tree
     QuadTreeCartesianEuclid<ValueType> quad(minCoord, maxCoord, true, capacity);
 
-    // create points and add them in the tree
+    // create points and add them in the tree at once
+    std::vector<Point<ValueType>> points;
+    points.reserve( numberOfAreas*pointsPerArea + pointsPerArea*2 );
     std::random_device rd;
     std::default_random_engine generator( seed );
     std::vector<std::normal_distribution<ValueType>> distForDim(dimension);
@@ -879,7 +884,7 @@ void MeshGenerator<IndexType, ValueType>::createQuadMesh( CSRSparseMatrix<ValueT
                 assert(thisCoord < maxCoord[d]);
                 pInRange[d] = thisCoord;
             }
-            quad.addContent(0,pInRange);
+            points.push_back(pInRange);
         }
     }
 
@@ -892,9 +897,10 @@ void MeshGenerator<IndexType, ValueType>::createQuadMesh( CSRSparseMatrix<ValueT
             p[d] = dist(generator);
             //p[d]= ((ValueType) rand()/RAND_MAX) * maxCoord[d];
         }
-        quad.addContent(0, p);
+        points.push_back(p);
     }
 
+    quad.bulkLoad(points);
     quad.indexSubtree(0);
     graphFromQuadtree(adjM, coords, quad);
 }
@@ -903,15 +909,12 @@ void MeshGenerator<IndexType, ValueType>::createQuadMesh( CSRSparseMatrix<ValueT
 template<typename IndexType, typename ValueType>
 void MeshGenerator<IndexType, ValueType>::graphFromQuadtree(CSRSparseMatrix<ValueType> &adjM, std::vector<DenseVector<ValueType>> &coords, const QuadTreeCartesianEuclid<ValueType> &quad) {
 
-    const IndexType treeSize = quad.countNodes();
     const IndexType dimension = quad.getDimensions();
 
     // the quad tree is created. extract it as a CSR matrix
-    // graphNgbrsCells is just empty now
-    std::vector< std::set<std::shared_ptr<const SpatialCell<ValueType>>> > graphNgbrsCells( treeSize );
     std::vector<std::vector<ValueType>> coordsV( dimension );
 
-    adjM = quad.template getTreeAsGraph<IndexType>( graphNgbrsCells, coordsV );
+    adjM = quad.template getLeafGraph<IndexType>( coordsV );
     const IndexType n = adjM.getNumRows();
     assert(n == coordsV[0].size());
 
@@ -944,6 +947,216 @@ std::vector<DenseVector<ValueType>> MeshGenerator<IndexType, ValueType>::randomP
     return ret;
 }
 
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+void MeshGenerator<IndexType, ValueType>::createPoints_dist(std::vector<DenseVector<ValueType>> &coords, DenseVector<ValueType> &nodeWeights, const IndexType globalN, const IndexType dimensions, const PointDistribution distribution, const unsigned long seed, const scai::dmemo::CommunicatorPtr comm) {
+    SCAI_REGION( "MeshGenerator.createPoints_dist" )
+
+    const scai::dmemo::DistributionPtr blockDist(new scai::dmemo::BlockDistribution(globalN, comm));
+
+    IndexType beginLocalRange, endLocalRange;
+    scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, globalN, comm->getRank(), comm->getSize());
+
+    std::vector<std::vector<ValueType>> localCoords;
+    std::vector<ValueType> localWeights;
+    createPointsRange( localCoords, localWeights, globalN, beginLocalRange, endLocalRange, dimensions, distribution, seed );
+
+    const IndexType localN = endLocalRange - beginLocalRange;
+    coords.resize(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        HArray<ValueType> localValues(localN, localCoords[d].data());
+        coords[d] = DenseVector<ValueType>(blockDist, localValues);
+    }
+    HArray<ValueType> localWeightValues(localN, localWeights.data());
+    nodeWeights = DenseVector<ValueType>(blockDist, localWeightValues);
+}
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+void MeshGenerator<IndexType, ValueType>::createPointsRange(std::vector<std::vector<ValueType>> &coords, std::vector<ValueType> &nodeWeights, const IndexType globalN, const IndexType beginIndex, const IndexType endIndex, const IndexType dimensions, const PointDistribution distribution, const unsigned long seed) {
+    SCAI_REGION( "MeshGenerator.createPointsRange" )
+
+    if (dimensions != 2 and dimensions != 3) {
+        throw std::invalid_argument("Points can only be created in 2 or 3 dimensions, not " + std::to_string(dimensions));
+    }
+    SCAI_ASSERT_LE_ERROR( beginIndex, endIndex, "Wrong range of points" );
+    SCAI_ASSERT_LE_ERROR( endIndex, globalN, "Range exceeds the number of points" );
+
+    const IndexType rangeN = endIndex - beginIndex;
+    coords.assign(dimensions, std::vector<ValueType>(rangeN));
+    nodeWeights.assign(rangeN, 1);
+
+    //the streams of hashedUniform; every random value of a point comes from a different stream
+    const unsigned long maxStreams = 16;
+    const double pi = std::acos(-1.0);
+
+    //fixed parameters of the distributions, derived from the seed only
+    const IndexType numClusters = 16;
+    const IndexType numLands = 4;
+    const double coastRefinement = 0.01;  // density falls with 1/(distance from coast + coastRefinement)
+    const double shelfWidth = 0.25;       // beyond that distance from the coast the sea has full depth
+    const IndexType maxLayers = 10;
+    const IndexType maxTries = 64;
+
+    //cluster centers, sizes and land masses; the index space beyond globalN is used to keep them apart from the points
+    std::vector<std::vector<double>> clusterCenters(std::max(numClusters, numLands), std::vector<double>(dimensions));
+    std::vector<double> clusterRadius(clusterCenters.size());
+    for (IndexType c = 0; c < IndexType(clusterCenters.size()); c++) {
+        const unsigned long clusterIndex = (unsigned long)globalN + c;
+        for (IndexType d = 0; d < dimensions; d++) {
+            clusterCenters[c][d] = 0.1 + 0.8*hashedUniform(seed, clusterIndex, d);
+        }
+        clusterRadius[c] = 0.02 + 0.08*hashedUniform(seed, clusterIndex, dimensions);
+    }
+
+    const IndexType gridSide = pointsGridSide(globalN, dimensions);
+
+    #pragma omp parallel for schedule(static)
+    for (IndexType i = 0; i < rangeN; i++) {
+        const unsigned long globalIndex = beginIndex + i;
+
+        switch (distribution) {
+        case PointDistribution::uniform: {
+            //the grid cell of the point, then a random position inside the cell
+            IndexType cellIndex = globalIndex;
+            for (IndexType d = 0; d < dimensions; d++) {
+                const IndexType cellCoord = cellIndex % gridSide;
+                cellIndex /= gridSide;
+                coords[d][i] = (cellCoord + hashedUniform(seed, globalIndex, d))/gridSide;
+            }
+            break;
+        }
+        case PointDistribution::gaussian: {
+            const IndexType c = std::min( IndexType(hashedUniform(seed, globalIndex, 0)*numClusters), numClusters-1 );
+            for (IndexType d = 0; d < dimensions; d++) {
+                //Box-Muller transform, 1-u is in (0,1]
+                const double u1 = 1 - hashedUniform(seed, globalIndex, 1+2*d);
+                const double u2 = hashedUniform(seed, globalIndex, 2+2*d);
+                const double normal = std::sqrt(-2*std::log(u1))*std::cos(2*pi*u2);
+                const double coord = clusterCenters[c][d] + clusterRadius[c]*normal;
+                coords[d][i] = std::min( std::max(coord, 0.0), 1.0 );
+            }
+            break;
+        }
+        case PointDistribution::ocean: {
+            //points are placed around a land mass at a distance from its coast that is more likely to be small.
+            //Points on land or outside the unit square are rejected and tried again with the next streams.
+            double x = 0, y = 0, coastDist = 0;
+            bool found = false;
+            for (IndexType t = 0; t < maxTries and not found; t++) {
+                const unsigned long stream = maxStreams*(t+1);
+                const IndexType land = std::min( IndexType(hashedUniform(seed, globalIndex, stream)*numLands), numLands-1 );
+                const double angle = 2*pi*hashedUniform(seed, globalIndex, stream+1);
+                coastDist = coastRefinement*(std::pow(1 + 1/coastRefinement, hashedUniform(seed, globalIndex, stream+2)) - 1);
+                const double r = clusterRadius[land] + coastDist;
+                x = clusterCenters[land][0] + r*std::cos(angle);
+                y = clusterCenters[land][1] + r*std::sin(angle);
+
+                found = x >= 0 and x < 1 and y >= 0 and y < 1;
+                for (IndexType l = 0; l < numLands and found; l++) {
+                    const double sqDist = std::pow(x-clusterCenters[l][0], 2) + std::pow(y-clusterCenters[l][1], 2);
+                    found = sqDist >= clusterRadius[l]*clusterRadius[l];
+                }
+            }
+            if (not found) {
+                //practically never happens; the point is then placed in the open sea
+                x = hashedUniform(seed, globalIndex, 0);
+                y = hashedUniform(seed, globalIndex, 1);
+                coastDist = shelfWidth;
+            }
+            coords[0][i] = x;
+            coords[1][i] = y;
+
+            const double depth = std::min(coastDist/shelfWidth, 1.0);
+            if (dimensions == 3) {
+                coords[2][i] = depth*hashedUniform(seed, globalIndex, 2);
+            }
+            nodeWeights[i] = 1 + std::floor((maxLayers-1)*depth);
+            break;
+        }
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+void MeshGenerator<IndexType, ValueType>::createPointsAdjacency_dist(CSRSparseMatrix<ValueType> &adjM, const IndexType globalN, const IndexType dimensions, const scai::dmemo::CommunicatorPtr comm) {
+    SCAI_REGION( "MeshGenerator.createPointsAdjacency_dist" )
+
+    const scai::dmemo::DistributionPtr blockDist(new scai::dmemo::BlockDistribution(globalN, comm));
+    const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(globalN));
+
+    IndexType beginLocalRange, endLocalRange;
+    scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, globalN, comm->getRank(), comm->getSize());
+    const IndexType localN = endLocalRange - beginLocalRange;
+
+    const IndexType gridSide = pointsGridSide(globalN, dimensions);
+    const IndexType numNeighbors = 2*dimensions;
+
+    HArray<IndexType> csrIA;
+    HArray<IndexType> csrJA;
+    HArray<ValueType> csrValues;
+    {
+        WriteOnlyAccess<IndexType> ia( csrIA, localN+1 );
+        // upper bound, resized after all values are written
+        WriteOnlyAccess<IndexType> ja( csrJA, numNeighbors*localN );
+        WriteOnlyAccess<ValueType> values( csrValues, numNeighbors*localN );
+        ia[0] = 0;
+        IndexType nnzCounter = 0;
+
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType globalInd = beginLocalRange + i;
+
+            //the neighbors differ by one in exactly one grid coordinate; the last grid layer can be incomplete
+            IndexType stride = 1;
+            for (IndexType d = 0; d < dimensions; d++) {
+                const IndexType cellCoord = (globalInd/stride) % gridSide;
+                if (cellCoord > 0) {
+                    ja[nnzCounter] = globalInd - stride;
+                    values[nnzCounter++] = 1;
+                }
+                if (cellCoord < gridSide-1 and globalInd + stride < globalN) {
+                    ja[nnzCounter] = globalInd + stride;
+                    values[nnzCounter++] = 1;
+                }
+                stride *= gridSide;
+            }
+            ia[i+1] = nnzCounter;
+        }
+        ja.resize(nnzCounter);
+        values.resize(nnzCounter);
+    }
+
+    scai::lama::CSRStorage<ValueType> localMatrix( localN, globalN, std::move(csrIA), std::move(csrJA), std::move(csrValues) );
+    adjM = scai::lama::distribute<CSRSparseMatrix<ValueType>>( localMatrix, blockDist, noDist );
+}
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+double MeshGenerator<IndexType, ValueType>::hashedUniform(const unsigned long seed, const unsigned long index, const unsigned long stream) {
+    //splitmix64 finalizer, applied twice to mix seed, stream and index
+    auto mix = [](uint64_t z) {
+        z += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    };
+    const uint64_t h = mix( mix(uint64_t(seed) ^ (uint64_t(stream) << 40)) + uint64_t(index) );
+    // the upper 53 bits as a double in [0,1)
+    return (h >> 11) * (1.0/9007199254740992.0);
+}
+//-------------------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+IndexType MeshGenerator<IndexType, ValueType>::pointsGridSide(const IndexType globalN, const IndexType dimensions) {
+    IndexType side = std::max<IndexType>(1, std::floor(std::pow(double(globalN), 1.0/dimensions)));
+    // fix rounding errors of pow, the grid must have at least globalN cells
+    while (std::pow(double(side), dimensions) < globalN) {
+        side++;
+    }
+    return side;
+}
 //-------------------------------------------------------------------------------------------------
 template<typename IndexType, typename ValueType>
 ValueType MeshGenerator<IndexType, ValueType>::dist3DSquared(std::tuple<IndexType, IndexType, IndexType> p1, std::tuple<IndexType, IndexType, IndexType> p2) {
@@ -91,6 +91,38 @@ public:
      */
     static void createQuadMesh( CSRSparseMatrix<ValueType> &adjM, std::vector<DenseVector<ValueType>> &coords,const int dimensions, const IndexType numberOfAreas, const IndexType pointsPerArea, const ValueType maxCoord, IndexType seed);
 
+    /** Creates points and node weights with a block distribution, without an adjacency matrix. Every point is computed
+    	only from its global index and the seed, so the points are the same for any number of PEs and no communication is needed.
+    	All points lie in the unit cube.
+
+    	@param[out] coords The coordinates of the points. coords.size()=dimensions.
+    	@param[out] nodeWeights The weight of every point, see PointDistribution.
+    	@param[in] globalN The total number of points.
+    	@param[in] dimensions The dimensions of the points, 2 or 3.
+    	@param[in] distribution How the points are distributed in space.
+    	@param[in] seed The random seed.
+    	@param[in] comm The communicator.
+    */
+    static void createPoints_dist(std::vector<DenseVector<ValueType>> &coords, DenseVector<ValueType> &nodeWeights, const IndexType globalN, const IndexType dimensions, const PointDistribution distribution, const unsigned long seed, const scai::dmemo::CommunicatorPtr comm);
+
+    /** The points with global indices beginIndex to endIndex-1, the same as the ones created by createPoints_dist.
+    	Can be used to create larger point sets in chunks.
+
+    	@param[out] coords The coordinates, coords[d].size()=endIndex-beginIndex.
+    	@param[out] nodeWeights The weights, nodeWeights.size()=endIndex-beginIndex.
+    */
+    static void createPointsRange(std::vector<std::vector<ValueType>> &coords, std::vector<ValueType> &nodeWeights, const IndexType globalN, const IndexType beginIndex, const IndexType endIndex, const IndexType dimensions, const PointDistribution distribution, const unsigned long seed);
+
+    /** The adjacency matrix for points created with PointDistribution::uniform. Every point lies in a cell of a regular grid and
+    	is adjacent to the points of the neighboring cells. Only the local rows are created, with a block distribution.
+
+    	@param[out] adjM The adjacency matrix.
+    	@param[in] globalN The total number of points.
+    	@param[in] dimensions The dimensions of the points, 2 or 3.
+    	@param[in] comm The communicator.
+    */
+    static void createPointsAdjacency_dist(CSRSparseMatrix<ValueType> &adjM, const IndexType globalN, const IndexType dimensions, const scai::dmemo::CommunicatorPtr comm);
+
     /** General version for the squared distance that works for arbitrary dimensions.
     */
     template<typename T>
@@ -129,6 +161,14 @@ private:
      */
     static std::vector<DenseVector<ValueType>> randomPoints(IndexType numberOfPoints, int dimensions, ValueType maxCoord);
 
+    /** A uniform random number in [0,1) that depends only on the seed, the index and the stream; a counter based generator.
+     */
+    static double hashedUniform(const unsigned long seed, const unsigned long index, const unsigned long stream);
+
+    /** Number of cells per dimension of the grid used for PointDistribution::uniform.
+     */
+    static IndexType pointsGridSide(const IndexType globalN, const IndexType dimensions);
+
     /** The squared distance of two 3D points.
       */
     static ValueType dist3DSquared(std::tuple<IndexType, IndexType, IndexType> p1, std::tuple<IndexType, IndexType, IndexType> p2);
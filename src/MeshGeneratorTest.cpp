@@ -498,5 +498,61 @@ TYPED_TEST(MeshGeneratorTest, testDistSquared) {
     EXPECT_NEAR( (MeshGenerator<IndexType,ValueType>::distSquared( std::vector<ValueType>({1.2,3,3.2,4.1}),std::vector<ValueType>({2.1,0.5,0.2,4.1}) )), 16.06, 1e-5 );
 }
 //-----------------------------------------------------------------
+// The created points depend only on their global index: every PE creates its local range again
+// without a distribution and compares. Also checks that the grid graph of the uniform points is correct.
+
+TYPED_TEST(MeshGeneratorTest, testCreatePoints_dist) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    const IndexType side = 20;
+    const IndexType N = side*side*side;
+    const IndexType dimensions = 3;
+    const unsigned long seed = 42;
+
+    for (PointDistribution distribution : {PointDistribution::uniform, PointDistribution::gaussian, PointDistribution::ocean}) {
+        std::vector<DenseVector<ValueType>> coords;
+        DenseVector<ValueType> nodeWeights;
+        MeshGenerator<IndexType, ValueType>::createPoints_dist( coords, nodeWeights, N, dimensions, distribution, seed, comm );
+
+        ASSERT_EQ( coords.size(), dimensions );
+        EXPECT_EQ( coords[0].size(), N );
+        EXPECT_EQ( nodeWeights.size(), N );
+        EXPECT_GE( nodeWeights.min(), 1 );
+        for (IndexType d = 0; d < dimensions; d++) {
+            EXPECT_GE( coords[d].min(), 0 );
+            EXPECT_LE( coords[d].max(), 1 );
+        }
+
+        //the local range, created without the communicator
+        IndexType beginLocalRange, endLocalRange;
+        scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, N, comm->getRank(), comm->getSize());
+        std::vector<std::vector<ValueType>> rangeCoords;
+        std::vector<ValueType> rangeWeights;
+        MeshGenerator<IndexType, ValueType>::createPointsRange( rangeCoords, rangeWeights, N, beginLocalRange, endLocalRange, dimensions, distribution, seed );
+
+        for (IndexType d = 0; d < dimensions; d++) {
+            scai::hmemo::ReadAccess<ValueType> localCoords( coords[d].getLocalValues() );
+            ASSERT_EQ( localCoords.size(), rangeCoords[d].size() );
+            for (IndexType i = 0; i < localCoords.size(); i++) {
+                EXPECT_EQ( localCoords[i], rangeCoords[d][i] );
+            }
+        }
+        scai::hmemo::ReadAccess<ValueType> localWeights( nodeWeights.getLocalValues() );
+        for (IndexType i = 0; i < localWeights.size(); i++) {
+            EXPECT_EQ( localWeights[i], rangeWeights[i] );
+        }
+    }
+
+    //the grid graph of side^3 points has 3*side^2*(side-1) edges
+    scai::lama::CSRSparseMatrix<ValueType> graph;
+    MeshGenerator<IndexType, ValueType>::createPointsAdjacency_dist( graph, N, dimensions, comm );
+    EXPECT_EQ( graph.getNumRows(), N );
+    EXPECT_EQ( graph.getNumValues(), 2*3*side*side*(side-1) );
+    aux<IndexType, ValueType>::checkLocalDegreeSymmetry( graph );
+    EXPECT_TRUE( graph.isConsistent() );
+}
+//-----------------------------------------------------------------
 
 }//namespace ITI
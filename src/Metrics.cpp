@@ -1,5 +1,7 @@
-#include <scai/solver/criteria/IterationCount.hpp>
-#include <scai/solver/CG.hpp>
+#include <scai/tasking/SyncToken.hpp>
+
+#include <cmath>
+#include <memory>
 
 #include "Metrics.h"
 #include "FileIO.h"
@@ -298,44 +300,15 @@ void Metrics<ValueType>::getRedistRequiredMetrics( const scai::lama::CSRSparseMa
     }
 
     //
-    // redistribute for SpMV, linear solver and commTime
+    // SpMV, linear solver and commTime; the columns stay global, all use the same local rows and halo plan
     //
 
-    copyGraph.redistribute( distFromPartition, distFromPartition );
+    const LocalMatrix localGraph = buildLocalMatrix(copyGraph);
 
-    MM["SpMVtime"] = getSPMVtime(copyGraph, repeatTimes);
+    MM["SpMVtime"] = getSPMVtime(localGraph, comm, repeatTimes);
 
     //TODO: take a percentage of repeatTimes; maybe all repeatTimes are too much for CG
-    MM["CGtime"] = getLinearSolverTime( copyGraph, 10, settings.maxCGIterations); 
-
-    //TODO: maybe extract this time from the actual SpMV above
-    // comm time in SpMV
-    {
-        PRINT0("starting comm schedule...");
-        const scai::dmemo::HaloExchangePlan& matrixHaloPlan = copyGraph.getHaloExchangePlan();
-        const scai::dmemo::CommunicationPlan& sendPlan  = matrixHaloPlan.getLocalCommunicationPlan();
-        const scai::dmemo::CommunicationPlan& recvPlan  = matrixHaloPlan.getHaloCommunicationPlan();
-
-        //PRINT(*comm << ": " << 	sendPlan.size() << " ++ " << sendPlan << " ___ " << recvPlan);
-        scai::hmemo::HArray<ValueType> sendData( sendPlan.totalQuantity(), 1.0 );
-        scai::hmemo::HArray<ValueType> recvData;
-
-        comm->synchronize();
-        std::chrono::time_point<std::chrono::steady_clock> beforeCommTime = std::chrono::steady_clock::now();
-        for ( IndexType i = 0; i < repeatTimes; ++i ) {
-            comm->exchangeByPlan( recvData, recvPlan, sendData, sendPlan );
-        }
-        //comm->synchronize();
-        std::chrono::duration<ValueType> commTime = std::chrono::steady_clock::now() - beforeCommTime;
-
-        //PRINT(*comm << ": "<< sendPlan );
-        time = comm->max(commTime.count());
-        MM["commTime"] = time/repeatTimes;
-
-        ValueType minTime = comm->min( commTime.count() );
-        PRINT0("max time for " << repeatTimes <<" communications: " << time << " , min time " << minTime);
-    }
-
+    MM["CGtime"] = getLinearSolverTime( localGraph, distFromPartition, 10, settings.maxCGIterations); 
 }
 
 
@@ -507,31 +480,148 @@ void Metrics<ValueType>::getMappingMetrics(
 }//getMappingMetrics
 //---------------------------------------------------------------------------------------
 
+template<typename ValueType>
+typename Metrics<ValueType>::LocalMatrix Metrics<ValueType>::buildLocalMatrix(const scai::lama::CSRSparseMatrix<ValueType>& graph) {
+    SCAI_REGION("Metrics.buildLocalMatrix");
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    SCAI_ASSERT_ERROR( graph.getColDistributionPtr()->isReplicated(), "The columns must not be distributed" );
+
+    LocalMatrix A;
+    A.localN = dist->getLocalSize();
+    A.halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(graph);
+    A.ia.assign(1, 0);
+    A.selfLoops.assign(A.localN, 0);
+    A.degrees.assign(A.localN, 0);
+
+    const scai::lama::CSRStorage<ValueType>& localStorage = graph.getLocalStorage();
+    scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+    scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+    scai::hmemo::ReadAccess<ValueType> values(localStorage.getValues());
+
+    for (IndexType i = 0; i < A.localN; i++) {
+        bool interior = true;
+        for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+            IndexType column = dist->global2Local(ja[j]);
+            if (column == i) {
+                A.selfLoops[i] += values[j];
+                continue;
+            }
+            if (column == scai::invalidIndex) {
+                column = A.localN + A.halo.global2Halo(ja[j]);
+                interior = false;
+            }
+            A.ja.push_back(column);
+            A.values.push_back(values[j]);
+            A.degrees[i] += values[j];
+        }
+        A.ia.push_back(A.ja.size());
+        (interior ? A.interiorRows : A.boundaryRows).push_back(i);
+    }
+
+    scai::hmemo::ReadAccess<IndexType> rSendIndices(A.halo.getLocalIndexes());
+    A.sendIndices.assign(rSendIndices.get(), rSendIndices.get() + rSendIndices.size());
+    return A;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename ValueType>
+void Metrics<ValueType>::localSpMV(const LocalMatrix& A, const bool laplacian, const ValueType* x, ValueType* y, std::vector<ValueType>& sendBuffer, std::vector<ValueType>& haloBuffer, const scai::dmemo::Communicator& comm, double& compTime, double& commTime) {
+    const IndexType localN = A.localN;
+    sendBuffer.resize(A.sendIndices.size());
+    haloBuffer.resize(A.halo.getHaloSize());
+    ValueType* haloValues = haloBuffer.data();
+
+    auto computeRows = [&](const std::vector<IndexType>& rows) {
+        const IndexType numRows = rows.size();
+        #pragma omp parallel for schedule(static)
+        for (IndexType r = 0; r < numRows; r++) {
+            const IndexType i = rows[r];
+            ValueType sum = 0;
+            for (IndexType j = A.ia[i]; j < A.ia[i+1]; j++) {
+                const IndexType column = A.ja[j];
+                sum += A.values[j] * (column < localN ? x[column] : haloValues[column - localN]);
+            }
+            y[i] = laplacian ? A.degrees[i]*x[i] - sum : A.selfLoops[i]*x[i] + sum;
+        }
+    };
+
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    for (IndexType k = 0; k < IndexType(A.sendIndices.size()); k++) {
+        sendBuffer[k] = x[A.sendIndices[k]];
+    }
+    std::unique_ptr<scai::tasking::SyncToken> token( comm.exchangeByPlanAsync( haloValues, A.halo.getHaloCommunicationPlan(), sendBuffer.data(), A.halo.getLocalCommunicationPlan() ) );
+    std::chrono::time_point<std::chrono::steady_clock> sent = std::chrono::steady_clock::now();
+
+    computeRows(A.interiorRows);
+    std::chrono::time_point<std::chrono::steady_clock> interiorDone = std::chrono::steady_clock::now();
+
+    token->wait();
+    std::chrono::time_point<std::chrono::steady_clock> received = std::chrono::steady_clock::now();
+
+    computeRows(A.boundaryRows);
+    std::chrono::time_point<std::chrono::steady_clock> end = std::chrono::steady_clock::now();
+
+    commTime += std::chrono::duration<double>(sent - start).count() + std::chrono::duration<double>(received - interiorDone).count();
+    compTime += std::chrono::duration<double>(interiorDone - sent).count() + std::chrono::duration<double>(end - received).count();
+}
+//---------------------------------------------------------------------------------------
+
 template<typename ValueType>
 ValueType Metrics<ValueType>::getSPMVtime(
-    scai::lama::CSRSparseMatrix<ValueType> graph,
+    const LocalMatrix& A,
+    const scai::dmemo::CommunicatorPtr comm,
     const IndexType repeatTimes){
 
-    scai::dmemo::CommunicatorPtr comm = graph.getRowDistributionPtr()->getCommunicatorPtr();
     PRINT0("starting SpMV...");
 
-    // vector for multiplication
-    scai::lama::DenseVector<ValueType> x ( graph.getColDistributionPtr(), 1.0 );
-    scai::lama::DenseVector<ValueType> y ( graph.getRowDistributionPtr(), 0.0 );
-    graph.setCommunicationKind( scai::lama::SyncKind::ASYNC_COMM );
+    std::vector<ValueType> x(A.localN, 1.0);
+    std::vector<ValueType> y(A.localN, 0.0);
+    std::vector<ValueType> sendBuffer, haloBuffer;
+
+    double compTime = 0;
+    double commTime = 0;
+    localSpMV(A, false, x.data(), y.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
+    compTime = 0;
+    commTime = 0;
     comm->synchronize();
-    
+
     // perform the actual multiplication
     std::chrono::time_point<std::chrono::steady_clock> beforeSpMVTime = std::chrono::steady_clock::now();
     for(IndexType r=0; r<repeatTimes; r++) {
-        y = graph *x +y;
+        localSpMV(A, false, x.data(), y.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
     }
     comm->synchronize();
-    std::chrono::duration<ValueType> SpMVTime = std::chrono::steady_clock::now() - beforeSpMVTime;
-    //PRINT(" SpMV time for PE "<< comm->getRank() << " = " << SpMVTime.count() );
+    std::chrono::duration<double> SpMVTime = std::chrono::steady_clock::now() - beforeSpMVTime;
+
+    const IndexType numPEs = comm->getSize();
+    const double maxCompTime = comm->max(compTime);
+    const double maxCommTime = comm->max(commTime);
+    const double avgCompTime = comm->sum(compTime)/numPEs;
+    const double avgCommTime = comm->sum(commTime)/numPEs;
+    MM["SpMVcompTime"] = maxCompTime/repeatTimes;
+    MM["SpMVcommTime"] = maxCommTime/repeatTimes;
+    MM["SpMVloadImbalance"] = avgCompTime > 0 ? maxCompTime/avgCompTime - 1 : 0;
+    MM["SpMVcommImbalance"] = avgCommTime > 0 ? maxCommTime/avgCommTime - 1 : 0;
 
     ValueType time = comm->max(SpMVTime.count());
-    PRINT0("max time for " << repeatTimes <<" SpMVs: " << time );
+    PRINT0("max time for " << repeatTimes <<" SpMVs: " << time << ", computation " << maxCompTime << ", communication " << maxCommTime );
+
+    // a blocking halo exchange with the same plan, without any computation
+    {
+        const scai::dmemo::CommunicationPlan& sendPlan = A.halo.getLocalCommunicationPlan();
+        const scai::dmemo::CommunicationPlan& recvPlan = A.halo.getHaloCommunicationPlan();
+
+        comm->synchronize();
+        std::chrono::time_point<std::chrono::steady_clock> beforeCommTime = std::chrono::steady_clock::now();
+        for ( IndexType i = 0; i < repeatTimes; ++i ) {
+            comm->exchangeByPlan( haloBuffer.data(), recvPlan, sendBuffer.data(), sendPlan );
+        }
+        std::chrono::duration<double> exchangeTime = std::chrono::steady_clock::now() - beforeCommTime;
+
+        const ValueType maxTime = comm->max(exchangeTime.count());
+        MM["commTime"] = maxTime/repeatTimes;
+        PRINT0("max time for " << repeatTimes <<" communications: " << maxTime << " , min time " << comm->min(exchangeTime.count()));
+    }
 
     return time/repeatTimes;
 }
@@ -539,55 +629,101 @@ ValueType Metrics<ValueType>::getSPMVtime(
 
 template<typename ValueType>
 ValueType Metrics<ValueType>::getLinearSolverTime( 
-    const scai::lama::CSRSparseMatrix<ValueType>& graph,
+    const LocalMatrix& A,
+    const scai::dmemo::DistributionPtr rowDist,
     const IndexType repeatTimes,
-    const IndexType maxIterations){
-
-    const scai::dmemo::CommunicatorPtr comm = graph.getRowDistributionPtr()->getCommunicatorPtr();
-    const scai::dmemo::DistributionPtr rowDist = graph.getRowDistributionPtr();
-    const scai::dmemo::DistributionPtr colDist = graph.getColDistributionPtr();
-
-    //the construction of the laplacian does not work when both rows and columns are distributed
-    //based on a general distribution; TODO:fix
-    //workaround: copy graph to preserve const-ness, redistribute with a block distribution, get
-    //the laplacian, redistribute the laplacian with the same distribution as the input
-    scai::lama::CSRSparseMatrix<ValueType> laplacian;
-    {
-        scai::lama::CSRSparseMatrix<ValueType> copyGraph( graph ); 
-        const IndexType N = graph.getNumRows();
-        const scai::dmemo::DistributionPtr blockDistPtr( new scai::dmemo::BlockDistribution(N, comm) );
-        copyGraph.redistribute( blockDistPtr, blockDistPtr );
-        
-        laplacian = GraphUtils<IndexType,ValueType>::constructLaplacian( copyGraph );
-        laplacian.redistribute( rowDist, colDist);
+    const IndexType iterations){
+
+    const scai::dmemo::CommunicatorPtr comm = rowDist->getCommunicatorPtr();
+    const IndexType N = rowDist->getGlobalSize();
+    SCAI_ASSERT_EQ_ERROR( A.localN, rowDist->getLocalSize(), "Distribution mismatch" );
+    const IndexType localN = A.localN;
+    std::vector<ValueType> sendBuffer, haloBuffer;
+
+    // the Laplacian is singular, the right hand side must be orthogonal to the constant vector
+    std::vector<ValueType> rhs(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        rhs[i] = rowDist->local2Global(i) % 2 == 0 ? 1 : -1;
+    }
+    const ValueType mean = comm->sum(std::accumulate(rhs.begin(), rhs.end(), 0.0)) / N;
+    for (ValueType& b : rhs) {
+        b -= mean;
     }
 
-    scai::lama::DenseVector<ValueType> solution( colDist, ValueType(1.0) );
-    
-    scai::solver::CG<ValueType> solver("CGSolver");
+    std::vector<ValueType> solution(localN), residual(localN), direction(localN), product(localN);
+    double compTime = 0;
+    double commTime = 0;
 
-    scai::solver::CriterionPtr<ValueType> criterion( new scai::solver::IterationCount<ValueType>( maxIterations ) );
-    solver.setStoppingCriterion( criterion );
-    ValueType totalTime = 0.0;
+    auto dotProduct = [&](const std::vector<ValueType>& a, const std::vector<ValueType>& b) {
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        double localSum = 0;
+        #pragma omp parallel for schedule(static) reduction(+:localSum)
+        for (IndexType i = 0; i < localN; i++) {
+            localSum += a[i]*b[i];
+        }
+        std::chrono::time_point<std::chrono::steady_clock> summed = std::chrono::steady_clock::now();
+        const double globalSum = comm->sum(localSum);
+        compTime += std::chrono::duration<double>(summed - start).count();
+        commTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - summed).count();
+        return globalSum;
+    };
+
+    const double rhsNorm = std::sqrt(dotProduct(rhs, rhs));
+    double residualNorm = rhsNorm;
+    double totalTime = 0.0;
+    compTime = 0;
+    commTime = 0;
 
     for(IndexType r=0; r<repeatTimes; r++) {
-        const scai::lama::DenseVector<ValueType> rhs( colDist, ValueType(1.0) );
-        solver.initialize( laplacian );
-
+        comm->synchronize();
         std::chrono::time_point<std::chrono::steady_clock> beforeTime = std::chrono::steady_clock::now();
 
-        solver.solve(solution, rhs);
+        std::fill(solution.begin(), solution.end(), 0);
+        residual = rhs;
+        direction = rhs;
+        double rr = dotProduct(residual, residual);
+
+        for (IndexType it = 0; it < iterations and rr > 0; it++) {
+            localSpMV(A, true, direction.data(), product.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
+            const double pAp = dotProduct(direction, product);
+            if (pAp <= 0) {
+                break;
+            }
+            const ValueType alpha = rr/pAp;
+
+            std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            #pragma omp parallel for schedule(static)
+            for (IndexType i = 0; i < localN; i++) {
+                solution[i] += alpha*direction[i];
+                residual[i] -= alpha*product[i];
+            }
+            compTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            const double rrNew = dotProduct(residual, residual);
+            const ValueType beta = rrNew/rr;
+            rr = rrNew;
+
+            start = std::chrono::steady_clock::now();
+            #pragma omp parallel for schedule(static)
+            for (IndexType i = 0; i < localN; i++) {
+                direction[i] = residual[i] + beta*direction[i];
+            }
+            compTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        residualNorm = std::sqrt(rr);
 
-        std::chrono::duration<ValueType> elapTime = std::chrono::steady_clock::now() - beforeTime;
+        std::chrono::duration<double> elapTime = std::chrono::steady_clock::now() - beforeTime;
         totalTime += elapTime.count();
-        //PRINT(" SpMV time for PE "<< comm->getRank() << " = " << SpMVTime.count() );
     }
     ValueType globTime = comm->max(totalTime)/repeatTimes;
-    
-    PRINT0("total time for "<< repeatTimes << " calls to CG solver: " << totalTime );
+    MM["CGcommTime"] = comm->max(commTime)/repeatTimes;
+    MM["CGresidual"] = rhsNorm > 0 ? residualNorm/rhsNorm : 0;
+
+    PRINT0("max time for "<< repeatTimes << " calls to CG solver with " << iterations << " iterations: " << comm->max(totalTime) << ", relative residual " << MM["CGresidual"] );
 
     return globTime;
 }
+//---------------------------------------------------------------------------------------
 
 template class Metrics<double>;
 template class Metrics<float>;
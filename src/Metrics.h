@@ -4,6 +4,7 @@
 #include <math.h>
 #include <scai/lama.hpp>
 #include <scai/dmemo/RedistributePlan.hpp>
+#include <scai/dmemo/HaloExchangePlan.hpp>
 #include <chrono>
 #include <algorithm>
 
@@ -41,6 +42,8 @@ public:
         {"preliminaryMaxCommVol",-1.0},{"preliminaryTotalCommVol",-1.0},
         {"totalBlockGraphEdges",-1.0}, {"maxCommVolume",-1.0}, {"totalCommVolume",-1.0}, {"maxBoundaryNodes",-1.0}, {"totalBoundaryNodes",-1.0},
         {"SpMVtime",-1.0}, {"commTime",-1.0}, {"CGtime", -1.0}, {"edgeImbalance", -1.0},
+        {"SpMVcompTime",-1.0}, {"SpMVcommTime",-1.0}, {"SpMVloadImbalance",-1.0}, {"SpMVcommImbalance",-1.0},
+        {"CGcommTime",-1.0}, {"CGresidual",-1.0},
         {"maxBorderNodesPercent",-1.0}, {"avgBorderNodesPercent",-1.0},
         {"maxBlockDiameter",-1.0}, {"harmMeanDiam",-1.0}, {"numDisconBlocks",-1.0},
         {"maxRedistVol",-1.0}, {"totRedistVol",-1.0},	 //redistribution metrics
@@ -98,6 +101,9 @@ public:
 
     /** @brief Get metrics that require some redistribution of the input data and thus are more time consuming.
 
+    The graph is redistributed by the partition once. The SpMV, CG and communication times all use one LocalMatrix
+    and halo plan of the redistributed graph, see getSPMVtime and getLinearSolverTime.
+
     @param[in] graph The input graph
     @param[in] partition A partition of the graph.
     @param[in] nodeWeights The weights for the vertices of the graph.
@@ -175,24 +181,59 @@ public:
     void printKMeansProfiling( std::ostream& out ) const ;
     //@}
 
+    /** The local rows of a graph in compact form. Column indices smaller than localN are local,
+    the others are localN + the halo index of the neighbor. Self loops are stored apart from the other entries,
+    so the same rows give both the adjacency matrix and the Laplacian.
+    */
+    struct LocalMatrix {
+        IndexType localN = 0;
+        std::vector<IndexType> ia;
+        std::vector<IndexType> ja;
+        std::vector<ValueType> values;
+        std::vector<ValueType> selfLoops;           ///< the diagonal of the adjacency matrix
+        std::vector<ValueType> degrees;             ///< the weighted degree without self loops, the diagonal of the Laplacian
+        std::vector<IndexType> interiorRows;        ///< rows without halo columns, computed while the halo is exchanged
+        std::vector<IndexType> boundaryRows;
+        scai::dmemo::HaloExchangePlan halo;
+        std::vector<IndexType> sendIndices;         ///< the local indices of halo.getLocalIndexes()
+    };
+
+    /** The local rows of \p graph, whose columns must not be distributed. Builds the halo plan of the rows. */
+    static LocalMatrix buildLocalMatrix(const scai::lama::CSRSparseMatrix<ValueType>& graph);
+
+    /** y = A*x, or y = L*x for the Laplacian L of A if \p laplacian is set. The halo values are sent before the interior rows
+    are computed and received before the boundary rows. The time for packing, sending and waiting is added to \p commTime,
+    the time for the rows to \p compTime.
+    */
+    static void localSpMV(const LocalMatrix& A, const bool laplacian, const ValueType* x, ValueType* y, std::vector<ValueType>& sendBuffer, std::vector<ValueType>& haloBuffer, const scai::dmemo::Communicator& comm, double& compTime, double& commTime);
+
 protected:
 
-    /** Given a distributed matrix (aka graph) it operates a multiplication with a vector for the
-        given number of repetitions and returns the average running time. The matrix is not const
-        because inside we set: matrix.setCommunicationKind( scai::lama::SyncKind::ASYNC_COMM );
+    /** Time SpMVs with the adjacency matrix \p A. One untimed multiplication is done first.
+    Sets SpMVtime, SpMVcompTime and SpMVcommTime, the maxima over all processes per multiplication,
+    SpMVloadImbalance and SpMVcommImbalance, the maximum over the average of the computation and
+    communication times minus one, and commTime, the time of a blocking halo exchange with the same plan.
+
+    @return The time per multiplication.
     */
     ValueType getSPMVtime(
-        scai::lama::CSRSparseMatrix<ValueType> matrix,
+        const LocalMatrix& A,
+        const scai::dmemo::CommunicatorPtr comm,
         const IndexType repeatTimes);
 
-    /** @brief Given a graph and a partition, solve the linear system implied by the laplacian of the graph.
+    /** @brief Solve the linear system of the Laplacian of the graph \p A, whose rows are distributed by \p rowDist.
+
+    CG runs for exactly \p iterations iterations, unless the residual is zero, so the time does not depend on the convergence.
+    The right hand side alternates between 1 and -1 and is shifted to mean zero. Sets CGtime, CGcommTime, the time for
+    halo exchanges and global sums, and CGresidual, the relative residual norm after the last solve.
 
         @return The time needed to solve the linear system.
     */
     ValueType getLinearSolverTime(
-        const scai::lama::CSRSparseMatrix<ValueType>& graph,
+        const LocalMatrix& A,
+        const scai::dmemo::DistributionPtr rowDist,
         const IndexType repeatTimes,
-        const IndexType maxIterations = 100
+        const IndexType iterations = 100
         );
 
 }; //struct Metrics
@@ -0,0 +1,153 @@
+#include <scai/lama.hpp>
+#include <scai/dmemo/BlockDistribution.hpp>
+
+#include <cmath>
+#include <numeric>
+
+#include "gtest/gtest.h"
+
+#include "MeshGenerator.h"
+#include "Metrics.h"
+
+
+namespace ITI {
+
+using scai::lama::CSRSparseMatrix;
+using scai::lama::DenseVector;
+
+template<typename T>
+class MetricsTest : public ::testing::Test {
+};
+
+using testTypes = ::testing::Types<double,float>;
+TYPED_TEST_SUITE(MetricsTest, testTypes);
+
+//------------------------------------------------------------------------------
+
+TYPED_TEST(MetricsTest, testRedistRequiredMetrics) {
+    using ValueType = TypeParam;
+
+    const IndexType sideLen = 10;
+    const IndexType dimensions = 3;
+    const IndexType N = std::pow(sideLen, dimensions);
+
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const scai::dmemo::DistributionPtr dist(scai::dmemo::Distribution::getDistributionPtr("BLOCK", comm, N));
+    const scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>(dist, noDistPointer);
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(graph, coords, maxCoord, numPoints, dimensions);
+
+    // every process gets the nodes it owns already, in reverse order of the ranks
+    const DenseVector<IndexType> partition(dist, comm->getSize()-1-comm->getRank());
+
+    Settings settings;
+    settings.numBlocks = comm->getSize();
+    settings.computeDiameter = false;
+    settings.maxCGIterations = 200;
+
+    Metrics<ValueType> metrics(settings);
+    metrics.getRedistRequiredMetrics(graph, partition, settings, 5);
+
+    EXPECT_GT(metrics.MM["SpMVtime"], 0);
+    EXPECT_GE(metrics.MM["SpMVcompTime"], 0);
+    EXPECT_GE(metrics.MM["SpMVcommTime"], 0);
+    EXPECT_LE(metrics.MM["SpMVcompTime"] + metrics.MM["SpMVcommTime"], 2*metrics.MM["SpMVtime"]);
+    EXPECT_GE(metrics.MM["SpMVloadImbalance"], 0);
+    EXPECT_GE(metrics.MM["SpMVcommImbalance"], 0);
+    EXPECT_GE(metrics.MM["commTime"], 0);
+
+    EXPECT_GT(metrics.MM["CGtime"], 0);
+    EXPECT_GE(metrics.MM["CGcommTime"], 0);
+    EXPECT_LE(metrics.MM["CGcommTime"], metrics.MM["CGtime"]);
+
+    // the Laplacian of a 10x10x10 mesh has condition number about 120 on the complement of the constant vector, 200 iterations are plenty
+    EXPECT_GE(metrics.MM["CGresidual"], 0);
+    EXPECT_LT(metrics.MM["CGresidual"], 1e-2);
+}
+//------------------------------------------------------------------------------
+
+TYPED_TEST(MetricsTest, testLocalSpMV) {
+    using ValueType = TypeParam;
+
+    //a 2D mesh with 7x9 nodes, distributed cyclically so that most neighbors are on other processes
+    const IndexType dimensions = 2;
+    const IndexType N = 7*9;
+
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const scai::dmemo::DistributionPtr blockDist(scai::dmemo::Distribution::getDistributionPtr("BLOCK", comm, N));
+    const scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>(blockDist, noDistPointer);
+    std::vector<ValueType> maxCoord = {7, 9};
+    std::vector<IndexType> numPoints = {7, 9};
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(blockDist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(graph, coords, maxCoord, numPoints, dimensions);
+
+    const scai::dmemo::DistributionPtr dist(scai::dmemo::Distribution::getDistributionPtr("CYCLIC", comm, N));
+    graph.redistribute(dist, noDistPointer);
+
+    const typename Metrics<ValueType>::LocalMatrix A = Metrics<ValueType>::buildLocalMatrix(graph);
+    const IndexType localN = dist->getLocalSize();
+    ASSERT_EQ(A.localN, localN);
+    if (comm->getSize() > 1 and localN > 0) {
+        EXPECT_GT(A.halo.getHaloSize(), 0);
+        EXPECT_FALSE(A.boundaryRows.empty());
+    }
+
+    //the degrees from the rows of the matrix
+    std::vector<ValueType> degrees(localN);
+    {
+        scai::hmemo::ReadAccess<IndexType> ia(graph.getLocalStorage().getIA());
+        scai::hmemo::ReadAccess<ValueType> values(graph.getLocalStorage().getValues());
+        for (IndexType i = 0; i < localN; i++) {
+            degrees[i] = std::accumulate(values.get() + ia[i], values.get() + ia[i+1], ValueType(0));
+        }
+    }
+
+    std::vector<ValueType> sendBuffer, haloBuffer;
+    double compTime = 0;
+    double commTime = 0;
+
+    //the adjacency matrix times the all-ones vector gives the degrees, the Laplacian gives zero; the mesh has unit weights, so all sums are exact
+    const std::vector<ValueType> ones(localN, 1);
+    std::vector<ValueType> y(localN, -1);
+    Metrics<ValueType>::localSpMV(A, false, ones.data(), y.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
+    EXPECT_EQ(y, degrees);
+
+    Metrics<ValueType>::localSpMV(A, true, ones.data(), y.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
+    EXPECT_EQ(y, std::vector<ValueType>(localN, 0));
+
+    //with the global indices as x, every entry is the sum of the indices of the neighbors, which needs the halo values
+    std::vector<ValueType> x(localN);
+    for (IndexType i = 0; i < localN; i++) {
+        x[i] = dist->local2Global(i);
+    }
+    Metrics<ValueType>::localSpMV(A, false, x.data(), y.data(), sendBuffer, haloBuffer, *comm, compTime, commTime);
+    {
+        scai::hmemo::ReadAccess<IndexType> ia(graph.getLocalStorage().getIA());
+        scai::hmemo::ReadAccess<IndexType> ja(graph.getLocalStorage().getJA());
+        scai::hmemo::ReadAccess<ValueType> values(graph.getLocalStorage().getValues());
+        for (IndexType i = 0; i < localN; i++) {
+            ValueType neighborSum = 0;
+            for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+                neighborSum += values[j]*ja[j];
+            }
+            EXPECT_EQ(y[i], neighborSum) << "row of node " << dist->local2Global(i);
+        }
+    }
+
+    EXPECT_GE(compTime, 0);
+    EXPECT_GE(commTime, 0);
+}
+
+} /* namespace ITI */
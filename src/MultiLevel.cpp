@@ -1,9 +1,15 @@
 #include <scai/dmemo/GenBlockDistribution.hpp>
 
+#include <cstdint>
+#include <random>
+#include <tuple>
+
 #include "MultiLevel.h"
 #include "GraphUtils.h"
 #include "HaloPlanFns.h"
 #include "ParcoRepart.h"
+#include "KMeans.h"
+#include "Telemetry.h"
 
 //TODO: needed monstly(only?) for debugging, to store the PE graph
 #include "FileIO.h"
@@ -44,6 +50,9 @@ DenseVector<IndexType> ITI::MultiLevel<IndexType, ValueType>::multiLevelStep(CSR
     //only needed to store local refinement specific metrics
     settings.thisRound++;
 
+    //the refinement needs every coarse node on the process of its fine nodes
+    settings.crossRankMatchingRounds = 0;
+
     auto origin = scai::lama::fill<DenseVector<IndexType>>(input.getRowDistributionPtr(), comm->getRank());//to track node movements through the hierarchies
 
     if (settings.multiLevelRounds > 0) {
@@ -106,16 +115,17 @@ DenseVector<IndexType> ITI::MultiLevel<IndexType, ValueType>::multiLevelStep(CSR
 
             part.setSameValue(projectedFineDist, comm->getRank());
 
+            //node weights and, if needed, coordinates are moved in one exchange
+            std::vector<DenseVector<ValueType>*> pointData(1, &nodeWeights);
             if (settings.useGeometricTieBreaking) {
                 for (IndexType dim = 0; dim < settings.dimensions; dim++) {
-                    coordinates[dim].redistribute(redistributor);
+                    pointData.push_back(&coordinates[dim]);
                 }
             }
+            aux<IndexType, ValueType>::redistributePacked(redistributor, pointData);
 
             input.redistribute(redistributor, input.getColDistributionPtr());
 
-            nodeWeights.redistribute(redistributor);
-
             origin.redistribute(redistributor);
 
             std::chrono::duration<double> uncoarseningTime =  std::chrono::steady_clock::now() - beforeUnCoarse;
@@ -131,7 +141,7 @@ DenseVector<IndexType> ITI::MultiLevel<IndexType, ValueType>::multiLevelStep(CSR
 
         std::chrono::time_point<std::chrono::steady_clock> before =  std::chrono::steady_clock::now();
 
-        std::vector<DenseVector<IndexType>> communicationScheme = ParcoRepart<IndexType,ValueType>::getCommunicationPairs_local(processGraph, settings);
+        std::vector<IndexType> communicationScheme = ParcoRepart<IndexType,ValueType>::getCommunicationPartners(processGraph, settings);
 
         std::vector<IndexType> nodesWithNonLocalNeighbors = GraphUtils<IndexType, ValueType>::getNodesWithNonLocalNeighbors(input);
 
@@ -155,7 +165,7 @@ DenseVector<IndexType> ITI::MultiLevel<IndexType, ValueType>::multiLevelStep(CSR
             /* TODO: if getting the graph is fast, maybe doing it in every step might help
             // get graph before every step
             processGraph = GraphUtils::getPEGraph<IndexType, ValueType>(input);
-            communicationScheme = ParcoRepart<IndexType,ValueType>::getCommunicationPairs_local(processGraph, settings);
+            communicationScheme = ParcoRepart<IndexType,ValueType>::getCommunicationPartners(processGraph, settings);
             nodesWithNonLocalNeighbors = GraphUtils::getNodesWithNonLocalNeighbors<IndexType, ValueType>(input);
             elapTime = std::chrono::steady_clock::now() - beforeFMStep;
             maxTime = comm->max( elapTime.count() );
@@ -225,6 +235,372 @@ DenseVector<IndexType> ITI::MultiLevel<IndexType, ValueType>::multiLevelStep(CSR
 }
 //---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+DenseVector<IndexType> MultiLevel<IndexType, ValueType>::vCyclePartition(const CSRSparseMatrix<ValueType> &input, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings, Metrics<ValueType>& metrics) {
+    SCAI_REGION( "MultiLevel.vCyclePartition" );
+    Telemetry::ScopedTimer telemetryTimer("vCyclePartition");
+    const scai::dmemo::CommunicatorPtr comm = input.getRowDistributionPtr()->getCommunicatorPtr();
+
+    if ((settings.vCycleKMeans or settings.nnCoarsening) and coordinates.size() != settings.dimensions) {
+        throw std::runtime_error("The V-cycle needs coordinates for k-means or nearest neighbor coarsening, but got " + std::to_string(coordinates.size()) + " dimensions instead of " + std::to_string(settings.dimensions));
+    }
+    SCAI_ASSERT_ERROR( nodeWeights.getDistributionPtr()->isEqual(input.getRowDistribution()), "distribution mismatch" );
+
+    const HaloExchangePlan halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(input);
+
+    DenseVector<IndexType> part;
+    for (IndexType cycle = 0; cycle < std::max(settings.vCycles, IndexType(1)); cycle++) {
+        std::chrono::time_point<std::chrono::steady_clock> beforeCycle = std::chrono::steady_clock::now();
+
+        part = vCycle(input, nodeWeights, coordinates, halo, part, settings, metrics);
+
+        if (settings.verbose) {
+            std::chrono::duration<double> cycleTime = std::chrono::steady_clock::now() - beforeCycle;
+            const ValueType time = comm->max(cycleTime.count());
+            const ValueType cut = GraphUtils<IndexType, ValueType>::computeCut(input, part, true);
+            const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance(part, settings.numBlocks, nodeWeights);
+            PRINT0("V-cycle " << cycle << ": cut " << cut << ", imbalance " << imbalance << ", time " << time);
+        }
+    }
+
+    return part;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+DenseVector<IndexType> MultiLevel<IndexType, ValueType>::vCycle(const CSRSparseMatrix<ValueType> &graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, const HaloExchangePlan& halo, const DenseVector<IndexType> &previous, Settings settings, Metrics<ValueType>& metrics) {
+    SCAI_REGION( "MultiLevel.vCycle" );
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType globalN = dist->getGlobalSize();
+    const IndexType localN = dist->getLocalSize();
+    const IndexType coarsestSize = std::max(settings.vCycleCoarsestSize, 20*settings.numBlocks);
+    const bool usePrevious = previous.size() > 0;
+
+    DenseVector<IndexType> part;
+    bool coarsened = false;
+
+    if (globalN > coarsestSize) {
+        //in later cycles, only nodes of the same block are contracted, so the partition can be projected to the coarse graph
+        std::vector<IndexType> localBlocks;
+        if (usePrevious) {
+            scai::hmemo::ReadAccess<IndexType> rPrevious(previous.getLocalValues());
+            localBlocks.assign(rPrevious.get(), rPrevious.get() + localN);
+        }
+
+        CSRSparseMatrix<ValueType> coarseGraph;
+        DenseVector<IndexType> fineToCoarse;
+        coarsen(graph, nodeWeights, halo, coordinates, coarseGraph, fineToCoarse, settings, 1, localBlocks);
+
+        if (settings.verbose) {
+            PRINT0("V-cycle level with " << globalN << " nodes coarsened to " << coarseGraph.getNumRows() << " nodes");
+        }
+
+        //without cross-rank matching, the matching is local and stops shrinking the graph once the local parts are small
+        if (coarseGraph.getNumRows() < 0.9*globalN) {
+            coarsened = true;
+            const scai::dmemo::DistributionPtr coarseDist = coarseGraph.getRowDistributionPtr();
+
+            DenseVector<ValueType> coarseWeights = sumToCoarse(nodeWeights, fineToCoarse, coarseDist);
+
+            //with cross-rank matching, a coarse node can have neighbors that no fine node of its process is adjacent to
+            HaloExchangePlan coarseHalo;
+            if (settings.crossRankMatchingRounds > 0) {
+                coarseHalo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(coarseGraph);
+            } else {
+                scai::hmemo::HArray<IndexType> haloData;
+                halo.updateHalo(haloData, fineToCoarse.getLocalValues(), *comm);
+                coarseHalo = coarsenHalo(*coarseDist, halo, fineToCoarse.getLocalValues(), haloData);
+            }
+
+            std::vector<DenseVector<ValueType>> coarseCoords;
+            if (settings.vCycleKMeans or settings.nnCoarsening) {
+                for (const DenseVector<ValueType>& coord : coordinates) {
+                    coarseCoords.push_back(projectToCoarse(coord, fineToCoarse, coarseDist));
+                }
+            }
+
+            //nodes are only matched within their block, so nodes whose coarse node is on another process can be skipped
+            DenseVector<IndexType> coarsePrevious;
+            if (usePrevious) {
+                coarsePrevious = DenseVector<IndexType>(coarseDist, 0);
+                scai::hmemo::ReadAccess<IndexType> rPrevious(previous.getLocalValues());
+                scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+                scai::hmemo::WriteAccess<IndexType> wCoarsePrevious(coarsePrevious.getLocalValues());
+                for (IndexType i = 0; i < localN; i++) {
+                    const IndexType coarseNode = coarseDist->global2Local(rFineToCoarse[i]);
+                    if (coarseNode != scai::invalidIndex) {
+                        wCoarsePrevious[coarseNode] = rPrevious[i];
+                    }
+                }
+            }
+
+            const DenseVector<IndexType> coarsePart = vCycle(coarseGraph, coarseWeights, coarseCoords, coarseHalo, coarsePrevious, settings, metrics);
+
+            const HaloExchangePlan coarseNodes = coarseNodeHalo(fineToCoarse, *coarseDist);
+            scai::hmemo::HArray<IndexType> haloPart;
+            coarseNodes.updateHalo(haloPart, coarsePart.getLocalValues(), *comm);
+
+            part = DenseVector<IndexType>(dist, 0);
+            {
+                scai::hmemo::ReadAccess<IndexType> rCoarsePart(coarsePart.getLocalValues());
+                scai::hmemo::ReadAccess<IndexType> rHaloPart(haloPart);
+                scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+                scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+                #pragma omp parallel for schedule(static)
+                for (IndexType i = 0; i < localN; i++) {
+                    const IndexType coarseNode = coarseDist->global2Local(rFineToCoarse[i]);
+                    wPart[i] = coarseNode != scai::invalidIndex ? rCoarsePart[coarseNode] : rHaloPart[coarseNodes.global2Halo(rFineToCoarse[i])];
+                }
+            }
+        }
+    }
+
+    if (!coarsened) {
+        if (settings.verbose) {
+            PRINT0("Coarsest graph of the V-cycle has " << globalN << " nodes");
+        }
+        part = usePrevious ? previous : coarsestPartition(graph, nodeWeights, coordinates, settings, metrics);
+    }
+
+    Telemetry::count("vCycleLevels");
+    LocalRefinement<IndexType, ValueType>::greedyRefinement(graph, part, nodeWeights, halo, settings.vCycleRefinementRounds, settings);
+
+    return part;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+DenseVector<IndexType> MultiLevel<IndexType, ValueType>::coarsestPartition(const CSRSparseMatrix<ValueType> &graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings, Metrics<ValueType>& metrics) {
+    SCAI_REGION( "MultiLevel.coarsestPartition" );
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType globalN = dist->getGlobalSize();
+    const IndexType k = settings.numBlocks;
+
+    //coarsening can stall far above the coarsest size, such a graph is not gathered on a single process
+    const IndexType maxGatheredSize = 8*std::max(settings.vCycleCoarsestSize, 20*k);
+    const bool gather = !settings.vCycleKMeans and globalN <= maxGatheredSize;
+
+    if (!gather and coordinates.size() == settings.dimensions) {
+        const std::vector<DenseVector<ValueType>> weights(1, nodeWeights);
+        const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(k, std::ceil(nodeWeights.sum()/k)));
+        DenseVector<IndexType> part = KMeans<IndexType, ValueType>::computePartition(coordinates, weights, blockSizes, settings, metrics);
+        if (!part.getDistributionPtr()->isEqual(*dist)) {
+            part.redistribute(dist);
+        }
+        return part;
+    }
+
+    if (!gather) {
+        //without coordinates, contiguous ranges of node indices are the blocks and the refinement on the finer levels has to improve them
+        if (settings.verbose) {
+            PRINT0("Coarsest graph with " << globalN << " nodes is too large to be gathered, using index ranges as blocks");
+        }
+        DenseVector<IndexType> part(dist, 0);
+        {
+            scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+            for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+                wPart[i] = static_cast<IndexType>((int64_t(dist->local2Global(i)) * k) / globalN);
+            }
+        }
+        return part;
+    }
+
+    //gather the graph on process 0
+    const DenseVector<IndexType> owners(dist, 0);
+    const scai::dmemo::DistributionPtr rootDist = scai::dmemo::generalDistributionByNewOwners(*dist, owners.getLocalValues());
+    const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(globalN));
+    CSRSparseMatrix<ValueType> gatheredGraph(graph);
+    gatheredGraph.redistribute(rootDist, noDist);
+    DenseVector<ValueType> gatheredWeights(nodeWeights);
+    gatheredWeights.redistribute(rootDist);
+
+    DenseVector<IndexType> gatheredPart(rootDist, 0);
+    const IndexType n = rootDist->getLocalSize();
+
+    if (n > 0) {
+        std::vector<IndexType> ia, ja;
+        std::vector<ValueType> values, weights;
+        {
+            const CSRStorage<ValueType>& storage = gatheredGraph.getLocalStorage();
+            scai::hmemo::ReadAccess<IndexType> rIA(storage.getIA());
+            scai::hmemo::ReadAccess<IndexType> rJA(storage.getJA());
+            scai::hmemo::ReadAccess<ValueType> rValues(storage.getValues());
+            scai::hmemo::ReadAccess<ValueType> rWeights(gatheredWeights.getLocalValues());
+            ia.assign(rIA.get(), rIA.get() + rIA.size());
+            ja.resize(rJA.size());
+            for (IndexType j = 0; j < rJA.size(); j++) {
+                ja[j] = rootDist->global2Local(rJA[j]);
+            }
+            values.assign(rValues.get(), rValues.get() + rValues.size());
+            weights.assign(rWeights.get(), rWeights.get() + rWeights.size());
+        }
+
+        const ValueType maxBlockWeight = (1 + settings.epsilon) * std::ceil(std::accumulate(weights.begin(), weights.end(), ValueType(0)) / k);
+
+        //8 trials with different seeds, the one with the least weight above the balance constraint and then the lowest cut wins
+        std::vector<IndexType> bestPart;
+        double bestExcess = std::numeric_limits<double>::max();
+        double bestCut = std::numeric_limits<double>::max();
+
+        for (IndexType trial = 0; trial < 8; trial++) {
+            std::vector<IndexType> trialPart = greedyGraphGrowing(ia, ja, values, weights, k, trial);
+
+            std::vector<double> blockWeights(k, 0);
+            double cut = 0;
+            for (IndexType v = 0; v < n; v++) {
+                blockWeights[trialPart[v]] += weights[v];
+                for (IndexType j = ia[v]; j < ia[v+1]; j++) {
+                    if (trialPart[ja[j]] != trialPart[v]) {
+                        cut += values[j];
+                    }
+                }
+            }
+            const double excess = std::max(*std::max_element(blockWeights.begin(), blockWeights.end()) - maxBlockWeight, 0.0);
+
+            if (excess < bestExcess or (excess == bestExcess and cut < bestCut)) {
+                bestPart.swap(trialPart);
+                bestExcess = excess;
+                bestCut = cut;
+            }
+        }
+
+        if (settings.verbose) {
+            PRINT0("Coarsest partition with cut " << bestCut/2);
+        }
+
+        scai::hmemo::WriteAccess<IndexType> wPart(gatheredPart.getLocalValues());
+        std::copy(bestPart.begin(), bestPart.end(), wPart.get());
+    }
+
+    gatheredPart.redistribute(dist);
+    return gatheredPart;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> MultiLevel<IndexType, ValueType>::greedyGraphGrowing(const std::vector<IndexType>& ia, const std::vector<IndexType>& ja, const std::vector<ValueType>& values, const std::vector<ValueType>& nodeWeights, const IndexType numBlocks, const IndexType seed) {
+    SCAI_REGION( "MultiLevel.greedyGraphGrowing" );
+    const IndexType n = nodeWeights.size();
+    SCAI_ASSERT_EQ_ERROR( ia.size(), n+1, "Size mismatch" );
+
+    std::mt19937 generator(seed);
+
+    //the first block of the part every node is in; a part with b blocks is split into parts with floor(b/2) and b-floor(b/2) blocks
+    std::vector<IndexType> part(n, 0);
+    std::vector<std::pair<IndexType, IndexType>> parts(1, std::make_pair(IndexType(0), numBlocks));
+
+    std::vector<char> inPart(n, 0), grown(n, 0), visited(n, 0);
+    std::vector<ValueType> connectivity(n, 0), degree(n, 0);
+    std::vector<IndexType> nodes, queue;
+
+    while (!parts.empty()) {
+        const IndexType firstBlock = parts.back().first;
+        const IndexType partBlocks = parts.back().second;
+        parts.pop_back();
+        if (partBlocks < 2) {
+            continue;
+        }
+        const IndexType secondBlock = firstBlock + partBlocks/2;
+        parts.push_back(std::make_pair(firstBlock, partBlocks/2));
+        parts.push_back(std::make_pair(secondBlock, partBlocks - partBlocks/2));
+
+        nodes.clear();
+        ValueType partWeight = 0;
+        for (IndexType v = 0; v < n; v++) {
+            if (part[v] == firstBlock) {
+                nodes.push_back(v);
+                inPart[v] = 1;
+                partWeight += nodeWeights[v];
+            }
+        }
+        if (nodes.empty()) {
+            continue;
+        }
+
+        //the weighted degree inside the part, the cut grows by degree - 2*connectivity when a node is added
+        for (const IndexType v : nodes) {
+            degree[v] = 0;
+            for (IndexType j = ia[v]; j < ia[v+1]; j++) {
+                if (ja[j] != v and inPart[ja[j]]) {
+                    degree[v] += values[j];
+                }
+            }
+        }
+
+        //a pseudo-peripheral start node: the last node found by a breadth-first search from a random node
+        std::uniform_int_distribution<IndexType> randomNode(0, nodes.size()-1);
+        queue.assign(1, nodes[randomNode(generator)]);
+        visited[queue[0]] = 1;
+        for (IndexType q = 0; q < queue.size(); q++) {
+            const IndexType v = queue[q];
+            for (IndexType j = ia[v]; j < ia[v+1]; j++) {
+                if (inPart[ja[j]] and !visited[ja[j]]) {
+                    visited[ja[j]] = 1;
+                    queue.push_back(ja[j]);
+                }
+            }
+        }
+        IndexType start = queue.back();
+        for (const IndexType v : queue) {
+            visited[v] = 0;
+        }
+
+        const ValueType targetWeight = partWeight * (partBlocks/2) / partBlocks;
+        ValueType grownWeight = 0;
+        IndexType nextUngrown = 0;
+
+        //lazy priority queue, entries with an outdated gain are skipped
+        std::priority_queue<std::pair<ValueType, IndexType>> candidates;
+        candidates.push(std::make_pair(-degree[start], start));
+
+        while (grownWeight < targetWeight) {
+            if (candidates.empty()) {
+                //the grown region is a connected component, continue with another one
+                while (grown[nodes[nextUngrown]]) {
+                    nextUngrown++;
+                }
+                start = nodes[nextUngrown];
+                candidates.push(std::make_pair(2*connectivity[start] - degree[start], start));
+            }
+
+            const std::pair<ValueType, IndexType> top = candidates.top();
+            candidates.pop();
+            const IndexType v = top.second;
+            if (grown[v] or top.first != 2*connectivity[v] - degree[v]) {
+                continue;
+            }
+            //stop if adding the node moves the weight further away from the target
+            if (grownWeight > 0 and grownWeight + nodeWeights[v] - targetWeight > targetWeight - grownWeight) {
+                break;
+            }
+
+            grown[v] = 1;
+            grownWeight += nodeWeights[v];
+            for (IndexType j = ia[v]; j < ia[v+1]; j++) {
+                const IndexType u = ja[j];
+                if (u != v and inPart[u] and !grown[u]) {
+                    connectivity[u] += values[j];
+                    candidates.push(std::make_pair(2*connectivity[u] - degree[u], u));
+                }
+            }
+        }
+
+        for (const IndexType v : nodes) {
+            if (!grown[v]) {
+                part[v] = secondBlock;
+            }
+            inPart[v] = 0;
+            grown[v] = 0;
+            connectivity[v] = 0;
+        }
+    }
+
+    return part;
+}
+//---------------------------------------------------------------------------------------
+
 template<typename IndexType, typename ValueType>
 DenseVector<IndexType> MultiLevel<IndexType, ValueType>::getFineTargets(const DenseVector<IndexType> &coarseOrigin, const DenseVector<IndexType> &fineToCoarseMap) {
     SCAI_REGION("MultiLevel.getFineTargets");
@@ -250,6 +626,7 @@ DenseVector<IndexType> MultiLevel<IndexType, ValueType>::getFineTargets(const De
 
         const IndexType oldFineLocalN = oldFineDist->getLocalSize();
 
+        #pragma omp parallel for schedule(static)
         for (IndexType i = 0; i < oldFineLocalN; i++) {
             IndexType oldLocalCoarse =  oldCoarseDist->global2Local(rMap[i]);//TODO: optimize this
             SCAI_ASSERT_DEBUG(oldLocalCoarse != scai::invalidIndex, "Index " << rMap[i] << " maybe not local after all?");
@@ -261,8 +638,9 @@ DenseVector<IndexType> MultiLevel<IndexType, ValueType>::getFineTargets(const De
 }
 
 template<typename IndexType, typename ValueType>
-void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>& adjM, const DenseVector<ValueType> &nodeWeights,  const HaloExchangePlan& halo, const std::vector<DenseVector<ValueType>>& coordinates, CSRSparseMatrix<ValueType>& coarseGraph, DenseVector<IndexType>& fineToCoarse, Settings settings, IndexType iterations) {
+void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>& adjM, const DenseVector<ValueType> &nodeWeights,  const HaloExchangePlan& halo, const std::vector<DenseVector<ValueType>>& coordinates, CSRSparseMatrix<ValueType>& coarseGraph, DenseVector<IndexType>& fineToCoarse, Settings settings, IndexType iterations, const std::vector<IndexType>& localBlocks) {
     SCAI_REGION("MultiLevel.coarsen");
+    Telemetry::ScopedTimer telemetryTimer("coarsen");
     scai::dmemo::CommunicatorPtr comm = adjM.getRowDistributionPtr()->getCommunicatorPtr();
     const scai::dmemo::DistributionPtr distPtr = adjM.getRowDistributionPtr();
 
@@ -278,6 +656,9 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
 
     std::vector<IndexType> localFineToCoarse(localN);
 
+    //nodes that were matched in one of the local iterations
+    std::vector<bool> contracted(localN, false);
+
     scai::hmemo::HArray<IndexType> globalIndices;
     distPtr->getOwnedIndexes(globalIndices);
     scai::hmemo::ReadAccess<IndexType> rIndex(globalIndices);
@@ -297,7 +678,7 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
         assert(ia.size()-1 == localN );
 
         //get a matching, the returned indices are from 0 to localN
-        std::vector<std::pair<IndexType,IndexType>> matching = MultiLevel<IndexType, ValueType>::maxLocalMatching( graph, localWeightCopy, coordinates, settings.nnCoarsening );
+        std::vector<std::pair<IndexType,IndexType>> matching = MultiLevel<IndexType, ValueType>::maxLocalMatching( graph, localWeightCopy, coordinates, settings.nnCoarsening, localBlocks );
 
         std::vector<IndexType> localMatchingPartner(localN, -1);
 
@@ -316,6 +697,8 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
 
                 localMatchingPartner[matching[i].first] = matching[i].second;
                 localMatchingPartner[matching[i].second] = matching[i].first;
+                contracted[matching[i].first] = true;
+                contracted[matching[i].second] = true;
 
                 if (matching[i].first < matching[i].second) {
                     localPreserved[matching[i].second] = 0;
@@ -409,6 +792,25 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
         }
     }
 
+    //match the remaining nodes with unmatched neighbors on other processes
+    const bool crossRank = settings.crossRankMatchingRounds > 0;
+    std::vector<IndexType> crossPartner;
+    if (crossRank) {
+        std::vector<bool> candidates(contracted.size());
+        for (IndexType i = 0; i < localN; i++) {
+            candidates[i] = !contracted[i];
+        }
+        crossPartner = crossRankMatching(graph, localWeightCopy, halo, candidates, localBlocks, settings.crossRankMatchingRounds);
+
+        //the endpoint with the smaller global index keeps the coarse node
+        scai::hmemo::WriteAccess<IndexType> wPreserved(preserved);
+        for (IndexType i = 0; i < localN; i++) {
+            if (crossPartner[i] != -1 and crossPartner[i] < rIndex[i]) {
+                wPreserved[i] = 0;
+            }
+        }
+    }
+
     SCAI_REGION_START("MultiLevel.coarsen.newGlobalIndices")
     //get new global indices by computing a prefix sum over the preserved nodes
     //fill gaps in index list. To avoid redistribution, we assign a block distribution and live with the implicit reindexing
@@ -424,12 +826,15 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
         scai::hmemo::ReadAccess<IndexType> localPreserved(preserved);
         scai::hmemo::WriteAccess<IndexType> wFineToCoarse(fineToCoarse.getLocalValues());
         for (IndexType i = 0; i < localN; i++) {
-            assert((localFineToCoarse[i] == i) == localPreserved[i]);
+            if (!localPreserved[i] and localFineToCoarse[i] == i) {
+                //matched with a node on another process, set below
+                assert(crossRank and crossPartner[i] != -1);
+                continue;
+            }
             wFineToCoarse[i] = wFineToCoarse[localFineToCoarse[i]];
         }
     }
 
-    assert(fineToCoarse.max() + 1 == newGlobalN);
     assert(newGlobalN <= globalN);
     assert(newGlobalN == comm->sum(newLocalN));
     SCAI_REGION_END("MultiLevel.coarsen.newGlobalIndices")
@@ -438,6 +843,110 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
     HArray<IndexType> haloData;
     halo.updateHalo(haloData, fineToCoarse.getLocalValues(), *comm);
 
+    if (crossRank) {
+        //nodes matched across processes get the coarse node of their partner, the halo needs the new values as well
+        {
+            scai::hmemo::ReadAccess<IndexType> localPreserved(preserved);
+            scai::hmemo::ReadAccess<IndexType> rHalo(haloData);
+            scai::hmemo::WriteAccess<IndexType> wFineToCoarse(fineToCoarse.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                if (!localPreserved[i] and crossPartner[i] != -1) {
+                    wFineToCoarse[i] = rHalo[halo.global2Halo(crossPartner[i])];
+                }
+            }
+        }
+        halo.updateHalo(haloData, fineToCoarse.getLocalValues(), *comm);
+    }
+    assert(fineToCoarse.max() + 1 == newGlobalN);
+
+    //create distribution object for coarse graph, the coarse nodes are stored with their preserved fine node
+    HArray<IndexType> myGlobalIndices;
+    {
+        scai::hmemo::ReadAccess<IndexType> localPreserved(preserved);
+        scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+        scai::hmemo::WriteOnlyAccess<IndexType> wIndices(myGlobalIndices, newLocalN);
+        IndexType numPreserved = 0;
+        for (IndexType i = 0; i < localN; i++) {
+            if (localPreserved[i]) {
+                wIndices[numPreserved++] = rFineToCoarse[i];
+            }
+        }
+        assert(numPreserved == newLocalN);
+        assert(std::is_sorted(wIndices.get(), wIndices.get() + newLocalN));
+    }
+
+    const auto newDist = scai::dmemo::generalDistributionUnchecked(newGlobalN, myGlobalIndices, comm);
+
+    //the rows of nodes matched across processes are added to the row of the coarse node on the other process
+    std::vector<std::vector<std::pair<IndexType, ValueType>>> receivedEdges(newLocalN);
+    if (crossRank) {
+        SCAI_REGION("MultiLevel.coarsen.sendCrossRankRows");
+        const IndexType numPEs = comm->getSize();
+
+        //the owner of every halo node, from the halo plan
+        std::vector<IndexType> haloOwner(halo.getHaloSize());
+        const scai::dmemo::CommunicationPlan& haloPlan = halo.getHaloCommunicationPlan();
+        for (IndexType i = 0; i < haloPlan.size(); i++) {
+            for (IndexType j = haloPlan[i].offset; j < haloPlan[i].offset + haloPlan[i].quantity; j++) {
+                haloOwner[j] = haloPlan[i].partitionId;
+            }
+        }
+
+        std::vector<std::vector<IndexType>> rowsPerPE(numPEs);
+        std::vector<std::vector<IndexType>> targetsPerPE(numPEs);
+        std::vector<std::vector<ValueType>> valuesPerPE(numPEs);
+        {
+            const CSRStorage<ValueType>& localStorage = graph.getLocalStorage();
+            scai::hmemo::ReadAccess<IndexType> ia( localStorage.getIA() );
+            scai::hmemo::ReadAccess<IndexType> ja( localStorage.getJA() );
+            scai::hmemo::ReadAccess<ValueType> values( localStorage.getValues() );
+            scai::hmemo::ReadAccess<IndexType> localPreserved(preserved);
+            scai::hmemo::ReadAccess<IndexType> rHalo(haloData);
+            scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+
+            for (IndexType i = 0; i < localN; i++) {
+                if (localPreserved[i] or crossPartner[i] == -1) {
+                    continue;
+                }
+                const IndexType owner = haloOwner[halo.global2Halo(crossPartner[i])];
+                for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+                    const IndexType localNeighbor = distPtr->global2Local(ja[j]);
+                    const IndexType coarseTarget = localNeighbor != scai::invalidIndex ? rFineToCoarse[localNeighbor] : rHalo[halo.global2Halo(ja[j])];
+                    rowsPerPE[owner].push_back(rFineToCoarse[i]);
+                    targetsPerPE[owner].push_back(coarseTarget);
+                    valuesPerPE[owner].push_back(values[j]);
+                }
+            }
+        }
+
+        std::vector<IndexType> quantities(numPEs);
+        std::vector<IndexType> sendRows, sendTargets;
+        std::vector<ValueType> sendValues;
+        for (IndexType p = 0; p < numPEs; p++) {
+            quantities[p] = rowsPerPE[p].size();
+            sendRows.insert(sendRows.end(), rowsPerPE[p].begin(), rowsPerPE[p].end());
+            sendTargets.insert(sendTargets.end(), targetsPerPE[p].begin(), targetsPerPE[p].end());
+            sendValues.insert(sendValues.end(), valuesPerPE[p].begin(), valuesPerPE[p].end());
+        }
+
+        scai::dmemo::CommunicationPlan sendPlan(quantities.data(), numPEs);
+        scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
+        const IndexType numRecv = recvPlan.totalQuantity();
+
+        std::vector<IndexType> recvRows(numRecv), recvTargets(numRecv);
+        std::vector<ValueType> recvValues(numRecv);
+        comm->exchangeByPlan( recvRows.data(), recvPlan, sendRows.data(), sendPlan );
+        comm->exchangeByPlan( recvTargets.data(), recvPlan, sendTargets.data(), sendPlan );
+        comm->exchangeByPlan( recvValues.data(), recvPlan, sendValues.data(), sendPlan );
+        Telemetry::countCollective( sendRows.size()*(2*sizeof(IndexType) + sizeof(ValueType)) );
+
+        for (IndexType i = 0; i < numRecv; i++) {
+            const IndexType coarseRow = newDist->global2Local(recvRows[i]);
+            SCAI_ASSERT_NE_ERROR( coarseRow, scai::invalidIndex, "Received row of coarse node " << recvRows[i] << ", which is not local" );
+            receivedEdges[coarseRow].push_back(std::make_pair(recvTargets[i], recvValues[i]));
+        }
+    }
+
     //create new coarsened CSR matrix
     scai::hmemo::HArray<IndexType> newIA(newLocalN + 1);
     std::vector<IndexType> newJA;
@@ -471,8 +980,9 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
                     IndexType localNeighbor = distPtr->global2Local(ja[j]);
 
                     if (localNeighbor != scai::invalidIndex) {
-                        assert(outgoingEdges.count(rFineToCoarse[localNeighbor]) == 0);
-                        outgoingEdges[rFineToCoarse[localNeighbor]] = values[j];
+                        //a node matched across processes shares its coarse node with a halo node
+                        assert(crossRank or outgoingEdges.count(rFineToCoarse[localNeighbor]) == 0);
+                        outgoingEdges[rFineToCoarse[localNeighbor]] += values[j];
                     } else {
                         IndexType haloIndex = halo.global2Halo(ja[j]);
                         assert(haloIndex != scai::invalidIndex);
@@ -480,6 +990,9 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
                         outgoingEdges[rHalo[haloIndex]] += values[j];
                     }
                 }
+                for (const std::pair<IndexType, ValueType>& edge : receivedEdges[iaIndex]) {
+                    outgoingEdges[edge.first] += edge.second;
+                }
 
                 newIAWrite[iaIndex+1] = newIAWrite[iaIndex] + outgoingEdges.size();
 
@@ -499,22 +1012,14 @@ void MultiLevel<IndexType, ValueType>::coarsen(const CSRSparseMatrix<ValueType>&
     scai::hmemo::HArray<IndexType> csrJA(newJA.size(), newJA.data());
     scai::hmemo::HArray<ValueType> csrValues(newValues.size(), newValues.data());
 
-    //create distribution object for coarse graph
-    HArray<IndexType> myGlobalIndices(fineToCoarse.getLocalValues());
-    scai::hmemo::WriteAccess<IndexType> wIndices(myGlobalIndices);
-    assert(wIndices.size() == localN);
-    std::sort(wIndices.get(), wIndices.get() + localN);
-    auto newEnd = std::unique(wIndices.get(), wIndices.get() + localN);
-    wIndices.resize(std::distance(wIndices.get(), newEnd));
-    assert(wIndices.size() == newLocalN);
-    wIndices.release();
-
-    const auto newDist = scai::dmemo::generalDistributionUnchecked(newGlobalN, myGlobalIndices, comm);
     const scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(newGlobalN));
 
     CSRStorage<ValueType> storage( newLocalN, newGlobalN, std::move(newIA), std::move(csrJA), std::move(csrValues) );
     coarseGraph = CSRSparseMatrix<ValueType>( newDist, std::move( storage ) );
 
+    //the contraction ratio per process, summed over all levels
+    Telemetry::count("coarsenFineNodes", localN);
+    Telemetry::count("coarsenCoarseNodes", newLocalN);
 }//---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
@@ -598,33 +1103,56 @@ scai::dmemo::DistributionPtr MultiLevel<IndexType, ValueType>::projectToCoarse(c
 
 template<typename IndexType, typename ValueType>
 DenseVector<ValueType> MultiLevel<IndexType, ValueType>::projectToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse) {
+    return projectToCoarse(input, fineToCoarse, projectToCoarse(fineToCoarse));
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+DenseVector<ValueType> MultiLevel<IndexType, ValueType>::projectToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::DistributionPtr coarseDist) {
     SCAI_REGION("MultiLevel.projectToCoarse.interpolate");
     const scai::dmemo::DistributionPtr inputDist = input.getDistributionPtr();
 
     scai::dmemo::DistributionPtr fineDist = fineToCoarse.getDistributionPtr();
     const IndexType fineLocalN = fineDist->getLocalSize();
     assert(inputDist->getLocalSize() == fineLocalN);
-    scai::dmemo::DistributionPtr coarseDist = projectToCoarse(fineToCoarse);
     IndexType coarseLocalN = coarseDist->getLocalSize();
 
     //add values in preparation for interpolation
     std::vector<ValueType> sum(coarseLocalN, 0);
     std::vector<IndexType> numFineNodes(coarseLocalN, 0);
+    std::vector<IndexType> remoteIndices;
+    std::vector<ValueType> remoteValues;
     {
         scai::hmemo::ReadAccess<ValueType> rInput(input.getLocalValues());
         scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+        // the index lookup is done in parallel, the sums in the order of the fine nodes,
+        // so the result does not depend on the number of threads
+        const std::vector<IndexType> coarseTargets = localCoarseTargets(rFineToCoarse.get(), fineLocalN, *coarseDist);
+
         for (IndexType i = 0; i < fineLocalN; i++) {
-            const IndexType coarseTarget = coarseDist->global2Local(rFineToCoarse[i]);
-            sum[coarseTarget] += rInput[i];
-            numFineNodes[coarseTarget] += 1;
+            const IndexType coarseTarget = coarseTargets[i];
+            if (coarseTarget != scai::invalidIndex) {
+                sum[coarseTarget] += rInput[i];
+                numFineNodes[coarseTarget] += 1;
+            } else {
+                //the value and a count of one for every fine node whose coarse node is on another process
+                remoteIndices.push_back(rFineToCoarse[i]);
+                remoteValues.push_back(rInput[i]);
+                remoteValues.push_back(1);
+            }
         }
     }
 
+    std::vector<ValueType> remoteSums(2*coarseLocalN, 0);
+    addToOwners(remoteIndices, remoteValues, 2, *coarseDist, remoteSums);
+
     DenseVector<ValueType> result(coarseDist, 0);
     scai::hmemo::WriteAccess<ValueType> wResult(result.getLocalValues());
+    #pragma omp parallel for schedule(static)
     for (IndexType i = 0; i < coarseLocalN; i++) {
-        assert(numFineNodes[i] > 0);
-        wResult[i] = sum[i] / numFineNodes[i];
+        const ValueType numNodes = numFineNodes[i] + remoteSums[2*i+1];
+        assert(numNodes > 0);
+        wResult[i] = (sum[i] + remoteSums[2*i]) / numNodes;
     }
     wResult.release();
     return result;
@@ -633,34 +1161,263 @@ DenseVector<ValueType> MultiLevel<IndexType, ValueType>::projectToCoarse(const D
 
 template<typename IndexType, typename ValueType>
 DenseVector<ValueType> MultiLevel<IndexType, ValueType>::sumToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse) {
+    return sumToCoarse(input, fineToCoarse, projectToCoarse(fineToCoarse));
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+DenseVector<ValueType> MultiLevel<IndexType, ValueType>::sumToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::DistributionPtr coarseDist) {
     SCAI_REGION("MultiLevel.sumToCoarse");
     const scai::dmemo::DistributionPtr inputDist = input.getDistributionPtr();
 
     scai::dmemo::DistributionPtr fineDist = fineToCoarse.getDistributionPtr();
     const IndexType fineLocalN = fineDist->getLocalSize();
-    scai::dmemo::DistributionPtr coarseDist = projectToCoarse(fineToCoarse);
-    [[maybe_unused]] const IndexType coarseLocalN = coarseDist->getLocalSize();
+    const IndexType coarseLocalN = coarseDist->getLocalSize();
     assert(inputDist->getLocalSize() == fineLocalN);
 
-    DenseVector<ValueType> result(coarseDist, 0);
-    scai::hmemo::WriteAccess<ValueType> wResult(result.getLocalValues());
+    std::vector<IndexType> remoteIndices;
+    std::vector<ValueType> remoteValues;
+    std::vector<ValueType> coarseValues(coarseLocalN, 0);
     {
         scai::hmemo::ReadAccess<ValueType> rInput(input.getLocalValues());
         scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+        // several fine nodes can have the same coarse target, they are added in a fixed order
+        const std::vector<IndexType> coarseTargets = localCoarseTargets(rFineToCoarse.get(), fineLocalN, *coarseDist);
+
         for (IndexType i = 0; i < fineLocalN; i++) {
-            const IndexType coarseTarget = coarseDist->global2Local(rFineToCoarse[i]);
-            assert(coarseTarget < coarseLocalN);
-            wResult[coarseTarget] += rInput[i];
+            const IndexType coarseTarget = coarseTargets[i];
+            if (coarseTarget != scai::invalidIndex) {
+                assert(coarseTarget < coarseLocalN);
+                coarseValues[coarseTarget] += rInput[i];
+            } else {
+                remoteIndices.push_back(rFineToCoarse[i]);
+                remoteValues.push_back(rInput[i]);
+            }
         }
     }
 
-    wResult.release();
-    return result;
+    addToOwners(remoteIndices, remoteValues, 1, *coarseDist, coarseValues);
+
+    return DenseVector<ValueType>(coarseDist, HArray<ValueType>(coarseLocalN, coarseValues.data()));
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> MultiLevel<IndexType, ValueType>::localCoarseTargets(const IndexType* fineToCoarse, const IndexType n, const scai::dmemo::Distribution& coarseDist) {
+    std::vector<IndexType> coarseTargets(n);
+    #pragma omp parallel for schedule(static)
+    for (IndexType i = 0; i < n; i++) {
+        coarseTargets[i] = coarseDist.global2Local(fineToCoarse[i]);
+    }
+    return coarseTargets;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+void MultiLevel<IndexType, ValueType>::addToOwners(const std::vector<IndexType>& indices, const std::vector<ValueType>& values, const IndexType stride, const scai::dmemo::Distribution& dist, std::vector<ValueType>& localSums) {
+    SCAI_REGION("MultiLevel.addToOwners");
+    const scai::dmemo::CommunicatorPtr comm = dist.getCommunicatorPtr();
+    const IndexType numPEs = comm->getSize();
+    const IndexType numIndices = indices.size();
+    SCAI_ASSERT_EQ_ERROR( IndexType(values.size()), numIndices*stride, "Size mismatch" );
+    SCAI_ASSERT_EQ_ERROR( IndexType(localSums.size()), dist.getLocalSize()*stride, "Size mismatch" );
+
+    if (not comm->any(numIndices > 0)) {
+        return;
+    }
+
+    scai::hmemo::HArray<IndexType> owners(numIndices, -1);
+    dist.computeOwners( owners, HArray<IndexType>(numIndices, indices.data()) );
+
+    //sort the entries by owner
+    std::vector<IndexType> quantities(numPEs, 0);
+    std::vector<IndexType> sendIndices(numIndices);
+    std::vector<ValueType> sendValues(numIndices*stride);
+    {
+        scai::hmemo::ReadAccess<IndexType> rOwners(owners);
+        for (IndexType i = 0; i < numIndices; i++) {
+            quantities[rOwners[i]]++;
+        }
+        std::vector<IndexType> sendPos(numPEs, 0);
+        std::partial_sum(quantities.begin(), quantities.end()-1, sendPos.begin()+1);
+        for (IndexType i = 0; i < numIndices; i++) {
+            const IndexType pos = sendPos[rOwners[i]]++;
+            sendIndices[pos] = indices[i];
+            std::copy(values.begin() + i*stride, values.begin() + (i+1)*stride, sendValues.begin() + pos*stride);
+        }
+    }
+
+    scai::dmemo::CommunicationPlan sendPlan(quantities.data(), numPEs);
+    scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
+    const IndexType numRecv = recvPlan.totalQuantity();
+
+    // the plans count indices, every index has stride values
+    auto scalePlan = [numPEs, stride](const scai::dmemo::CommunicationPlan& plan) {
+        std::vector<IndexType> valueQuantities(numPEs, 0);
+        for (IndexType i = 0; i < plan.size(); i++) {
+            valueQuantities[plan[i].partitionId] = plan[i].quantity*stride;
+        }
+        return scai::dmemo::CommunicationPlan(valueQuantities.data(), valueQuantities.size());
+    };
+
+    std::vector<IndexType> recvIndices(numRecv);
+    std::vector<ValueType> recvValues(numRecv*stride);
+    comm->exchangeByPlan( recvIndices.data(), recvPlan, sendIndices.data(), sendPlan );
+    comm->exchangeByPlan( recvValues.data(), scalePlan(recvPlan), sendValues.data(), scalePlan(sendPlan) );
+    Telemetry::countCollective( numIndices*(sizeof(IndexType) + stride*sizeof(ValueType)) );
+
+    for (IndexType i = 0; i < numRecv; i++) {
+        const IndexType localIndex = dist.global2Local(recvIndices[i]);
+        SCAI_ASSERT_NE_ERROR( localIndex, scai::invalidIndex, "Received index " << recvIndices[i] << ", which is not local" );
+        for (IndexType s = 0; s < stride; s++) {
+            localSums[localIndex*stride + s] += recvValues[i*stride + s];
+        }
+    }
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+HaloExchangePlan MultiLevel<IndexType, ValueType>::coarseNodeHalo(const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::Distribution& coarseDist) {
+    SCAI_REGION("MultiLevel.coarseNodeHalo");
+    const scai::dmemo::CommunicatorPtr comm = coarseDist.getCommunicatorPtr();
+
+    std::vector<IndexType> requiredIndices;
+    {
+        scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+        for (IndexType i = 0; i < rFineToCoarse.size(); i++) {
+            if (!coarseDist.isLocal(rFineToCoarse[i])) {
+                requiredIndices.push_back(rFineToCoarse[i]);
+            }
+        }
+    }
+
+    if (not comm->any(requiredIndices.size() > 0)) {
+        return HaloExchangePlan();
+    }
+
+    std::sort(requiredIndices.begin(), requiredIndices.end());
+    requiredIndices.erase(std::unique(requiredIndices.begin(), requiredIndices.end()), requiredIndices.end());
+    scai::hmemo::HArrayRef<IndexType> arrRequiredIndexes( requiredIndices );
+    return scai::dmemo::haloExchangePlan( coarseDist, arrRequiredIndexes );
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> MultiLevel<IndexType, ValueType>::crossRankMatching(const CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType>& nodeWeights, const HaloExchangePlan& halo, const std::vector<bool>& candidates, const std::vector<IndexType>& localBlocks, const IndexType rounds) {
+    SCAI_REGION("MultiLevel.crossRankMatching");
+    const scai::dmemo::DistributionPtr distPtr = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = distPtr->getCommunicatorPtr();
+    const IndexType localN = distPtr->getLocalSize();
+    SCAI_ASSERT_EQ_ERROR( IndexType(candidates.size()), localN, "Size mismatch" );
+    SCAI_ASSERT_ERROR( localBlocks.empty() or IndexType(localBlocks.size()) == localN, "Size mismatch" );
+
+    //processes without nodes have no blocks either, but must take part in the halo update
+    const bool useBlocks = comm->any(!localBlocks.empty());
+
+    HArray<ValueType> haloWeights;
+    halo.updateHalo(haloWeights, nodeWeights.getLocalValues(), *comm);
+    HArray<IndexType> haloBlocks;
+    if (useBlocks) {
+        halo.updateHalo(haloBlocks, HArray<IndexType>(localN, localBlocks.data()), *comm);
+    }
+
+    HArray<IndexType> available(localN, 0);
+    {
+        scai::hmemo::WriteAccess<IndexType> wAvailable(available);
+        for (IndexType i = 0; i < localN; i++) {
+            wAvailable[i] = candidates[i];
+        }
+    }
+    HArray<IndexType> proposal(localN, -1);
+    HArray<IndexType> haloAvailable;
+    HArray<IndexType> haloProposal;
+    std::vector<IndexType> partner(localN, -1);
+    IndexType localMatches = 0;
+
+    const CSRStorage<ValueType>& localStorage = graph.getLocalStorage();
+    scai::hmemo::ReadAccess<IndexType> ia( localStorage.getIA() );
+    scai::hmemo::ReadAccess<IndexType> ja( localStorage.getJA() );
+    scai::hmemo::ReadAccess<ValueType> values( localStorage.getValues() );
+
+    // strict total order on the edges with equal rating, the same on both endpoints. Ordering by the indices alone
+    // lets the proposals of unweighted graphs form long chains with a single mutual pair, a hash of the edge does not.
+    auto edgeKey = [](const IndexType u, const IndexType v) {
+        const uint64_t first = std::min(u, v);
+        const uint64_t second = std::max(u, v);
+        uint64_t x = (first << 32) ^ second;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return std::make_tuple(x, first, second);
+    };
+
+    for (IndexType round = 0; round < rounds; round++) {
+        halo.updateHalo(haloAvailable, available, *comm);
+
+        {
+            scai::hmemo::ReadAccess<IndexType> rAvailable(available);
+            scai::hmemo::ReadAccess<IndexType> rHaloAvailable(haloAvailable);
+            scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
+            scai::hmemo::ReadAccess<ValueType> rHaloWeights(haloWeights);
+            scai::hmemo::ReadAccess<IndexType> rHaloBlocks(haloBlocks);
+            scai::hmemo::WriteAccess<IndexType> wProposal(proposal);
+
+            for (IndexType i = 0; i < localN; i++) {
+                wProposal[i] = -1;
+                if (!rAvailable[i]) {
+                    continue;
+                }
+                const IndexType globalI = distPtr->local2Global(i);
+
+                IndexType best = -1;
+                ValueType bestRating = -1;
+                for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+                    const IndexType haloIndex = halo.global2Halo(ja[j]);
+                    if (haloIndex == scai::invalidIndex or !rHaloAvailable[haloIndex]
+                        or (useBlocks and rHaloBlocks[haloIndex] != localBlocks[i])) {
+                        continue;
+                    }
+                    const ValueType rating = values[j]*values[j]/(rWeights[i]*rHaloWeights[haloIndex]);
+                    if (best < 0 or rating > bestRating or (rating == bestRating and edgeKey(globalI, ja[j]) < edgeKey(globalI, best))) {
+                        best = ja[j];
+                        bestRating = rating;
+                    }
+                }
+                wProposal[i] = best;
+            }
+        }
+
+        halo.updateHalo(haloProposal, proposal, *comm);
+
+        IndexType newMatches = 0;
+        {
+            scai::hmemo::ReadAccess<IndexType> rProposal(proposal);
+            scai::hmemo::ReadAccess<IndexType> rHaloProposal(haloProposal);
+            scai::hmemo::WriteAccess<IndexType> wAvailable(available);
+            for (IndexType i = 0; i < localN; i++) {
+                if (rProposal[i] != -1 and rHaloProposal[halo.global2Halo(rProposal[i])] == distPtr->local2Global(i)) {
+                    partner[i] = rProposal[i];
+                    wAvailable[i] = 0;
+                    newMatches++;
+                }
+            }
+        }
+        localMatches += newMatches;
+
+        if (comm->sum(newMatches) == 0) {
+            break;
+        }
+    }
+
+    Telemetry::count("crossRankMatchedNodes", localMatches);
+    return partner;
 }
 //---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
-std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::maxLocalMatching(const scai::lama::CSRSparseMatrix<ValueType>& adjM, const DenseVector<ValueType>& nodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, bool nnCoarsening) {
+std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::maxLocalMatching(const scai::lama::CSRSparseMatrix<ValueType>& adjM, const DenseVector<ValueType>& nodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, bool nnCoarsening, const std::vector<IndexType>& localBlocks) {
     SCAI_REGION("MultiLevel.maxLocalMatching");
 
     const scai::dmemo::DistributionPtr distPtr = adjM.getRowDistributionPtr();
@@ -681,6 +1438,7 @@ std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::ma
     // ia must have size localN+1
     assert(ia.size()-1 == localN );
     SCAI_ASSERT_EQ_ERROR( rLocalNodeWeights.size(), localN, "Size mismatch" );
+    SCAI_ASSERT_ERROR( localBlocks.empty() or localBlocks.size() == localN, "Size mismatch" );
 
     // the vector<vector> to return
     // matching[0][i]-matching[1][i] are the endpoints of an edge that is matched
@@ -690,7 +1448,7 @@ std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::ma
     std::vector<bool> matched(localN, false);
 
     //use a function pointer to avoid an 'if' statement in the foor loop
-    IndexType (*getPartner)( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched);
+    IndexType (*getPartner)( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched, const std::vector<IndexType>& localBlocks);
 
     if( nnCoarsening ){
         getPartner = nnPartner;
@@ -705,7 +1463,7 @@ std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::ma
             continue;
         }
 
-        IndexType bestTarget = getPartner( localNode, ia, values, ja, rLocalNodeWeights, coordinates, distPtr, matched);
+        IndexType bestTarget = getPartner( localNode, ia, values, ja, rLocalNodeWeights, coordinates, distPtr, matched, localBlocks);
 
         if (bestTarget > 0) {
             IndexType globalNgbr = ja[bestTarget];
@@ -731,7 +1489,7 @@ std::vector<std::pair<IndexType,IndexType>> MultiLevel<IndexType, ValueType>::ma
 //---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
-IndexType MultiLevel<IndexType, ValueType>::edgeRatingPartner(  const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched){
+IndexType MultiLevel<IndexType, ValueType>::edgeRatingPartner(  const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched, const std::vector<IndexType>& localBlocks){
     SCAI_REGION("MultiLevel.edgeRatingPartner");
 
     IndexType bestTarget = -1;
@@ -741,7 +1499,8 @@ IndexType MultiLevel<IndexType, ValueType>::edgeRatingPartner(  const IndexType
     for (IndexType j = ia[localNode]; j < endCols; j++) {
         IndexType localNeighbor = distPtr->global2Local(ja[j]);
     
-        if (localNeighbor != scai::invalidIndex && localNeighbor != localNode && !matched[localNeighbor]) {
+        if (localNeighbor != scai::invalidIndex && localNeighbor != localNode && !matched[localNeighbor]
+            && (localBlocks.empty() || localBlocks[localNeighbor] == localBlocks[localNode])) {
             //neighbor is local and unmatched, possible partner
             ValueType thisEdgeRating = values[j]*values[j]/(localNodeWeights[localNode]*localNodeWeights[localNeighbor]);
 
@@ -757,7 +1516,7 @@ IndexType MultiLevel<IndexType, ValueType>::edgeRatingPartner(  const IndexType
 //---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
-IndexType MultiLevel<IndexType, ValueType>::nnPartner(  const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched){
+IndexType MultiLevel<IndexType, ValueType>::nnPartner(  const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched, const std::vector<IndexType>& localBlocks){
     SCAI_REGION("MultiLevel.nnPartner");
 
     const IndexType dim = coordinates.size();
@@ -775,7 +1534,8 @@ IndexType MultiLevel<IndexType, ValueType>::nnPartner(  const IndexType localNod
     for (IndexType j = ia[localNode]; j < endCols; j++) {
         IndexType localNeighbor = distPtr->global2Local(ja[j]);
 
-        if (localNeighbor != scai::invalidIndex && localNeighbor != localNode && !matched[localNeighbor]) {
+        if (localNeighbor != scai::invalidIndex && localNeighbor != localNode && !matched[localNeighbor]
+            && (localBlocks.empty() || localBlocks[localNeighbor] == localBlocks[localNode])) {
             //neighbor is local and unmatched, possible partner
             
             std::vector<ValueType> ngbrPoint(dim);
@@ -51,6 +51,52 @@ public:
      */
     static DenseVector<IndexType> multiLevelStep(scai::lama::CSRSparseMatrix<ValueType> &input, DenseVector<IndexType> &part, DenseVector<ValueType> &nodeWeights, std::vector<DenseVector<ValueType>> &coordinates, const HaloExchangePlan& halo, Settings settings, Metrics<ValueType>& metrics);
 
+    /**
+     * Partition a graph with multilevel V-cycles; neither coordinates nor an initial partition are needed.
+     *
+     * The graph is coarsened with edge matchings until it has at most max(settings.vCycleCoarsestSize, 20*numBlocks) nodes
+     * or a coarsening step removes less than 10% of the nodes. The coarsest graph is partitioned by coarsestPartition, the partition is
+     * projected back level by level and improved on every level with LocalRefinement::greedyRefinement.
+     * Every further V-cycle only contracts nodes of the same block, starts from the projected partition on the coarsest level and refines it again.
+     *
+     * @param[in] input Adjacency matrix of the input graph
+     * @param[in] nodeWeights The weights of the nodes
+     * @param[in] coordinates The coordinates of the nodes; only needed if settings.vCycleKMeans or settings.nnCoarsening is set
+     * @param[in] settings Uses numBlocks, epsilon and the V-cycle parameters
+     * @param[out] metrics
+     *
+     * @return The partition, distributed like the rows of \p input
+     */
+    static DenseVector<IndexType> vCyclePartition(const CSRSparseMatrix<ValueType> &input, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings, Metrics<ValueType>& metrics);
+
+    /**
+     * Partition the coarsest graph of a V-cycle.
+     * With settings.vCycleKMeans, balanced k-means runs on the projected coordinates of the distributed graph.
+     * Otherwise, the graph is gathered on process 0, which runs greedyGraphGrowing with 8 different seeds
+     * and keeps the partition with the lowest cut among those within the balance constraint.
+     * If coarsening stalled and the graph has more than 8*max(settings.vCycleCoarsestSize, 20*numBlocks) nodes, it is not gathered;
+     * k-means is used if coordinates are given, otherwise every block is a contiguous range of node indices.
+     *
+     * @return The partition, distributed like the rows of \p graph
+     */
+    static DenseVector<IndexType> coarsestPartition(const CSRSparseMatrix<ValueType> &graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings, Metrics<ValueType>& metrics);
+
+    /**
+     * Partition a graph that is stored completely on this process by recursive bisection with greedy graph growing.
+     * Every bisection grows one side from a pseudo-peripheral node of its part, always adding the node that increases the cut the least,
+     * until it has the fraction floor(b/2)/b of the weight of the part, where b is the number of blocks of the part.
+     *
+     * @param[in] ia Offsets of the adjacency lists, with n+1 entries
+     * @param[in] ja The neighbors of every node; self loops are ignored
+     * @param[in] values The edge weights
+     * @param[in] nodeWeights The weights of the n nodes
+     * @param[in] numBlocks The number of blocks
+     * @param[in] seed Selects the start nodes, different seeds give different partitions
+     *
+     * @return The block of every node
+     */
+    static std::vector<IndexType> greedyGraphGrowing(const std::vector<IndexType>& ia, const std::vector<IndexType>& ja, const std::vector<ValueType>& values, const std::vector<ValueType>& nodeWeights, const IndexType numBlocks, const IndexType seed);
+
     /**
      * Given the origin array resulting from a multi-level step on a coarsened graph, compute where local elements on the current level have to be sent to recreate the coarse distribution on the current level.
      * Involves communication.
@@ -73,21 +119,29 @@ public:
      * @param[out] coarseGraph Adjacency matrix of coarsened graph
      * @param[out] fineToCoarse DenseVector with as many entries as uncoarsened nodes. For each uncoarsened node, contains the corresponding coarsened node.
      * @param[in] iterations Number of contraction iterations
+     * @param[in] localBlocks If not empty, the block of every local node; only nodes of the same block are contracted
+     *
+     * With settings.crossRankMatchingRounds > 0, nodes that are still unmatched after the local iterations are matched with unmatched
+     * neighbors on other processes, see crossRankMatching. The coarse node of such a pair is stored on the process of the endpoint
+     * with the smaller global index, so fineToCoarse can point to coarse nodes on other processes. Without it, all coarse nodes
+     * are on the process of their fine nodes.
      */
-    static void coarsen(const CSRSparseMatrix<ValueType>& inputGraph, const DenseVector<ValueType> &nodeWeights, const HaloExchangePlan& halo, const std::vector<DenseVector<ValueType>>& coordinates, CSRSparseMatrix<ValueType>& coarseGraph, DenseVector<IndexType>& fineToCoarse, Settings settings, IndexType iterations = 1);
+    static void coarsen(const CSRSparseMatrix<ValueType>& inputGraph, const DenseVector<ValueType> &nodeWeights, const HaloExchangePlan& halo, const std::vector<DenseVector<ValueType>>& coordinates, CSRSparseMatrix<ValueType>& coarseGraph, DenseVector<IndexType>& fineToCoarse, Settings settings, IndexType iterations = 1, const std::vector<IndexType>& localBlocks = {});
 
     /**
      * @brief Perform a local maximum matching
      *
      * @param[in] graph Adjacency matrix of input graph
      * @param[in] nodeWeights
+     * @param[in] localBlocks If not empty, the block of every local node; only nodes of the same block are matched
      *
      * @return vector of edges in maximum matching. ret[i].first is a vertex that is matched to ret[i].second
      */
-    static std::vector<std::pair<IndexType,IndexType>> maxLocalMatching(const scai::lama::CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, bool nnCoarsening=false );
+    static std::vector<std::pair<IndexType,IndexType>> maxLocalMatching(const scai::lama::CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, bool nnCoarsening=false, const std::vector<IndexType>& localBlocks = {} );
 
     /**
      * @brief Project a fine DenseVector to a coarse DenseVector. Values are interpolated linearly.
+     * The coarse nodes must be on the process of their fine nodes, use the version with the coarse distribution otherwise.
      *
      * @param[in] input
      * @param[in] fineToCoarse
@@ -96,8 +150,15 @@ public:
      */
     static DenseVector<ValueType> projectToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse);
 
+    /**
+     * @brief Project a fine DenseVector to a coarse DenseVector with the distribution \p coarseDist. Values are interpolated linearly.
+     * Values of fine nodes whose coarse node is on another process are sent to that process.
+     */
+    static DenseVector<ValueType> projectToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::DistributionPtr coarseDist);
+
     /**
      * @brief Project a fine DenseVector to a coarse DenseVector. Values are summed.
+     * The coarse nodes must be on the process of their fine nodes, use the version with the coarse distribution otherwise.
      *
      * @param[in] input
      * @param[in] fineToCoarse
@@ -106,8 +167,15 @@ public:
      */
     static DenseVector<ValueType> sumToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse);
 
+    /**
+     * @brief Project a fine DenseVector to a coarse DenseVector with the distribution \p coarseDist. Values are summed.
+     * Values of fine nodes whose coarse node is on another process are sent to that process.
+     */
+    static DenseVector<ValueType> sumToCoarse(const DenseVector<ValueType>& input, const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::DistributionPtr coarseDist);
+
     /**
      * @brief Compute coarse distribution from fineToCoarse map
+     * The coarse nodes must be on the process of their fine nodes.
      *
      * @param[in] fineToCoarse
      *
@@ -115,6 +183,16 @@ public:
      */
     static scai::dmemo::DistributionPtr projectToCoarse(const DenseVector<IndexType>& fineToCoarse);
 
+    /**
+     * @brief The halo of the coarse nodes of local fine nodes that are stored on other processes.
+     * Used to prolong coarse values to fine nodes after coarsening with settings.crossRankMatchingRounds > 0.
+     * If all coarse nodes are local on all processes, the plan is empty and no further communication is needed.
+     *
+     * @param[in] fineToCoarse
+     * @param[in] coarseDist The distribution of the coarse graph
+     */
+    static HaloExchangePlan coarseNodeHalo(const DenseVector<IndexType>& fineToCoarse, const scai::dmemo::Distribution& coarseDist);
+
     /**
      * @brief Compute a global prefix sum of a block-distributed input
      @attention This works only if \p input is distributed using a block distribution.
@@ -142,9 +220,42 @@ public:
 
 private:
 
-    static IndexType edgeRatingPartner( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched);
+    /**
+     * One V-cycle on this level: coarsen, recursive call, project the coarse partition to this level and refine it.
+     * If \p previous is not empty, only nodes of the same block are contracted and the coarsest level starts with the projection of \p previous.
+     */
+    static DenseVector<IndexType> vCycle(const CSRSparseMatrix<ValueType> &graph, const DenseVector<ValueType> &nodeWeights, const std::vector<DenseVector<ValueType>> &coordinates, const HaloExchangePlan& halo, const DenseVector<IndexType> &previous, Settings settings, Metrics<ValueType>& metrics);
+
+    /**
+     * Match local nodes with neighbors on other processes, both must be candidates.
+     * In every round, every available candidate proposes to its best available non-local neighbor by edge rating,
+     * ties are broken by a hash of the global indices of the endpoints; mutual proposals are matched. The best remaining edge is always
+     * mutual, so every round matches at least one pair until no candidate edges are left.
+     *
+     * @param[in] graph Adjacency matrix, \p halo must contain all non-local neighbors
+     * @param[in] candidates Whether every local node may be matched
+     * @param[in] localBlocks If not empty, the block of every local node; only nodes of the same block are matched
+     * @param[in] rounds Maximum number of proposal rounds, each needs two halo updates
+     *
+     * @return For every local node, the global index of its partner on another process, or -1
+     */
+    static std::vector<IndexType> crossRankMatching(const CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType>& nodeWeights, const HaloExchangePlan& halo, const std::vector<bool>& candidates, const std::vector<IndexType>& localBlocks, const IndexType rounds);
+
+    /**
+     * Add the \p stride values of every entry of \p values to \p localSums at stride times the local index of the corresponding entry of \p indices,
+     * on the process that owns it in \p dist. Collective, returns without communication if all lists are empty.
+     */
+    static void addToOwners(const std::vector<IndexType>& indices, const std::vector<ValueType>& values, const IndexType stride, const scai::dmemo::Distribution& dist, std::vector<ValueType>& localSums);
+
+    /**
+     * The local index in \p coarseDist of each of the \p n global indices in \p fineToCoarse, or invalidIndex if it is not local.
+     * The lookups are done in parallel, so the callers can sum up in a fixed order.
+     */
+    static std::vector<IndexType> localCoarseTargets(const IndexType* fineToCoarse, const IndexType n, const scai::dmemo::Distribution& coarseDist);
+
+    static IndexType edgeRatingPartner( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched, const std::vector<IndexType>& localBlocks);
 
-    static IndexType nnPartner( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched);    
+    static IndexType nnPartner( const IndexType localNode, const scai::hmemo::ReadAccess<IndexType>& ia, const scai::hmemo::ReadAccess<ValueType>& values, const scai::hmemo::ReadAccess<IndexType>& ja, const scai::hmemo::ReadAccess<ValueType>& localNodeWeights, const std::vector<DenseVector<ValueType>>& coordinates, const scai::dmemo::DistributionPtr distPtr, const std::vector<bool>& matched, const std::vector<IndexType>& localBlocks);
 
 }; // class MultiLevel
 } // namespace ITI
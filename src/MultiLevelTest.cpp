@@ -392,4 +392,229 @@ TYPED_TEST (MultiLevelTest, testPixeledCoarsen_2D) {
 
 //---------------------------------------------------------------------------------------
 
+TYPED_TEST (MultiLevelTest, testGreedyGraphGrowing) {
+    using ValueType = TypeParam;
+
+    //a 20x30 grid
+    const IndexType sideX = 20;
+    const IndexType sideY = 30;
+    const IndexType n = sideX*sideY;
+    std::vector<IndexType> ia(1, 0);
+    std::vector<IndexType> ja;
+    for (IndexType x = 0; x < sideX; x++) {
+        for (IndexType y = 0; y < sideY; y++) {
+            if (x > 0) ja.push_back((x-1)*sideY + y);
+            if (y > 0) ja.push_back(x*sideY + y-1);
+            if (y < sideY-1) ja.push_back(x*sideY + y+1);
+            if (x < sideX-1) ja.push_back((x+1)*sideY + y);
+            ia.push_back(ja.size());
+        }
+    }
+    const std::vector<ValueType> values(ja.size(), 1);
+    const std::vector<ValueType> nodeWeights(n, 1);
+    const IndexType k = 5;
+
+    for (IndexType seed : {0, 1, 2}) {
+        const std::vector<IndexType> part = MultiLevel<IndexType, ValueType>::greedyGraphGrowing(ia, ja, values, nodeWeights, k, seed);
+        ASSERT_EQ(part.size(), n);
+
+        std::vector<IndexType> blockSizes(k, 0);
+        IndexType cut = 0;
+        for (IndexType v = 0; v < n; v++) {
+            ASSERT_GE(part[v], 0);
+            ASSERT_LT(part[v], k);
+            blockSizes[part[v]]++;
+            for (IndexType j = ia[v]; j < ia[v+1]; j++) {
+                cut += part[ja[j]] != part[v];
+            }
+        }
+        cut /= 2;
+
+        //every bisection misses its target by at most half a node, for k=5 the errors of up to three levels of bisection add up
+        for (IndexType b = 0; b < k; b++) {
+            EXPECT_NEAR(blockSizes[b], n/k, 2);
+        }
+        //four straight cuts through the short side cost 80 edges
+        EXPECT_LT(cut, 200);
+
+        EXPECT_EQ(part, (MultiLevel<IndexType, ValueType>::greedyGraphGrowing(ia, ja, values, nodeWeights, k, seed)));
+    }
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (MultiLevelTest, testVCyclePartition) {
+    using ValueType = TypeParam;
+
+    const IndexType sideLen = 20;
+    const IndexType dimensions = 3;
+    const IndexType N = std::pow(sideLen, dimensions);
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>( dist, noDistPointer );
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist( graph, coords, maxCoord, numPoints, dimensions );
+    const DenseVector<ValueType> nodeWeights(dist, 1);
+    const ValueType numEdges = graph.getNumValues()/2;
+
+    Settings settings;
+    settings.numBlocks = std::max(IndexType(4), comm->getSize());
+    settings.dimensions = dimensions;
+    settings.epsilon = 0.05;
+    settings.vCycleCoarsestSize = 200;
+
+    std::vector<ValueType> cuts;
+    for (IndexType vCycles : {1, 2}) {
+        for (bool kMeans : {false, true}) {
+            settings.vCycles = vCycles;
+            settings.vCycleKMeans = kMeans;
+            Metrics<ValueType> metrics(settings);
+
+            DenseVector<IndexType> partition = MultiLevel<IndexType, ValueType>::vCyclePartition(graph, nodeWeights, coords, settings, metrics);
+
+            ASSERT_TRUE(partition.getDistributionPtr()->isEqual(*dist));
+            EXPECT_GE(partition.min(), 0);
+            EXPECT_LT(partition.max(), settings.numBlocks);
+            //the refinement moves nodes only into blocks below the balance constraint and out of blocks above it
+            EXPECT_LE(GraphUtils<IndexType, ValueType>::computeImbalance(partition, settings.numBlocks), settings.epsilon + 1e-5);
+
+            //a random partition cuts about (k-1)/k of the edges
+            const ValueType cut = GraphUtils<IndexType, ValueType>::computeCut(graph, partition);
+            EXPECT_LT(cut, 0.1*numEdges);
+            cuts.push_back(cut);
+        }
+    }
+
+    //the second V-cycle starts from the balanced result of the first one, so every move has a positive gain.
+    //Only on a single process are the gains exact, moves of neighbors on other processes in the same sub-round can cancel them.
+    if (comm->getSize() == 1) {
+        EXPECT_LE(cuts[2], cuts[0]);
+        EXPECT_LE(cuts[3], cuts[1]);
+    } else {
+        EXPECT_LE(cuts[2], 1.05*cuts[0]);
+        EXPECT_LE(cuts[3], 1.05*cuts[1]);
+    }
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST (MultiLevelTest, testCrossRankCoarsening) {
+    using ValueType = TypeParam;
+
+    //with a cyclic distribution and a prime side length, all neighbors in the grid are on other processes
+    const IndexType sideLen = 17;
+    const IndexType dimensions = 2;
+    const IndexType N = sideLen*sideLen;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    scai::dmemo::DistributionPtr blockDist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
+    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "CYCLIC", comm, N) );
+    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+
+    CSRSparseMatrix<ValueType> graph = scai::lama::zero<CSRSparseMatrix<ValueType>>( blockDist, noDistPointer );
+    std::vector<ValueType> maxCoord(dimensions, sideLen);
+    std::vector<IndexType> numPoints(dimensions, sideLen);
+    std::vector<DenseVector<ValueType>> coords(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d] = DenseVector<ValueType>(blockDist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist( graph, coords, maxCoord, numPoints, dimensions );
+    graph.redistribute(dist, noDistPointer);
+    for (IndexType d = 0; d < dimensions; d++) {
+        coords[d].redistribute(dist);
+    }
+
+    const DenseVector<ValueType> nodeWeights(dist, 1);
+    const scai::dmemo::HaloExchangePlan halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(graph);
+    const ValueType totalEdgeWeight = graph.l1Norm();
+
+    Settings settings;
+    settings.dimensions = dimensions;
+    std::vector<IndexType> coarseSizes;
+
+    for (IndexType rounds : {0, 3}) {
+        settings.crossRankMatchingRounds = rounds;
+
+        CSRSparseMatrix<ValueType> coarseGraph;
+        DenseVector<IndexType> fineToCoarse;
+        MultiLevel<IndexType, ValueType>::coarsen(graph, nodeWeights, halo, coords, coarseGraph, fineToCoarse, settings);
+        const scai::dmemo::DistributionPtr coarseDist = coarseGraph.getRowDistributionPtr();
+        const IndexType coarseN = coarseGraph.getNumRows();
+        coarseSizes.push_back(coarseN);
+
+        EXPECT_TRUE(coarseGraph.isConsistent());
+        EXPECT_TRUE(coarseGraph.checkSymmetry());
+        EXPECT_EQ(fineToCoarse.min(), 0);
+        EXPECT_EQ(fineToCoarse.max(), coarseN-1);
+
+        //contraction keeps the node and edge weights, the edges inside a pair become self loops
+        const DenseVector<ValueType> coarseWeights = MultiLevel<IndexType, ValueType>::sumToCoarse(nodeWeights, fineToCoarse, coarseDist);
+        ASSERT_TRUE(coarseWeights.getDistributionPtr()->isEqual(*coarseDist));
+        EXPECT_EQ(coarseWeights.sum(), N);
+        EXPECT_GE(coarseWeights.min(), 1);
+        EXPECT_LE(coarseWeights.max(), 2);
+        EXPECT_NEAR(coarseGraph.l1Norm(), totalEdgeWeight, 1e-5*totalEdgeWeight);
+
+        //the interpolated coordinate of a pair is its center
+        const DenseVector<ValueType> coarseX = MultiLevel<IndexType, ValueType>::projectToCoarse(coords[0], fineToCoarse, coarseDist);
+        const ValueType sumX = coords[0].sum();
+        EXPECT_NEAR(coarseX.dotProduct(coarseWeights), sumX, 1e-5*sumX);
+
+        //every fine node gets back the index of its coarse node
+        DenseVector<IndexType> coarseIndices(coarseDist, 0);
+        {
+            scai::hmemo::WriteAccess<IndexType> wIndices(coarseIndices.getLocalValues());
+            for (IndexType i = 0; i < coarseDist->getLocalSize(); i++) {
+                wIndices[i] = coarseDist->local2Global(i);
+            }
+        }
+        const scai::dmemo::HaloExchangePlan coarseNodes = MultiLevel<IndexType, ValueType>::coarseNodeHalo(fineToCoarse, *coarseDist);
+        scai::hmemo::HArray<IndexType> haloIndices;
+        coarseNodes.updateHalo(haloIndices, coarseIndices.getLocalValues(), *comm);
+        {
+            scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+            scai::hmemo::ReadAccess<IndexType> rHaloIndices(haloIndices);
+            for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+                const IndexType coarseNode = rFineToCoarse[i];
+                if (!coarseDist->isLocal(coarseNode)) {
+                    EXPECT_GT(rounds, 0);
+                    EXPECT_EQ(rHaloIndices[coarseNodes.global2Halo(coarseNode)], coarseNode);
+                }
+            }
+        }
+    }
+
+    if (comm->getSize() == 1) {
+        EXPECT_EQ(coarseSizes[0], coarseSizes[1]);
+    } else if (comm->getSize() != sideLen) {
+        //without cross-rank matching, no edge of the grid can be contracted
+        EXPECT_EQ(coarseSizes[0], N);
+        EXPECT_LT(coarseSizes[1], 0.8*N);
+    }
+
+    //the V-cycle keeps working when the coarse nodes move to other processes
+    settings.numBlocks = 4;
+    settings.epsilon = 0.05;
+    settings.vCycleCoarsestSize = 50;
+    settings.crossRankMatchingRounds = 3;
+    for (IndexType vCycles : {1, 2}) {
+        settings.vCycles = vCycles;
+        Metrics<ValueType> metrics(settings);
+        DenseVector<IndexType> partition = MultiLevel<IndexType, ValueType>::vCyclePartition(graph, nodeWeights, coords, settings, metrics);
+
+        ASSERT_TRUE(partition.getDistributionPtr()->isEqual(*dist));
+        EXPECT_GE(partition.min(), 0);
+        EXPECT_LT(partition.max(), settings.numBlocks);
+        EXPECT_LE(GraphUtils<IndexType, ValueType>::computeImbalance(partition, settings.numBlocks), 2*settings.epsilon);
+        EXPECT_LT(GraphUtils<IndexType, ValueType>::computeCut(graph, partition), 0.2*graph.getNumValues()/2);
+    }
+}
+//---------------------------------------------------------------------------------------
+
 } // namespace ITI
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <omp.h>
+
+#include "Settings.h"
+
+namespace ITI {
+
+/** @brief Sets the number of OpenMP threads for its lifetime and restores the previous value afterwards.
+
+Used by the entry points of the library for Settings::numThreads, so that calling the library does not change
+the OpenMP setting of the caller. A value of 0 leaves the number of threads unchanged.
+*/
+class OmpThreadsScope {
+public:
+    OmpThreadsScope(const IndexType numThreads) : previous(omp_get_max_threads()) {
+        if (numThreads > 0) {
+            omp_set_num_threads(numThreads);
+        }
+    }
+
+    ~OmpThreadsScope() {
+        omp_set_num_threads(previous);
+    }
+
+    OmpThreadsScope(const OmpThreadsScope&) = delete;
+    OmpThreadsScope& operator=(const OmpThreadsScope&) = delete;
+
+private:
+    const int previous;
+};
+
+} /* namespace ITI */
@@ -21,6 +21,7 @@
 #include <set>
 #include <iostream>
 #include <iomanip>
+#include <omp.h>
 
 #include <scai/tracing.hpp>
 
@@ -33,6 +34,8 @@
 #include "MultiSection.h"
 #include "GraphUtils.h"
 #include "Mapping.h"
+#include "Telemetry.h"
+#include "OmpThreadsScope.h"
 
 #if PARMETIS_FOUND
 #include "Wrappers.h"
@@ -269,6 +272,10 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::partitionGraph(
     const IndexType dimensions = coordinates.size();
 
     SCAI_REGION( "ParcoRepart.partitionGraph" )
+    Telemetry::ScopedTimer telemetryTimer("partitionGraph");
+
+    //number of threads used by the local kernels of this process, the caller's setting is restored on return
+    const OmpThreadsScope threadsScope( settings.numThreads );
 
     std::chrono::time_point<std::chrono::steady_clock> startTime = std::chrono::steady_clock::now();
 
@@ -374,6 +381,7 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::initialPartition(
     Metrics<ValueType>& metrics){
     
 	SCAI_REGION( "ParcoRepart.initialPartition" )
+	Telemetry::ScopedTimer telemetryTimer("initialPartition");
 
 	const IndexType k = settings.numBlocks;
 	std::chrono::time_point<std::chrono::steady_clock> beforeInitPart =  std::chrono::steady_clock::now();
@@ -383,7 +391,11 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::initialPartition(
 
     if( settings.initialPartition==ITI::Tool::geoSFC) {
         PRINT0("Initial partition with SFCs");
-        result= HilbertCurve<IndexType, ValueType>::computePartition(coordinates, settings);
+        if (nodeWeights.empty()) {
+            result= HilbertCurve<IndexType, ValueType>::computePartition(coordinates, settings);
+        } else {
+            result= HilbertCurve<IndexType, ValueType>::computePartition(coordinates, nodeWeights[0], settings);
+        }
         std::chrono::duration<double> sfcTime = std::chrono::steady_clock::now() - beforeInitPart;
         if ( settings.verbose ) {
             ValueType totSFCTime = ValueType(comm->max(sfcTime.count()) );
@@ -434,7 +446,7 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::initialPartition(
         std::chrono::time_point<std::chrono::steady_clock> beforeKMeans =  std::chrono::steady_clock::now();
 
         if (settings.repartition) {
-            result = ITI::KMeans<IndexType,ValueType>::computeRepartition(coordinateCopy, nodeWeightCopy, blockSizes, previous, settings);
+            result = ITI::KMeans<IndexType,ValueType>::computeRepartition(coordinateCopy, nodeWeightCopy, blockSizes, previous, settings, metrics);
         } else if (settings.initialPartition == ITI::Tool::geoKmeans) {
             result = ITI::KMeans<IndexType,ValueType>::computePartition(coordinateCopy, nodeWeightCopy, blockSizes, settings, metrics);
         } else if (settings.initialPartition == ITI::Tool::geoHierKM or settings.initialPartition == ITI::Tool::geoHierRepart) {
@@ -490,6 +502,36 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::initialPartition(
             if(comm->getRank() == 0)
                 std::cout << "MS Time:" << totMsTime << std::endl;
         }
+    } else if (settings.initialPartition == ITI::Tool::geoSpectral) {
+        PRINT0("Initial partition with the spectral embedding");
+        if (nodeWeights.size() > 1) {
+            throw std::logic_error("Spectral partitioning not yet implemented for multiple weights.");
+        }
+
+        const DenseVector<ValueType> weights = nodeWeights.empty() ? fill<DenseVector<ValueType>>(input.getRowDistributionPtr(), 1) : nodeWeights[0];
+        result = SpectralPartition<IndexType, ValueType>::getPartition(input, weights, settings, metrics);
+        std::chrono::duration<double> spectralTime = std::chrono::steady_clock::now() - beforeInitPart;
+
+        if ( settings.verbose ) {
+            ValueType totSpectralTime = ValueType ( comm->max(spectralTime.count()) );
+            if(comm->getRank() == 0)
+                std::cout << "Spectral Time:" << totSpectralTime << std::endl;
+        }
+    } else if (settings.initialPartition == ITI::Tool::geoVCycle) {
+        PRINT0("Initial partition with multilevel V-cycles");
+        if (nodeWeights.size() > 1) {
+            throw std::logic_error("V-cycle partitioning not yet implemented for multiple weights.");
+        }
+
+        const DenseVector<ValueType> weights = nodeWeights.empty() ? fill<DenseVector<ValueType>>(input.getRowDistributionPtr(), 1) : nodeWeights[0];
+        result = MultiLevel<IndexType, ValueType>::vCyclePartition(input, weights, coordinates, settings, metrics);
+        std::chrono::duration<double> vCycleTime = std::chrono::steady_clock::now() - beforeInitPart;
+
+        if ( settings.verbose ) {
+            ValueType totVCycleTime = ValueType ( comm->max(vCycleTime.count()) );
+            if(comm->getRank() == 0)
+                std::cout << "V-cycle Time:" << totVCycleTime << std::endl;
+        }
     } else if (settings.initialPartition == ITI::Tool::none) {
         //no need to explicitly check for repartitioning mode or not.
         assert(comm->getSize() == settings.numBlocks);
@@ -525,7 +567,8 @@ void ParcoRepart<IndexType, ValueType>::doLocalRefinement(
     Settings settings,
 	Metrics<ValueType>& metrics){
 
-	SCAI_REGION("ParcoRepart.doLocalRefinement");		
+	SCAI_REGION("ParcoRepart.doLocalRefinement");
+	Telemetry::ScopedTimer telemetryTimer("localRefinement");
 	
 	//uncomment to store the first, geometric partition into a file that then can be visualized using matlab and GPI's code
 	//std::string filename = "geomPart.mtx";
@@ -635,8 +678,6 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::pixelPartition(const s
     SCAI_REGION( "ParcoRepart.pixelPartition" )
 
     SCAI_REGION_START("ParcoRepart.pixelPartition.initialise")
-    std::chrono::time_point<std::chrono::steady_clock> start, round;
-    start = std::chrono::steady_clock::now();
 
     const scai::dmemo::DistributionPtr coordDist = coordinates[0].getDistributionPtr();
     const scai::dmemo::CommunicatorPtr comm = coordDist->getCommunicatorPtr();
@@ -649,14 +690,14 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::pixelPartition(const s
     if (k != comm->getSize() && comm->getRank() == 0) {
         throw std::logic_error("Pixel partition only implemented for same number of blocks and processes.");
     }
+    if (dimensions != 2 and dimensions != 3) {
+        throw std::runtime_error("Available only for 2D and 3D. Data given have dimension:" + std::to_string(dimensions) );
+    }
 
     std::vector<ValueType> minCoords(dimensions, std::numeric_limits<ValueType>::max());
     std::vector<ValueType> maxCoords(dimensions, std::numeric_limits<ValueType>::lowest());
     DenseVector<IndexType> result(coordDist, 0);
 
-    //TODO: probably minimum is not needed
-    //TODO: if we know maximum from the input we could save that although is not too costly
-
     /*
      * get minimum / maximum of local coordinates
      */
@@ -678,302 +719,461 @@ DenseVector<IndexType> ParcoRepart<IndexType, ValueType>::pixelPartition(const s
         maxCoords[dim] = comm->max(maxCoords[dim]);
     }
 
-    // measure density with rounding
-    // have to handle 2D and 3D cases seperately
-    const IndexType sideLen = settings.pixeledSideLen;
-    const IndexType cubeSize = std::pow(sideLen, dimensions);
-
-    //TODO: generalize this to arbitrary dimensions, do not handle 2D and 3D differently
-    //TODO: by a  for(int d=0; d<dimension; d++){ ... }
-    // a 2D or 3D arrays as a one dimensional vector
-    // [i][j] is in position: i*sideLen + j
-    // [i][j][k] is in: i*sideLen*sideLen + j*sideLen + k
+    // Only the non-empty pixels are stored, keyed by the Morton code of their position in the grid.
+    // Memory and communication depend on the number of occupied pixels, not on sideLen^dimensions.
+    IndexType sideLen = settings.pixeledSideLen;
+    IndexType bitsPerDim = 0;
+    while ((1ul << bitsPerDim) < (unsigned long) sideLen) {
+        bitsPerDim++;
+    }
+    SCAI_ASSERT_LE_ERROR( bitsPerDim*dimensions, IndexType(8*sizeof(unsigned long)), "Side length " << sideLen << " is too large for " << dimensions << " dimensions" );
 
-    //std::vector<IndexType> density( cubeSize ,0);
-    scai::hmemo::HArray<IndexType> density( cubeSize, IndexType(0) );
-    scai::hmemo::WriteAccess<IndexType> wDensity(density);
+    //the +1 is needed
+    std::vector<IndexType> maxScaled(dimensions);
+    for (IndexType dim = 0; dim < dimensions; dim++) {
+        maxScaled[dim] = maxCoords[dim]+1;
+    }
 
     SCAI_REGION_END("ParcoRepart.pixelPartition.initialise")
 
-    if(dimensions==2) {
+    std::vector<unsigned long> pointKeys(localN);
+    {
         SCAI_REGION( "ParcoRepart.pixelPartition.localDensity" )
-        scai::hmemo::ReadAccess<ValueType> coordAccess0( coordinates[0].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess1( coordinates[1].getLocalValues() );
-
-        IndexType scaledX, scaledY;
-        //the +1 is needed
-        IndexType maxX = maxCoords[0]+1;
-        IndexType maxY = maxCoords[1]+1;
-
-        for(IndexType i=0; i<localN; i++) {
-            scaledX = coordAccess0[i]/maxX * sideLen;
-            scaledY = coordAccess1[i]/maxY * sideLen;
-            IndexType pixelInd = scaledX*sideLen + scaledY;
-            SCAI_ASSERT( pixelInd < wDensity.size(), "Index too big: "<< std::to_string(pixelInd) );
-            ++wDensity[pixelInd];
+        std::vector<scai::hmemo::ReadAccess<ValueType>> rCoords;
+        rCoords.reserve(dimensions);
+        for (IndexType dim = 0; dim < dimensions; dim++) {
+            rCoords.emplace_back( coordinates[dim].getLocalValues() );
         }
-    } else if(dimensions==3) {
-        SCAI_REGION( "ParcoRepart.pixelPartition.localDensity" )
-        scai::hmemo::ReadAccess<ValueType> coordAccess0( coordinates[0].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess1( coordinates[1].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess2( coordinates[2].getLocalValues() );
-
-        IndexType scaledX, scaledY, scaledZ;
 
-        IndexType maxX = maxCoords[0]+1;
-        IndexType maxY = maxCoords[1]+1;
-        IndexType maxZ = maxCoords[2]+1;
-
-        for(IndexType i=0; i<localN; i++) {
-            scaledX = coordAccess0[i]/maxX * sideLen;
-            scaledY = coordAccess1[i]/maxY * sideLen;
-            scaledZ = coordAccess2[i]/maxZ * sideLen;
-            IndexType pixelInd = scaledX*sideLen*sideLen + scaledY*sideLen + scaledZ;
-
-            SCAI_ASSERT( pixelInd < wDensity.size(), "Index too big: "<< std::to_string(pixelInd) );
-            ++wDensity[pixelInd];
+        std::vector<IndexType> pixelCoords(dimensions);
+        for (IndexType i = 0; i < localN; i++) {
+            for (IndexType dim = 0; dim < dimensions; dim++) {
+                const IndexType scaled = rCoords[dim][i]/maxScaled[dim] * sideLen;
+                pixelCoords[dim] = std::min(std::max(scaled, IndexType(0)), sideLen-1);
+            }
+            pointKeys[i] = pixelKey( pixelCoords, bitsPerDim );
         }
-    } else {
-        throw std::runtime_error("Available only for 2D and 3D. Data given have dimension:" + std::to_string(dimensions) );
     }
-    wDensity.release();
 
-    // sum density from all PEs
+    // count the points of every local pixel
+    std::vector<std::pair<unsigned long, IndexType>> localDensity;
     {
-        SCAI_REGION( "ParcoRepart.pixelPartition.sumDensity" )
-        comm->sumArray( density );
+        std::vector<unsigned long> sortedKeys(pointKeys);
+        std::sort( sortedKeys.begin(), sortedKeys.end() );
+        for (IndexType i = 0; i < localN; i++) {
+            if (i > 0 and sortedKeys[i] == sortedKeys[i-1]) {
+                localDensity.back().second++;
+            } else {
+                localDensity.push_back( std::make_pair(sortedKeys[i], IndexType(1)) );
+            }
+        }
     }
 
-    //TODO: is that needed? we just can overwrite density array.
-    // use the summed density as a Dense vector
-    scai::lama::DenseVector<IndexType> sumDensity( density );
+    // sum density from all PEs; the grid is coarsened until the non-empty pixels fit into the memory of the local points
+    const IndexType maxPixels = std::max( globalN/comm->getSize(), IndexType(1024) );
+    IndexType levels = 0;
+    std::vector<std::pair<unsigned long, IndexType>> density = sumSparseDensity( localDensity, dimensions, bitsPerDim, maxPixels, comm, levels );
+    const IndexType numPixels = density.size();
+    if (levels > 0) {
+        bitsPerDim -= levels;
+        sideLen = ((sideLen-1) >> levels) + 1;
+        for (unsigned long& key : pointKeys) {
+            key >>= levels*dimensions;
+        }
+        if (settings.verbose) {
+            PRINT0("more than " << maxPixels << " non-empty pixels, coarsened the grid to side length " << sideLen);
+        }
+    }
+
+    // the pixels are numbered by their position in density, sorted by key
+    std::vector<unsigned long> pixelKeys(numPixels);
+    std::vector<IndexType> localSumDens(numPixels);
+    for (IndexType p = 0; p < numPixels; p++) {
+        pixelKeys[p] = density[p].first;
+        localSumDens[p] = density[p].second;
+    }
+    const std::vector<IndexType> pixelSums(localSumDens);
+
+    auto findPixel = [&pixelKeys](const unsigned long key) {
+        auto it = std::lower_bound( pixelKeys.begin(), pixelKeys.end(), key );
+        return (it != pixelKeys.end() and *it == key) ? IndexType(it - pixelKeys.begin()) : IndexType(-1);
+    };
+
+    // the non-empty pixels that share a face with pixel p
+    auto neighbours = [&](const IndexType p) {
+        std::vector<IndexType> ngbrs;
+        std::vector<IndexType> pixelCoords = pixelPosition( pixelKeys[p], dimensions, bitsPerDim );
+        for (IndexType dim = 0; dim < dimensions; dim++) {
+            for (IndexType step : {-1, 1}) {
+                pixelCoords[dim] += step;
+                if (pixelCoords[dim] >= 0 and pixelCoords[dim] < sideLen) {
+                    const IndexType ngbr = findPixel( pixelKey(pixelCoords, bitsPerDim) );
+                    if (ngbr >= 0) {
+                        ngbrs.push_back(ngbr);
+                    }
+                }
+                pixelCoords[dim] -= step;
+            }
+        }
+        return ngbrs;
+    };
+
+    auto pixelDistance = [&](const IndexType p1, const IndexType p2) {
+        const std::vector<IndexType> coords1 = pixelPosition( pixelKeys[p1], dimensions, bitsPerDim );
+        const std::vector<IndexType> coords2 = pixelPosition( pixelKeys[p2], dimensions, bitsPerDim );
+        ValueType sqDist = 0;
+        for (IndexType dim = 0; dim < dimensions; dim++) {
+            sqDist += std::pow( coords1[dim]-coords2[dim], 2 );
+        }
+        return std::sqrt(sqDist);
+    };
 
     //
     //using the summed density get an initial pixeled partition
 
-    std::vector<IndexType> pixeledPartition( density.size(), -1);
+    std::vector<IndexType> pixeledPartition( numPixels, -1);
 
     IndexType pointsLeft= globalN;
-    IndexType pixelsLeft= cubeSize;
+    IndexType pixelsLeft= numPixels;
     IndexType maxBlockSize = globalN/k * 1.02; // allowing some imbalance
+    const IndexType optBlockSize = globalN/k;
     PRINT0("max allowed block size: " << maxBlockSize );
+    if (settings.verbose) {
+        PRINT0("non-empty pixels: " << numPixels );
+    }
     IndexType thisBlockSize;
+    std::vector<IndexType> blockSizes(k, 0);
+
+    // the pixels by decreasing density; the densest free pixel is the next seed
+    std::vector<IndexType> byDensity(numPixels);
+    std::iota(byDensity.begin(), byDensity.end(), 0);
+    std::stable_sort(byDensity.begin(), byDensity.end(), [&pixelSums](IndexType p1, IndexType p2) {
+        return pixelSums[p1] > pixelSums[p2];
+    });
+    IndexType densestFree = 0;
+    auto nextSeed = [&]() {
+        while (densestFree < numPixels and localSumDens[byDensity[densestFree]] == -1) {
+            densestFree++;
+        }
+        return densestFree < numPixels ? byDensity[densestFree] : IndexType(-1);
+    };
 
     //for all the blocks
     for(IndexType block=0; block<k; block++) {
         SCAI_REGION( "ParcoRepart.pixelPartition.localPixelGrowing")
 
-        ValueType averagePointsPerPixel = ValueType(pointsLeft)/pixelsLeft;
+        ValueType averagePointsPerPixel = ValueType(pointsLeft)/std::max(pixelsLeft, IndexType(1));
         // a factor to force the block to spread more
         ValueType spreadFactor;
         // make a block spread towards the borders (and corners) of our input space
         ValueType geomSpread;
-        // to measure the distance from the first, center pixel
-        ValueType pixelDistance;
 
         // start from the densest pixel
-        //IndexType maxDensityPixel = std::distance( sumDensity.begin(), std::max_element(sumDensity.begin(), sumDensity.end()) );
-
-        //TODO: sumDensity is local/not distributed. No need for that, just to avoid getValue.
-        scai::hmemo::WriteAccess<IndexType> localSumDens( sumDensity.getLocalValues() );
-
-        //TODO: bad way to do that. linear time for every block. maybe sort or use a priority queue
-        IndexType maxDensityPixel=-1;
-        IndexType maxDensity=-1;
-        for(IndexType ii=0; ii<sumDensity.size(); ii++) {
-            if(localSumDens[ii]>maxDensity) {
-                maxDensityPixel = ii;
-                maxDensity= localSumDens[ii];
-            }
-        }
+        IndexType seedPixel = nextSeed();
 
-        if(maxDensityPixel<0) {
+        if(seedPixel<0) {
             PRINT0("Max density pixel id = -1. Should not happen(?) or pixels are finished. For block "<< block<< " and k= " << k);
             break;
         }
 
-        SCAI_ASSERT(maxDensityPixel < sumDensity.size(), "Too big index: " + std::to_string(maxDensityPixel));
-        SCAI_ASSERT(maxDensityPixel >= 0, "Negative index: " + std::to_string(maxDensityPixel));
-        spreadFactor = averagePointsPerPixel/localSumDens[ maxDensityPixel ];
-
+        thisBlockSize = 0;
         //TODO: change to more appropriate data type
-        // insert all the neighbouring pixels
         std::vector<std::pair<IndexType, ValueType>> border;
-        std::vector<IndexType> neighbours = ParcoRepart<IndexType, ValueType>::neighbourPixels( maxDensityPixel, sideLen, dimensions);
-
-        // insert in border if not already picked
-        for(IndexType j=0; j<neighbours.size(); j++) {
-            // make sure this neighbour does not belong to another block
-            if(localSumDens[ neighbours[j]] != -1 ) {
-                std::pair<IndexType, ValueType> toInsert;
-                toInsert.first = neighbours[j];
-                SCAI_ASSERT(neighbours[j] < sumDensity.size(), "Too big index: " + std::to_string(neighbours[j]));
-                SCAI_ASSERT(neighbours[j] >= 0, "Negative index: " + std::to_string(neighbours[j]));
-                geomSpread = 1 + 1/std::log2(sideLen)*( std::abs(sideLen/2 - neighbours[j]/sideLen)/(0.8*sideLen/2) + std::abs(sideLen/2 - neighbours[j]%sideLen)/(0.8*sideLen/2) );
-                //PRINT0( geomSpread );
-                // value to pick a border node
-                pixelDistance = aux<IndexType, ValueType>::pixelL2Distance2D( maxDensityPixel, neighbours[j], sideLen);
-                toInsert.second = (1/pixelDistance)* geomSpread * (spreadFactor* (std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[maxDensityPixel], 0.5) );
-                border.push_back(toInsert);
-            }
-        }
-        thisBlockSize = localSumDens[maxDensityPixel];
-
-        pixeledPartition[maxDensityPixel] = block;
-
-        // set this pixel to -1 so it is not picked again
-        localSumDens[maxDensityPixel] = -1;
 
+        // grow around the seed; if the region of the seed is used up, e.g., an island, and the block is still small,
+        // continue at the densest free pixel
+        while (seedPixel >= 0) {
+            spreadFactor = averagePointsPerPixel/localSumDens[ seedPixel ];
+
+            // insert all the neighbouring pixels
+            for(IndexType ngbr : neighbours(seedPixel)) {
+                // make sure this neighbour does not belong to another block
+                if(localSumDens[ngbr] != -1 ) {
+                    const std::vector<IndexType> ngbrPosition = pixelPosition( pixelKeys[ngbr], dimensions, bitsPerDim );
+                    geomSpread = 1 + 1/std::log2(sideLen)*( std::abs(sideLen/2 - ngbrPosition[0])/(0.8*sideLen/2) + std::abs(sideLen/2 - ngbrPosition[1])/(0.8*sideLen/2) );
+                    // value to pick a border node
+                    border.push_back( std::make_pair(ngbr, (1/pixelDistance(seedPixel, ngbr))* geomSpread * (spreadFactor* (std::pow(localSumDens[ngbr], 0.5)) + std::pow(localSumDens[seedPixel], 0.5) )) );
+                }
+            }
+            thisBlockSize += localSumDens[seedPixel];
+            --pixelsLeft;
+            pointsLeft -= localSumDens[seedPixel];
 
-        while(border.size() !=0 ) {     // there are still pixels to check
+            pixeledPartition[seedPixel] = block;
 
-            //TODO: different data type to avoid that
-            // sort border by the value in increasing order
-            std::sort( border.begin(), border.end(),
-            [](const std::pair<IndexType, ValueType> &left, const std::pair<IndexType, ValueType> &right) {
-                return left.second < right.second;
-            });
+            // set this pixel to -1 so it is not picked again
+            localSumDens[seedPixel] = -1;
 
-            std::pair<IndexType, ValueType> bestPixel;
-            IndexType bestIndex=-1;
-            do {
-                bestPixel = border.back();
-                border.pop_back();
-                bestIndex = bestPixel.first;
+            while(border.size() !=0 ) {     // there are still pixels to check
 
-            } while( localSumDens[ bestIndex] +thisBlockSize > maxBlockSize and border.size()>0); // this pixel is too big
+                //TODO: different data type to avoid that
+                // sort border by the value in increasing order
+                std::sort( border.begin(), border.end(),
+                [](const std::pair<IndexType, ValueType> &left, const std::pair<IndexType, ValueType> &right) {
+                    return left.second < right.second;
+                });
 
-            // picked last pixel in border but is too big
-            if(localSumDens[ bestIndex] +thisBlockSize > maxBlockSize ) {
-                break;
-            }
-            SCAI_ASSERT(localSumDens[ bestIndex ] != -1, "Wrong pixel choice.");
+                std::pair<IndexType, ValueType> bestPixel;
+                IndexType bestIndex=-1;
+                do {
+                    bestPixel = border.back();
+                    border.pop_back();
+                    bestIndex = bestPixel.first;
 
-            // this pixel now belongs in this block
-            SCAI_ASSERT(bestIndex < sumDensity.size(), "Wrong pixel index: " + std::to_string(bestIndex));
-            pixeledPartition[ bestIndex ] = block;
-            thisBlockSize += localSumDens[ bestIndex ];
-            --pixelsLeft;
-            pointsLeft -= localSumDens[ bestIndex ];
+                } while( (localSumDens[ bestIndex] == -1 or localSumDens[ bestIndex] +thisBlockSize > maxBlockSize) and border.size()>0); // this pixel is taken or too big
 
-            //averagePointsPerPixel = ValueType(pointsLeft)/pixelsLeft;
-            //spreadFactor = localSumDens[ bestIndex ]/averagePointsPerPixel;
-            //spreadFactor = (k-block)*averagePointsPerPixel/localSumDens[ bestIndex ];
-            spreadFactor = averagePointsPerPixel/localSumDens[ bestIndex ];
+                // picked last pixel in border but is too big
+                if(localSumDens[ bestIndex] == -1 or localSumDens[ bestIndex] +thisBlockSize > maxBlockSize ) {
+                    break;
+                }
 
-            //get the neighbours of the new pixel
-            std::vector<IndexType> neighbours = ParcoRepart<IndexType, ValueType>::neighbourPixels( bestIndex, sideLen, dimensions);
+                // this pixel now belongs in this block
+                pixeledPartition[ bestIndex ] = block;
+                thisBlockSize += localSumDens[ bestIndex ];
+                --pixelsLeft;
+                pointsLeft -= localSumDens[ bestIndex ];
 
-            //insert neighbour in border or update value if already there
-            for(IndexType j=0; j<neighbours.size(); j++) {
+                spreadFactor = averagePointsPerPixel/localSumDens[ bestIndex ];
+                geomSpread = 1;
 
-                SCAI_ASSERT(neighbours[j] < sumDensity.size(), "Too big index: " + std::to_string(neighbours[j]));
-                SCAI_ASSERT(neighbours[j] >= 0, "Negative index: " + std::to_string(neighbours[j]));
+                //insert neighbour in border or update value if already there
+                for(IndexType ngbr : neighbours(bestIndex)) {
 
-                //geomSpread = 1 + 1.0/detailLvl*( std::abs(sideLen/2.0 - neighbours[j]/sideLen)/(0.8*sideLen/2.0) + std::abs(sideLen/2.0 - neighbours[j]%sideLen)/(0.8*sideLen/2.0) );
-                IndexType ngbrX = neighbours[j]/sideLen;
-                IndexType ngbrY = neighbours[j]%sideLen;
+                    if (localSumDens[ngbr] == -1) { // this pixel is already picked by a block (maybe this)
+                        continue;
+                    }
 
-                geomSpread= 1+ (std::pow(ngbrX-sideLen/2, 2) + std::pow(ngbrY-sideLen/2, 2))*(2/std::pow(sideLen,2));
-                //geomSpread = geomSpread * geomSpread;// std::pow(geomSpread, 0.5);
-                //
-                geomSpread = 1;
-                //
+                    const ValueType distToSeed = pixelDistance( seedPixel, ngbr );
+                    const ValueType value = geomSpread*  (1/(distToSeed*distToSeed))* ( spreadFactor *std::pow(localSumDens[ngbr], 0.5) + std::pow(localSumDens[bestIndex], 0.5) );
 
-                if (localSumDens[ neighbours[j]] == -1) { // this pixel is already picked by a block (maybe this)
-                    continue;
-                } else {
                     bool inBorder = false;
-
                     for (IndexType l=0; l<border.size(); l++) {
-                        if( border[l].first == neighbours[j]) { // its already in border, update value
-                            //border[l].second = 1.3*border[l].second + geomSpread * (spreadFactor*(std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[bestIndex], 0.5) );
-                            pixelDistance = aux<IndexType, ValueType>::pixelL2Distance2D( maxDensityPixel, neighbours[j], sideLen);
-                            border[l].second += geomSpread*  (1/(pixelDistance*pixelDistance))* ( spreadFactor *std::pow(localSumDens[neighbours[j]], 0.5) + std::pow(localSumDens[bestIndex], 0.5) );
+                        if( border[l].first == ngbr) { // its already in border, update value
+                            border[l].second += value;
                             inBorder= true;
                         }
                     }
                     if (!inBorder) {
-                        std::pair<IndexType, ValueType> toInsert;
-                        toInsert.first = neighbours[j];
-                        //toInsert.second = geomSpread * (spreadFactor* (std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[bestIndex], 0.5));
-                        pixelDistance = aux<IndexType, ValueType>::pixelL2Distance2D( maxDensityPixel, neighbours[j], sideLen);
-                        //toInsert.second = (1/(pixelDistance*pixelDistance))* geomSpread * (spreadFactor* (std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[bestIndex], 0.5));
-                        toInsert.second = geomSpread*  (1/(pixelDistance*pixelDistance))* ( spreadFactor *(std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[bestIndex], 0.5) );
-                        //toInsert.second = geomSpread * (spreadFactor* (std::pow(localSumDens[neighbours[j]], 0.5)) + std::pow(localSumDens[bestIndex], 0.5))/(std::pow( std::abs( localSumDens[bestIndex] - localSumDens[neighbours[j]]),0.5));
-                        border.push_back(toInsert);
+                        border.push_back( std::make_pair(ngbr, value) );
                     }
                 }
+
+                localSumDens[ bestIndex ] = -1;
             }
 
-            localSumDens[ bestIndex ] = -1;
+            border.clear();
+            seedPixel = -1;
+            if (thisBlockSize < optBlockSize) {
+                const IndexType candidate = nextSeed();
+                if (candidate >= 0 and localSumDens[candidate] + thisBlockSize <= maxBlockSize) {
+                    seedPixel = candidate;
+                }
+            }
         }
-        //PRINT0("##### final blockSize for block "<< block << ": "<< thisBlockSize);
+        blockSizes[block] = thisBlockSize;
     } // for(IndexType block=0; block<k; block++)
 
-    // assign all orphan pixels to last block
-    for(unsigned long int pp=0; pp<pixeledPartition.size(); pp++) {
-        scai::hmemo::ReadAccess<IndexType> localSumDens( sumDensity.getLocalValues() );
-        if(pixeledPartition[pp] == -1) {
-            pixeledPartition[pp] = k-1;
-            thisBlockSize += localSumDens[pp];
+    {
+        SCAI_REGION( "ParcoRepart.pixelPartition.assignOrphans" )
+        // orphan pixels next to a block join the smallest neighbouring block with room left, breadth-first from the blocks
+        std::vector<IndexType> queue;
+        std::vector<bool> queued(numPixels, false);
+        for (IndexType p = 0; p < numPixels; p++) {
+            if (pixeledPartition[p] == -1) {
+                continue;
+            }
+            for (IndexType ngbr : neighbours(p)) {
+                if (pixeledPartition[ngbr] == -1 and !queued[ngbr]) {
+                    queued[ngbr] = true;
+                    queue.push_back(ngbr);
+                }
+            }
+        }
+        for (IndexType q = 0; q < IndexType(queue.size()); q++) {
+            const IndexType p = queue[q];
+            const std::vector<IndexType> ngbrs = neighbours(p);
+            IndexType bestBlock = -1;
+            for (IndexType ngbr : ngbrs) {
+                const IndexType b = pixeledPartition[ngbr];
+                if (b >= 0 and blockSizes[b] + pixelSums[p] <= maxBlockSize and (bestBlock < 0 or blockSizes[b] < blockSizes[bestBlock])) {
+                    bestBlock = b;
+                }
+            }
+            if (bestBlock < 0) {
+                continue;
+            }
+            pixeledPartition[p] = bestBlock;
+            blockSizes[bestBlock] += pixelSums[p];
+            for (IndexType ngbr : ngbrs) {
+                if (pixeledPartition[ngbr] == -1 and !queued[ngbr]) {
+                    queued[ngbr] = true;
+                    queue.push_back(ngbr);
+                }
+            }
+        }
+
+        // the rest, i.e., islands without a block and pixels next to full blocks, go to the least loaded block, densest first
+        for (IndexType p : byDensity) {
+            if (pixeledPartition[p] == -1) {
+                const IndexType b = std::min_element(blockSizes.begin(), blockSizes.end()) - blockSizes.begin();
+                pixeledPartition[p] = b;
+                blockSizes[b] += pixelSums[p];
+            }
         }
     }
-    //PRINT0("##### final blockSize for block "<< k-1 << ": "<< thisBlockSize);
 
     /*
      * here all pixels should have a partition
     */
 
     // set your local part of the partition/result
-    scai::hmemo::WriteOnlyAccess<IndexType> wLocalPart ( result.getLocalValues() );
-
-    if(dimensions==2) {
+    {
         SCAI_REGION( "ParcoRepart.pixelPartition.setLocalPartition" )
-        scai::hmemo::ReadAccess<ValueType> coordAccess0( coordinates[0].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess1( coordinates[1].getLocalValues() );
+        scai::hmemo::WriteOnlyAccess<IndexType> wLocalPart ( result.getLocalValues(), localN );
+        for(IndexType i=0; i<localN; i++) {
+            const IndexType pixel = findPixel( pointKeys[i] );
+            SCAI_ASSERT( pixel >= 0, "Pixel of point " << i << " not found" );
+            wLocalPart[i] = pixeledPartition[pixel];
+            SCAI_ASSERT(wLocalPart[i] < k, " Wrong block number: " + std::to_string(wLocalPart[i] ) );
+        }
+    }
 
-        IndexType scaledX, scaledY;
-        //the +1 is needed
-        IndexType maxX = maxCoords[0]+1;
-        IndexType maxY = maxCoords[1]+1;
+    return result;
+}
+//-----------------------------------------------------------------------------------------
 
-        for(IndexType i=0; i<localN; i++) {
-            scaledX = coordAccess0[i]/maxX * sideLen;
-            scaledY = coordAccess1[i]/maxY * sideLen;
-            IndexType densInd = scaledX*sideLen + scaledY;
-            //PRINT(densInd << " # " << coordAccess0[i] << " _ " << coordAccess1[i] );
-            SCAI_ASSERT( densInd < density.size(), "Index too big: "<< std::to_string(densInd) );
+template<typename IndexType, typename ValueType>
+unsigned long ParcoRepart<IndexType, ValueType>::pixelKey(const std::vector<IndexType>& pixelCoords, const IndexType bitsPerDim) {
+    const IndexType dimensions = pixelCoords.size();
+    unsigned long key = 0;
+    for (IndexType bit = 0; bit < bitsPerDim; bit++) {
+        for (IndexType dim = 0; dim < dimensions; dim++) {
+            key |= ((unsigned long)(pixelCoords[dim] >> bit) & 1ul) << (bit*dimensions + dim);
+        }
+    }
+    return key;
+}
+//-----------------------------------------------------------------------------------------
 
-            wLocalPart[i] = pixeledPartition[densInd];
-            SCAI_ASSERT(wLocalPart[i] < k, " Wrong block number: " + std::to_string(wLocalPart[i] ) );
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> ParcoRepart<IndexType, ValueType>::pixelPosition(const unsigned long key, const IndexType dimensions, const IndexType bitsPerDim) {
+    std::vector<IndexType> pixelCoords(dimensions, 0);
+    for (IndexType bit = 0; bit < bitsPerDim; bit++) {
+        for (IndexType dim = 0; dim < dimensions; dim++) {
+            pixelCoords[dim] |= IndexType((key >> (bit*dimensions + dim)) & 1ul) << bit;
         }
-    } else if(dimensions==3) {
-        SCAI_REGION( "ParcoRepart.pixelPartition.setLocalPartition" )
-        scai::hmemo::ReadAccess<ValueType> coordAccess0( coordinates[0].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess1( coordinates[1].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess2( coordinates[2].getLocalValues() );
+    }
+    return pixelCoords;
+}
+//-----------------------------------------------------------------------------------------
 
-        IndexType scaledX, scaledY, scaledZ;
+template<typename IndexType, typename ValueType>
+std::vector<std::pair<unsigned long, IndexType>> ParcoRepart<IndexType, ValueType>::sumSparseDensity(
+    const std::vector<std::pair<unsigned long, IndexType>>& localDensity,
+    const IndexType dimensions,
+    const IndexType maxLevels,
+    const IndexType maxPixels,
+    const scai::dmemo::CommunicatorPtr comm,
+    IndexType& levels) {
+    SCAI_REGION( "ParcoRepart.sumSparseDensity" )
 
-        IndexType maxX = maxCoords[0]+1;
-        IndexType maxY = maxCoords[1]+1;
-        IndexType maxZ = maxCoords[2]+1;
+    const IndexType numPEs = comm->getSize();
+    const IndexType rank = comm->getRank();
+
+    // add up the counts of equal keys in a sorted vector, in place
+    auto mergeSorted = [](std::vector<std::pair<unsigned long, IndexType>>& density) {
+        IndexType numMerged = 0;
+        for (IndexType i = 0; i < IndexType(density.size()); i++) {
+            if (numMerged > 0 and density[numMerged-1].first == density[i].first) {
+                density[numMerged-1].second += density[i].second;
+            } else {
+                density[numMerged++] = density[i];
+            }
+        }
+        density.resize(numMerged);
+    };
 
-        for(IndexType i=0; i<localN; i++) {
-            scaledX = coordAccess0[i]/maxX * sideLen;
-            scaledY = coordAccess1[i]/maxY * sideLen;
-            scaledZ = coordAccess2[i]/maxZ * sideLen;
-            IndexType densInd = scaledX*sideLen*sideLen + scaledY*sideLen + scaledZ;
+    std::vector<std::pair<unsigned long, IndexType>> sendDensity(localDensity);
+    std::vector<std::pair<unsigned long, IndexType>> ownDensity;
+    IndexType numPixels;
+    levels = 0;
 
-            SCAI_ASSERT( densInd < density.size(), "Index too big: "<< std::to_string(densInd) );
-            wLocalPart[i] = pixeledPartition[densInd];
-            SCAI_ASSERT(wLocalPart[i] < k, " Wrong block number: " + std::to_string(wLocalPart[i] ) );
+    while (true) {
+        const IndexType localSize = sendDensity.size();
+
+        // the counts of every key are added up on PE key%numPEs
+        std::vector<IndexType> quantities(numPEs, 0);
+        for (const std::pair<unsigned long, IndexType>& entry : sendDensity) {
+            quantities[entry.first % numPEs]++;
         }
-    } else {
-        throw std::runtime_error("Available only for 2D and 3D. Data given have dimension:" + std::to_string(dimensions) );
+        std::vector<IndexType> sendPos(numPEs, 0);
+        std::partial_sum(quantities.begin(), quantities.end()-1, sendPos.begin()+1);
+
+        std::vector<unsigned long> sendKeys(localSize);
+        std::vector<IndexType> sendCounts(localSize);
+        for (const std::pair<unsigned long, IndexType>& entry : sendDensity) {
+            const IndexType target = entry.first % numPEs;
+            sendKeys[sendPos[target]] = entry.first;
+            sendCounts[sendPos[target]] = entry.second;
+            sendPos[target]++;
+        }
+
+        scai::dmemo::CommunicationPlan sendPlan(quantities.data(), numPEs);
+        scai::dmemo::CommunicationPlan recvPlan = comm->transpose( sendPlan );
+        const IndexType numRecv = recvPlan.totalQuantity();
+
+        std::vector<unsigned long> recvKeys(numRecv);
+        std::vector<IndexType> recvCounts(numRecv);
+        comm->exchangeByPlan( recvKeys.data(), recvPlan, sendKeys.data(), sendPlan );
+        comm->exchangeByPlan( recvCounts.data(), recvPlan, sendCounts.data(), sendPlan );
+        Telemetry::countCollective( localSize*(sizeof(unsigned long) + sizeof(IndexType)) );
+
+        ownDensity.resize(numRecv);
+        for (IndexType i = 0; i < numRecv; i++) {
+            ownDensity[i] = std::make_pair(recvKeys[i], recvCounts[i]);
+        }
+        std::sort( ownDensity.begin(), ownDensity.end() );
+        mergeSorted( ownDensity );
+
+        numPixels = comm->sum( IndexType(ownDensity.size()) );
+        if (numPixels <= maxPixels or levels >= maxLevels) {
+            break;
+        }
+
+        // too many pixels to replicate: merge 2^dimensions pixels into one and sum again, the own pixels are the new input
+        levels++;
+        for (std::pair<unsigned long, IndexType>& entry : ownDensity) {
+            entry.first >>= dimensions;
+        }
+        std::sort( ownDensity.begin(), ownDensity.end() );
+        mergeSorted( ownDensity );
+        sendDensity.swap( ownDensity );
+    }
+    const IndexType numOwn = ownDensity.size();
+
+    // replicate the summed pixels on all PEs
+    std::vector<IndexType> numPerPE(numPEs, 0);
+    numPerPE[rank] = numOwn;
+    comm->sumImpl( numPerPE.data(), numPerPE.data(), numPEs, scai::common::TypeTraits<IndexType>::stype );
+    std::vector<IndexType> offsets(numPEs+1, 0);
+    std::partial_sum(numPerPE.begin(), numPerPE.end(), offsets.begin()+1);
+    SCAI_ASSERT_EQ_ERROR( offsets.back(), numPixels, "Pixel count mismatch" );
+
+    std::vector<unsigned long> allKeys(numPixels, 0);
+    std::vector<IndexType> allCounts(numPixels, 0);
+    for (IndexType i = 0; i < numOwn; i++) {
+        allKeys[offsets[rank]+i] = ownDensity[i].first;
+        allCounts[offsets[rank]+i] = ownDensity[i].second;
     }
-    wLocalPart.release();
+    comm->sumImpl( allKeys.data(), allKeys.data(), numPixels, scai::common::TypeTraits<unsigned long>::stype );
+    comm->sumImpl( allCounts.data(), allCounts.data(), numPixels, scai::common::TypeTraits<IndexType>::stype );
+    Telemetry::countCollective( numPixels*(sizeof(unsigned long) + sizeof(IndexType)) );
+
+    std::vector<std::pair<unsigned long, IndexType>> result(numPixels);
+    for (IndexType i = 0; i < numPixels; i++) {
+        result[i] = std::make_pair(allKeys[i], allCounts[i]);
+    }
+    std::sort( result.begin(), result.end() );
 
     return result;
 }
@@ -1042,6 +1242,26 @@ std::vector<DenseVector<IndexType>> ParcoRepart<IndexType, ValueType>::getCommun
 }
 //---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> ParcoRepart<IndexType, ValueType>::getCommunicationPartners( const CSRSparseMatrix<ValueType> &peGraph, Settings settings) {
+    SCAI_REGION("ParcoRepart.getCommunicationPartners");
+
+    const scai::dmemo::CommunicatorPtr comm = peGraph.getRowDistributionPtr()->getCommunicatorPtr();
+
+    std::chrono::time_point<std::chrono::steady_clock> beforeColoring =  std::chrono::steady_clock::now();
+
+    IndexType colors;
+    std::vector<IndexType> partners = GraphUtils<IndexType, ValueType>::distributedEdgeColoring( peGraph, colors);
+
+    std::chrono::duration<double> coloringTime = std::chrono::steady_clock::now() - beforeColoring;
+    ValueType maxTime = comm->max( coloringTime.count() );
+    ValueType minTime = comm->min( coloringTime.count() );
+    if (settings.verbose) PRINT0("coloring done in time " << minTime << " -- " << maxTime << ", using " << colors << " colors" );
+
+    return partners;
+}
+//---------------------------------------------------------------------------------------
+
 
 template<typename IndexType, typename ValueType>
 std::vector<IndexType> ParcoRepart<IndexType, ValueType>::neighbourPixels(const IndexType thisPixel, const IndexType sideLen, const IndexType dimension) {
@@ -174,6 +174,12 @@ public:
 
     /**
      * Get an initial partition using the morton curve and measuring density per square.
+     * The grid has settings.pixeledSideLen pixels per dimension; only non-empty pixels are stored,
+     * so the side length is not bounded by the memory for a dense grid. If there are more non-empty pixels
+     * than the average number of local points (at least 1024), the grid is coarsened until they fit, see sumSparseDensity.
+     *
+     * Blocks grow from the densest free pixel; a block that runs out of neighbouring pixels continues at the next densest one.
+     * Pixels left over are given to the smallest neighbouring block with room, or else to the least loaded block.
      */
     static DenseVector<IndexType> pixelPartition(const std::vector<DenseVector<ValueType>> &coordinates, Settings settings);
 
@@ -190,6 +196,16 @@ public:
      */
     static std::vector<DenseVector<IndexType>> getCommunicationPairs_local( CSRSparseMatrix<ValueType> &adjM, Settings settings);
 
+    /** Given the distributed PE graph, returns the communication partners of this process for the
+     *  rounds of the local refinement. Uses GraphUtils::distributedEdgeColoring, the graph is not replicated.
+     *
+     * @param[in] peGraph The PE graph as returned by GraphUtils::getPEGraph.
+     * @return std::vector.size()= number of rounds, the same on all processes.
+     *  return[i] = k : in round i, this process talks with process k, which talks with this process.
+     *  If this process is inactive in round i, return[i] is its own rank.
+     */
+    static std::vector<IndexType> getCommunicationPartners( const CSRSparseMatrix<ValueType> &peGraph, Settings settings);
+
     //private:
 
     /** Finds the IDs of all the neighbors of this pixel.
@@ -203,6 +219,35 @@ public:
 
 private:
 
+    /** The Morton code of a pixel, i.e., the bits of its grid coordinates interleaved. */
+    static unsigned long pixelKey(const std::vector<IndexType>& pixelCoords, const IndexType bitsPerDim);
+
+    /** The grid coordinates of the pixel with the given Morton code; the inverse of pixelKey. */
+    static std::vector<IndexType> pixelPosition(const unsigned long key, const IndexType dimensions, const IndexType bitsPerDim);
+
+    /** Sum the point counts of sparse pixels over all PEs.
+
+    Every pixel is sent to PE key%p, which adds up the counts of the same pixel. While there are more than
+    \p maxPixels summed pixels, the owners merge 2^dimensions pixels into one by dropping the lowest bit of every
+    coordinate and sum again. Only then the summed pixels are replicated, so the memory and communication depend
+    on the number of non-empty pixels, at most \p maxPixels, and not on the size of the grid.
+
+    @param[in] localDensity The local (key, count) pairs, every key at most once.
+    @param[in] dimensions The number of coordinates interleaved in a key.
+    @param[in] maxLevels The maximum number of coarsening steps, i.e., the bits per dimension of the keys.
+    @param[in] maxPixels The maximum number of replicated pixels, unless maxLevels is reached first.
+    @param[in] comm The communicator.
+    @param[out] levels The number of coarsening steps; the returned keys are the input keys shifted by levels*dimensions bits.
+    @return The global (key, count) pairs of all non-empty pixels, sorted by key, the same on all PEs.
+    */
+    static std::vector<std::pair<unsigned long, IndexType>> sumSparseDensity(
+        const std::vector<std::pair<unsigned long, IndexType>>& localDensity,
+        const IndexType dimensions,
+        const IndexType maxLevels,
+        const IndexType maxPixels,
+        const scai::dmemo::CommunicatorPtr comm,
+        IndexType& levels);
+
     /** The initial (geometric) partition of a graph. 
 
     Attention, for metis, and methods using the multilevel approach, the term 'initial partition' usually refers to the first
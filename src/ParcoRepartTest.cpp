@@ -108,6 +108,82 @@ TYPED_TEST(ParcoRepartTest, testInitialPartition) {
 }
 //---------------------------------------------------------------------------------------
 
+TYPED_TEST(ParcoRepartTest, testPixelPartitionFineGrid) {
+    using ValueType = TypeParam;
+
+    std::string file = ParcoRepartTest<ValueType>::graphPath + "bigtrace-00000.graph";
+    std::ifstream f(file);
+    const IndexType dimensions = 2;
+    IndexType N, edges;
+    f >> N >> edges;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType k = comm->getSize();
+
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions);
+
+    Settings settings;
+    settings.numBlocks = k;
+    settings.dimensions = dimensions;
+    // a dense grid would have 2^32 pixels, far more than points
+    settings.pixeledSideLen = 1 << 16;
+
+    DenseVector<IndexType> partition = ParcoRepart<IndexType, ValueType>::pixelPartition(coords, settings);
+
+    EXPECT_EQ( N, partition.size() );
+    EXPECT_GE( partition.min(), 0 );
+    EXPECT_LE( partition.max(), k-1 );
+    EXPECT_TRUE( partition.getDistributionPtr()->isEqual(*coords[0].getDistributionPtr()) );
+}
+//---------------------------------------------------------------------------------------
+
+TYPED_TEST(ParcoRepartTest, testPixelPartitionIslands) {
+    using ValueType = TypeParam;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType k = comm->getSize();
+    const IndexType dimensions = 2;
+
+    // islands of different sizes in an almost empty square, every island is a dense lattice of points
+    const std::vector<IndexType> islandSides = {50, 20, 35, 10, 40, 25, 15};
+    const std::vector<std::pair<ValueType,ValueType>> islandCorners = {{10,10}, {900,50}, {400,700}, {980,980}, {100,600}, {700,400}, {500,100}};
+    std::vector<IndexType> islandOffsets(1, 0);
+    for (IndexType side : islandSides) {
+        islandOffsets.push_back(islandOffsets.back() + side*side);
+    }
+    const IndexType N = islandOffsets.back();
+
+    const scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(N, comm));
+    std::vector<DenseVector<ValueType>> coords(dimensions, DenseVector<ValueType>(dist, 0));
+    {
+        scai::hmemo::WriteAccess<ValueType> wX(coords[0].getLocalValues());
+        scai::hmemo::WriteAccess<ValueType> wY(coords[1].getLocalValues());
+        for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+            const IndexType globalI = dist->local2Global(i);
+            const IndexType island = std::upper_bound(islandOffsets.begin(), islandOffsets.end(), globalI) - islandOffsets.begin() - 1;
+            const IndexType pos = globalI - islandOffsets[island];
+            wX[i] = islandCorners[island].first + ValueType(pos % islandSides[island])/4;
+            wY[i] = islandCorners[island].second + ValueType(pos / islandSides[island])/4;
+        }
+    }
+
+    Settings settings;
+    settings.numBlocks = k;
+    settings.dimensions = dimensions;
+    settings.pixeledSideLen = 1 << 12;
+
+    DenseVector<IndexType> partition = ParcoRepart<IndexType, ValueType>::pixelPartition(coords, settings);
+
+    EXPECT_EQ( N, partition.size() );
+    EXPECT_GE( partition.min(), 0 );
+    EXPECT_LE( partition.max(), k-1 );
+
+    // the blocks jump between islands and the left over pixels are spread, so no block is much larger than N/k
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, k );
+    EXPECT_LE( imbalance, 0.05 );
+}
+//---------------------------------------------------------------------------------------
+
 TYPED_TEST(ParcoRepartTest, testMetisWrapper) {
     using ValueType = TypeParam;
 
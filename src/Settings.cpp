@@ -28,6 +28,12 @@ std::ostream& ITI::operator<<( std::ostream& out, const ITI::Tool tool) {
     case Tool::geoMS:
         token = "geoMS";
         break;
+    case Tool::geoSpectral:
+        token = "geoSpectral";
+        break;
+    case Tool::geoVCycle:
+        token = "geoVCycle";
+        break;
     case Tool::parMetisGraph:
         token = "parMetisGraph";
         break;
@@ -107,6 +113,10 @@ std::istream& ITI::operator>>(std::istream& in, ITI::Tool& tool) {
         tool = ITI::Tool::geoHierRepart;
     else if( token=="geoMS" or tokenLower=="geoms")
         tool = ITI::Tool::geoMS;
+    else if( token=="geoSpectral" or tokenLower=="geospectral")
+        tool = ITI::Tool::geoSpectral;
+    else if( token=="geoVCycle" or tokenLower=="geovcycle")
+        tool = ITI::Tool::geoVCycle;
     else if( token=="parMetisGraph" or tokenLower=="parmetisgraph")
         tool = ITI::Tool::parMetisGraph;
     else if( token=="parMetisGeom" or tokenLower=="parmetisgeom" )
@@ -170,6 +180,14 @@ bool ITI::Settings::checkValidity() {
     if( initialPartition==Tool::unknown or initialPartition==Tool::unknown){
         return false;
     }
+    if( numThreads<0 ){
+        this->isValid = false;
+        return false;
+    }
+    if( streaming and (streamChunkSize<1 or streamPasses<1) ){
+        this->isValid = false;
+        return false;
+    }
 
     return isValid;
 }
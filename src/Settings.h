@@ -13,6 +13,10 @@ namespace ITI {
 
 using scai::IndexType;
 
+#ifdef GEOGRAPHER_64BIT_INDEX
+static_assert(sizeof(IndexType) == 8, "Geographer was configured with USE_64BIT_INDEX, but Lama uses a 32-bit IndexType. Rebuild Lama with SCAI_INDEX_TYPE=long.");
+#endif
+
 /*The size of a point/vertex in the application. This is mainly (only)
 used for the mapping using the CommTree. Every node in the tree has a
 memory variable that indicated the maximum allowed size of this PE or
@@ -109,6 +113,48 @@ inline std::ostream& operator<<(std::ostream& out, Format method) {
 
 //-----------------------------------------------------------------------------------
 
+/** Distributions of the points created by MeshGenerator::createPoints_dist. All points are in the unit cube.
+
+- uniform: uniformly distributed points, every point is placed at random inside its own cell of a regular grid.
+	Only for this distribution an adjacency matrix can be created.
+- gaussian: points around a number of cluster centers, normally distributed in every dimension.
+- ocean: points around some land masses, refined towards the coast like the ADCIRC meshes, see FileIO::readCoordsOcean.
+	The node weight is the number of vertical layers, it grows with the distance from the coast. In 3D, the third coordinate is the depth.
+*/
+enum class PointDistribution {uniform, gaussian, ocean};
+
+/** @brief Operator to read an enum PointDistribution from a stream.
+*/
+inline std::istream& operator>>(std::istream& in, PointDistribution& distribution) {
+    std::string token;
+    in >> token;
+    if (token == "uniform")
+        distribution = ITI::PointDistribution::uniform;
+    else if (token == "gaussian")
+        distribution = ITI::PointDistribution::gaussian;
+    else if (token == "ocean")
+        distribution = ITI::PointDistribution::ocean;
+    else
+        in.setstate(std::ios_base::failbit);
+    return in;
+}
+
+/** @brief Operator to convert an enum PointDistribution to a stream.
+*/
+inline std::ostream& operator<<(std::ostream& out, PointDistribution distribution) {
+    std::string token;
+    if (distribution == ITI::PointDistribution::uniform)
+        token = "uniform";
+    else if (distribution == ITI::PointDistribution::gaussian)
+        token = "gaussian";
+    else if (distribution == ITI::PointDistribution::ocean)
+        token = "ocean";
+    out << token;
+    return out;
+}
+
+//-----------------------------------------------------------------------------------
+
 /** Different tools, i.e., algorithmic approaches, that can be used to partition a input graph, point set or a mesh, i.e., a graph with coordinates.
 	For geographer, typically these are predetermined combinations of the input settings.
 
@@ -119,6 +165,10 @@ inline std::ostream& operator<<(std::ostream& out, Format method) {
 - geoHierRepart First step is same as using geoHierKM but we also do a post-processing repartition step to improve the cut more.
 - geoSFC Partition a point set (no graph is needed) using the hilbert space filling curve.
 - geoMS Partition a point set (no graph is needed) using the MultiSection algorithm.
+- geoSpectral Partition a graph (coordinates are not used) with its spectral embedding: the eigenvectors of the smallest
+	eigenvalues of the Laplacian are computed with LOBPCG and the embedding is split by recursive bisection and balanced k-means.
+- geoVCycle Partition a graph with multilevel V-cycles: the graph is coarsened, the coarsest graph is partitioned with greedy graph growing
+	(or with balanced k-means on the projected coordinates) and the partition is projected back and refined on every level.
 ### The tools below require the external libraries parmetis and zoltan2.
 - parMetisGraph Partition a graph using parmetis
 - parMetisGeom Partition a mesh using a version of parmetis that also uses coordinates for an initial partition.
@@ -128,7 +178,7 @@ inline std::ostream& operator<<(std::ostream& out, Format method) {
 - zoltanMJ Partition a point set (no graph is needed) using the Multijagged algorithm of zoltan2.
 - zoltanMJ Partition a point set (no graph is needed) using the space filling curves algorithm of zoltan2.
 */
-enum class Tool { geographer, geoKmeans, geoHierKM, geoHierRepart, geoSFC, geoMS, parMetisGraph, parMetisGeom, parMetisSFC, parMetisRefine, zoltanRIB, zoltanRCB, zoltanMJ, zoltanSFC, parhipFastMesh, parhipUltraFastMesh, parhipEcoMesh, myAlgo, none, unknown};
+enum class Tool { geographer, geoKmeans, geoHierKM, geoHierRepart, geoSFC, geoMS, geoSpectral, geoVCycle, parMetisGraph, parMetisGeom, parMetisSFC, parMetisRefine, zoltanRIB, zoltanRCB, zoltanMJ, zoltanSFC, parhipFastMesh, parhipUltraFastMesh, parhipEcoMesh, myAlgo, none, unknown};
 
 
 std::istream& operator>>(std::istream& in, ITI::Tool& tool);
@@ -155,6 +205,8 @@ struct Settings {
     IndexType numBlocks = 2; 	///< number of blocks to partition to
     double epsilon = 0.03;		///< maximum allowed imbalance of the output partition
     bool repartition = false; 	///< set to true to respect the initial partition
+    double migrationPenalty = 0;	///< when repartitioning with k-means, the effective distance of a point to all blocks except its current one is multiplied with 1+migrationPenalty
+    double migrationBudget = 0;		///< if > 0, when repartitioning with k-means the migration penalty is doubled until at most this fraction of the points moves
 
     ITI::Tool initialPartition = ITI::Tool::geoKmeans;			///< the tool to use to get the initial partition, \sa Tool
     //static const ITI::Tool initialMigration = ITI::Tool::geoSFC;///< pre-processing step to redistribute/migrate coordinates
@@ -187,6 +239,9 @@ struct Settings {
     IndexType numX = 32;
     IndexType numY = 32;
     IndexType numZ = 1;
+    IndexType numPoints = 0;            ///< number of points to create with --generatePoints, no graph is created unless generateAdjacency is set
+    ITI::PointDistribution pointDistribution = ITI::PointDistribution::uniform; ///< how the created points are distributed, \sa PointDistribution
+    bool generateAdjacency = false;     ///< also create the adjacency matrix of the created points, only for the uniform distribution
     //@}
 
     /** @name Tuning parameters for local refinement
@@ -208,6 +263,7 @@ struct Settings {
     */
     //@{
     IndexType sfcResolution = 9; 			///<tuning parameters for SFC, the resolution depth for the curve
+    bool sfcSort = false;					///< split the curve with a distributed sort instead of splitter selection
     //@}
 
 
@@ -221,10 +277,15 @@ struct Settings {
     double influenceExponent = 0.5;
     double influenceChangeCap = 0.1;
     IndexType balanceIterations = 20;		///< maximum number of iteration to do in order to achieve balance
-    IndexType maxKMeansIterations = 50;		///< maximum number of global k-means iterations
+    IndexType maxKMeansIterations = 50;		///< maximum number of global k-means iterations; repeated rounds on the same sample with adaptiveSampling are not counted
+    bool adaptiveSampling = false;			///< grow the k-means sample only when the centers converged on it, and stop after one full pass if the sample already met the bounds
     bool tightenBounds = false;
     bool freezeBalancedInfluence = false;
     bool erodeInfluence = false;
+    IndexType yinyangGroups = 0;			///< if > 0, group the centers and keep a distance lower bound per group and point (Yinyang k-means)
+    bool centerTree = false;				///< search the closest centers with a k-d tree over the centers of every process; ignored if yinyangGroups > 0
+    bool mixedPrecision = false;			///< run the k-means assignment on a packed single-precision copy of the coordinates, sums stay in ValueType
+    bool validateMixedPrecision = false;	///< with mixedPrecision, also compute the partition with full precision and store the fraction of differently assigned points in the metrics
     //bool manhattanDistance = false;
     std::vector<IndexType> hierLevels; 		///< for hierarchial kMeans, the number of blocks per level
     //@}
@@ -239,6 +300,25 @@ struct Settings {
     IndexType pixeledSideLen = 10;			///< the side length of a uniform grid
     //@}
 
+    /** @name Parameters for the spectral partitioner
+    */
+    //@{
+    IndexType spectralDimensions = 3;		///< number of Laplacian eigenvectors in the spectral embedding
+    double spectralTolerance = 1e-3;		///< LOBPCG stops when all residual norms are below this times an upper bound of the largest eigenvalue
+    IndexType spectralMaxIterations = 200;	///< maximum number of LOBPCG iterations on every level of the hierarchy
+    IndexType spectralCoarsestSize = 1000;	///< the graph is coarsened for the start vectors until it has at most this many nodes
+    bool spectralKMeans = true;				///< improve the recursive bisection of the embedding with balanced k-means
+    //@}
+
+    /** @name Parameters for the multilevel V-cycle
+    */
+    //@{
+    IndexType vCycles = 1;					///< number of V-cycles, the later ones keep the blocks while coarsening and refine the partition again
+    IndexType vCycleCoarsestSize = 2000;	///< coarsening stops at max(vCycleCoarsestSize, 20*numBlocks) nodes or when the graph does not shrink any more
+    IndexType vCycleRefinementRounds = 10;	///< maximum number of greedy refinement rounds on every level
+    bool vCycleKMeans = false;				///< partition the coarsest graph with balanced k-means on the projected coordinates instead of greedy graph growing
+    //@}
+
     /** @name Tuning parameters for multiLevel heuristic
     */
     //@{
@@ -246,6 +326,7 @@ struct Settings {
     IndexType multiLevelRounds = 0;			///< number of multilevel rounds
     IndexType coarseningStepsBetweenRefinement = 3; ///< number of rounds every which we do coarsening
     bool nnCoarsening = false;              ///< when matching vertices, use the nearest neighbor to match (and contract with)
+    IndexType crossRankMatchingRounds = 0;  ///< handshake rounds to match unmatched nodes with neighbors on other processes when coarsening, 0 keeps the matching local; not used by multiLevelStep
     //@}
 
     /** @name Debug and profiling parameters
@@ -265,7 +346,26 @@ struct Settings {
     //calculate expensive performance metrics?
     bool computeDiameter = false;			///< if the diameter should be computed (can be expensive)
     IndexType maxDiameterRounds = 2;		///< max number of rounds to approximate the diameter
-    IndexType maxCGIterations = 500;        ///< max number of iterations of the CG solver in metrics
+    IndexType maxCGIterations = 500;        ///< number of iterations of the CG solver in metrics, it only stops early if the residual is zero
+    //@}
+
+    /** @name Shared-memory parallelism
+    Hybrid mode: the local kernels of every MPI process (k-means assignment, SFC indices,
+    coarsening, local refinement and metrics) are run with OpenMP.
+    */
+    //@{
+    IndexType numThreads = 0;               ///< number of OpenMP threads per MPI process, 1 means pure MPI; 0 leaves the OpenMP runtime setting unchanged
+    //@}
+
+    /** @name Streaming partitioning
+    For point sets larger than the aggregated memory: the binary coordinate file is read in chunks
+    and every chunk is assigned to the k-means centers. Only one chunk per process is in memory.
+    */
+    //@{
+    bool streaming = false;                 ///< partition the coordinate file in chunks without loading it
+    IndexType streamChunkSize = 1048576;    ///< number of points of a chunk, per process
+    IndexType streamSampleSize = 100000;    ///< global number of points sampled to find the initial centers
+    IndexType streamPasses = 5;             ///< maximum number of passes over the file
     //@}
 
     /** @name Various parameters
@@ -307,6 +407,7 @@ struct Settings {
         out<< "minGainForNextRound= " << minGainForNextRound << std::endl;
         out<< "multiLevelRounds= " << multiLevelRounds << std::endl;
         out<< "coarseningStepsBetweenRefinement= "<< coarseningStepsBetweenRefinement << std::endl;
+        out<< "crossRankMatchingRounds= "<< crossRankMatchingRounds << std::endl;
         out<< "parameters used:" <<std::endl;
         if( useDiffusionTieBreaking ) {
             out<< "\tuseDiffusionTieBreaking"  <<std::endl;
@@ -327,11 +428,29 @@ struct Settings {
         if(ITI::to_string(initialPartition).rfind("geoSFC",0)==0 ){
         //if (initialPartition==ITI::Tool::geoSFC) {
             out<< "\tsfcResolution: " << sfcResolution << std::endl;
+            if( sfcSort ) {
+                out<< "\tsplit curve with distributed sort" << std::endl;
+            }
         }
         //else if (initialPartition==ITI::Tool::geoKmeans) {
         else if(ITI::to_string(initialPartition).rfind("geoKmeans",0)==0 ){
             out<< "\tminSamplingNodes: " << minSamplingNodes << std::endl;
             out<< "\tinfluenceExponent: " << influenceExponent << std::endl;
+            if( yinyangGroups>0 ) {
+                out<< "\tyinyangGroups: " << yinyangGroups << std::endl;
+            }
+            else if( centerTree ) {
+                out<< "\tcenter search with k-d tree" << std::endl;
+            }
+            if( repartition and (migrationPenalty>0 or migrationBudget>0) ) {
+                out<< "\tmigrationPenalty: " << migrationPenalty << ", migrationBudget: " << migrationBudget << std::endl;
+            }
+            if( adaptiveSampling ) {
+                out<< "\tadaptive sampling" << std::endl;
+            }
+            if( mixedPrecision ) {
+                out<< "\tmixed precision assignment" << std::endl;
+            }
         }
         else if(ITI::to_string(initialPartition).rfind("geoHier",0)==0 ){
             out<< "\tminSamplingNodes: " << minSamplingNodes << std::endl;
@@ -345,6 +464,16 @@ struct Settings {
         else if(ITI::to_string(initialPartition).rfind("geoMS",0)==0 ){
             out<< "\tbisect: " << bisect << std::endl;
             out<< "\tuseIter "<< useIter << std::endl;
+        }
+        else if(ITI::to_string(initialPartition).rfind("geoSpectral",0)==0 ){
+            out<< "\tspectralDimensions: " << spectralDimensions << ", spectralTolerance: " << spectralTolerance << std::endl;
+            if( spectralKMeans ) {
+                out<< "\tbalanced k-means on the embedding" << std::endl;
+            }
+        }
+        else if(ITI::to_string(initialPartition).rfind("geoVCycle",0)==0 ){
+            out<< "\tvCycles: " << vCycles << ", vCycleCoarsestSize: " << vCycleCoarsestSize << ", vCycleRefinementRounds: " << vCycleRefinementRounds << std::endl;
+            out<< "\tcoarsest partition with " << (vCycleKMeans ? "balanced k-means" : "greedy graph growing") << std::endl;
         } else {
             out<< "initial partition undefined" << std::endl;
         }
@@ -357,6 +486,10 @@ struct Settings {
 
         out << "epsilon= "<< epsilon << std::endl;
         out << "numBlocks= " << numBlocks << std::endl;
+        out << "numThreads= " << numThreads << std::endl;
+        if( streaming ){
+            out << "streaming with chunk size " << streamChunkSize << " and " << streamPasses << " passes" << std::endl;
+        }
     }
 //--------------------------------------------------------------------------------------------
 
@@ -373,9 +506,11 @@ struct Settings {
 
 
 
+/** A pair of vertex IDs, used to sort edge lists with JanusSort.
+*/
 struct int_pair {
-    int32_t first;
-    int32_t second;
+    IndexType first;
+    IndexType second;
     bool operator<(const int_pair& rhs ) const {
         return first < rhs.first || (first == rhs.first && second < rhs.second);
     }
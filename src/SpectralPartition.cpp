@@ -5,312 +5,761 @@
  *      Author: tzovas
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 
 #include "SpectralPartition.h"
 #include "GraphUtils.h"
+#include "MultiLevel.h"
+#include "KMeans.h"
+#include "Telemetry.h"
 
 namespace ITI {
 
+namespace {
+
+/** out[j] = A_j^T v for the first \p numColumns columns of A, local part only. */
+template<typename ValueType>
+void localDots(const ValueType* A, const IndexType numColumns, const ValueType* v, const IndexType localN, double* out) {
+    for (IndexType j = 0; j < numColumns; j++) {
+        const ValueType* column = A + j*localN;
+        double sum = 0;
+        #pragma omp parallel for schedule(static) reduction(+:sum)
+        for (IndexType i = 0; i < localN; i++) {
+            sum += double(column[i])*v[i];
+        }
+        out[j] = sum;
+    }
+}
+
+} // anonymous namespace
+
+//---------------------------------------------------------------------------------------
 
 template<typename IndexType, typename ValueType>
-scai::lama::DenseVector<IndexType> SpectralPartition<IndexType, ValueType>::getPartition(const CSRSparseMatrix<ValueType> &adjM, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings) {
+DenseVector<IndexType> SpectralPartition<IndexType, ValueType>::getPartition(const CSRSparseMatrix<ValueType> &adjM, const DenseVector<ValueType> &nodeWeights, Settings settings, Metrics<ValueType>& metrics) {
     SCAI_REGION( "SpectralPartition.getPartition" )
+    Telemetry::ScopedTimer telemetryTimer("spectralPartition");
 
-    std::chrono::time_point<std::chrono::steady_clock> start, round;
-    start = std::chrono::steady_clock::now();
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
 
-    //const scai::dmemo::DistributionPtr coordDist = coordinates[0].getDistributionPtr();
     const scai::dmemo::DistributionPtr inputDist = adjM.getRowDistributionPtr();
     const scai::dmemo::CommunicatorPtr comm = inputDist->getCommunicatorPtr();
-
-    IndexType k = settings.numBlocks;
-    const IndexType dimensions = coordinates.size();
-    const IndexType localN = inputDist->getLocalSize();
+    const IndexType k = settings.numBlocks;
     const IndexType globalN = inputDist->getGlobalSize();
+    const IndexType localN = inputDist->getLocalSize();
 
-    if (k != comm->getSize() && comm->getRank() == 0) {
-        throw std::logic_error("Spectral partition only implemented for same number of blocks and processes.");
-    }
+    SCAI_ASSERT_ERROR( nodeWeights.getDistributionPtr()->isEqual(*inputDist), "Distribution mismatch of node weights" );
+    SCAI_ASSERT_LE_ERROR( k, globalN, "More blocks than nodes" );
 
-    // get a pixeled-coarsen graph , this is replicated in every PE
-    scai::lama::DenseVector<ValueType> pixelWeights;
-    scai::lama::CSRSparseMatrix<ValueType> pixelGraph = MultiLevel<IndexType, ValueType>::pixeledCoarsen(adjM, coordinates, pixelWeights, settings);
-    SCAI_ASSERT( pixelGraph.getRowDistributionPtr()->isReplicated() == 1, "Pixel graph should (?) be replicated.");
-
-    IndexType numPixels = pixelGraph.getNumRows();
-    SCAI_ASSERT( numPixels == pixelGraph.getNumColumns(), "Wrong pixeled graph.");
-    SCAI_ASSERT( pixelGraph.isConsistent() == 1, "Pixeled graph not consistent.");
-
-    // get the laplacian of the pixeled graph , since the pixeled graph is replicated so should be the laplacian
-    scai::lama::CSRSparseMatrix<ValueType> laplacian = GraphUtils<IndexType, ValueType>::constructLaplacian(pixelGraph);
-    SCAI_ASSERT( laplacian.isConsistent() == 1, "Laplacian graph not consistent.");
-    SCAI_ASSERT( laplacian.getNumRows() == numPixels, "Wrong size of the laplacian.");
-
-    if( !laplacian.getRowDistributionPtr()->isReplicated() ) {
-        // replicate the laplacian
-        scai::dmemo::DistributionPtr pixelNoDistPointer(new scai::dmemo::NoDistribution( numPixels ));
-        laplacian.redistribute( pixelNoDistPointer, pixelNoDistPointer);
-    } else {
-        PRINT0("Laplacian already replicated, no need to redistribute.");
+    if (k == 1) {
+        return DenseVector<IndexType>(inputDist, 0);
     }
 
-    // the fiedler vector corresponding to second smallest eigenvalue
-    scai::lama::DenseVector<ValueType> fiedler;
-    ValueType fiedlerEigenvalue;
+    const IndexType numVectors = std::min(settings.spectralDimensions, globalN-1);
+    std::vector<ValueType> eigenvalues;
+    std::vector<DenseVector<ValueType>> embedding = getSpectralEmbedding(adjM, numVectors, settings, eigenvalues);
 
-    scai::lama::DenseVector<IndexType> permutation;
+    // the eigenvectors have unit length, scale them so that the coordinates do not shrink with the size of the graph
+    const ValueType scaling = std::sqrt(ValueType(globalN));
+    for (IndexType d = 0; d < numVectors; d++) {
+        embedding[d] *= scaling;
+    }
 
-    {
-        SCAI_REGION( "SpectralPartition.getPartition.getFiedlerVectorAndSort" )
-        fiedler= SpectralPartition<IndexType, ValueType>::getFiedlerVector( pixelGraph, fiedlerEigenvalue );
-        SCAI_ASSERT( fiedler.size() == numPixels, "Sizes do not agree.");
-        fiedler.sort(permutation, true);
+    std::chrono::duration<double> embeddingTime = std::chrono::steady_clock::now() - start;
+    metrics.MM["timeSpectralEmbedding"] = comm->max(embeddingTime.count());
+    metrics.MM["spectralFiedlerValue"] = eigenvalues[0];
+    if (settings.verbose) {
+        PRINT0("Spectral embedding with " << numVectors << " eigenvectors, Fiedler value " << eigenvalues[0] << ", time " << metrics.MM["timeSpectralEmbedding"]);
     }
 
-    //TODO(?): a distributed version
-    // since pixelGraph is replicated so is the permutation
-    SCAI_ASSERT( true, permutation.getDistributionPtr()->isReplicated() );
-
-    // TODO: change to localPixelPartition( numPixels, k-1); so that the last part get the remaining pixels (if any)
-    // get local partition of the pixeled graph
-    auto localPixelPartition = scai::lama::fill<DenseVector<IndexType>>( numPixels, -1);
-    IndexType averageBlockSize = globalN/k +1;
-    IndexType serialPixelInd =0;
-
-    for(IndexType block=0; block<k; block++) {
-        IndexType thisBlockSize = 0;
-        // these two vectors should be replicated
-        SCAI_ASSERT( localPixelPartition.getDistributionPtr()->isReplicated() == 1, "Should be (?) replicated.");
-        SCAI_ASSERT( pixelWeights.getDistributionPtr()->isReplicated() == 1, "Should be (?) replicated.");
-
-        scai::hmemo::WriteOnlyAccess<IndexType> wPixelPart( localPixelPartition.getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> rPixelWeights( pixelWeights.getLocalValues() );
-
-        while( thisBlockSize < averageBlockSize) {
-            SCAI_ASSERT( serialPixelInd<permutation.getLocalValues().size(), "Pixel index " << serialPixelInd << " too big.");
-            IndexType pixel= permutation.getLocalValues()[ serialPixelInd ];
-            SCAI_ASSERT( pixel<numPixels, "Wrong pixel value "<< pixel);
-            wPixelPart[ pixel ] = block;
-            thisBlockSize += rPixelWeights[ pixel ];
-            ++serialPixelInd;
-
-            if(serialPixelInd >= numPixels) {
-                if(block != k-1) {
-                    PRINT("Pixels finished but still have blocks that will be empty: current block is "<< block << " and k= "<< k << std::endl << "This should not happen. Exiting...");
-                    return scai::lama::fill<DenseVector<IndexType>>(inputDist, -1);
+    DenseVector<IndexType> result = recursiveBisection(embedding, nodeWeights, k);
+
+    if (settings.spectralKMeans) {
+        // the weighted centers of the bisection blocks are the initial k-means centers
+        std::vector<double> centerSums(k*(numVectors+1), 0);
+        {
+            scai::hmemo::ReadAccess<IndexType> rPart(result.getLocalValues());
+            scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
+            for (IndexType d = 0; d < numVectors; d++) {
+                scai::hmemo::ReadAccess<ValueType> rCoords(embedding[d].getLocalValues());
+                for (IndexType i = 0; i < localN; i++) {
+                    centerSums[rPart[i]*(numVectors+1) + d] += double(rWeights[i])*rCoords[i];
                 }
-                break;
+            }
+            for (IndexType i = 0; i < localN; i++) {
+                centerSums[rPart[i]*(numVectors+1) + numVectors] += rWeights[i];
             }
         }
-        // every block can have size > averageBlockSize but hopefully not much more...
-    }
-
-    {
-        // TODO: for debugging, should remove
-        for(int i=0; i<numPixels; i++) {
-            scai::hmemo::ReadAccess<IndexType> rPixelPart( localPixelPartition.getLocalValues() );
-            int b = rPixelPart[i];
-            SCAI_ASSERT( b>=0, "Wrong pixel partitioning " << b <<" for pixel "<< i);
-            SCAI_ASSERT( b<k, "Wrong pixel partitioning " << b <<" for pixel "<< i);
+        comm->sumImpl(centerSums.data(), centerSums.data(), centerSums.size(), scai::common::TypeTraits<double>::stype);
+
+        std::vector<std::vector<ValueType>> centers(k, std::vector<ValueType>(numVectors, 0));
+        for (IndexType b = 0; b < k; b++) {
+            const double blockWeight = centerSums[b*(numVectors+1) + numVectors];
+            if (blockWeight > 0) {
+                for (IndexType d = 0; d < numVectors; d++) {
+                    centers[b][d] = centerSums[b*(numVectors+1) + d] / blockWeight;
+                }
+            }
         }
-    }
-    //
-    // here, every pixel must belong to a part
-    //
 
-    const unsigned long sideLen = settings.pixeledSideLen;
+        const ValueType weightSum = nodeWeights.sum();
+        const std::vector<std::vector<ValueType>> blockSizes(1, std::vector<ValueType>(k, std::ceil(weightSum/k)));
 
-    //TODO: finding the max is also done in pixeledCoarsen, maybe we can pass max as input parameter there
-    std::vector<ValueType> maxCoords(dimensions, std::numeric_limits<ValueType>::lowest());
+        Settings kMeansSettings = settings;
+        kMeansSettings.dimensions = numVectors;
+        kMeansSettings.repartition = false;
 
-    // get local max
-    for (IndexType dim = 0; dim < dimensions; dim++) {
-        //get local parts of coordinates
-        const scai::hmemo::HArray<ValueType>& localPartOfCoords = coordinates[dim].getLocalValues();
-        for (IndexType i = 0; i < localN; i++) {
-            ValueType coord = localPartOfCoords[i];
-            if (coord > maxCoords[dim]) maxCoords[dim] = coord;
-        }
+        const DenseVector<IndexType> firstLevel(inputDist, 0);
+        result = KMeans<IndexType,ValueType>::computePartition(embedding, {nodeWeights}, blockSizes, firstLevel, {centers}, kMeansSettings, metrics);
     }
-    // communicate to get global  max
-    for (IndexType dim = 0; dim < dimensions; dim++) {
-        maxCoords[dim] = comm->max(maxCoords[dim]);
+
+    return result;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<DenseVector<ValueType>> SpectralPartition<IndexType, ValueType>::getSpectralEmbedding(const CSRSparseMatrix<ValueType>& adjM, const IndexType numVectors, const Settings settings, std::vector<ValueType>& eigenvalues) {
+    SCAI_REGION("SpectralPartition.getSpectralEmbedding");
+
+    const IndexType globalN = adjM.getNumRows();
+    if (adjM.getNumColumns() != globalN) {
+        throw std::runtime_error("Matrix must be square to be an adjacency matrix");
     }
+    SCAI_ASSERT_GT_ERROR( numVectors, 0, "At least one eigenvector is needed" );
+    SCAI_ASSERT_LT_ERROR( numVectors, globalN, "The number of eigenvectors must be smaller than the number of nodes" );
 
-    // set your local part of the partition/result
-    DenseVector<IndexType>  result(inputDist, 0);
+    const scai::dmemo::DistributionPtr dist = adjM.getRowDistributionPtr();
+    const IndexType localN = dist->getLocalSize();
 
-    {
-        scai::hmemo::WriteOnlyAccess<IndexType> wLocalPart ( result.getLocalValues() );
-        scai::hmemo::ReadAccess<IndexType> rPixelPart( localPixelPartition.getLocalValues() );
-
-        scai::hmemo::ReadAccess<ValueType> coordAccess0( coordinates[0].getLocalValues() );
-        scai::hmemo::ReadAccess<ValueType> coordAccess1( coordinates[1].getLocalValues() );
-        // this is faulty, if dimensions=2 coordAccess2 is equal to coordAccess1
-        scai::hmemo::ReadAccess<ValueType> coordAccess2( coordinates[dimensions-1].getLocalValues() );
-
-        for(IndexType i=0; i<localN; i++) {
-            IndexType scaledX = sideLen*coordAccess0[i]/(maxCoords[0]+1);
-            IndexType scaledY = sideLen*coordAccess1[i]/(maxCoords[1]+1);
-            IndexType thisPixel;    // the pixel this node belongs to
-            if(dimensions==3) {
-                IndexType scaledZ = sideLen*coordAccess2[i]/(maxCoords[2]+1);
-                thisPixel = scaledX*sideLen*sideLen + scaledY*sideLen + scaledZ;
-            } else {
-                thisPixel = scaledX*sideLen + scaledY;
-            }
-            SCAI_ASSERT( thisPixel < numPixels, "Index too big: "<< thisPixel );
+    // the node weights only guide the coarsening of the start vectors
+    const DenseVector<ValueType> unitWeights = scai::lama::fill<DenseVector<ValueType>>(dist, 1);
+    const std::vector<ValueType> X = multilevelEigenvectors(adjM, unitWeights, numVectors, settings, eigenvalues);
 
-            // set the block for this node
-            wLocalPart[i] = rPixelPart[ thisPixel ];
-        }
+    std::vector<DenseVector<ValueType>> result(numVectors);
+    for (IndexType c = 0; c < numVectors; c++) {
+        scai::hmemo::HArray<ValueType> column(localN, X.data() + c*localN);
+        result[c] = DenseVector<ValueType>(dist, std::move(column));
     }
 
     return result;
 }
 //---------------------------------------------------------------------------------------
 
-
 template<typename IndexType, typename ValueType>
-scai::lama::DenseVector<ValueType> SpectralPartition<IndexType, ValueType>::getFiedlerVector(const scai::lama::CSRSparseMatrix<ValueType>& adjM, ValueType& eigenvalue ) {
+DenseVector<ValueType> SpectralPartition<IndexType, ValueType>::getFiedlerVector(const CSRSparseMatrix<ValueType>& adjM, ValueType& eigenvalue, const Settings settings) {
     SCAI_REGION("SpectralPartition.getFiedlerVector");
 
-    IndexType globalN= adjM.getNumRows();
-    SCAI_ASSERT_EQ_ERROR( globalN, adjM.getNumColumns(), "Matrix not square, numRows != numColumns");
+    std::vector<ValueType> eigenvalues;
+    std::vector<DenseVector<ValueType>> embedding = getSpectralEmbedding(adjM, 1, settings, eigenvalues);
+    eigenvalue = eigenvalues[0];
 
-    scai::lama::CSRSparseMatrix<ValueType> laplacian = GraphUtils<IndexType, ValueType>::constructLaplacian( adjM );
+    return embedding[0];
+}
+//---------------------------------------------------------------------------------------
 
-    // set u=[ 1+sqrt(n), 1, 1, 1, ... ]
-    ValueType n12 = scai::common::Math::sqrt( ValueType( globalN ));
+template<typename IndexType, typename ValueType>
+DenseVector<IndexType> SpectralPartition<IndexType, ValueType>::recursiveBisection(const std::vector<DenseVector<ValueType>>& embedding, const DenseVector<ValueType>& nodeWeights, const IndexType numBlocks) {
+    SCAI_REGION("SpectralPartition.recursiveBisection");
+
+    const scai::dmemo::DistributionPtr dist = embedding[0].getDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType localN = dist->getLocalSize();
+    const IndexType dim = embedding.size();
+    const scai::common::ScalarType stype = scai::common::TypeTraits<double>::stype;
+
+    // the number of steps to find the split values, every step halves the interval
+    const IndexType bisectionSteps = 50;
+
+    std::vector<std::vector<ValueType>> coords(dim);
+    for (IndexType d = 0; d < dim; d++) {
+        SCAI_ASSERT_ERROR( embedding[d].getDistributionPtr()->isEqual(*dist), "Distribution mismatch in dimension " << d );
+        scai::hmemo::ReadAccess<ValueType> rCoords(embedding[d].getLocalValues());
+        coords[d].assign(rCoords.get(), rCoords.get() + localN);
+    }
+    std::vector<ValueType> weights(localN);
+    {
+        scai::hmemo::ReadAccess<ValueType> rWeights(nodeWeights.getLocalValues());
+        SCAI_ASSERT_EQ_ERROR( rWeights.size(), localN, "Size mismatch of node weights" );
+        std::copy(rWeights.get(), rWeights.get() + localN, weights.begin());
+    }
 
-    auto u = scai::lama::fill<scai::lama::DenseVector<ValueType>>( laplacian.getRowDistributionPtr(), 1);
-    u[0] = n12 + 1;
+    // every part is identified by its first block; numTargetBlocks[b] is the number of blocks
+    // of the part starting at b, or 0 if no part starts at b
+    std::vector<IndexType> localPart(localN, 0);
+    std::vector<IndexType> numTargetBlocks(numBlocks, 0);
+    numTargetBlocks[0] = numBlocks;
+
+    while (true) {
+        std::vector<IndexType> splitParts;
+        for (IndexType b = 0; b < numBlocks; b++) {
+            if (numTargetBlocks[b] > 1) {
+                splitParts.push_back(b);
+            }
+        }
+        if (splitParts.empty()) {
+            break;
+        }
 
-    ValueType alpha= globalN + n12;
+        const IndexType numSplit = splitParts.size();
+        std::vector<IndexType> splitIndex(numBlocks, -1);
+        for (IndexType s = 0; s < numSplit; s++) {
+            splitIndex[splitParts[s]] = s;
+        }
 
-    // set h= L*u/alpha
-    auto h = scai::lama::eval<scai::lama::DenseVector<ValueType>>( laplacian*u );
-    h /= alpha;
+        // weight, weighted sum and weighted sum of squares of every part in every dimension
+        const IndexType stride = 1 + 2*dim;
+        std::vector<double> moments(numSplit*stride, 0);
+        std::vector<double> minValues(numSplit*dim, std::numeric_limits<double>::max());
+        std::vector<double> maxValues(numSplit*dim, std::numeric_limits<double>::lowest());
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType s = splitIndex[localPart[i]];
+            if (s < 0) {
+                continue;
+            }
+            const double w = weights[i];
+            moments[s*stride] += w;
+            for (IndexType d = 0; d < dim; d++) {
+                const double x = coords[d][i];
+                moments[s*stride + 1 + d] += w*x;
+                moments[s*stride + 1 + dim + d] += w*x*x;
+                minValues[s*dim + d] = std::min(minValues[s*dim + d], x);
+                maxValues[s*dim + d] = std::max(maxValues[s*dim + d], x);
+            }
+        }
+        comm->sumImpl(moments.data(), moments.data(), moments.size(), stype);
+        comm->minImpl(minValues.data(), minValues.data(), minValues.size(), stype);
+        comm->maxImpl(maxValues.data(), maxValues.data(), maxValues.size(), stype);
+
+        // split along the dimension with the largest variance, at the target fraction of the weight
+        std::vector<IndexType> splitDim(numSplit, 0);
+        std::vector<double> lower(numSplit), upper(numSplit), target(numSplit);
+        for (IndexType s = 0; s < numSplit; s++) {
+            const double partWeight = moments[s*stride];
+            double maxVariance = -1;
+            for (IndexType d = 0; d < dim and partWeight > 0; d++) {
+                const double mean = moments[s*stride + 1 + d] / partWeight;
+                const double variance = moments[s*stride + 1 + dim + d] / partWeight - mean*mean;
+                if (variance > maxVariance) {
+                    maxVariance = variance;
+                    splitDim[s] = d;
+                }
+            }
+            const IndexType numPartBlocks = numTargetBlocks[splitParts[s]];
+            target[s] = partWeight * (numPartBlocks/2) / numPartBlocks;
+            lower[s] = minValues[s*dim + splitDim[s]];
+            upper[s] = maxValues[s*dim + splitDim[s]];
+        }
 
-    // set v= h - gamma*u/2
-    ValueType gamma= u.dotProduct(h)/ alpha * 0.5;
-    auto v = scai::lama::eval<scai::lama::DenseVector<ValueType>>(h - gamma*u);
+        // after the bisection, the weight below lower is smaller than the target and the weight below upper is not
+        for (IndexType step = 0; step < bisectionSteps; step++) {
+            std::vector<double> weightBelow(numSplit, 0);
+            for (IndexType i = 0; i < localN; i++) {
+                const IndexType s = splitIndex[localPart[i]];
+                if (s >= 0 and coords[splitDim[s]][i] < (lower[s]+upper[s])/2) {
+                    weightBelow[s] += weights[i];
+                }
+            }
+            comm->sumImpl(weightBelow.data(), weightBelow.data(), numSplit, stype);
+
+            for (IndexType s = 0; s < numSplit; s++) {
+                const double middle = (lower[s]+upper[s])/2;
+                if (weightBelow[s] < target[s]) {
+                    lower[s] = middle;
+                } else {
+                    upper[s] = middle;
+                }
+            }
+        }
 
-    scai::lama::DenseVector<ValueType> r(u);
-    r[0]= 0.0;
-    scai::lama::DenseVector<ValueType> s(v);
-    s[0]= 0.0;
-    auto t = scai::lama::fill<scai::lama::DenseVector<ValueType>>( laplacian.getRowDistributionPtr(), 1.0);
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType s = splitIndex[localPart[i]];
+            if (s >= 0 and coords[splitDim[s]][i] >= upper[s]) {
+                localPart[i] += numTargetBlocks[localPart[i]]/2;
+            }
+        }
 
-    scai::lama::DenseVector<ValueType> y;
-    scai::lama::DenseVector<ValueType> diff;
+        for (IndexType s = 0; s < numSplit; s++) {
+            const IndexType firstBlock = splitParts[s];
+            const IndexType numPartBlocks = numTargetBlocks[firstBlock];
+            numTargetBlocks[firstBlock] = numPartBlocks/2;
+            numTargetBlocks[firstBlock + numPartBlocks/2] = numPartBlocks - numPartBlocks/2;
+        }
+    }
 
-    t[0] = 0.0;
-    scai::lama::DenseVector<ValueType> z(t);
+    scai::hmemo::HArray<IndexType> partArray(localN, localPart.data());
+    return DenseVector<IndexType>(dist, std::move(partArray));
+}
+//---------------------------------------------------------------------------------------
 
-    IndexType kmax = 200;        // maximal number of iterations
-    ValueType eps  = 1e-7;       // accuracy for maxNorm
-    ValueType lambda = 0.0;   // the eigenvalue (?) TODO: make sure
+template<typename IndexType, typename ValueType>
+std::vector<ValueType> SpectralPartition<IndexType, ValueType>::multilevelEigenvectors(const CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType>& nodeWeights, const IndexType numVectors, const Settings& settings, std::vector<ValueType>& eigenvalues) {
+    SCAI_REGION("SpectralPartition.multilevelEigenvectors");
+
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const IndexType globalN = dist->getGlobalSize();
+    const IndexType localN = dist->getLocalSize();
+
+    const scai::dmemo::HaloExchangePlan halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(graph);
+
+    std::vector<ValueType> X;
+    bool prolonged = false;
+
+    // the coarsest graph must be large enough for the search space of LOBPCG
+    const IndexType coarsestSize = std::max(settings.spectralCoarsestSize, 4*(numVectors+1));
+    if (globalN > coarsestSize) {
+        CSRSparseMatrix<ValueType> coarseGraph;
+        DenseVector<IndexType> fineToCoarse;
+
+        // no coordinates are needed for the matching by edge rating
+        Settings coarseSettings = settings;
+        coarseSettings.nnCoarsening = false;
+        MultiLevel<IndexType, ValueType>::coarsen(graph, nodeWeights, halo, {}, coarseGraph, fineToCoarse, coarseSettings, 1);
+
+        // without cross-rank matching, the matching is local and stops contracting when the local parts are small
+        const IndexType coarseN = coarseGraph.getNumRows();
+        if (coarseN < 0.9*globalN) {
+            const scai::dmemo::DistributionPtr coarseDist = coarseGraph.getRowDistributionPtr();
+            const DenseVector<ValueType> coarseWeights = MultiLevel<IndexType, ValueType>::sumToCoarse(nodeWeights, fineToCoarse, coarseDist);
+            const std::vector<ValueType> coarseX = multilevelEigenvectors(coarseGraph, coarseWeights, numVectors, settings, eigenvalues);
+
+            // every fine node gets the values of its coarse node, coarse nodes on other processes come from a halo
+            const IndexType coarseLocalN = coarseDist->getLocalSize();
+            const scai::dmemo::HaloExchangePlan coarseNodes = MultiLevel<IndexType, ValueType>::coarseNodeHalo(fineToCoarse, *coarseDist);
+            const IndexType coarseHaloSize = coarseNodes.getHaloSize();
+            std::vector<ValueType> haloX(coarseHaloSize*numVectors);
+            for (IndexType c = 0; c < numVectors; c++) {
+                scai::hmemo::HArray<ValueType> column(coarseLocalN, coarseX.data() + c*coarseLocalN);
+                scai::hmemo::HArray<ValueType> haloColumn;
+                coarseNodes.updateHalo(haloColumn, column, *comm);
+                scai::hmemo::ReadAccess<ValueType> rHaloColumn(haloColumn);
+                std::copy(rHaloColumn.get(), rHaloColumn.get() + coarseHaloSize, haloX.begin() + c*coarseHaloSize);
+            }
 
-    // temporary vector outside of loop for reuse, avoids alloc/dealloc
-    scai::lama::DenseVector<ValueType> res;
-    scai::lama::DenseVector<ValueType> x;
+            scai::hmemo::ReadAccess<IndexType> rFineToCoarse(fineToCoarse.getLocalValues());
+            X.resize(localN*numVectors);
+            for (IndexType i = 0; i < localN; i++) {
+                const IndexType coarseNode = coarseDist->global2Local(rFineToCoarse[i]);
+                for (IndexType c = 0; c < numVectors; c++) {
+                    X[c*localN + i] = coarseNode != scai::invalidIndex ? coarseX[c*coarseLocalN + coarseNode]
+                                      : haloX[c*coarseHaloSize + coarseNodes.global2Halo(rFineToCoarse[i])];
+                }
+            }
+            prolonged = true;
+        }
+    }
 
-    for(IndexType k=0; k<kmax; k++) {
-        // normalize t
-        t = t/t.l2Norm();
+    if (!prolonged) {
+        X.resize(localN*numVectors);
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType globalI = dist->local2Global(i);
+            for (IndexType c = 0; c < numVectors; c++) {
+                X[c*localN + i] = randomEntry(globalI, c);
+            }
+        }
+    }
 
-        y= laplacian*t;
-        y[0] = 0.0;                  // fill element as we actually use L[2:n,2:n]
-        y -= s.dotProduct( t ) * r;
-        y -= r.dotProduct( t ) * s;
+    const LocalLaplacian laplacian = buildLocalLaplacian(graph, halo);
+    const IndexType iterations = lobpcg(laplacian, halo, comm, globalN, X, numVectors, settings, eigenvalues);
 
-        lambda = t.dotProduct( y );
-        diff = y - lambda * t;
-        ValueType  diffNorm = diff.maxNorm();
+    Telemetry::count("lobpcgIterations", iterations);
+    if (settings.verbose) {
+        PRINT0("LOBPCG on " << globalN << " nodes took " << iterations << " iterations, smallest eigenvalue " << eigenvalues[0]);
+    }
 
-        if( diffNorm<eps) {
-            break;
-        }
+    return X;
+}
+//---------------------------------------------------------------------------------------
 
-        //solve
-        //set res
-        res = t - laplacian * z;
-        res += s.dotProduct(z) * r;
-        res += r.dotProduct(z) * s;
-        res[0] = 0.0;
+template<typename IndexType, typename ValueType>
+IndexType SpectralPartition<IndexType, ValueType>::lobpcg(const LocalLaplacian& laplacian, const scai::dmemo::HaloExchangePlan& halo, const scai::dmemo::CommunicatorPtr comm, const IndexType globalN, std::vector<ValueType>& X, const IndexType numVectors, const Settings& settings, std::vector<ValueType>& eigenvalues) {
+    SCAI_REGION("SpectralPartition.lobpcg");
+
+    const IndexType localN = laplacian.localN;
+    const IndexType m = numVectors;
+    SCAI_ASSERT_EQ_ERROR( X.size(), localN*m, "Wrong size of start vectors" );
+
+    // twice the maximum degree is an upper bound for the largest eigenvalue, the residuals are relative to it
+    ValueType maxDegree = 0;
+    std::vector<ValueType> inverseDegree(localN, 1);
+    for (IndexType i = 0; i < localN; i++) {
+        maxDegree = std::max(maxDegree, laplacian.degree[i]);
+        if (laplacian.degree[i] > 0) {
+            inverseDegree[i] = 1 / laplacian.degree[i];
+        }
+    }
+    maxDegree = comm->max(maxDegree);
+    const double residualBound = settings.spectralTolerance * (maxDegree > 0 ? 2*maxDegree : 1);
 
-        scai::lama::DenseVector<ValueType> d(res);
+    std::vector<ValueType> LX(localN*m);
+    std::vector<double> lambda;
+    std::vector<double> C;
 
-        ValueType rOld  = res.dotProduct( res );
-        ValueType rNorm = res.l2Norm();
+    // Rayleigh-Ritz in the span of the start vectors
+    {
+        orthonormalize(X, nullptr, 0, m, m, localN, globalN, comm);
+        applyLaplacian(laplacian, halo, comm, X.data(), m, LX.data());
 
-        IndexType maxIter= 100;
+        std::vector<double> G = gramMatrix(X.data(), LX.data(), m, localN, comm);
+        symmetricEigen(G, m, lambda, C);
 
+        std::vector<ValueType> rotated;
+        combineColumns(X, localN, 0, m, C, m, 0, m, rotated);
+        X.swap(rotated);
+        combineColumns(LX, localN, 0, m, C, m, 0, m, rotated);
+        LX.swap(rotated);
+    }
 
-        for(IndexType kk=0; kk<maxIter and rNorm>eps; kk++) {
-            x = laplacian*d;
+    // the search space is [X, P, W], W are the preconditioned residuals and P the previous search directions
+    std::vector<ValueType> P, LP, R(localN*m), S, LS;
+    IndexType numP = 0;
+    IndexType iteration = 0;
+
+    for (; iteration < settings.spectralMaxIterations; iteration++) {
+        std::vector<double> residualNorms(m, 0);
+        for (IndexType c = 0; c < m; c++) {
+            double sum = 0;
+            #pragma omp parallel for schedule(static) reduction(+:sum)
+            for (IndexType i = 0; i < localN; i++) {
+                const ValueType r = LX[c*localN + i] - ValueType(lambda[c])*X[c*localN + i];
+                R[c*localN + i] = r;
+                sum += double(r)*r;
+            }
+            residualNorms[c] = sum;
+        }
+        comm->sumImpl(residualNorms.data(), residualNorms.data(), m, scai::common::TypeTraits<double>::stype);
 
-            x -= s.dotProduct(d) * r;
-            x -= r.dotProduct(d) * s;
-            x[0] = 0.0;
+        const double maxResidual = std::sqrt(*std::max_element(residualNorms.begin(), residualNorms.end()));
+        if (maxResidual <= residualBound) {
+            break;
+        }
 
-            ValueType tmpSc = rOld/ d.dotProduct(x);
-            z = z + tmpSc*d;
-            res = res - tmpSc*x;
-            ValueType rNew = res.dotProduct(res);
-            ValueType beta = rNew/ rOld;
-            d = res + beta*d;
-            rOld = rNew;
-            rNorm = res.l2Norm();
+        S.resize(localN*(2*m + numP));
+        LS.resize(localN*(2*m + numP));
+        std::copy(X.begin(), X.end(), S.begin());
+        std::copy(LX.begin(), LX.end(), LS.begin());
+        std::copy(P.begin(), P.begin() + localN*numP, S.begin() + localN*m);
+        std::copy(LP.begin(), LP.begin() + localN*numP, LS.begin() + localN*m);
+
+        // the linear combinations of the orthonormalization are also applied to L*X and L*P, only L*W is computed
+        const IndexType numXP = orthonormalize(S, &LS, 0, m + numP, m, localN, globalN, comm);
+
+        for (IndexType c = 0; c < m; c++) {
+            ValueType* w = S.data() + (numXP + c)*localN;
+            #pragma omp parallel for schedule(static)
+            for (IndexType i = 0; i < localN; i++) {
+                w[i] = inverseDegree[i]*R[c*localN + i];
+            }
+        }
+        const IndexType numS = orthonormalize(S, nullptr, numXP, numXP + m, 0, localN, globalN, comm);
+        applyLaplacian(laplacian, halo, comm, S.data() + numXP*localN, numS - numXP, LS.data() + numXP*localN);
+
+        // Rayleigh-Ritz in the search space
+        std::vector<double> G = gramMatrix(S.data(), LS.data(), numS, localN, comm);
+        std::vector<double> theta;
+        symmetricEigen(G, numS, theta, C);
+
+        combineColumns(S, localN, 0, numS, C, numS, 0, m, X);
+        combineColumns(LS, localN, 0, numS, C, numS, 0, m, LX);
+
+        // the new search directions are the parts of the new vectors that come from P and W
+        numP = numS > m ? m : 0;
+        if (numP > 0) {
+            combineColumns(S, localN, m, numS - m, C, numS, m, m, P);
+            combineColumns(LS, localN, m, numS - m, C, numS, m, m, LP);
         }
 
-        t = z;
+        lambda.assign(theta.begin(), theta.begin() + m);
     }
 
-    t[0] = 0.0;
-    ValueType beta = u.dotProduct(t) / alpha;
-    t = t- beta*u;
+    eigenvalues.assign(lambda.begin(), lambda.end());
+    return iteration;
+}
+//---------------------------------------------------------------------------------------
 
-    eigenvalue = lambda;
+template<typename IndexType, typename ValueType>
+typename SpectralPartition<IndexType, ValueType>::LocalLaplacian SpectralPartition<IndexType, ValueType>::buildLocalLaplacian(const CSRSparseMatrix<ValueType>& graph, const scai::dmemo::HaloExchangePlan& halo) {
+    SCAI_REGION("SpectralPartition.buildLocalLaplacian");
+
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const IndexType localN = dist->getLocalSize();
+
+    const scai::lama::CSRStorage<ValueType>& storage = graph.getLocalStorage();
+    scai::hmemo::ReadAccess<IndexType> ia(storage.getIA());
+    scai::hmemo::ReadAccess<IndexType> ja(storage.getJA());
+    scai::hmemo::ReadAccess<ValueType> values(storage.getValues());
+    SCAI_ASSERT_EQ_ERROR( ia.size(), localN+1, "Wrong size of local storage" );
+
+    LocalLaplacian result;
+    result.localN = localN;
+    result.ia.resize(localN+1);
+    result.ja.reserve(ja.size());
+    result.values.reserve(ja.size());
+    result.degree.assign(localN, 0);
+
+    result.ia[0] = 0;
+    for (IndexType i = 0; i < localN; i++) {
+        const IndexType globalI = dist->local2Global(i);
+        for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+            // coarse graphs from MultiLevel::coarsen contain self loops, they do not change the Laplacian
+            if (ja[j] == globalI) {
+                continue;
+            }
+            IndexType column = dist->global2Local(ja[j]);
+            if (column == scai::invalidIndex) {
+                const IndexType haloIndex = halo.global2Halo(ja[j]);
+                SCAI_ASSERT_NE_ERROR( haloIndex, scai::invalidIndex, "Neighbor " << ja[j] << " is neither local nor in the halo" );
+                column = localN + haloIndex;
+            }
+            result.ja.push_back(column);
+            result.values.push_back(values[j]);
+            result.degree[i] += values[j];
+        }
+        result.ia[i+1] = result.ja.size();
+    }
 
-    return t;
+    return result;
 }
+//---------------------------------------------------------------------------------------
 
-/*
 template<typename IndexType, typename ValueType>
-scai::lama::DenseVector<ValueType> SpectralPartition<IndexType, ValueType>::getFiedlerVector2(const scai::lama::CSRSparseMatrix<ValueType>& adjM, ValueType& eigenvalue ){
-    SCAI_REGION("SpectralPartition.getFiedlerVector2");
+void SpectralPartition<IndexType, ValueType>::applyLaplacian(const LocalLaplacian& laplacian, const scai::dmemo::HaloExchangePlan& halo, const scai::dmemo::CommunicatorPtr comm, const ValueType* X, const IndexType numColumns, ValueType* Y) {
+    SCAI_REGION("SpectralPartition.applyLaplacian");
+
+    const IndexType localN = laplacian.localN;
+    const IndexType* ia = laplacian.ia.data();
+    const IndexType* ja = laplacian.ja.data();
+    const ValueType* values = laplacian.values.data();
+    const ValueType* degree = laplacian.degree.data();
+
+    scai::hmemo::HArray<ValueType> column;
+    scai::hmemo::HArray<ValueType> haloData;
+
+    for (IndexType c = 0; c < numColumns; c++) {
+        const ValueType* x = X + c*localN;
+        ValueType* y = Y + c*localN;
+        {
+            scai::hmemo::WriteOnlyAccess<ValueType> wColumn(column, localN);
+            std::copy(x, x + localN, wColumn.get());
+        }
+        halo.updateHalo(haloData, column, *comm);
 
-    IndexType globalN= adjM.getNumRows();
-    SCAI_ASSERT_EQ_ERROR( globalN, adjM.getNumColumns(), "Matrix not square, numRows != numColumns");
+        scai::hmemo::ReadAccess<ValueType> rHalo(haloData);
+        const ValueType* haloValues = rHalo.get();
 
-    scai::lama::CSRSparseMatrix<ValueType> laplacian = GraphUtils::constructLaplacian<IndexType, ValueType>( adjM );
+        #pragma omp parallel for schedule(static)
+        for (IndexType i = 0; i < localN; i++) {
+            ValueType sum = degree[i]*x[i];
+            for (IndexType j = ia[i]; j < ia[i+1]; j++) {
+                const IndexType neighbor = ja[j];
+                sum -= values[j] * (neighbor < localN ? x[neighbor] : haloValues[neighbor - localN]);
+            }
+            y[i] = sum;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------
 
-    // set u=[ 1+sqrt(n), 1, 1, 1, ... ]
-    ValueType n12 = scai::common::Math::sqrt( ValueType( globalN ));
+template<typename IndexType, typename ValueType>
+IndexType SpectralPartition<IndexType, ValueType>::orthonormalize(std::vector<ValueType>& V, std::vector<ValueType>* LV, const IndexType begin, const IndexType end, const IndexType numProtected, const IndexType localN, const IndexType globalN, const scai::dmemo::CommunicatorPtr comm) {
+    SCAI_REGION("SpectralPartition.orthonormalize");
+
+    const scai::common::ScalarType stype = scai::common::TypeTraits<double>::stype;
+    const ValueType constantEntry = 1 / std::sqrt(ValueType(globalN));
+    const double dropTolerance = std::sqrt(std::numeric_limits<ValueType>::epsilon());
+
+    IndexType numColumns = begin;
+    for (IndexType c = begin; c < end; c++) {
+        ValueType* v = V.data() + numColumns*localN;
+        ValueType* lv = LV ? LV->data() + numColumns*localN : nullptr;
+        if (c != numColumns) {
+            std::copy(V.data() + c*localN, V.data() + (c+1)*localN, v);
+            if (LV) {
+                std::copy(LV->data() + c*localN, LV->data() + (c+1)*localN, lv);
+            }
+        }
 
-    auto u = scai::lama::fill<scai::lama::DenseVector<ValueType>>( laplacian.getRowDistributionPtr(), 1);
-    u[0] = n12 + 1;
+        double norm;
+        localDots(v, 1, v, localN, &norm);
+        const double originalNorm = std::sqrt(comm->sum(norm));
 
-    ValueType alpha= globalN + n12;
+        // the constant vector is in the kernel of the Laplacian, projecting it out does not change L*v
+        for (IndexType pass = 0; pass < 2; pass++) {
+            std::vector<double> coefficients(numColumns+1, 0);
+            localDots(V.data(), numColumns, v, localN, coefficients.data());
+            for (IndexType i = 0; i < localN; i++) {
+                coefficients[numColumns] += double(v[i])*constantEntry;
+            }
+            comm->sumImpl(coefficients.data(), coefficients.data(), numColumns+1, stype);
 
-    scai::HouseholderTransformedMatrix<ValueType> HLH( L, u, alpha );
+            #pragma omp parallel for schedule(static)
+            for (IndexType i = 0; i < localN; i++) {
+                double value = v[i] - coefficients[numColumns]*constantEntry;
+                for (IndexType j = 0; j < numColumns; j++) {
+                    value -= coefficients[j]*V[j*localN + i];
+                }
+                v[i] = value;
+                if (lv) {
+                    double lValue = lv[i];
+                    for (IndexType j = 0; j < numColumns; j++) {
+                        lValue -= coefficients[j]*(*LV)[j*localN + i];
+                    }
+                    lv[i] = lValue;
+                }
+            }
+        }
 
-    auto t = fill<DenseVector<ValueType>>( L.getRowDistributionPtr(), 1.0 );
+        localDots(v, 1, v, localN, &norm);
+        norm = std::sqrt(comm->sum(norm));
 
-    DenseVector<ValueType> y;
-    DenseVector<ValueType> diff;
+        if (!(norm > dropTolerance*originalNorm)) {
+            if (c < numProtected) {
+                throw std::runtime_error("Start vector " + std::to_string(c) + " is linearly dependent on the previous ones or on the constant vector.");
+            }
+            continue;
+        }
 
-    t[0] = 0.0;
+        #pragma omp parallel for schedule(static)
+        for (IndexType i = 0; i < localN; i++) {
+            v[i] /= norm;
+            if (lv) {
+                lv[i] /= norm;
+            }
+        }
+        numColumns++;
+    }
+
+    return numColumns;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<double> SpectralPartition<IndexType, ValueType>::gramMatrix(const ValueType* A, const ValueType* B, const IndexType numColumns, const IndexType localN, const scai::dmemo::CommunicatorPtr comm) {
+    std::vector<double> G(numColumns*numColumns, 0);
+    for (IndexType r = 0; r < numColumns; r++) {
+        localDots(B, numColumns, A + r*localN, localN, G.data() + r*numColumns);
+    }
+    comm->sumImpl(G.data(), G.data(), G.size(), scai::common::TypeTraits<double>::stype);
+    return G;
+}
+//---------------------------------------------------------------------------------------
 
-    DenseVector<ValueType> z( t );
+template<typename IndexType, typename ValueType>
+void SpectralPartition<IndexType, ValueType>::combineColumns(const std::vector<ValueType>& V, const IndexType localN, const IndexType firstColumn, const IndexType numColumns, const std::vector<double>& C, const IndexType ldc, const IndexType firstRow, const IndexType numOut, std::vector<ValueType>& result) {
+    result.resize(localN*numOut);
+
+    #pragma omp parallel for schedule(static)
+    for (IndexType i = 0; i < localN; i++) {
+        for (IndexType j = 0; j < numOut; j++) {
+            double sum = 0;
+            for (IndexType r = 0; r < numColumns; r++) {
+                sum += C[j*ldc + firstRow + r] * V[(firstColumn + r)*localN + i];
+            }
+            result[j*localN + i] = sum;
+        }
+    }
+}
+//---------------------------------------------------------------------------------------
 
+template<typename IndexType, typename ValueType>
+void SpectralPartition<IndexType, ValueType>::symmetricEigen(const std::vector<double>& matrix, const IndexType n, std::vector<double>& eigenvalues, std::vector<double>& eigenvectors) {
+    std::vector<double> A(matrix);
+    std::vector<double> V(n*n, 0);
+    for (IndexType i = 0; i < n; i++) {
+        V[i*n + i] = 1;
+    }
 
+    // A is symmetric, use the average of both triangles
+    double frobenius = 0;
+    for (IndexType p = 0; p < n; p++) {
+        for (IndexType q = 0; q < p; q++) {
+            A[p*n + q] = A[q*n + p] = (A[p*n + q] + A[q*n + p]) / 2;
+        }
+    }
+    for (const double a : A) {
+        frobenius += a*a;
+    }
+
+    const IndexType maxSweeps = 100;
+    for (IndexType sweep = 0; sweep < maxSweeps; sweep++) {
+        double offDiagonal = 0;
+        for (IndexType p = 0; p < n; p++) {
+            for (IndexType q = p+1; q < n; q++) {
+                offDiagonal += A[p*n + q]*A[p*n + q];
+            }
+        }
+        if (offDiagonal <= 1e-30*frobenius) {
+            break;
+        }
+
+        for (IndexType p = 0; p < n; p++) {
+            for (IndexType q = p+1; q < n; q++) {
+                const double apq = A[p*n + q];
+                if (apq == 0) {
+                    continue;
+                }
+                // the rotation that annihilates A[p][q]
+                const double theta = (A[q*n + q] - A[p*n + p]) / (2*apq);
+                const double t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta*theta + 1));
+                const double c = 1 / std::sqrt(t*t + 1);
+                const double s = t*c;
+
+                for (IndexType k = 0; k < n; k++) {
+                    const double akp = A[k*n + p];
+                    const double akq = A[k*n + q];
+                    A[k*n + p] = c*akp - s*akq;
+                    A[k*n + q] = s*akp + c*akq;
+                }
+                for (IndexType k = 0; k < n; k++) {
+                    const double apk = A[p*n + k];
+                    const double aqk = A[q*n + k];
+                    A[p*n + k] = c*apk - s*aqk;
+                    A[q*n + k] = s*apk + c*aqk;
+                }
+                for (IndexType k = 0; k < n; k++) {
+                    const double vkp = V[p*n + k];
+                    const double vkq = V[q*n + k];
+                    V[p*n + k] = c*vkp - s*vkq;
+                    V[q*n + k] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+
+    std::vector<IndexType> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&A, n](IndexType a, IndexType b) {
+        return A[a*n + a] < A[b*n + b];
+    });
+
+    eigenvalues.resize(n);
+    eigenvectors.resize(n*n);
+    for (IndexType j = 0; j < n; j++) {
+        eigenvalues[j] = A[order[j]*n + order[j]];
+        std::copy(V.begin() + order[j]*n, V.begin() + (order[j]+1)*n, eigenvectors.begin() + j*n);
+    }
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+ValueType SpectralPartition<IndexType, ValueType>::randomEntry(const IndexType globalIndex, const IndexType column) {
+    // splitmix64 of the index and the column
+    std::uint64_t z = std::uint64_t(globalIndex)*0x9E3779B97F4A7C15ULL + std::uint64_t(column+1)*0xD1B54A32D192ED03ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return ValueType( double(z >> 11) / double(1ULL << 53) * 2 - 1 );
 }
-*/
 //---------------------------------------------------------------------------------------
 
-template class SpectralPartition<IndexType, ValueType>;
+template class SpectralPartition<IndexType, double>;
+template class SpectralPartition<IndexType, float>;
 
-};
+} /* namespace ITI */
@@ -7,56 +7,144 @@
 
 #pragma once
 
+#include <scai/lama.hpp>
+#include <scai/lama/matrix/all.hpp>
+#include <scai/lama/Vector.hpp>
+
 #include <scai/dmemo/Distribution.hpp>
-#include <scai/dmemo/BlockDistribution.hpp>
-#include <scai/dmemo/GenBlockDistribution.hpp>
-#include <scai/sparsekernel/openmp/OpenMPCSRUtils.hpp>
+#include <scai/dmemo/HaloExchangePlan.hpp>
 #include <scai/tracing.hpp>
 
-#include <assert.h>
-#include <cmath>
-#include <climits>
-#include <queue>
-#include <string>
-#include <unordered_set>
-#include <numeric>
-#include <iterator>
-#include <algorithm>
-#include <tuple>
-#include <chrono>
-
-#include "PrioQueue.h"
-#include "MultiLevel.h"
+#include <vector>
+
 #include "Settings.h"
+#include "Metrics.h"
 
 namespace ITI {
 
-/** @brief Partition a graph using the spectral partitioning method.
-@warning This class is heavily unstable and not further developed.
+using scai::lama::CSRSparseMatrix;
+using scai::lama::DenseVector;
+
+/** @brief Partition a graph using its spectral embedding, no coordinates are needed.
+
+The eigenvectors of the smallest non-zero eigenvalues of the graph Laplacian are computed with
+LOBPCG, the locally optimal block preconditioned conjugate gradient method by Knyazev.
+The start vectors come from the coarser levels of a hierarchy built with MultiLevel::coarsen, the
+coarsest level starts with pseudorandom vectors that do not depend on the number of processes.
+
+Every iteration applies the Laplacian to the block of search directions once, with one halo
+exchange per vector, and does a few global reductions of small dense matrices; the Rayleigh-Ritz
+problems have at most 3*numVectors rows and are solved redundantly on every process.
+
+The embedding is split by recursive bisection, optionally followed by balanced k-means in the
+embedding space, see getPartition.
 */
 
 template <typename IndexType, typename ValueType>
 class SpectralPartition {
 public:
-    /** Returns a spectral partition of the input graph
-     * @param[in] adjM The adjacency matrix of the input graph to partition.
-     * @param[in] coordinates Node positions
-     */
-    static scai::lama::DenseVector<IndexType> getPartition(const CSRSparseMatrix<ValueType> &adjM, const std::vector<DenseVector<ValueType>> &coordinates, Settings settings);
-
-    /**Main program to determine the Fiedler vector for a Laplacian matrix
-     *
-     *  Method: Inverse power method incorporated with Householder deflation
-     *
-     *  Paper: An efficient and accurate method to compute the Fiedler vector based on
-     *         Householder deflation and inverse power iteration
-     *         Jian-ping Wu, Jun-qiang Song, Wei-min Zhang
-     * @param[in] adjM The adjacency matrix of the input graph to get the Fiedler eigenvector.
-     * @param[out] eigenvalue The second smallest eigenvalue that corresponds to the fiedler vector.
-     * @return The Fiedler eigenvector, aka the vector corresponding to the second smallest eigenvalue of adjM.
-     */
-    static scai::lama::DenseVector<ValueType> getFiedlerVector(const scai::lama::CSRSparseMatrix<ValueType>& adjM,
-            ValueType& eigenvalue );
+    /** Returns a spectral partition of the input graph into settings.numBlocks blocks.
+
+    The embedding has settings.spectralDimensions eigenvectors. It is first split by recursiveBisection,
+    if settings.spectralKMeans is set, the centers of these blocks are the initial centers for
+    balanced k-means in the embedding space, see KMeans::computePartition.
+
+    @param[in] adjM The adjacency matrix of the input graph to partition.
+    @param[in] nodeWeights The weights of the nodes, distributed like the rows of \p adjM.
+    @param[in] settings Uses numBlocks, epsilon, the spectral parameters and, for k-means, the k-means parameters.
+    @param[out] metrics The time for the embedding and the Fiedler value are stored here.
+    @return The partition, distributed like the rows of \p adjM.
+    */
+    static DenseVector<IndexType> getPartition(const CSRSparseMatrix<ValueType> &adjM, const DenseVector<ValueType> &nodeWeights, Settings settings, Metrics<ValueType>& metrics);
+
+    /** Returns the eigenvectors of the \p numVectors smallest eigenvalues of the Laplacian of \p adjM,
+    excluding the constant vector.
+
+    Edge weights are used, self loops are ignored; apart from that, the matrix is the one built by GraphUtils::constructLaplacian.
+    The eigenvectors are orthonormal. For disconnected graphs, the indicator vectors of the components
+    are eigenvectors with eigenvalue 0 and may be returned.
+
+    @param[in] adjM The adjacency matrix of the graph, must be symmetric.
+    @param[in] numVectors The number of eigenvectors, must be smaller than the number of nodes.
+    @param[in] settings Uses spectralTolerance, spectralMaxIterations and spectralCoarsestSize.
+    @param[out] eigenvalues The eigenvalues in ascending order.
+    @return The eigenvectors, distributed like the rows of \p adjM.
+    */
+    static std::vector<DenseVector<ValueType>> getSpectralEmbedding(const CSRSparseMatrix<ValueType>& adjM, const IndexType numVectors, const Settings settings, std::vector<ValueType>& eigenvalues);
+
+    /** Returns the Fiedler vector of the Laplacian of \p adjM, i.e., the eigenvector of the second smallest eigenvalue.
+    This is getSpectralEmbedding with one vector.
+
+    @param[in] adjM The adjacency matrix of the input graph to get the Fiedler eigenvector.
+    @param[out] eigenvalue The second smallest eigenvalue that corresponds to the fiedler vector.
+    @param[in] settings Uses the same parameters as getSpectralEmbedding.
+    @return The Fiedler eigenvector, aka the vector corresponding to the second smallest eigenvalue of the Laplacian.
+    */
+    static DenseVector<ValueType> getFiedlerVector(const CSRSparseMatrix<ValueType>& adjM, ValueType& eigenvalue, const Settings settings = Settings() );
+
+    /** Split the points of \p embedding recursively into \p numBlocks blocks of about equal weight.
+
+    Every block with b > 1 target blocks is split at the weighted median, or at the fraction floor(b/2)/b of its weight,
+    along the embedding coordinate with the largest weighted variance inside the block.
+    All blocks of one recursion level are split at the same time, the split values are found by bisection
+    of the value range with one global sum per step.
+
+    @param[in] embedding The coordinates of the points, e.g., from getSpectralEmbedding.
+    @param[in] nodeWeights The weights of the points.
+    @param[in] numBlocks The number of blocks.
+    @return The block of every point, distributed like the embedding.
+    */
+    static DenseVector<IndexType> recursiveBisection(const std::vector<DenseVector<ValueType>>& embedding, const DenseVector<ValueType>& nodeWeights, const IndexType numBlocks);
+
+private:
+
+    /** The local rows of the Laplacian in compact form. Column indices smaller than localN are local,
+    the others are localN + the halo index of the neighbor.
+    */
+    struct LocalLaplacian {
+        IndexType localN = 0;
+        std::vector<IndexType> ia;
+        std::vector<IndexType> ja;
+        std::vector<ValueType> values;      ///< the edge weights, the off-diagonal entries are their negation
+        std::vector<ValueType> degree;      ///< the weighted degree, i.e., the diagonal entry
+    };
+
+    static LocalLaplacian buildLocalLaplacian(const CSRSparseMatrix<ValueType>& graph, const scai::dmemo::HaloExchangePlan& halo);
+
+    /** Y = L*X for the \p numColumns columns of X, stored column after column. */
+    static void applyLaplacian(const LocalLaplacian& laplacian, const scai::dmemo::HaloExchangePlan& halo, const scai::dmemo::CommunicatorPtr comm, const ValueType* X, const IndexType numColumns, ValueType* Y);
+
+    /** The eigenvectors of the graph at this level, with start vectors prolonged from the next coarser level.
+    The result is stored column after column, with graph.getLocalNumRows() entries per column.
+    */
+    static std::vector<ValueType> multilevelEigenvectors(const CSRSparseMatrix<ValueType>& graph, const DenseVector<ValueType>& nodeWeights, const IndexType numVectors, const Settings& settings, std::vector<ValueType>& eigenvalues);
+
+    /** Run LOBPCG from the start vectors \p X, the result is stored in \p X. Returns the number of iterations. */
+    static IndexType lobpcg(const LocalLaplacian& laplacian, const scai::dmemo::HaloExchangePlan& halo, const scai::dmemo::CommunicatorPtr comm, const IndexType globalN, std::vector<ValueType>& X, const IndexType numVectors, const Settings& settings, std::vector<ValueType>& eigenvalues);
+
+    /** Orthonormalize the columns [begin, end) of \p V against the constant vector, the columns [0, begin) and each other,
+    with classical Gram-Schmidt done twice. The columns [0, begin) must be orthonormal already.
+
+    If \p LV is not null, the same linear combinations are applied to its columns, so it stays the product of the Laplacian and \p V.
+    Columns that are numerically dependent are removed, except the columns before \p numProtected which throw an exception.
+
+    @return The new end, i.e., the number of orthonormal columns.
+    */
+    static IndexType orthonormalize(std::vector<ValueType>& V, std::vector<ValueType>* LV, const IndexType begin, const IndexType end, const IndexType numProtected, const IndexType localN, const IndexType globalN, const scai::dmemo::CommunicatorPtr comm);
+
+    /** The matrix A^T*B of the columns of A and B, summed over all processes; row major, \p numColumns x \p numColumns. */
+    static std::vector<double> gramMatrix(const ValueType* A, const ValueType* B, const IndexType numColumns, const IndexType localN, const scai::dmemo::CommunicatorPtr comm);
+
+    /** result = V*C for the \p numColumns columns of V starting at \p firstColumn and the rows of C starting at \p firstRow.
+    C is column major with leading dimension \p ldc, result has \p numOut columns.
+    */
+    static void combineColumns(const std::vector<ValueType>& V, const IndexType localN, const IndexType firstColumn, const IndexType numColumns, const std::vector<double>& C, const IndexType ldc, const IndexType firstRow, const IndexType numOut, std::vector<ValueType>& result);
+
+    /** All eigenvalues, ascending, and eigenvectors, column major, of the symmetric row major \p n x \p n matrix, with cyclic Jacobi rotations. */
+    static void symmetricEigen(const std::vector<double>& matrix, const IndexType n, std::vector<double>& eigenvalues, std::vector<double>& eigenvectors);
+
+    /** A pseudorandom value in [-1,1) that depends only on the global index and the column. */
+    static ValueType randomEntry(const IndexType globalIndex, const IndexType column);
 };
 
-}
+} /* namespace ITI */
@@ -1,293 +1,226 @@
 #include <scai/lama.hpp>
-#include <scai/lama/matrix/all.hpp>
-#include <scai/lama/matutils/MatrixCreator.hpp>
-#include <scai/lama/Vector.hpp>
-
 #include <scai/dmemo/BlockDistribution.hpp>
-#include <scai/dmemo/Distribution.hpp>
-
-#include <scai/hmemo/Context.hpp>
-#include <scai/hmemo/HArray.hpp>
 
-#include <scai/solver/GMRES.hpp>
-#include <scai/solver/SimpleAMG.hpp>
-#include <scai/solver/CG.hpp>
-#include <scai/solver/logger/CommonLogger.hpp>
-#include <scai/solver/criteria/ResidualThreshold.hpp>
-#include <scai/solver/criteria/IterationCount.hpp>
+#include <cmath>
 
-#include <algorithm>
-#include <memory>
-#include <cstdlib>
-#include <numeric>
+#include "gtest/gtest.h"
 
 #include "MeshGenerator.h"
-#include "FileIO.h"
-#include "gtest/gtest.h"
+#include "GraphUtils.h"
 #include "SpectralPartition.h"
 
-namespace ITI {
-
-class DISABLED_SpectralPartitionTest : public ::testing::Test {
-protected:
-    // the directory of all the meshes used
-    // projectRoot is defined in config.h.in
-    const std::string graphPath = projectRoot+"/meshes/";
-};
-
-TEST_F(DISABLED_SpectralPartitionTest, testFiedlerVector) {
-    using scai::hmemo::HArray;
 
-    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
-    // for now local refinement requires k = P
-    //
-    IndexType N = 20;
-    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
-    scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(N));
-
-    //broadcast seed value from root to ensure equal pseudorandom numbers.
-    ValueType seed[1] = {static_cast<ValueType>(time(NULL))};
-    comm->bcast( seed, 1, 0 );
-    srand(seed[0]);
-
-    scai::lama::CSRSparseMatrix<ValueType> graph;// = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>(dist, noDist);
+namespace ITI {
 
-    /**
-     * create random graph with weighted edges. We first store the edges in a dense adjacency matrix, then manually convert to CSR.
-     * This is necessary since the Lama-supplied conversion to CSR adds zero-valued entries on the diagonal, which confuses constructLaplacian
-     */
+using scai::lama::CSRSparseMatrix;
+using scai::lama::DenseVector;
+using scai::hmemo::HArray;
 
-    {
-        std::vector<ValueType> denseAdjacencyMatrix(N*N, 0);
-
-        for (IndexType i = 0; i < N; i++) {
-            const IndexType degreeBound = rand()%5+6;
-            bool connectedToNextRow = false;
-
-            for( IndexType j=0; j<degreeBound; j++) {
-                const IndexType col= rand()%N;
-                if( col!=i ) {
-                    const ValueType w = rand()%10+1;
-                    denseAdjacencyMatrix[i*N+col] = w;
-                    denseAdjacencyMatrix[col*N+i] = w;
-                }
+template<typename T>
+class SpectralPartitionTest : public ::testing::Test {
+protected:
+    /** A path with N nodes, block distributed. */
+    CSRSparseMatrix<T> pathGraph(const IndexType N) {
+        const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+        const scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(N, comm));
+        const IndexType localN = dist->getLocalSize();
+
+        std::vector<IndexType> ia(1, 0);
+        std::vector<IndexType> ja;
+        for (IndexType i = 0; i < localN; i++) {
+            const IndexType globalI = dist->local2Global(i);
+            if (globalI > 0) {
+                ja.push_back(globalI-1);
             }
-
-            // connect this row with the next one so graph is connected
-            const IndexType col = (i+1)%N;
-            if (col != i) {
-                const ValueType w = rand()%10 +1;
-                denseAdjacencyMatrix[i*N+col] = w;
-                denseAdjacencyMatrix[col*N+i] = w;
+            if (globalI < N-1) {
+                ja.push_back(globalI+1);
             }
+            ia.push_back(ja.size());
+        }
+        std::vector<T> values(ja.size(), 1);
+
+        scai::lama::CSRStorage<T> storage(localN, N,
+                                          HArray<IndexType>(ia.size(), ia.data()),
+                                          HArray<IndexType>(ja.size(), ja.data()),
+                                          HArray<T>(values.size(), values.data()));
+        return CSRSparseMatrix<T>(dist, std::move(storage));
+    }
 
+    /** A structured 3D mesh with sideLen^3 nodes, block distributed. */
+    CSRSparseMatrix<T> mesh(const IndexType sideLen) {
+        const IndexType dimensions = 3;
+        const IndexType N = std::pow(sideLen, dimensions);
+        const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+        const scai::dmemo::DistributionPtr dist(scai::dmemo::Distribution::getDistributionPtr("BLOCK", comm, N));
+        const scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
+
+        CSRSparseMatrix<T> graph = scai::lama::zero<CSRSparseMatrix<T>>(dist, noDistPointer);
+        std::vector<T> maxCoord(dimensions, sideLen);
+        std::vector<IndexType> numPoints(dimensions, sideLen);
+        std::vector<DenseVector<T>> coords(dimensions);
+        for (IndexType d = 0; d < dimensions; d++) {
+            coords[d] = DenseVector<T>(dist, 0);
         }
+        MeshGenerator<IndexType, T>::createStructuredMesh_dist(graph, coords, maxCoord, numPoints, dimensions);
+        return graph;
+    }
+};
+
+using testTypes = ::testing::Types<double,float>;
+TYPED_TEST_SUITE(SpectralPartitionTest, testTypes);
 
-        //convert to CSR
-        std::vector<IndexType> newIA(N+1);
-        std::vector<IndexType> newJA;
-        std::vector<ValueType> newValues;
-
-        for(IndexType i=0; i<N; i++) {
-            for( IndexType j=0; j<N; j++) {
-                if( denseAdjacencyMatrix[i*N+j] != 0 ) {
-                    newJA.push_back(j);
-                    newValues.push_back(denseAdjacencyMatrix[i*N+j]);
-                }
+//------------------------------------------------------------------------------
+
+TYPED_TEST(SpectralPartitionTest, testFiedlerVectorOfPath) {
+    using ValueType = TypeParam;
+
+    const IndexType N = 64;
+    const CSRSparseMatrix<ValueType> graph = this->pathGraph(N);
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+
+    // the eigenvector of the path is cos(pi*(i+1/2)/N) with eigenvalue 2-2cos(pi/N)
+    const double pi = std::acos(-1.0);
+    const double expectedValue = 2*(1-std::cos(pi/N));
+
+    for (IndexType coarsestSize : {1000, 16}) {
+        Settings settings;
+        settings.spectralTolerance = 1e-5;
+        settings.spectralMaxIterations = 500;
+        settings.spectralCoarsestSize = coarsestSize;
+
+        ValueType eigenvalue;
+        DenseVector<ValueType> fiedler = SpectralPartition<IndexType, ValueType>::getFiedlerVector(graph, eigenvalue, settings);
+
+        ASSERT_TRUE(fiedler.getDistribution().isEqual(*dist));
+        EXPECT_NEAR(eigenvalue, expectedValue, 1e-2*expectedValue);
+        EXPECT_NEAR(fiedler.l2Norm(), 1, 1e-4);
+        EXPECT_NEAR(fiedler.sum(), 0, 1e-3);
+
+        // compare with the exact eigenvector, up to the sign
+        DenseVector<ValueType> exact(dist, 0);
+        {
+            scai::hmemo::WriteAccess<ValueType> wExact(exact.getLocalValues());
+            for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+                wExact[i] = std::cos(pi*(dist->local2Global(i)+0.5)/N);
             }
-            newIA[i+1] = newJA.size();
         }
+        const ValueType correlation = exact.dotProduct(fiedler) / exact.l2Norm();
+        EXPECT_GT(std::abs(correlation), 0.99);
+    }
+}
+//------------------------------------------------------------------------------
 
-        const IndexType M = newJA.size();
-        ASSERT_EQ(M, newValues.size());
+TYPED_TEST(SpectralPartitionTest, testSpectralEmbeddingOfMesh) {
+    using ValueType = TypeParam;
 
-        scai::lama::CSRStorage<ValueType> storage(N,N, HArray<IndexType>(N+1,newIA.data()), HArray<IndexType>(M, newJA.data()), HArray<ValueType>(M, newValues.data()));
-        graph = scai::lama::CSRSparseMatrix<ValueType>(std::move(storage));
-    }
-    ValueType fiedlerEigenvalue = -8;
-    scai::lama::DenseVector<ValueType> fiedler;
-
-    {   // get the getFiedlerVector function
-        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
-        fiedler = SpectralPartition<IndexType, ValueType>::getFiedlerVector( graph, fiedlerEigenvalue );
-        PRINT0("time to get fiedler vector: " << ( std::chrono::duration<double> (std::chrono::steady_clock::now() -start) ).count() );
-        SCAI_ASSERT( fiedlerEigenvalue >0, "fiedler eigenvalue negative: "<< fiedlerEigenvalue);
-    }
+    const CSRSparseMatrix<ValueType> graph = this->mesh(12);
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
 
-    //TODO: done in a hurry, add proper tests, assertions
-    //prints - assertion
+    Settings settings;
+    settings.spectralTolerance = 1e-4;
+    settings.spectralCoarsestSize = 200;
+    const IndexType numVectors = 4;
 
-    ValueType fiedlerMax = fiedler.max();
-    ValueType fiedlerl1Norm = fiedler.l1Norm();
-    ValueType fiedlerl2Norm = fiedler.l2Norm();
-    ValueType fiedlerMin = fiedler.min();
+    std::vector<ValueType> eigenvalues;
+    std::vector<DenseVector<ValueType>> embedding = SpectralPartition<IndexType, ValueType>::getSpectralEmbedding(graph, numVectors, settings, eigenvalues);
+    ASSERT_EQ(embedding.size(), numVectors);
+    ASSERT_EQ(eigenvalues.size(), numVectors);
 
-    PRINT0(fiedler.size() << " , max= " << fiedlerMax << " , min= " << fiedlerMin << " , l1Norm= " << fiedlerl1Norm << " , l2Norm= " << fiedlerl2Norm << " , fiedlerEigenvalue= " << fiedlerEigenvalue);
+    const CSRSparseMatrix<ValueType> laplacian = GraphUtils<IndexType, ValueType>::constructLaplacian(graph);
 
-    EXPECT_TRUE( graph.getRowDistributionPtr()->isEqual( fiedler.getDistribution() ) );
+    for (IndexType v = 0; v < numVectors; v++) {
+        ASSERT_TRUE(embedding[v].getDistribution().isEqual(*dist));
+        EXPECT_GT(eigenvalues[v], 0);
+        if (v > 0) {
+            EXPECT_GE(eigenvalues[v], eigenvalues[v-1]*(1-1e-3));
+        }
 
-}
+        // orthonormal and orthogonal to the constant vector
+        EXPECT_NEAR(embedding[v].sum(), 0, 1e-3);
+        for (IndexType w = 0; w <= v; w++) {
+            EXPECT_NEAR(embedding[v].dotProduct(embedding[w]), v == w ? 1 : 0, 1e-3);
+        }
 
-//------------------------------------------------------------------------------
+        // the residual is bounded by the tolerance times the bound 2*maxDegree of the largest eigenvalue
+        DenseVector<ValueType> residual = scai::lama::eval<DenseVector<ValueType>>(laplacian * embedding[v]);
+        residual -= eigenvalues[v] * embedding[v];
+        EXPECT_LE(residual.l2Norm(), 10*settings.spectralTolerance*2*6);
+    }
 
-TEST_F(DISABLED_SpectralPartitionTest, DISABLED_testGetPartition) {
-    //std::string file = "Grid32x32";
-    std::string file = graphPath + "trace-00008.graph";
-    std::ifstream f(file);
-    IndexType dimensions= 2;
-    IndexType N, edges;
-    f >> N >> edges;
-
-    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
-    // for now local refinement requires k = P
-    IndexType k = comm->getSize();
-    //
-    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
-    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
-    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file );
-    graph.redistribute(dist, noDistPointer);
-
-    std::vector<DenseVector<ValueType>> coordinates = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions);
-    EXPECT_TRUE(coordinates[0].getDistributionPtr()->isEqual(*dist));
-
-    EXPECT_EQ( graph.getNumColumns(), graph.getNumRows());
-    EXPECT_EQ(edges, (graph.getNumValues())/2 );
-
-    struct Settings settings;
-    settings.numBlocks= k;
-    settings.epsilon = 0.2;
-    settings.dimensions = dimensions;
-
-    PRINT0("Get a spectral partition");
-    // get spectral partition
-    settings.pixeledSideLen = 16;    // for a 16x16 coarsen graph
-    scai::lama::DenseVector<IndexType> spectralPartition = SpectralPartition<IndexType, ValueType>::getPartition( graph, coordinates, settings);
-
-    EXPECT_GE(k-1, scai::utilskernel::HArrayUtils::max(spectralPartition.getLocalValues()) );
-    EXPECT_EQ(N, spectralPartition.size());
-    EXPECT_EQ(0, spectralPartition.min());
-    EXPECT_EQ(k-1, spectralPartition.max());
-    EXPECT_EQ(graph.getRowDistribution(), spectralPartition.getDistribution());
+    // the mesh is a cube, the first three eigenvalues belong to the three axes and are equal
+    EXPECT_NEAR(eigenvalues[0], eigenvalues[2], 1e-2*eigenvalues[0]);
 }
 //------------------------------------------------------------------------------
 
-TEST_F(DISABLED_SpectralPartitionTest, testGetPartitionFromPixeledGraph) {
-    //std::string file = "Grid32x32";
-    std::string file = graphPath + "trace-00008.graph";
-    std::ifstream f(file);
-    IndexType dimensions= 2;
-    IndexType N, edges;
-    f >> N >> edges;
-
-    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
-    // for now local refinement requires k = P
-    IndexType k = comm->getSize();
-    //
-    scai::dmemo::DistributionPtr dist ( scai::dmemo::Distribution::getDistributionPtr( "BLOCK", comm, N) );
-    scai::dmemo::DistributionPtr noDistPointer(new scai::dmemo::NoDistribution(N));
-    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file );
-    graph.redistribute(dist, noDistPointer);
-
-    std::vector<DenseVector<ValueType>> coordinates = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions);
-    EXPECT_TRUE(coordinates[0].getDistributionPtr()->isEqual(*dist));
-
-    EXPECT_EQ( graph.getNumColumns(), graph.getNumRows());
-    EXPECT_EQ(edges, (graph.getNumValues())/2 );
-
-    struct Settings settings;
-    settings.numBlocks= k;
-    settings.epsilon = 0.2;
-    settings.dimensions = dimensions;
-    settings.pixeledSideLen = 16;    // for a 16x16 coarsen graph
-
-    // get a pixeled-coarsen graph , this is replicated in every PE
-    scai::lama::DenseVector<ValueType> pixelWeights;
-    scai::lama::CSRSparseMatrix<ValueType> pixelGraph = MultiLevel<IndexType, ValueType>::pixeledCoarsen(graph, coordinates, pixelWeights, settings);
-    SCAI_ASSERT( pixelGraph.getRowDistributionPtr()->isReplicated() == 1, "Pixel graph should (?) be replicated.");
-
-    int emptyPixels=0;
-    for(int i=0; i<pixelWeights.size(); i++) {
-        if(pixelWeights[i]==0) {
-            //PRINT0(i);
-            ++emptyPixels;
-        }
-    }
-    PRINT0("emptyPixels= " << emptyPixels);
-    IndexType numPixels = pixelGraph.getNumRows();
-    SCAI_ASSERT( numPixels == pixelGraph.getNumColumns(), "Wrong pixeled graph.");
-    SCAI_ASSERT( pixelGraph.isConsistent() == 1, "Pixeled graph not consistent.");
-    if(settings.pixeledSideLen < 32) SCAI_ASSERT( pixelGraph.checkSymmetry() == 1, "Pixeled graph not symmetric.");
-
-    // get the vector using Eigen
-    DenseVector<ValueType> eigenVec (numPixels, -1);
-    ValueType eigenEigenValue =0;
-
-    // get the laplacian of the pixeled graph , since the pixeled graph is replicated so should be the laplacian
-    scai::lama::CSRSparseMatrix<ValueType> pixelLaplacian = GraphUtils<IndexType, ValueType>::constructLaplacian( pixelGraph );
-    SCAI_ASSERT( pixelLaplacian.isConsistent() == 1, "Laplacian graph not consistent.");
-    SCAI_ASSERT( pixelLaplacian.getNumRows() == numPixels, "Wrong size of the laplacian.");
-    ValueType sum=0;
-    {   // the sum of all elements of the laplacian should be 0
-        scai::hmemo::ReadAccess<ValueType> readLaplVal(pixelLaplacian.getLocalStorage().getValues() );
-        for(int i=0; i<readLaplVal.size(); i++) {
-            sum += readLaplVal[i];
-        }
-    }
-    // this does not work with the version of pixel coarsen where we add edge to isolated vertices
-    //EXPECT_EQ( sum , 0 );
-
-    // the Eigen approach for the pixeled graph
+TYPED_TEST(SpectralPartitionTest, testGetPartition) {
+    using ValueType = TypeParam;
 
+    const CSRSparseMatrix<ValueType> graph = this->mesh(16);
+    const scai::dmemo::DistributionPtr dist = graph.getRowDistributionPtr();
+    const scai::dmemo::CommunicatorPtr comm = dist->getCommunicatorPtr();
+    const DenseVector<ValueType> nodeWeights(dist, 1);
 
-    DenseVector<ValueType> prod = scai::lama::eval<DenseVector<ValueType>>( pixelGraph*eigenVec);
+    Settings settings;
+    settings.numBlocks = std::max(IndexType(4), comm->getSize());
+    settings.dimensions = 3;
+    settings.epsilon = 0.05;
+    settings.spectralCoarsestSize = 500;
 
-    // get the fiedler vector for the pixeled graph using LAMA
-    ValueType eigenvalue;
-    scai::lama::DenseVector<ValueType> fiedler = SpectralPartition<IndexType, ValueType>::getFiedlerVector( pixelGraph, eigenvalue );
-    SCAI_ASSERT( fiedler.size() == numPixels, "Sizes do not agree.");
+    for (bool kMeans : {false, true}) {
+        settings.spectralKMeans = kMeans;
+        Metrics<ValueType> metrics(settings);
 
+        DenseVector<IndexType> partition = SpectralPartition<IndexType, ValueType>::getPartition(graph, nodeWeights, settings, metrics);
 
-    SCAI_ASSERT_EQ_ERROR( eigenVec.size(), fiedler.size(), "Wrong vector sizes");
-    PRINT0("eigenvalue should be similar: Eigen= "<< eigenEigenValue << " , fiedler= "<< eigenvalue);
+        ASSERT_TRUE(partition.getDistribution().isEqual(*dist));
+        EXPECT_GE(partition.min(), 0);
+        EXPECT_LT(partition.max(), settings.numBlocks);
 
-    ValueType eigenl1Norm = eigenVec.l1Norm();
-    ValueType fiedlerl1Norm = fiedler.l1Norm();
-    PRINT0("l1 norm should be similar: Eigen= "<< eigenl1Norm << " , fiedler= "<< fiedlerl1Norm );
+        const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance(partition, settings.numBlocks);
+        EXPECT_LE(imbalance, kMeans ? settings.epsilon : 0.01);
 
-    ValueType eigenl2Norm = eigenVec.l2Norm();
-    ValueType fiedlerl2Norm = fiedler.l2Norm();
-    PRINT0("l2 norm should be similar: Eigen= "<< eigenl2Norm << " , fiedler= "<< fiedlerl2Norm );
+        // a spectral partition of a cube cuts much less than a random one, which cuts about (k-1)/k of all edges
+        const ValueType cut = GraphUtils<IndexType, ValueType>::computeCut(graph, partition);
+        EXPECT_LT(cut, 0.25*graph.getNumValues()/2);
 
-    ValueType eigenMax = eigenVec.max();
-    ValueType fiedlerMax = fiedler.max();
-    PRINT0("max should be similar: Eigen= "<< eigenMax  << " , fiedler= "<< fiedlerMax );
+        EXPECT_GT(metrics.MM["spectralFiedlerValue"], 0);
+    }
+}
+//------------------------------------------------------------------------------
 
-    ValueType eigenMin = eigenVec.min();
-    ValueType fiedlerMin = fiedler.min();
-    PRINT0("min should be similar: Eigen= "<< eigenMin << " , fiedler= "<< fiedlerMin );
+TYPED_TEST(SpectralPartitionTest, testRecursiveBisection) {
+    using ValueType = TypeParam;
 
-    EXPECT_TRUE( eigenVec.getDistributionPtr()->isEqual( fiedler.getDistribution() ) );
-    EXPECT_TRUE( pixelGraph.getRowDistributionPtr()->isEqual( fiedler.getDistribution() ) );
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+    const IndexType N = 1000;
+    const scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(N, comm));
 
+    // points on a line, with the second coordinate almost constant; the line is split into intervals
+    std::vector<DenseVector<ValueType>> embedding(2, DenseVector<ValueType>(dist, 0));
+    {
+        scai::hmemo::WriteAccess<ValueType> wX(embedding[0].getLocalValues());
+        scai::hmemo::WriteAccess<ValueType> wY(embedding[1].getLocalValues());
+        for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+            const IndexType globalI = dist->local2Global(i);
+            wX[i] = globalI;
+            wY[i] = (globalI % 2)*1e-3;
+        }
+    }
+    const DenseVector<ValueType> nodeWeights(dist, 1);
+    const IndexType numBlocks = 5;
 
-    // check
-    DenseVector<ValueType> prodF = scai::lama::eval<DenseVector<ValueType>>(pixelGraph*fiedler);
-    DenseVector<ValueType> prodF2 = scai::lama::eval<DenseVector<ValueType>>( eigenvalue*fiedler);
+    DenseVector<IndexType> partition = SpectralPartition<IndexType, ValueType>::recursiveBisection(embedding, nodeWeights, numBlocks);
 
-    // sort
-    scai::lama::DenseVector<IndexType> permutation, permutationF;
-    eigenVec.sort(permutation, true);
-    fiedler.sort(permutationF, true);
+    ASSERT_TRUE(partition.getDistribution().isEqual(*dist));
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance(partition, numBlocks);
+    EXPECT_LE(imbalance, 0.01);
 
-    /*
-    PRINT0("The permutation should be almost the same or the inverse: ");
-    for(int i=0; i<fiedler.size(); i++){
-        if( i<10 or i>fiedler.size()-10){
-            PRINT0(i<<": "<< permutation.getValue(i) << " + " << permutationF.getValue(i) );
-        }
+    // every block is an interval
+    scai::hmemo::ReadAccess<IndexType> rPart(partition.getLocalValues());
+    for (IndexType i = 0; i < dist->getLocalSize(); i++) {
+        const IndexType globalI = dist->local2Global(i);
+        EXPECT_EQ(rPart[i], (globalI*numBlocks)/N);
     }
-    */
 }
 
-
-}
+} /* namespace ITI */
@@ -0,0 +1,302 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#include <scai/lama/DenseVector.hpp>
+#include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/dmemo/GenBlockDistribution.hpp>
+
+#include "StreamingPartition.h"
+#include "FileIO.h"
+#include "KMeans.h"
+#include "OmpThreadsScope.h"
+
+namespace ITI {
+
+template<typename IndexType, typename ValueType>
+IndexType StreamingPartition<IndexType, ValueType>::partitionFromFile(
+    const std::string coordFile,
+    const std::string partFile,
+    Settings settings,
+    Metrics<ValueType>& metrics,
+    const scai::dmemo::CommunicatorPtr comm ) {
+
+    SCAI_REGION("StreamingPartition.partitionFromFile");
+    const OmpThreadsScope threadsScope( settings.numThreads );
+
+    std::chrono::time_point<std::chrono::steady_clock> startTime = std::chrono::steady_clock::now();
+
+    const IndexType dim = settings.dimensions;
+    const IndexType k = settings.numBlocks;
+    const IndexType globalN = FileIO<IndexType, ValueType>::getNumCoordsBinary( coordFile );
+    SCAI_ASSERT_GE_ERROR( globalN, k, "Fewer points than blocks in file " << coordFile );
+
+    // every process streams through its block of the file
+    IndexType beginLocalRange, endLocalRange;
+    scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, globalN, comm->getRank(), comm->getSize());
+    const IndexType chunkSize = settings.streamChunkSize;
+
+    //
+    // first pass: bounding box and a sample of the points
+    //
+
+    std::vector<ValueType> minCoords(dim, std::numeric_limits<ValueType>::max());
+    std::vector<ValueType> maxCoords(dim, std::numeric_limits<ValueType>::lowest());
+    std::vector<std::vector<ValueType>> sample(dim);
+    const IndexType sampleStride = std::max<IndexType>(1, globalN/std::max<IndexType>(settings.streamSampleSize, k));
+
+    {
+        SCAI_REGION("StreamingPartition.partitionFromFile.samplingPass");
+        for (IndexType chunkBegin = beginLocalRange; chunkBegin < endLocalRange; chunkBegin += chunkSize) {
+            const IndexType chunkEnd = std::min(chunkBegin + chunkSize, endLocalRange);
+            const std::vector<std::vector<ValueType>> chunk = FileIO<IndexType, ValueType>::readCoordsBinaryRange( coordFile, chunkBegin, chunkEnd, dim );
+
+            for (IndexType d = 0; d < dim; d++) {
+                const auto minMax = std::minmax_element(chunk[d].begin(), chunk[d].end());
+                minCoords[d] = std::min(minCoords[d], *minMax.first);
+                maxCoords[d] = std::max(maxCoords[d], *minMax.second);
+            }
+
+            // sample with a global stride so that the sample does not depend on the number of processes
+            IndexType firstSampled = chunkBegin + (sampleStride - chunkBegin%sampleStride)%sampleStride;
+            for (IndexType i = firstSampled; i < chunkEnd; i += sampleStride) {
+                for (IndexType d = 0; d < dim; d++) {
+                    sample[d].push_back(chunk[d][i-chunkBegin]);
+                }
+            }
+        }
+    }
+
+    for (IndexType d = 0; d < dim; d++) {
+        minCoords[d] = comm->min(minCoords[d]);
+        maxCoords[d] = comm->max(maxCoords[d]);
+        SCAI_ASSERT_NE_ERROR(minCoords[d], maxCoords[d], "min=max for dimension "<< d << ", this will cause problems to the hilbert index.");
+    }
+
+    std::vector<std::vector<ValueType>> centers;
+    {
+        SCAI_REGION("StreamingPartition.partitionFromFile.initialCenters");
+        const IndexType localSampleN = sample[0].size();
+        const IndexType globalSampleN = comm->sum(localSampleN);
+        scai::dmemo::DistributionPtr sampleDist = scai::dmemo::genBlockDistributionBySize(globalSampleN, localSampleN, comm);
+
+        std::vector<DenseVector<ValueType>> sampleCoords(dim);
+        for (IndexType d = 0; d < dim; d++) {
+            scai::hmemo::HArray<ValueType> localValues(localSampleN, sample[d].data());
+            sampleCoords[d] = DenseVector<ValueType>(sampleDist, localValues);
+            std::vector<ValueType>().swap(sample[d]);
+        }
+
+        centers = KMeans<IndexType, ValueType>::findInitialCentersSFC(sampleCoords, minCoords, maxCoords, settings);
+    }
+    SCAI_ASSERT_EQ_ERROR(centers.size(), k, "Number of centers is not correct");
+
+    ValueType diagonalLength = 0;
+    for (IndexType d = 0; d < dim; d++) {
+        diagonalLength += std::pow(maxCoords[d]-minCoords[d], 2);
+    }
+    diagonalLength = std::sqrt(diagonalLength);
+    const ValueType threshold = 0.002*diagonalLength;
+
+    //
+    // streaming passes: assign every chunk and write the block IDs to a local file
+    //
+
+    const ValueType targetBlockWeight = ValueType(globalN)/k;
+    const std::string localPartFile = partFile + ".part" + std::to_string(comm->getRank());
+    std::vector<ValueType> influence(k, 1);
+    ValueType imbalance = 0;
+
+    IndexType pass = 0;
+    for (; pass < settings.streamPasses; pass++) {
+        SCAI_REGION("StreamingPartition.partitionFromFile.pass");
+        std::chrono::time_point<std::chrono::steady_clock> passStart = std::chrono::steady_clock::now();
+
+        // accumulate in double, the sums are over possibly billions of points
+        std::vector<double> blockWeights(k, 0);
+        std::vector<double> centerSums(k*dim, 0);
+
+        std::ofstream localOut(localPartFile.c_str(), std::ios::out | std::ios::trunc);
+        if( localOut.fail() ) {
+            throw std::runtime_error("Could not write to file " + localPartFile);
+        }
+        // the header of FileIO::writePartitionParallel, the first local file starts the partition file
+        if (comm->getRank() == 0) {
+            localOut << "% " << globalN << "\n";
+        }
+
+        for (IndexType chunkBegin = beginLocalRange; chunkBegin < endLocalRange; chunkBegin += chunkSize) {
+            const IndexType chunkEnd = std::min(chunkBegin + chunkSize, endLocalRange);
+            const std::vector<std::vector<ValueType>> chunk = FileIO<IndexType, ValueType>::readCoordsBinaryRange( coordFile, chunkBegin, chunkEnd, dim );
+
+            const std::vector<IndexType> assignment = assignChunk(chunk, centers, influence);
+
+            for (IndexType i = 0; i < chunkEnd-chunkBegin; i++) {
+                const IndexType block = assignment[i];
+                blockWeights[block] += 1;
+                for (IndexType d = 0; d < dim; d++) {
+                    centerSums[block*dim+d] += chunk[d][i];
+                }
+                localOut << block << "\n";
+            }
+        }
+        localOut.close();
+
+        comm->sumImpl(blockWeights.data(), blockWeights.data(), k, scai::common::TypeTraits<double>::stype);
+        comm->sumImpl(centerSums.data(), centerSums.data(), k*dim, scai::common::TypeTraits<double>::stype);
+
+        // new centers; an empty block keeps its old center
+        ValueType delta = 0;
+        for (IndexType b = 0; b < k; b++) {
+            if (blockWeights[b] == 0) continue;
+            ValueType sqMove = 0;
+            for (IndexType d = 0; d < dim; d++) {
+                const ValueType newCoord = ValueType(centerSums[b*dim+d]/blockWeights[b]);
+                sqMove += std::pow(newCoord - centers[b][d], 2);
+                centers[b][d] = newCoord;
+            }
+            delta = std::max(delta, std::sqrt(sqMove));
+        }
+
+        // imbalance of the partition that was just written
+        imbalance = ValueType( (*std::max_element(blockWeights.begin(), blockWeights.end()) - targetBlockWeight)/targetBlockWeight );
+
+        // adapt influence values, as in KMeans::assignBlocks
+        for (IndexType b = 0; b < k; b++) {
+            const ValueType ratio = ValueType(blockWeights[b]/targetBlockWeight);
+            if (std::abs(ratio - 1) < settings.epsilon and settings.freezeBalancedInfluence) {
+                continue;
+            }
+            influence[b] = std::max( influence[b]*ValueType(1-settings.influenceChangeCap),
+                std::min( ValueType(influence[b]*std::pow(ratio, settings.influenceExponent)),
+                influence[b]*ValueType(1+settings.influenceChangeCap) )
+                );
+        }
+
+        std::chrono::duration<ValueType> passTime = std::chrono::steady_clock::now() - passStart;
+        const ValueType maxPassTime = comm->max(passTime.count());
+        metrics.kmeansProfiling.push_back( std::make_tuple(delta, maxPassTime, imbalance) );
+        metrics.numBalanceIter.push_back( 1 );
+
+        if (settings.verbose) {
+            PRINT0("pass " << pass << ": delta= " << delta << ", imbalance= " << imbalance << ", time= " << maxPassTime);
+        }
+
+        if (imbalance <= settings.epsilon and delta < threshold) {
+            pass++;
+            break;
+        }
+    }
+
+    //
+    // concatenate the local files into the partition file
+    //
+
+    mergePartFiles(partFile, localPartFile, comm);
+
+    std::chrono::duration<ValueType> totalTime = std::chrono::steady_clock::now() - startTime;
+    metrics.MM["timeKmeans"] = comm->max(totalTime.count());
+    metrics.MM["finalImbalance"] = imbalance;
+    metrics.MM["streamPasses"] = pass;
+
+    return globalN;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+std::vector<IndexType> StreamingPartition<IndexType, ValueType>::assignChunk(
+    const std::vector<std::vector<ValueType>>& chunk,
+    const std::vector<std::vector<ValueType>>& centers,
+    const std::vector<ValueType>& influence ) {
+
+    SCAI_REGION("StreamingPartition.assignChunk");
+
+    const IndexType dim = chunk.size();
+    const IndexType chunkN = chunk[0].size();
+    const IndexType k = centers.size();
+
+    std::vector<IndexType> assignment(chunkN, 0);
+    if (chunkN == 0) {
+        return assignment;
+    }
+
+    // pre-filter the centers with the bounding box of the chunk, like in KMeans::assignBlocks
+    std::vector<ValueType> minCoords(dim), maxCoords(dim);
+    for (IndexType d = 0; d < dim; d++) {
+        const auto minMax = std::minmax_element(chunk[d].begin(), chunk[d].end());
+        minCoords[d] = *minMax.first;
+        maxCoords[d] = *minMax.second;
+    }
+
+    // the box can be flat in some dimension, so compute the distance directly and not with a SpatialCell
+    std::vector<ValueType> effectMinDist(k);
+    for (IndexType b = 0; b < k; b++) {
+        ValueType sqMinDist = 0;
+        for (IndexType d = 0; d < dim; d++) {
+            const ValueType outside = std::max( ValueType(0), std::max(minCoords[d]-centers[b][d], centers[b][d]-maxCoords[d]) );
+            sqMinDist += outside*outside;
+        }
+        effectMinDist[b] = sqMinDist*influence[b];
+    }
+
+    std::vector<IndexType> clusterIndices(k);
+    std::iota(clusterIndices.begin(), clusterIndices.end(), 0);
+    std::sort(clusterIndices.begin(), clusterIndices.end(), [&effectMinDist](IndexType a, IndexType b) {
+        return effectMinDist[a] < effectMinDist[b] || (effectMinDist[a] == effectMinDist[b] && a < b);
+    });
+
+    #pragma omp parallel for schedule(static)
+    for (IndexType i = 0; i < chunkN; i++) {
+        IndexType bestBlock = clusterIndices[0];
+        ValueType bestValue = std::numeric_limits<ValueType>::max();
+
+        for (IndexType c = 0; c < k && effectMinDist[clusterIndices[c]] < bestValue; c++) {
+            const IndexType j = clusterIndices[c];
+            ValueType sqDist = 0;
+            for (IndexType d = 0; d < dim; d++) {
+                sqDist += std::pow(centers[j][d]-chunk[d][i], 2);
+            }
+            const ValueType effectiveDistance = sqDist*influence[j];
+            if (effectiveDistance < bestValue) {
+                bestValue = effectiveDistance;
+                bestBlock = j;
+            }
+        }
+        assignment[i] = bestBlock;
+    }
+
+    return assignment;
+}
+//---------------------------------------------------------------------------------------
+
+template<typename IndexType, typename ValueType>
+void StreamingPartition<IndexType, ValueType>::mergePartFiles(
+    const std::string partFile,
+    const std::string localPartFile,
+    const scai::dmemo::CommunicatorPtr comm ) {
+
+    SCAI_REGION("StreamingPartition.mergePartFiles");
+
+    std::ifstream infile(localPartFile.c_str(), std::ios::binary | std::ios::in | std::ios::ate);
+    if (comm->max(IndexType(infile.fail())) > 0) {
+        throw std::runtime_error("Could not read file " + localPartFile);
+    }
+    const std::size_t localBytes = infile.tellg();
+    infile.seekg(0);
+
+    // all processes write at once, the local file is read in pieces and does not need to fit into memory
+    FileIO<IndexType, ValueType>::writeCollective(partFile, infile, localBytes, comm);
+
+    infile.close();
+    std::remove(localPartFile.c_str());
+}
+//---------------------------------------------------------------------------------------
+
+template class StreamingPartition<IndexType, double>;
+template class StreamingPartition<IndexType, float>;
+
+} /* namespace ITI */
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <scai/dmemo/Communicator.hpp>
+#include <scai/tracing.hpp>
+
+#include "Settings.h"
+#include "Metrics.h"
+
+namespace ITI {
+
+/** Partition point sets that do not fit into the aggregated memory of all processes.
+
+The coordinates are read from a binary file (see FileIO::readCoordsBinary) in chunks of
+settings.streamChunkSize points per process. A first pass computes the bounding box and
+samples points to find initial centers with KMeans::findInitialCentersSFC. Then, in every
+pass over the file, each chunk is assigned to the closest center, adjusted by the influence
+values as in KMeans::assignBlocks, and the block weights and centers are accumulated.
+After every pass, centers and influence values are updated globally.
+
+The block IDs are never stored in memory, they are written to the output file chunk by chunk.
+The output file has the same format as FileIO::writePartitionParallel.
+*/
+
+template <typename IndexType, typename ValueType>
+class StreamingPartition {
+public:
+
+    /** @brief Partition the points of a binary coordinate file and write the partition to a file.
+
+     Only unit node weights are supported. Memory per process is O(settings.streamChunkSize + k*dimensions)
+     plus the sample used for the initial centers.
+
+     @param[in] coordFile The binary file with the coordinates, 3 doubles per point.
+     @param[in] partFile The file to write the partition to; it can be read with FileIO::readPartition.
+     @param[in] settings Settings struct. Uses numBlocks, dimensions, epsilon and the streaming and k-means parameters.
+     @param[out] metrics Timing and imbalance of every pass are stored here.
+     @param[in] comm The communicator; the file is split among all processes.
+
+     @return The global number of points.
+     */
+    static IndexType partitionFromFile(
+        const std::string coordFile,
+        const std::string partFile,
+        Settings settings,
+        Metrics<ValueType>& metrics,
+        const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr() );
+
+private:
+
+    /** Returns the block ID with the smallest effective distance for every point of the chunk.
+
+     @param[in] chunk The coordinates of the chunk, chunk[d][i] is the d-th coordinate of point i.
+     @param[in] centers The block centers, centers[b][d].
+     @param[in] influence The influence value of every block.
+     */
+    static std::vector<IndexType> assignChunk(
+        const std::vector<std::vector<ValueType>>& chunk,
+        const std::vector<std::vector<ValueType>>& centers,
+        const std::vector<ValueType>& influence );
+
+    /** Concatenates the local part files of all processes into \p partFile, in the order of the ranks,
+     with collective MPI-IO. The local part file of rank 0 starts with the header line. The local part files are deleted.
+     */
+    static void mergePartFiles(
+        const std::string partFile,
+        const std::string localPartFile,
+        const scai::dmemo::CommunicatorPtr comm );
+};
+
+} /* namespace ITI */
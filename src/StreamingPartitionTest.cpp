@@ -0,0 +1,114 @@
+#include <fstream>
+
+#include <scai/lama.hpp>
+#include <scai/dmemo/BlockDistribution.hpp>
+
+#include "gtest/gtest.h"
+
+#include "StreamingPartition.h"
+#include "FileIO.h"
+#include "GraphUtils.h"
+#include "Settings.h"
+#include "Metrics.h"
+
+
+namespace ITI {
+
+template<typename T>
+class StreamingPartitionTest : public ::testing::Test {
+protected:
+    // the directory of all the meshes used
+    // projectRoot is defined in config.h.in
+    const std::string graphPath = projectRoot+"/meshes/";
+};
+
+using testTypes = ::testing::Types<double,float>;
+TYPED_TEST_SUITE(StreamingPartitionTest, testTypes);
+
+//-----------------------------------------------------------------
+
+TYPED_TEST(StreamingPartitionTest, testReadCoordsBinaryRange) {
+    using ValueType = TypeParam;
+
+    std::string file = StreamingPartitionTest<ValueType>::graphPath + "delaunayTest.graph";
+    std::ifstream f(file);
+    IndexType N, edges;
+    f >> N >> edges;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    //the Schamberger graphs have always 3 coordinates, as the binary format
+    const IndexType dimensions = 3;
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions, comm);
+
+    const std::string binFile = file + "_stream.xyz";
+    FileIO<IndexType, ValueType>::writeCoordsParallel( coords, binFile );
+
+    EXPECT_EQ( FileIO<IndexType, ValueType>::getNumCoordsBinary(binFile), N );
+
+    //every PE reads its local range in several chunks
+    IndexType beginLocalRange, endLocalRange;
+    scai::dmemo::BlockDistribution::getLocalRange(beginLocalRange, endLocalRange, N, comm->getRank(), comm->getSize());
+    const IndexType chunkSize = 17;
+
+    for (IndexType d = 0; d < dimensions; d++) {
+        scai::hmemo::ReadAccess<ValueType> localCoords( coords[d].getLocalValues() );
+
+        for (IndexType chunkBegin = beginLocalRange; chunkBegin < endLocalRange; chunkBegin += chunkSize) {
+            const IndexType chunkEnd = std::min(chunkBegin + chunkSize, endLocalRange);
+            std::vector<std::vector<ValueType>> chunk = FileIO<IndexType, ValueType>::readCoordsBinaryRange( binFile, chunkBegin, chunkEnd, dimensions );
+            ASSERT_EQ( chunk[d].size(), chunkEnd-chunkBegin );
+
+            for (IndexType i = chunkBegin; i < chunkEnd; i++) {
+                EXPECT_EQ( chunk[d][i-chunkBegin], localCoords[i-beginLocalRange] );
+            }
+        }
+    }
+
+    //reading past the end of the file must fail
+    EXPECT_THROW( FileIO<IndexType, ValueType>::readCoordsBinaryRange( binFile, N-1, N+1, dimensions ), std::runtime_error );
+}
+//-----------------------------------------------------------------
+
+TYPED_TEST(StreamingPartitionTest, testPartitionFromFile) {
+    using ValueType = TypeParam;
+
+    std::string file = StreamingPartitionTest<ValueType>::graphPath + "delaunayTest.graph";
+    std::ifstream f(file);
+    IndexType N, edges;
+    f >> N >> edges;
+
+    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, 3, comm);
+    const std::string binFile = file + "_stream.xyz";
+    FileIO<IndexType, ValueType>::writeCoordsParallel( coords, binFile );
+
+    Settings settings;
+    settings.dimensions = 2; //the third coordinate is always 0
+    settings.numBlocks = 8;
+    settings.epsilon = 0.05;
+    settings.streaming = true;
+    settings.streamChunkSize = N/(7*comm->getSize()) + 1;
+    settings.streamSampleSize = N/4;
+    settings.streamPasses = 30;
+
+    Metrics<ValueType> metrics( settings );
+    const std::string partFile = file + "_stream.part";
+
+    const IndexType globalN = StreamingPartition<IndexType, ValueType>::partitionFromFile( binFile, partFile, settings, metrics, comm );
+    EXPECT_EQ( globalN, N );
+    EXPECT_LE( metrics.MM["streamPasses"], settings.streamPasses );
+    EXPECT_EQ( IndexType(metrics.kmeansProfiling.size()), IndexType(metrics.MM["streamPasses"]) );
+
+    //the partition file can be read like any other partition
+    DenseVector<IndexType> partition = FileIO<IndexType, ValueType>::readPartition( partFile, N );
+    EXPECT_EQ( partition.size(), N );
+    EXPECT_GE( partition.min(), 0 );
+    EXPECT_LE( partition.max(), settings.numBlocks-1 );
+
+    const ValueType imbalance = GraphUtils<IndexType, ValueType>::computeImbalance( partition, settings.numBlocks );
+    EXPECT_NEAR( imbalance, metrics.MM["finalImbalance"], 1e-5 );
+}
+
+} /* namespace ITI */
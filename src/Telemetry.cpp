@@ -0,0 +1,347 @@
+#include "Telemetry.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <numeric>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include <scai/tracing.hpp>
+
+namespace ITI {
+
+std::vector<std::string> Telemetry::scopes;
+std::map<std::string, Telemetry::TimerEntry> Telemetry::timers;
+std::map<std::string, double> Telemetry::counters;
+
+namespace {
+
+/** Minimum, maximum, sum and number of processes of values that only some processes have. */
+struct Aggregate {
+    std::vector<double> min;
+    std::vector<double> max;
+    std::vector<double> sum;
+    std::vector<double> numProcesses;
+};
+
+Aggregate aggregateOverProcesses(const std::vector<double>& values, const std::vector<bool>& present, const scai::dmemo::CommunicatorPtr comm) {
+    const IndexType n = values.size();
+    Aggregate result;
+    result.min.resize(n);
+    result.max.resize(n);
+    result.sum.resize(n);
+    result.numProcesses.resize(n);
+
+    std::vector<double> localMin(n), localMax(n), localSum(n), localPresent(n);
+    for (IndexType i = 0; i < n; i++) {
+        localMin[i] = present[i] ? values[i] : std::numeric_limits<double>::max();
+        localMax[i] = present[i] ? values[i] : std::numeric_limits<double>::lowest();
+        localSum[i] = present[i] ? values[i] : 0;
+        localPresent[i] = present[i] ? 1 : 0;
+    }
+
+    const scai::common::ScalarType stype = scai::common::TypeTraits<double>::stype;
+    comm->minImpl(result.min.data(), localMin.data(), n, stype);
+    comm->maxImpl(result.max.data(), localMax.data(), n, stype);
+    comm->sumImpl(result.sum.data(), localSum.data(), n, stype);
+    comm->sumImpl(result.numProcesses.data(), localPresent.data(), n, stype);
+
+    return result;
+}
+
+void writeStatistics(std::ostream& out, const Aggregate& aggr, const IndexType i) {
+    const double avg = aggr.numProcesses[i] > 0 ? aggr.sum[i]/aggr.numProcesses[i] : 0;
+    out << "\"min\": " << aggr.min[i] << ", \"max\": " << aggr.max[i] << ", \"avg\": " << avg
+        << ", \"sum\": " << aggr.sum[i] << ", \"processes\": " << aggr.numProcesses[i];
+}
+
+/** JSON has no infinity or NaN, these are written as null. */
+void writeNumber(std::ostream& out, const double value) {
+    if (std::isfinite(value)) {
+        out << value;
+    } else {
+        out << "null";
+    }
+}
+
+} // anonymous namespace
+
+//---------------------------------------------------------------------------------------
+
+Telemetry::ScopedTimer::ScopedTimer(const std::string& name) {
+    const std::string path = scopes.empty() ? name : scopes.back() + "/" + name;
+    scopes.push_back(path);
+    start = std::chrono::steady_clock::now();
+}
+
+Telemetry::ScopedTimer::~ScopedTimer() {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    TimerEntry& entry = timers[scopes.back()];
+    entry.seconds += elapsed.count();
+    entry.calls++;
+    //reading /proc is too slow for inner timers, and the peak only grows, so the outermost timer covers all nested ones
+    if (scopes.size() == 1) {
+        entry.peakMemory = memoryUsage().second;
+    }
+    scopes.pop_back();
+}
+
+//---------------------------------------------------------------------------------------
+
+void Telemetry::count(const std::string& name, const double value) {
+    const std::string path = scopes.empty() ? name : scopes.back() + "/" + name;
+    counters[path] += value;
+}
+
+void Telemetry::countCollective(const double bytes) {
+    count("collectives");
+    count("bytesSent", bytes);
+}
+
+//---------------------------------------------------------------------------------------
+
+std::pair<double,double> Telemetry::memoryUsage() {
+    double rss = 0;
+    double peak = 0;
+
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        double kiloBytes;
+        fields >> key >> kiloBytes;
+        if (key == "VmRSS:") {
+            rss = kiloBytes*1024;
+        } else if (key == "VmHWM:") {
+            peak = kiloBytes*1024;
+        }
+    }
+
+    return std::make_pair(rss, peak);
+}
+
+void Telemetry::reset() {
+    scopes.clear();
+    timers.clear();
+    counters.clear();
+}
+
+//---------------------------------------------------------------------------------------
+
+std::vector<std::string> Telemetry::globalNames(const std::vector<std::string>& localNames, const scai::dmemo::CommunicatorPtr comm) {
+    const IndexType numPEs = comm->getSize();
+    const IndexType rootPE = 0;
+    const bool isRoot = comm->getRank() == rootPE;
+
+    // all names of this process, each one terminated by a 0
+    std::vector<IndexType> localChars;
+    for (const std::string& name : localNames) {
+        for (const char c : name) {
+            localChars.push_back( static_cast<unsigned char>(c) );
+        }
+        localChars.push_back(0);
+    }
+
+    // only the root gets the names of all processes, the others only get the deduplicated list
+    IndexType numLocalChars = localChars.size();
+    std::vector<IndexType> numChars(isRoot ? numPEs : 1, 0);
+    comm->gather(numChars.data(), 1, rootPE, &numLocalChars);
+
+    const IndexType sumChars = isRoot ? std::accumulate(numChars.begin(), numChars.end(), IndexType(0)) : 1;
+    std::vector<IndexType> allChars(std::max<IndexType>(sumChars, 1), 0);
+    comm->gatherV(allChars.data(), numLocalChars, rootPE, localChars.data(), numChars.data());
+
+    std::vector<IndexType> uniqueChars;
+    if (isRoot) {
+        std::set<std::string> names;
+        std::string name;
+        for (IndexType i = 0; i < sumChars; i++) {
+            if (allChars[i] == 0) {
+                names.insert(name);
+                name.clear();
+            } else {
+                name.push_back( static_cast<char>(allChars[i]) );
+            }
+        }
+        for (const std::string& uniqueName : names) {
+            for (const char c : uniqueName) {
+                uniqueChars.push_back( static_cast<unsigned char>(c) );
+            }
+            uniqueChars.push_back(0);
+        }
+    }
+
+    IndexType numUniqueChars = uniqueChars.size();
+    comm->bcast(&numUniqueChars, 1, rootPE);
+    uniqueChars.resize(numUniqueChars);
+    comm->bcast(uniqueChars.data(), numUniqueChars, rootPE);
+
+    // the root sorted the names, so all processes get them in the same order
+    std::vector<std::string> result;
+    std::string name;
+    for (const IndexType c : uniqueChars) {
+        if (c == 0) {
+            result.push_back(name);
+            name.clear();
+        } else {
+            name.push_back( static_cast<char>(c) );
+        }
+    }
+
+    return result;
+}
+
+std::string Telemetry::jsonString(const std::string& s) {
+    std::string result = "\"";
+    for (const char c : s) {
+        if (c == '"' or c == '\\') {
+            result.push_back('\\');
+        }
+        result.push_back(c);
+    }
+    return result + "\"";
+}
+
+//---------------------------------------------------------------------------------------
+
+void Telemetry::writeJSON(std::ostream& out, const scai::dmemo::CommunicatorPtr comm, const std::map<std::string,double>& metrics) {
+    SCAI_REGION("Telemetry.writeJSON");
+
+    const IndexType numPEs = comm->getSize();
+    const IndexType rank = comm->getRank();
+
+    //
+    // timers
+    //
+
+    std::vector<std::string> localTimerNames;
+    for (const auto& timer : timers) {
+        localTimerNames.push_back(timer.first);
+    }
+    const std::vector<std::string> timerNames = globalNames(localTimerNames, comm);
+    const IndexType numTimers = timerNames.size();
+
+    std::vector<double> seconds(numTimers, 0), calls(numTimers, 0), peakMemory(numTimers, 0);
+    std::vector<bool> timerPresent(numTimers, false);
+    for (IndexType i = 0; i < numTimers; i++) {
+        auto it = timers.find(timerNames[i]);
+        if (it != timers.end()) {
+            seconds[i] = it->second.seconds;
+            calls[i] = it->second.calls;
+            peakMemory[i] = it->second.peakMemory;
+            timerPresent[i] = true;
+        }
+    }
+    const Aggregate timeAggr = aggregateOverProcesses(seconds, timerPresent, comm);
+    const Aggregate callAggr = aggregateOverProcesses(calls, timerPresent, comm);
+    const Aggregate memoryAggr = aggregateOverProcesses(peakMemory, timerPresent, comm);
+
+    //
+    // counters
+    //
+
+    std::vector<std::string> localCounterNames;
+    for (const auto& counter : counters) {
+        localCounterNames.push_back(counter.first);
+    }
+    const std::vector<std::string> counterNames = globalNames(localCounterNames, comm);
+    const IndexType numCounters = counterNames.size();
+
+    std::vector<double> counterValues(numCounters, 0);
+    std::vector<bool> counterPresent(numCounters, false);
+    for (IndexType i = 0; i < numCounters; i++) {
+        auto it = counters.find(counterNames[i]);
+        if (it != counters.end()) {
+            counterValues[i] = it->second;
+            counterPresent[i] = true;
+        }
+    }
+    const Aggregate counterAggr = aggregateOverProcesses(counterValues, counterPresent, comm);
+
+    //
+    // memory of every process
+    //
+
+    const std::pair<double,double> memory = memoryUsage();
+    std::vector<double> rssPerRank(numPEs, 0), peakPerRank(numPEs, 0);
+    rssPerRank[rank] = memory.first;
+    peakPerRank[rank] = memory.second;
+    comm->sumImpl(rssPerRank.data(), rssPerRank.data(), numPEs, scai::common::TypeTraits<double>::stype);
+    comm->sumImpl(peakPerRank.data(), peakPerRank.data(), numPEs, scai::common::TypeTraits<double>::stype);
+
+    if (rank != 0) {
+        return;
+    }
+
+    auto oldPrecision = out.precision(std::numeric_limits<double>::max_digits10);
+
+    out << "{" << std::endl;
+    out << "  \"numProcesses\": " << numPEs << "," << std::endl;
+
+    out << "  \"timers\": {";
+    for (IndexType i = 0; i < numTimers; i++) {
+        out << (i > 0 ? "," : "") << std::endl << "    " << jsonString(timerNames[i]) << ": {\"seconds\": {";
+        writeStatistics(out, timeAggr, i);
+        out << "}, \"calls\": " << callAggr.max[i];
+        if (timerNames[i].find('/') == std::string::npos) {
+            out << ", \"maxPeakMemory\": " << memoryAggr.max[i];
+        }
+        out << "}";
+    }
+    out << std::endl << "  }," << std::endl;
+
+    out << "  \"counters\": {";
+    for (IndexType i = 0; i < numCounters; i++) {
+        out << (i > 0 ? "," : "") << std::endl << "    " << jsonString(counterNames[i]) << ": {";
+        writeStatistics(out, counterAggr, i);
+        out << "}";
+    }
+    out << std::endl << "  }," << std::endl;
+
+    out << "  \"memory\": {" << std::endl;
+    for (const auto& perRank : {std::make_pair("rss", &rssPerRank), std::make_pair("peak", &peakPerRank)}) {
+        const std::vector<double>& values = *perRank.second;
+        out << "    " << jsonString(perRank.first) << ": {\"min\": " << *std::min_element(values.begin(), values.end())
+            << ", \"max\": " << *std::max_element(values.begin(), values.end())
+            << ", \"avg\": " << std::accumulate(values.begin(), values.end(), 0.0)/numPEs << ", \"perRank\": [";
+        for (IndexType p = 0; p < numPEs; p++) {
+            out << (p > 0 ? ", " : "") << values[p];
+        }
+        out << "]}" << (perRank.second == &rssPerRank ? "," : "") << std::endl;
+    }
+    out << "  }," << std::endl;
+
+    out << "  \"metrics\": {";
+    bool first = true;
+    for (const auto& metric : metrics) {
+        out << (first ? "" : ",") << std::endl << "    " << jsonString(metric.first) << ": ";
+        writeNumber(out, metric.second);
+        first = false;
+    }
+    out << std::endl << "  }" << std::endl;
+    out << "}" << std::endl;
+
+    out.precision(oldPrecision);
+}
+
+void Telemetry::writeJSON(const std::string filename, const scai::dmemo::CommunicatorPtr comm, const std::map<std::string,double>& metrics) {
+    if (filename == "-") {
+        return;
+    }
+
+    std::ofstream outF;
+    if (comm->getRank() == 0) {
+        outF.open(filename);
+        if (outF.fail()) {
+            std::cout << "Could not open file " << filename << ", telemetry not stored" << std::endl;
+        }
+    }
+    writeJSON(outF, comm, metrics);
+}
+
+} /* namespace ITI */
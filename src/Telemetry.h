@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <ostream>
+
+#include <scai/dmemo/Communicator.hpp>
+
+#include "Settings.h"
+
+namespace ITI {
+
+/** @brief Timers, counters and memory usage that are always available, reported as JSON.
+
+Timers nest: a timer started while another one is running is stored below it, e.g., "partitionGraph/kMeans".
+Counters are stored below the innermost running timer, e.g., "partitionGraph/kMeans/bytesSent".
+Everything is local to the process until writeJSON, which reports the minimum, maximum and average
+over all processes.
+
+The state is global and not thread safe: timers and counters must not be used inside OpenMP parallel regions.
+The overhead is a map lookup per timer or counter update, so they belong to phases, not to inner loops.
+*/
+class Telemetry {
+public:
+
+    /** Adds the wall time between construction and destruction to the timer \p name below the running timers.
+    If no other timer is running, the peak memory usage is sampled at destruction as well.
+    */
+    class ScopedTimer {
+    public:
+        ScopedTimer(const std::string& name);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        std::chrono::time_point<std::chrono::steady_clock> start;
+    };
+
+    /** Add \p value to the counter \p name below the running timers. */
+    static void count(const std::string& name, const double value = 1);
+
+    /** Count a collective operation or data exchange that sends \p bytes bytes from this process.
+    Updates the counters "collectives" and "bytesSent".
+    */
+    static void countCollective(const double bytes);
+
+    /** The resident set size and its peak, in bytes, read from /proc/self/status; 0 where this is not available. */
+    static std::pair<double,double> memoryUsage();
+
+    /** Remove all timers and counters. */
+    static void reset();
+
+    /** Write the report of all processes as a JSON object. This is collective, only rank 0 writes to \p out.
+
+    @param[out] out The stream to write to.
+    @param[in] comm The communicator of all processes that take part.
+    @param[in] metrics Additional values, e.g., Metrics::MM, that are written unchanged.
+    */
+    static void writeJSON(std::ostream& out, const scai::dmemo::CommunicatorPtr comm, const std::map<std::string,double>& metrics = {});
+
+    /** Like writeJSON, but into the file \p filename. Collective; does nothing if \p filename is "-". */
+    static void writeJSON(const std::string filename, const scai::dmemo::CommunicatorPtr comm, const std::map<std::string,double>& metrics = {});
+
+private:
+
+    struct TimerEntry {
+        double seconds = 0;
+        double calls = 0;
+        double peakMemory = 0;     ///< the peak resident set size at the end of the last call, only for timers that are not nested
+    };
+
+    /** The union of \p localNames over all processes, sorted. The names are gathered on the root only, which broadcasts the deduplicated list. */
+    static std::vector<std::string> globalNames(const std::vector<std::string>& localNames, const scai::dmemo::CommunicatorPtr comm);
+
+    static std::string jsonString(const std::string& s);
+
+    static std::vector<std::string> scopes;            ///< the paths of the running timers, innermost last
+    static std::map<std::string, TimerEntry> timers;
+    static std::map<std::string, double> counters;
+};
+
+} /* namespace ITI */
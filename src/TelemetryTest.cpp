@@ -0,0 +1,78 @@
+#include <sstream>
+
+#include <scai/dmemo/Communicator.hpp>
+
+#include "gtest/gtest.h"
+
+#include "Telemetry.h"
+
+
+namespace ITI {
+
+class TelemetryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Telemetry::reset();
+    }
+
+    void TearDown() override {
+        Telemetry::reset();
+    }
+};
+
+//-----------------------------------------------------------------
+
+TEST_F(TelemetryTest, testNestedTimersAndCounters) {
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    {
+        Telemetry::ScopedTimer outer("outer");
+        for (IndexType i = 0; i < 3; i++) {
+            Telemetry::ScopedTimer inner("inner");
+            Telemetry::countCollective(100);
+        }
+        // only some processes have this counter, it must still appear in the report
+        if (comm->getRank() == comm->getSize()-1) {
+            Telemetry::count("lastRankOnly", 2);
+        }
+    }
+
+    std::map<std::string,double> metrics;
+    metrics["finalCut"] = 42;
+
+    std::ostringstream out;
+    Telemetry::writeJSON(out, comm, metrics);
+    const std::string json = out.str();
+
+    if (comm->getRank() == 0) {
+        EXPECT_NE(json.find("\"outer\""), std::string::npos);
+        EXPECT_NE(json.find("\"outer/inner\": {\"seconds\""), std::string::npos);
+        EXPECT_NE(json.find("\"calls\": 3"), std::string::npos);
+        EXPECT_NE(json.find("\"outer/inner/collectives\""), std::string::npos);
+        EXPECT_NE(json.find("\"outer/inner/bytesSent\": {\"min\": 300"), std::string::npos);
+        EXPECT_NE(json.find("\"outer/lastRankOnly\""), std::string::npos);
+        EXPECT_NE(json.find("\"finalCut\": 42"), std::string::npos);
+
+        // the memory is only sampled by the outermost timer
+        const size_t outerBegin = json.find("\"outer\": {");
+        const size_t innerBegin = json.find("\"outer/inner\": {");
+        ASSERT_NE(outerBegin, std::string::npos);
+        ASSERT_NE(innerBegin, std::string::npos);
+        const std::string outerLine = json.substr(outerBegin, json.find('\n', outerBegin) - outerBegin);
+        const std::string innerLine = json.substr(innerBegin, json.find('\n', innerBegin) - innerBegin);
+        EXPECT_NE(outerLine.find("\"maxPeakMemory\""), std::string::npos);
+        EXPECT_EQ(innerLine.find("\"maxPeakMemory\""), std::string::npos);
+        EXPECT_EQ(json.front(), '{');
+    } else {
+        EXPECT_TRUE(json.empty());
+    }
+}
+//-----------------------------------------------------------------
+
+TEST_F(TelemetryTest, testMemoryUsage) {
+    const std::pair<double,double> memory = Telemetry::memoryUsage();
+    EXPECT_GE(memory.first, 0);
+    EXPECT_GE(memory.second, memory.first);
+}
+
+} /* namespace ITI */
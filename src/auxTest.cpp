@@ -483,6 +483,117 @@ TYPED_TEST(auxTest, testRedistributeFromPartition) {
 }
 
 
+TYPED_TEST(auxTest, testRedistributePacked) {
+
+    using ValueType = TypeParam;
+
+    std::string file = auxTest<ValueType>::graphPath + "Grid8x8";
+    const IndexType dimensions = 2;
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file, comm);
+    const IndexType N = graph.getNumRows();
+    std::vector<DenseVector<ValueType>> coordinates = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions, comm);
+
+    const scai::dmemo::DistributionPtr inputDist = graph.getRowDistributionPtr();
+    const IndexType localN = inputDist->getLocalSize();
+
+    //the weight of a vertex is its global index
+    DenseVector<ValueType> nodeWeights(inputDist, 0);
+    for (IndexType i = 0; i < localN; i++) {
+        nodeWeights.getLocalValues()[i] = inputDist->local2Global(i);
+    }
+
+    srand( comm->getRank() );
+    DenseVector<IndexType> partition(inputDist, 0);
+    for (IndexType i = 0; i < localN; i++) {
+        partition.getLocalValues()[i] = rand() % comm->getSize();
+    }
+
+    scai::dmemo::RedistributePlan redistributor = scai::dmemo::redistributePlanByNewOwners( partition.getLocalValues(), inputDist );
+    const scai::dmemo::DistributionPtr targetDist = redistributor.getTargetDistributionPtr();
+
+    //the reference: every vector redistributed on its own
+    std::vector<DenseVector<ValueType>> expectedCoords = coordinates;
+    for (IndexType d = 0; d < dimensions; d++) {
+        expectedCoords[d].redistribute(redistributor);
+    }
+    DenseVector<ValueType> expectedWeights = nodeWeights;
+    expectedWeights.redistribute(redistributor);
+
+    std::vector<DenseVector<ValueType>*> pointData = {&coordinates[0], &nodeWeights, &coordinates[1]};
+    aux<IndexType, ValueType>::redistributePacked( redistributor, pointData );
+
+    const IndexType newLocalN = targetDist->getLocalSize();
+    EXPECT_TRUE( nodeWeights.getDistribution().isEqual(*targetDist) );
+    scai::hmemo::ReadAccess<ValueType> rWeights( nodeWeights.getLocalValues() );
+    scai::hmemo::ReadAccess<ValueType> rExpectedWeights( expectedWeights.getLocalValues() );
+    for (IndexType i = 0; i < newLocalN; i++) {
+        EXPECT_EQ( rWeights[i], rExpectedWeights[i] );
+        EXPECT_EQ( rWeights[i], targetDist->local2Global(i) );
+    }
+
+    for (IndexType d = 0; d < dimensions; d++) {
+        EXPECT_TRUE( coordinates[d].getDistribution().isEqual(*targetDist) );
+        scai::hmemo::ReadAccess<ValueType> rCoords( coordinates[d].getLocalValues() );
+        scai::hmemo::ReadAccess<ValueType> rExpectedCoords( expectedCoords[d].getLocalValues() );
+        for (IndexType i = 0; i < newLocalN; i++) {
+            EXPECT_EQ( rCoords[i], rExpectedCoords[i] );
+        }
+    }
+}
+
+//-----------------------------------------------------------------
+
+TYPED_TEST(auxTest, testRedistributeInputMismatchedDistribution) {
+
+    using ValueType = TypeParam;
+
+    std::string file = auxTest<ValueType>::graphPath + "Grid8x8";
+    const IndexType dimensions = 2;
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
+
+    CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file, comm);
+    const IndexType N = graph.getNumRows();
+    std::vector<DenseVector<ValueType>> coordinates = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), N, dimensions, comm);
+
+    const scai::dmemo::DistributionPtr inputDist = graph.getRowDistributionPtr();
+    const IndexType localN = inputDist->getLocalSize();
+
+    //the node weights and the partition do not have the distribution of the graph
+    const scai::dmemo::DistributionPtr cyclicDist = scai::dmemo::Distribution::getDistributionPtr( "CYCLIC", comm, N );
+    std::vector<DenseVector<ValueType>> nodeWeights(1, DenseVector<ValueType>(cyclicDist, 0));
+    for (IndexType i = 0; i < cyclicDist->getLocalSize(); i++) {
+        nodeWeights[0].getLocalValues()[i] = cyclicDist->local2Global(i);
+    }
+
+    srand( comm->getRank() );
+    DenseVector<IndexType> owners(inputDist, 0);
+    for (IndexType i = 0; i < localN; i++) {
+        owners.getLocalValues()[i] = rand() % comm->getSize();
+    }
+    scai::dmemo::RedistributePlan redistributor = scai::dmemo::redistributePlanByNewOwners( owners.getLocalValues(), inputDist );
+    const scai::dmemo::DistributionPtr targetDist = redistributor.getTargetDistributionPtr();
+
+    DenseVector<IndexType> partition(cyclicDist, comm->getRank());
+
+    aux<IndexType, ValueType>::redistributeInput( redistributor, partition, graph, coordinates, nodeWeights );
+
+    EXPECT_TRUE( graph.getRowDistribution().isEqual(*targetDist) );
+    EXPECT_TRUE( partition.getDistribution().isEqual(*targetDist) );
+    for (IndexType d = 0; d < dimensions; d++) {
+        EXPECT_TRUE( coordinates[d].getDistribution().isEqual(*targetDist) );
+    }
+    EXPECT_TRUE( nodeWeights[0].getDistribution().isEqual(*targetDist) );
+
+    scai::hmemo::ReadAccess<ValueType> rWeights( nodeWeights[0].getLocalValues() );
+    for (IndexType i = 0; i < targetDist->getLocalSize(); i++) {
+        EXPECT_EQ( rWeights[i], targetDist->local2Global(i) );
+    }
+}
+
+//-----------------------------------------------------------------
+
 TYPED_TEST(auxTest, benchmarkRedistributeFromPartition) {
 
     using ValueType = TypeParam;
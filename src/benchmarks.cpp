@@ -1,131 +1,466 @@
-#include "gtest/gtest.h"
+/**
+ * @file benchmarks.cpp
+ *
+ * Benchmarks of the performance critical kernels on generated structured meshes, built as the target geographer_bench.
+ *
+ * Every benchmark runs on meshes of several side lengths and reports one JSON object per line and mesh, with the commit,
+ * the number of processes and threads and the time of every repetition. The time of a repetition is the maximum over
+ * all processes. Example, for 2D meshes with 128^2, 512^2 and 2048^2 points on 8 processes with 4 threads each:
+ *
+ *     mpirun -np 8 ./geographer_bench --sizes 128,512,2048 --dimensions 2 --threads 4 --outFile bench.jsonl
+ *
+ * With --benchmarks, a comma separated subset can be chosen; --help lists all options. For the thread scaling of the
+ * local kernels, run the same total number of cores with e.g. one process per core and one process per socket.
+ */
+
+#include <scai/lama.hpp>
+#include <scai/dmemo/BlockDistribution.hpp>
+#include <scai/dmemo/NoDistribution.hpp>
+
+#include <omp.h>
+
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <limits>
+#include <cstdint>
+
+#include <cxxopts.hpp>
 
-#include "Mapping.h"
-#include "GraphUtils.h"
-#include "FileIO.h"
-#include "Metrics.h"
 #include "Settings.h"
+#include "Metrics.h"
+#include "MeshGenerator.h"
+#include "FileIO.h"
+#include "GraphUtils.h"
+#include "HilbertCurve.h"
 #include "KMeans.h"
-#include "CommTree.h"
+#include "MultiSection.h"
+#include "MultiLevel.h"
+#include "LocalRefinement.h"
 #include "ParcoRepart.h"
+#include "AuxiliaryFunctions.h"
+#include "Telemetry.h"
+#include "quadtree/QuadNodeCartesianEuclid.h"
 
+using namespace ITI;
+typedef double ValueType;
 
-namespace ITI {
-
-class benchmarkTest : public ::testing::Test {
-protected:
-    // the directory of all the meshes used
-    std::string graphPath = "./meshes/";
-};
-
-
-TEST_F( benchmarkTest, benchMapping ) {
+namespace {
 
-    //std::string fileName = "Grid32x32";
-    //std::string fileName = "slowrot-00000.graph";
-    std::string fileName = "bubbles-00010.graph";
-    std::string file = graphPath + fileName;
-    const IndexType dimensions = 2;
+const std::vector<std::string> allBenchmarks = {"hilbert", "findCenters", "assignBlocks", "kmeans", "projection", "coarsen", "localFM", "borderDiffusion", "blockGraph", "commVolume", "readMetis", "redistribute"};
 
-    Settings settings;
-    settings.dimensions = dimensions;
-    settings.numBlocks = 8;
-    settings.noRefinement = true;
-    settings.writePEgraph = true;
-    settings.writeInFile = true;
-    settings.storeInfo = true;
-
-    const IndexType k = settings.numBlocks;
-
-    //
-    // 1 - read graph, coordinates and create unit nodeweights
-    //
-
-    scai::lama::CSRSparseMatrix<ValueType> graph = FileIO<IndexType, ValueType>::readGraph(file );
-    IndexType globalN = graph.getNumRows();
-
-    std::vector<DenseVector<ValueType>> coords = FileIO<IndexType, ValueType>::readCoords( std::string(file + ".xyz"), globalN, dimensions);
-
-    std::vector<scai::lama::DenseVector<ValueType>> unitWeights(2, scai::lama::DenseVector<ValueType>(graph.getRowDistributionPtr(), 1));
-
-    //
-    // 2 - read the PE graph
-    //
-
-    std::string PEfile = "./meshes/PEgraphs/myPEgraph8.txt";
-    CommTree<IndexType,ValueType> cTree = FileIO<IndexType, ValueType>::readPETree( PEfile );
-    cTree.adaptWeights( unitWeights );
+struct BenchmarkOptions {
+    IndexType dimensions = 2;
+    IndexType numBlocks = 0;        ///< 0 means the number of processes
+    IndexType repetitions = 5;
+    IndexType warmup = 1;           ///< untimed runs before the repetitions
+    IndexType threads = 1;
+    std::string tmpDir = ".";       ///< where the METIS files for readMetis are written
+};
 
-    const scai::lama::CSRSparseMatrix<ValueType> PEGraph = cTree.exportAsGraph_local();
+/** A generated mesh with block distributed graph, coordinates and unit node weights. */
+struct Mesh {
+    IndexType sideLen;
+    IndexType n;
+    IndexType edges;
+    CSRSparseMatrix<ValueType> graph;
+    std::vector<DenseVector<ValueType>> coords;
+    std::vector<DenseVector<ValueType>> nodeWeights;
+};
 
-    SCAI_ASSERT_EQ_ERROR( PEGraph.getNumRows(), k, "Wrong number of rows/vertices" );
-    SCAI_ASSERT_LE_ERROR( scai::utilskernel::HArrayUtils::max(PEGraph.getLocalStorage().getIA() ), PEGraph.getNumValues(), "some ia value is too large" );
-    if( settings.writePEgraph ) {
-        FileIO<IndexType,ValueType>::writeGraph( PEGraph, "peFromTree"+std::to_string(k)+".graph", 1);
+Mesh generateMesh(const IndexType sideLen, const IndexType dimensions, const scai::dmemo::CommunicatorPtr comm) {
+    Mesh mesh;
+    mesh.sideLen = sideLen;
+    mesh.n = 1;
+    for (IndexType d = 0; d < dimensions; d++) {
+        mesh.n *= sideLen;
     }
 
-    //
-    // 3 - read and partition graph without using the PEgraph
-    //
+    scai::dmemo::DistributionPtr dist(new scai::dmemo::BlockDistribution(mesh.n, comm));
+    scai::dmemo::DistributionPtr noDist(new scai::dmemo::NoDistribution(mesh.n));
+    mesh.graph = scai::lama::zero<CSRSparseMatrix<ValueType>>(dist, noDist);
 
-    settings.initialPartition = InitialPartitioningMethods::KMeans;
-    struct Metrics metrics(settings);
+    const std::vector<ValueType> maxCoord(dimensions, sideLen);
+    const std::vector<IndexType> numPoints(dimensions, sideLen);
+    mesh.coords.resize(dimensions);
+    for (IndexType d = 0; d < dimensions; d++) {
+        mesh.coords[d] = DenseVector<ValueType>(dist, 0);
+    }
+    MeshGenerator<IndexType, ValueType>::createStructuredMesh_dist(mesh.graph, mesh.coords, maxCoord, numPoints, dimensions);
+
+    mesh.nodeWeights = std::vector<DenseVector<ValueType>>(1, DenseVector<ValueType>(dist, 1));
+    mesh.edges = mesh.graph.getNumValues()/2;
+    return mesh;
+}
+
+/** A partition into k slabs along the global node IDs, i.e., along the last mesh dimension. */
+DenseVector<IndexType> slabPartition(const scai::dmemo::DistributionPtr dist, const IndexType k) {
+    const IndexType n = dist->getGlobalSize();
+    const IndexType localN = dist->getLocalSize();
+    DenseVector<IndexType> part(dist, 0);
+    {
+        scai::hmemo::WriteAccess<IndexType> wPart(part.getLocalValues());
+        for (IndexType i = 0; i < localN; i++) {
+            wPart[i] = (std::int64_t(dist->local2Global(i))*k)/n;
+        }
+    }
+    return part;
+}
+
+/** Time \p kernel, calling \p prepare untimed before every run. Returns the maximum time over all processes of every repetition. */
+std::vector<double> timeKernel(const std::function<void()>& prepare, const std::function<void()>& kernel, const BenchmarkOptions& options, const scai::dmemo::CommunicatorPtr comm) {
+    std::vector<double> seconds;
+    for (IndexType r = -options.warmup; r < options.repetitions; r++) {
+        prepare();
+        comm->synchronize();
+        std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        kernel();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double maxTime = comm->max(elapsed.count());
+        if (r >= 0) {
+            seconds.push_back(maxTime);
+        }
+    }
+    return seconds;
+}
+
+/** Write the result of one benchmark as one line of JSON. */
+void writeResult(std::ostream& out, const std::string& name, const Mesh& mesh, const IndexType numBlocks, const IndexType items, std::vector<double> seconds, const BenchmarkOptions& options, const scai::dmemo::CommunicatorPtr comm) {
+    const double peakMemory = comm->max(Telemetry::memoryUsage().second);
+    if (comm->getRank() != 0) {
+        return;
+    }
 
-    std::vector<std::vector<ValueType>> balances = cTree.getBalanceVectors( -1 );
-    SCAI_ASSERT_EQ_ERROR( balances.size(), 2, "Wrong number of balance constrains");
-    SCAI_ASSERT_EQ_ERROR( balances[0].size(), k, "Wrong size of balance vector");
+    auto oldPrecision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << "{\"benchmark\": \"" << name << "\", \"commit\": \"" << version << "\"";
+    out << ", \"dimensions\": " << options.dimensions << ", \"sideLen\": " << mesh.sideLen << ", \"n\": " << mesh.n << ", \"edges\": " << mesh.edges;
+    out << ", \"numBlocks\": " << numBlocks << ", \"processes\": " << comm->getSize() << ", \"threads\": " << options.threads;
+    out << ", \"seconds\": [";
+    for (IndexType r = 0; r < IndexType(seconds.size()); r++) {
+        out << (r > 0 ? ", " : "") << seconds[r];
+    }
+    out << "]";
+
+    std::sort(seconds.begin(), seconds.end());
+    const double median = seconds[seconds.size()/2];
+    out << ", \"minSeconds\": " << seconds.front() << ", \"medianSeconds\": " << median;
+    out << ", \"itemsPerSecond\": " << (median > 0 ? items/median : 0) << ", \"maxPeakMemory\": " << peakMemory << "}" << std::endl;
+    out.precision(oldPrecision);
+}
+
+/** Run the benchmark \p name on \p mesh. Returns false if it is not applicable to this configuration. */
+bool runBenchmark(const std::string& name, Mesh& mesh, const BenchmarkOptions& options, std::ostream& out, const scai::dmemo::CommunicatorPtr comm) {
+    const scai::dmemo::DistributionPtr dist = mesh.graph.getRowDistributionPtr();
+    const IndexType localN = dist->getLocalSize();
+    const IndexType dim = options.dimensions;
+    const IndexType p = comm->getSize();
+    const IndexType k = options.numBlocks > 0 ? options.numBlocks : p;
+    const std::function<void()> noPreparation = [](){};
 
+    Settings settings;
+    settings.dimensions = dim;
+    settings.numBlocks = k;
+    settings.numThreads = options.threads;
+    Metrics<ValueType> metrics(settings);
+
+    std::vector<double> seconds;
+    IndexType items = mesh.n;
+
+    if (name == "hilbert") {
+        seconds = timeKernel(noPreparation, [&]() {
+            HilbertCurve<IndexType, ValueType>::getHilbertIndexVector(mesh.coords, settings.sfcResolution, dim);
+        }, options, comm);
+
+    } else if (name == "findCenters") {
+        const DenseVector<IndexType> part = slabPartition(dist, k);
+        std::vector<IndexType> localIndices(localN);
+        std::iota(localIndices.begin(), localIndices.end(), 0);
+        seconds = timeKernel(noPreparation, [&]() {
+            KMeans<IndexType, ValueType>::findCenters(mesh.coords, part, k, localIndices.begin(), localIndices.end(), mesh.nodeWeights[0]);
+        }, options, comm);
+
+    } else if (name == "assignBlocks") {
+        // one balanced assignment, starting from the centers of a slab partition
+        std::vector<IndexType> localIndices(localN);
+        std::iota(localIndices.begin(), localIndices.end(), 0);
+        const std::vector<std::vector<ValueType>> centersPerDim = KMeans<IndexType, ValueType>::findCenters(mesh.coords, slabPartition(dist, k), k, localIndices.begin(), localIndices.end(), mesh.nodeWeights[0]);
+        std::vector<ValueType> centers(k*dim);
+        for (IndexType c = 0; c < k; c++) {
+            for (IndexType d = 0; d < dim; d++) {
+                centers[c*dim+d] = centersPerDim[d][c];
+            }
+        }
+
+        std::vector<std::vector<ValueType>> coords(dim);
+        std::vector<ValueType> minCoords(dim), maxCoords(dim);
+        for (IndexType d = 0; d < dim; d++) {
+            scai::hmemo::ReadAccess<ValueType> rCoords(mesh.coords[d].getLocalValues());
+            coords[d].assign(rCoords.get(), rCoords.get()+localN);
+            minCoords[d] = *std::min_element(coords[d].begin(), coords[d].end());
+            maxCoords[d] = *std::max_element(coords[d].begin(), coords[d].end());
+        }
+        const QuadNodeCartesianEuclid<ValueType> boundingBox(minCoords, maxCoords);
+        const CoordinateCache<ValueType> noCache;
+        const std::vector<std::vector<ValueType>> weights(1, std::vector<ValueType>(localN, 1));
+        const std::vector<std::vector<ValueType>> targetBlockWeights(1, std::vector<ValueType>(k, ValueType(mesh.n)/k));
+        const std::vector<IndexType> blockSizesPrefixSum = {0, k};
+        const DenseVector<IndexType> previous(dist, 0);
+        const DenseVector<IndexType> oldBlocks(dist, 0);
+
+        std::vector<ValueType> upperBoundOwnCenter, lowerBoundNextCenter, imbalance, newCenters;
+        std::vector<std::vector<ValueType>> influence, blockWeights;
+        CenterGroups<IndexType, ValueType> groups;
+        seconds = timeKernel([&]() {
+            upperBoundOwnCenter.assign(localN, std::numeric_limits<ValueType>::max());
+            lowerBoundNextCenter.assign(localN, 0);
+            influence.assign(1, std::vector<ValueType>(k, 1));
+            imbalance.assign(1, 1);
+        }, [&]() {
+            KMeans<IndexType, ValueType>::assignBlocks(coords, noCache, centers, blockSizesPrefixSum, localIndices.begin(), localIndices.end(),
+                weights, weights, previous, oldBlocks, targetBlockWeights, boundingBox, upperBoundOwnCenter, lowerBoundNextCenter,
+                groups, influence, imbalance, newCenters, blockWeights, settings, metrics);
+        }, options, comm);
+
+    } else if (name == "kmeans") {
+        // a complete balanced k-means partition, with all its sampling rounds and balance iterations
+        seconds = timeKernel(noPreparation, [&]() {
+            KMeans<IndexType, ValueType>::computePartition(mesh.coords, settings);
+        }, options, comm);
+
+    } else if (name == "projection") {
+        // the projection of the grid cells to every dimension, as in the first step of MultiSection
+        const DenseVector<ValueType> gridWeights(dist, 1);
+        rectangle<ValueType> bBox;
+        bBox.bottom = std::vector<ValueType>(dim, 0);
+        bBox.top = std::vector<ValueType>(dim, mesh.sideLen);
+        const std::shared_ptr<rectCell<IndexType, ValueType>> root(new rectCell<IndexType, ValueType>(bBox));
+        seconds = timeKernel(noPreparation, [&]() {
+            for (IndexType d = 0; d < dim; d++) {
+                MultiSection<IndexType, ValueType>::projection(gridWeights, root, std::vector<IndexType>(1, d), mesh.sideLen, settings);
+            }
+        }, options, comm);
+
+    } else if (name == "coarsen") {
+        const scai::dmemo::HaloExchangePlan halo = GraphUtils<IndexType, ValueType>::buildNeighborHalo(mesh.graph);
+        seconds = timeKernel(noPreparation, [&]() {
+            CSRSparseMatrix<ValueType> coarseGraph;
+            DenseVector<IndexType> fineToCoarse;
+            MultiLevel<IndexType, ValueType>::coarsen(mesh.graph, mesh.nodeWeights[0], halo, mesh.coords, coarseGraph, fineToCoarse, settings);
+        }, options, comm);
+
+    } else if (name == "localFM") {
+        // one round of distributed FM with every process as one block; this calls twoWayLocalFM for every pair of neighbors
+        if (p == 1) {
+            return false;
+        }
+        settings.numBlocks = p;
+        DenseVector<IndexType> initialPart(dist, comm->getRank());
+        CSRSparseMatrix<ValueType> blockGraph = GraphUtils<IndexType, ValueType>::getBlockGraph(mesh.graph, initialPart, p);
+        const std::vector<DenseVector<IndexType>> scheme = ParcoRepart<IndexType, ValueType>::getCommunicationPairs_local(blockGraph, settings);
+
+        CSRSparseMatrix<ValueType> graph;
+        DenseVector<IndexType> part, origin;
+        DenseVector<ValueType> weights;
+        std::vector<DenseVector<ValueType>> coords;
+        std::vector<IndexType> borderNodes;
+        std::vector<ValueType> distances;
+        seconds = timeKernel([&]() {
+            graph = mesh.graph;
+            part = initialPart;
+            origin = DenseVector<IndexType>(dist, comm->getRank());
+            weights = mesh.nodeWeights[0];
+            coords = mesh.coords;
+            borderNodes = GraphUtils<IndexType, ValueType>::getNodesWithNonLocalNeighbors(graph);
+            distances = LocalRefinement<IndexType, ValueType>::distancesFromBlockCenter(coords);
+        }, [&]() {
+            LocalRefinement<IndexType, ValueType>::distributedFMStep(graph, part, borderNodes, weights, coords, distances, origin, scheme, settings);
+        }, options, comm);
+        items = comm->sum(IndexType(GraphUtils<IndexType, ValueType>::getNodesWithNonLocalNeighbors(mesh.graph).size()));
+
+    } else if (name == "borderDiffusion") {
+        // the diffusion of the FM tie-breaking keys, with all local nodes as the border region
+        std::vector<IndexType> borderRegionIDs(localN);
+        for (IndexType i = 0; i < localN; i++) {
+            borderRegionIDs[i] = dist->local2Global(i);
+        }
+        CSRStorage<ValueType> haloStorage;
+        scai::dmemo::HaloExchangePlan halo;
+        LocalRefinement<IndexType, ValueType>::BorderRegionGraph regionGraph;
+        std::vector<ValueType> load;
+        seconds = timeKernel([&]() {
+            // a unit load on every process, it spreads from the first local node
+            load.assign(localN, 0);
+            if (localN > 0) {
+                load[0] = 1;
+            }
+        }, [&]() {
+            LocalRefinement<IndexType, ValueType>::buildBorderRegionGraph(mesh.graph, haloStorage, halo, borderRegionIDs, regionGraph);
+            LocalRefinement<IndexType, ValueType>::diffuseInBorderRegion(regionGraph, 1, settings.diffusionRounds, load);
+        }, options, comm);
+
+    } else if (name == "blockGraph") {
+        const DenseVector<IndexType> part = slabPartition(dist, k);
+        seconds = timeKernel(noPreparation, [&]() {
+            GraphUtils<IndexType, ValueType>::getBlockGraph(mesh.graph, part, k);
+        }, options, comm);
+
+    } else if (name == "commVolume") {
+        const DenseVector<IndexType> part = slabPartition(dist, k);
+        seconds = timeKernel(noPreparation, [&]() {
+            GraphUtils<IndexType, ValueType>::computeCut(mesh.graph, part);
+            GraphUtils<IndexType, ValueType>::computeCommVolume(mesh.graph, part, settings);
+        }, options, comm);
+
+    } else if (name == "readMetis") {
+        const std::string filename = options.tmpDir + "/geographer_bench_" + std::to_string(mesh.sideLen) + "_" + std::to_string(dim) + "d.graph";
+        FileIO<IndexType, ValueType>::writeGraphParallel(mesh.graph, filename);
+        seconds = timeKernel(noPreparation, [&]() {
+            FileIO<IndexType, ValueType>::readGraph(filename, comm);
+        }, options, comm);
+        comm->synchronize();
+        if (comm->getRank() == 0) {
+            std::remove(filename.c_str());
+        }
+
+    } else if (name == "redistribute") {
+        // every row of the mesh goes to the next process in turn, so every process sends to all others
+        DenseVector<IndexType> owners(dist, 0);
+        {
+            scai::hmemo::WriteAccess<IndexType> wOwners(owners.getLocalValues());
+            for (IndexType i = 0; i < localN; i++) {
+                wOwners[i] = (dist->local2Global(i)/mesh.sideLen) % p;
+            }
+        }
+        const scai::dmemo::DistributionPtr targetDist = scai::dmemo::generalDistributionByNewOwners(owners.getDistribution(), owners.getLocalValues());
+
+        CSRSparseMatrix<ValueType> graph;
+        DenseVector<IndexType> part;
+        std::vector<DenseVector<ValueType>> coords, weights;
+        seconds = timeKernel([&]() {
+            graph = mesh.graph;
+            part = owners;
+            coords = mesh.coords;
+            weights = mesh.nodeWeights;
+        }, [&]() {
+            aux<IndexType, ValueType>::redistributeInput(targetDist, part, graph, coords, weights);
+        }, options, comm);
+
+    } else {
+        throw std::invalid_argument("Unknown benchmark " + name);
+    }
 
-    // get partition ParcoRepart::partitionGraph to accept constrains
-    scai::lama::DenseVector<IndexType> partition = ParcoRepart<IndexType, ValueType>::partitionGraph(graph, coords, unitWeights, balances, settings, metrics);
-    ASSERT_EQ(globalN, partition.size());
+    writeResult(out, name, mesh, settings.numBlocks, items, seconds, options, comm);
+    return true;
+}
 
-    //
-    // 4 - partition graph with the PEgraph
-    //
+std::vector<std::string> splitList(const std::string& list) {
+    std::stringstream ss(list);
+    std::string item;
+    std::vector<std::string> result;
+    while (!std::getline(ss, item, ',').fail()) {
+        result.push_back(item);
+    }
+    return result;
+}
 
-    //read graph again or redistribute because the previous partition might have change it
-    scai::lama::CSRSparseMatrix<ValueType> graph2 = FileIO<IndexType, ValueType>::readGraph(file );
+} // anonymous namespace
 
-    struct Metrics metrics2( settings );
+//----------------------------------------------------------------------------
 
-    scai::lama::DenseVector<IndexType> partitionWithPE = ITI::KMeans::computeHierarchicalPartition(  \
-            graph2, coords, unitWeights, cTree, settings, metrics );
+int main(int argc, char** argv) {
+    using namespace cxxopts;
 
-    if(settings.writeInFile) {
-        FileIO<IndexType,ValueType>::writePartitionParallel( partition, "./partResults/partKM"+std::to_string(settings.numBlocks)+".out");
-        FileIO<IndexType,ValueType>::writePartitionParallel( partitionWithPE, "./partResults/partHKM"+std::to_string(settings.numBlocks)+".out");
+    const scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
 
-        //FileIO<IndexType,ValueType>::writeGraph( GraphUtils<IndexType,ValueType>::getBlockGraph(graph, partition, settings.numBlocks), "blockKM"+std::to_string(settings.numBlocks)+".graph", 1);
-        //FileIO<IndexType,ValueType>::writeGraph( GraphUtils<IndexType,ValueType>::getBlockGraph(graph, partitionWithPE, settings.numBlocks), "blockHKM"+std::to_string(settings.numBlocks)+".graph", 1);
+    std::string benchmarkList;
+    for (const std::string& name : allBenchmarks) {
+        benchmarkList += (benchmarkList.empty() ? "" : ",") + name;
     }
 
-    //
-    // 5 - compare quality
-    //
-
-    scai::dmemo::CommunicatorPtr comm = scai::dmemo::Communicator::getCommunicatorPtr();
-    PRINT0("--------- Metrics for regular partition");
-
-    //graph and partition are distributed inside partitionGraph; distributions must allign
-    unitWeights[0].redistribute( partition.getDistributionPtr() );
-
-    metrics.getMappingMetrics( graph, partition, PEGraph);
-    metrics.getEasyMetrics( graph, partition, unitWeights[0], settings );
-    if(comm->getRank()==0)
-        metrics.print( std::cout );
+    cxxopts::Options options("geographer_bench", "Benchmarks of the Geographer kernels on generated structured meshes");
+    options.add_options()
+    ("help", "Print this help")
+    ("benchmarks", "Comma separated list of the benchmarks to run, out of " + benchmarkList, value<std::string>()->default_value(benchmarkList))
+    ("sizes", "Comma separated list of the side lengths of the generated meshes, default is 64,256,1024 in 2D and 16,40,100 in 3D", value<std::string>())
+    ("dimensions", "Dimension of the generated meshes, 2 or 3", value<IndexType>()->default_value("2"))
+    ("numBlocks", "Number of blocks for the partition based kernels, default is the number of processes", value<IndexType>())
+    ("repetitions", "Number of timed repetitions of every benchmark", value<IndexType>()->default_value("5"))
+    ("warmup", "Number of untimed runs before the repetitions", value<IndexType>()->default_value("1"))
+    ("threads", "Number of OpenMP threads per process", value<IndexType>()->default_value("1"))
+    ("tmpDir", "Directory for the temporary METIS files of readMetis", value<std::string>()->default_value("."))
+    ("outFile", "Append the results to this file, one JSON object per line; - for standard output only", value<std::string>()->default_value("-"))
+    ;
+    cxxopts::ParseResult vm = options.parse(argc, argv);
+
+    if (vm.count("help")) {
+        if (comm->getRank() == 0) {
+            std::cout << options.help() << std::endl;
+        }
+        return 0;
+    }
 
-    PRINT0("--------- Metrics for hierarchical partition");
+    BenchmarkOptions benchOptions;
+    benchOptions.dimensions = vm["dimensions"].as<IndexType>();
+    benchOptions.repetitions = vm["repetitions"].as<IndexType>();
+    benchOptions.warmup = vm["warmup"].as<IndexType>();
+    benchOptions.threads = vm["threads"].as<IndexType>();
+    benchOptions.tmpDir = vm["tmpDir"].as<std::string>();
+    if (vm.count("numBlocks")) {
+        benchOptions.numBlocks = vm["numBlocks"].as<IndexType>();
+    }
+    if (benchOptions.repetitions < 1) {
+        throw std::invalid_argument("Need at least one repetition");
+    }
+    omp_set_num_threads(benchOptions.threads);
 
-    //graph and partition are distributed inside partitionGraph; distributions must allign
-    unitWeights[0].redistribute( partitionWithPE.getDistributionPtr() );
+    const std::vector<std::string> benchmarks = splitList(vm["benchmarks"].as<std::string>());
+    for (const std::string& name : benchmarks) {
+        if (std::find(allBenchmarks.begin(), allBenchmarks.end(), name) == allBenchmarks.end()) {
+            throw std::invalid_argument("Unknown benchmark " + name + ", available are " + benchmarkList);
+        }
+    }
 
-    metrics2.getMappingMetrics( graph2, partitionWithPE, PEGraph);
-    metrics2.getEasyMetrics( graph2, partitionWithPE, unitWeights[0], settings );
-    if(comm->getRank()==0)
-        metrics2.print( std::cout );
+    const std::string outFile = vm["outFile"].as<std::string>();
+    std::ofstream outF;
+    if (comm->getRank() == 0 and outFile != "-") {
+        outF.open(outFile, std::ios::app);
+        if (outF.fail()) {
+            throw std::runtime_error("Could not open file " + outFile);
+        }
+    }
 
+    //the default meshes have at most a million points in both dimensions
+    std::string sizes = benchOptions.dimensions == 3 ? "16,40,100" : "64,256,1024";
+    if (vm.count("sizes")) {
+        sizes = vm["sizes"].as<std::string>();
+    }
 
-}//TEST_F( benchmarkTest, testMapping )
+    for (const std::string& size : splitList(sizes)) {
+        Mesh mesh = generateMesh(std::stoi(size), benchOptions.dimensions, comm);
+
+        for (const std::string& name : benchmarks) {
+            std::ostringstream result;
+            if (!runBenchmark(name, mesh, benchOptions, result, comm)) {
+                if (comm->getRank() == 0) {
+                    std::cout << "Skipping " << name << ", it needs more than one process" << std::endl;
+                }
+                continue;
+            }
+
+            if (comm->getRank() == 0) {
+                std::cout << result.str();
+                if (outF.is_open()) {
+                    outF << result.str();
+                    outF.flush();
+                }
+            }
+        }
+    }
 
-}// namespace
\ No newline at end of file
+    return 0;
+}
@@ -27,6 +27,8 @@
 #include "GraphUtils.h"
 #include "parseArgs.h"
 #include "mainHeader.h"
+#include "StreamingPartition.h"
+#include "Telemetry.h"
 
 /**
  *  Examples of use:
@@ -77,6 +79,29 @@ int main(int argc, char** argv) {
 
     printInfo( std::cout, comm, settings);
 
+    //---------------------------------------------------------
+    //
+    // streaming mode: the coordinates are never loaded completely
+    //
+
+    if( settings.streaming ) {
+        if( !vm.count("coordFile") or settings.outFile=="-" ) {
+            throw std::invalid_argument("Streaming mode needs a binary coordinate file, --coordFile, and an output file, --outFile.");
+        }
+        const std::string coordFile = vm["coordFile"].as<std::string>();
+        const std::string partOutFile = settings.outFile+".part";
+
+        Metrics<ValueType> metrics( settings );
+        const IndexType N = StreamingPartition<IndexType, ValueType>::partitionFromFile( coordFile, partOutFile, settings, metrics, comm );
+
+        if( comm->getRank()==0 ) {
+            std::cout << "Streamed " << N << " points in " << metrics.MM["streamPasses"] << " passes, time " << metrics.MM["timeKmeans"]
+                      << ", imbalance " << metrics.MM["finalImbalance"] << std::endl;
+            std::cout << "Partition written to file " << partOutFile << std::endl;
+        }
+        return 0;
+    }
+
     //---------------------------------------------------------
     //
     // generate or read graph and coordinates
@@ -260,7 +285,10 @@ int main(int argc, char** argv) {
 
         std::chrono::time_point<std::chrono::steady_clock> beforeReport = std::chrono::steady_clock::now();
 
-        metricsVec[r].getMetrics(graph, partition, nodeWeights, settings );
+        {
+            Telemetry::ScopedTimer telemetryTimer("metrics");
+            metricsVec[r].getMetrics(graph, partition, nodeWeights, settings );
+        }
         metricsVec[r].MM["inputTime"] = ValueType ( comm->max(inputTime.count() ));
 
         std::chrono::duration<double> reportTime =  std::chrono::steady_clock::now() - beforeReport;
@@ -413,6 +441,11 @@ int main(int argc, char** argv) {
         PRINT0("PE graph stored in " << filename );
     }
 
+    //timers, counters and memory usage of all processes, collective; after all output files, so their timers are included
+    if( settings.storeInfo && outFile!="-" ) {
+        Telemetry::writeJSON( outFile + ".telemetry.json", comm, aggrMetrics.MM );
+    }
+
     if (vm.count("callExit")) {
         //this is needed for supermuc
         std::exit(0);
@@ -149,6 +149,26 @@ IndexType readInput(
         nodeWeights.resize(1);
         nodeWeights[0] = scai::lama::fill<scai::lama::DenseVector<ValueType>>(graph.getRowDistributionPtr(), 1);
 
+    } else if (vm.count("generatePoints")) {
+
+        N = settings.numPoints;
+
+        if( comm->getRank()== 0) {
+            std::cout<< "Creating " << N << " points with " << settings.pointDistribution << " distribution in dimension " << settings.dimensions << std::endl;
+        }
+
+        nodeWeights.resize(1);
+        ITI::MeshGenerator<IndexType, ValueType>::createPoints_dist( coords, nodeWeights[0], N, settings.dimensions, settings.pointDistribution, static_cast<unsigned long>(settings.seed), comm );
+
+        // without adjacency the graph is empty and only the geometric tools can be used
+        if( settings.generateAdjacency ){
+            ITI::MeshGenerator<IndexType, ValueType>::createPointsAdjacency_dist( graph, N, settings.dimensions, comm );
+        }else{
+            scai::dmemo::DistributionPtr rowDistPtr = coords[0].getDistributionPtr();
+            scai::dmemo::DistributionPtr noDistPtr(new scai::dmemo::NoDistribution(N));
+            graph = scai::lama::zero<scai::lama::CSRSparseMatrix<ValueType>>( rowDistPtr, noDistPtr );
+        }
+
     } else if (vm.count("quadTreeFile")) {
         //if (comm->getRank() == 0) {
         graph = ITI::FileIO<IndexType, ValueType>::readQuadTree(vm["quadTreeFile"].as<std::string>(), coords);
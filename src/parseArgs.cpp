@@ -28,6 +28,12 @@ Options populateOptions() {
     ("coordFormat", "format of coordinate file: AUTO, METIS, ADCIRC and MATRIXMARKET. See src/Settings.h for more details.", value<ITI::Format>())
     ("numNodeWeights", "Number of node weights to use. If the input graph contains more node weights, only the first ones are used.", value<IndexType>())
     ("seed", "random seed, default is current time", value<double>()->default_value(std::to_string(time(NULL))))
+    ("numThreads", "Number of OpenMP threads per process for the local kernels, default is the OpenMP setting, e.g., OMP_NUM_THREADS. Use with one process per socket for the hybrid mode.", value<IndexType>())
+    //streaming
+    ("streaming", "Partition the binary coordinate file given by --coordFile in chunks, without loading it in memory. Only for point sets, the partition is written to --outFile.")
+    ("streamChunkSize", "Number of points per process that are read and assigned at once in the streaming mode", value<IndexType>())
+    ("streamSampleSize", "Number of sampled points to find the initial centers in the streaming mode", value<IndexType>())
+    ("streamPasses", "Maximum number of passes over the coordinate file in the streaming mode", value<IndexType>())
     //mapping
     ("PEgraphFile", "read communication graph from file", value<std::string>())
     ("blockSizesFile", "file to read the block sizes for every block", value<std::string>() )
@@ -35,7 +41,7 @@ Options populateOptions() {
     //repartitioning
     ("previousPartition", "file of previous partition, used for repartitioning", value<std::string>())
     //multi-level and local refinement
-    ("initialPartition", "Choose initial partitioning method between space-filling curves (geoSFC), balanced k-means (geoKmeans) or the hierarchical version (geoHierKM) and MultiJagged (geoMS). If parmetis or zoltan are installed, you can also choose to partition with them using for example, parMetisGraph or zoltanMJ. For more information, see src/Settings.h file.", value<std::string>())
+    ("initialPartition", "Choose initial partitioning method between space-filling curves (geoSFC), balanced k-means (geoKmeans) or the hierarchical version (geoHierKM), MultiJagged (geoMS), the spectral embedding of the graph (geoSpectral) and multilevel V-cycles (geoVCycle). If parmetis or zoltan are installed, you can also choose to partition with them using for example, parMetisGraph or zoltanMJ. For more information, see src/Settings.h file.", value<std::string>())
     ("initialMigration", "The preprocessing step to distribute data before calling the partitioning algorithm", value<std::string>())
     ("noRefinement", "skip local refinement steps")
     ("multiLevelRounds", "Tuning Parameter: How many multi-level rounds with coarsening to perform", value<IndexType>()->default_value(std::to_string(settings.multiLevelRounds)))
@@ -48,13 +54,26 @@ Options populateOptions() {
     ("useGeometricTieBreaking", "Tuning Parameter: Use distances to block center for tie breaking", value<bool>())
     ("skipNoGainColors", "Tuning Parameter: Skip Colors that didn't result in a gain in the last global round", value<bool>())
     ("nnCoarsening", "When coarsening, pick the nearest neighbor based on the euclidean distance", value<bool>())
+    ("crossRankMatchingRounds", "When coarsening for the V-cycle or the spectral partitioner, match unmatched nodes with neighbors on other processes in this many handshake rounds. 0 keeps the matching local", value<IndexType>())
     ("localRefAlgo", "With which algorithm to do local refinement.", value<Tool>() )
     //multisection
     ("bisect", "Used for the multisection method. If set to true the algorithm perfoms bisections (not multisection) until the desired number of parts is reached", value<bool>())
     ("cutsPerDim", "If MultiSection is chosen, then provide d values that define the number of cuts per dimension. You must provide as many numbers as the dimensions separated with commas. For example, --cutsPerDim=3,4,10 for 3 dimensions resulting in 3*4*10=120 blocks", value<std::string>())
-    ("pixeledSideLen", "The resolution for the pixeled partition or the spectral", value<IndexType>())
+    ("pixeledSideLen", "The resolution for the pixeled partition", value<IndexType>())
+    //spectral
+    ("spectralDimensions", "Number of Laplacian eigenvectors in the embedding of the spectral partitioner", value<IndexType>())
+    ("spectralTolerance", "Relative residual at which the eigensolver of the spectral partitioner stops", value<double>())
+    ("spectralMaxIterations", "Maximum number of eigensolver iterations per level for the spectral partitioner", value<IndexType>())
+    ("spectralCoarsestSize", "The graph is coarsened for the start vectors of the spectral partitioner until it has at most this many nodes", value<IndexType>())
+    ("spectralKMeans", "Improve the recursive bisection of the spectral embedding with balanced k-means", value<bool>())
+    //multilevel V-cycle
+    ("vCycles", "Number of V-cycles for geoVCycle", value<IndexType>())
+    ("vCycleCoarsestSize", "The V-cycle coarsens the graph until it has at most this many nodes", value<IndexType>())
+    ("vCycleRefinementRounds", "Maximum number of greedy refinement rounds on every level of the V-cycle", value<IndexType>())
+    ("vCycleKMeans", "Partition the coarsest graph of the V-cycle with balanced k-means on the coordinates instead of greedy graph growing", value<bool>())
     //sfc
     ("sfcResolution", "The resolution depth of the hilbert space filling curve", value<IndexType>())
+    ("sfcSort", "Split the hilbert curve with a distributed sort instead of splitter selection")
     // K-Means
     ("minSamplingNodes", "Tuning parameter for K-Means", value<IndexType>())
     ("influenceExponent", "Tuning parameter for K-Means, default is ", value<double>()->default_value(std::to_string(settings.influenceExponent)))
@@ -62,7 +81,14 @@ Options populateOptions() {
     ("balanceIterations", "Tuning parameter for K-Means", value<IndexType>())
     ("maxKMeansIterations", "Tuning parameter for K-Means", value<IndexType>())
     ("tightenBounds", "Tuning parameter for K-Means")
+    ("migrationPenalty", "When repartitioning with K-Means, multiply the effective distance to all blocks except the current block of a point with 1+migrationPenalty", value<double>())
+    ("migrationBudget", "When repartitioning with K-Means, the fraction of points that may move to another block", value<double>())
+    ("adaptiveSampling", "Grow the K-Means sample only when the centers converged on the current sample and skip further full passes if the sample already meets the bounds")
     ("erodeInfluence", "Tuning parameter for K-Means, in case of large deltas and imbalances.")
+    ("yinyangGroups", "Number of center groups for the Yinyang distance bounds in K-Means, useful for large k. 0 disables the group bounds", value<IndexType>())
+    ("centerTree", "Search the closest K-Means centers with a k-d tree over the centers, useful for large k")
+    ("mixedPrecision", "Assign points to K-Means centers using a packed single-precision copy of the coordinates")
+    ("validateMixedPrecision", "With mixedPrecision, also compute the K-Means partition in full precision and report the fraction of differently assigned points")
     // using '/' to separate the lines breaks the output message
     ("hierLevels", "The number of blocks per level. Total number of PEs (=number of leaves) is the product for all hierLevels[i] and there are hierLevels.size() hierarchy levels. Example: --hierLevels 3,4,10 there are 3 levels. In the first one, each node has 3 children, in the next one each node has 4 and in the last, each node has 10. In total 3*4*10= 120 leaves/PEs", value<std::string>())
     //output
@@ -79,7 +105,7 @@ Options populateOptions() {
     ("repeatTimes", "How many times we repeat the partitioning process.", value<IndexType>())
     ("noComputeDiameter", "Compute diameter of resulting block files.")
     ("maxDiameterRounds", "abort diameter algorithm after that many BFS rounds", value<IndexType>())
-    ("maxCGIterations", "max number of iterations of the CG solver in metrics",  value<IndexType>())
+    ("maxCGIterations", "number of iterations of the CG solver in metrics",  value<IndexType>())
     ("metricsDetail", "no: no metrics, easy:cut, imbalance, communication volume and diameter if possible, all: easy + SpMV time and communication time in SpMV", value<std::string>())
     ("autoSettings", "Set some settings automatically to some values possibly overwriting some user passed parameters. ", value<bool>() )
     ("partition", "file of partition (typically used by tools/analyzePartition)", value<std::string>())
@@ -91,6 +117,9 @@ Options populateOptions() {
     ("numX", "Number of points in x dimension of generated graph", value<IndexType>())
     ("numY", "Number of points in y dimension of generated graph", value<IndexType>())
     ("numZ", "Number of points in z dimension of generated graph", value<IndexType>())
+    ("generatePoints", "Create that many points instead of reading them; no graph is created unless --generateAdjacency is given", value<IndexType>())
+    ("pointDistribution", "Distribution of the created points: uniform, gaussian or ocean. See src/Settings.h for more details.", value<ITI::PointDistribution>())
+    ("generateAdjacency", "Also create the grid graph of the created points, only for the uniform distribution")
     // exotic test cases
     ("quadTreeFile", "read QuadTree from file", value<std::string>())
     ("useDiffusionCoordinates", "Use coordinates based from diffusive systems instead of loading from file", value<bool>())
@@ -114,7 +143,13 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
         return settings;
     }
 
-    if (vm.count("generate") + vm.count("graphFile") + vm.count("quadTreeFile") != 1) {
+    if (vm.count("streaming")) {
+        //the streaming mode reads only the coordinates
+        if (!vm.count("coordFile") or vm.count("generate") + vm.count("generatePoints") + vm.count("graphFile") + vm.count("quadTreeFile") != 0) {
+            std::cout << "Call the streaming mode with --coordFile <input> only. Use --help for more parameters." << std::endl;
+            settings.isValid = false;
+        }
+    } else if (vm.count("generate") + vm.count("generatePoints") + vm.count("graphFile") + vm.count("quadTreeFile") != 1) {
         std::cout << "Call with --graphFile <input>. Use --help for more parameters." << std::endl;
         settings.isValid = false;
         //return 126;
@@ -182,6 +217,10 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     settings.storePartition = vm.count("storePartition");
     settings.erodeInfluence = vm.count("erodeInfluence");
     settings.tightenBounds = vm.count("tightenBounds");
+    settings.centerTree = vm.count("centerTree");
+    settings.adaptiveSampling = vm.count("adaptiveSampling");
+    settings.mixedPrecision = vm.count("mixedPrecision");
+    settings.validateMixedPrecision = vm.count("validateMixedPrecision");
     settings.noRefinement = vm.count("noRefinement");
     settings.useDiffusionCoordinates = vm.count("useDiffusionCoordinates");
     settings.gainOverBalance = vm.count("gainOverBalance");
@@ -236,6 +275,7 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     } else {
         settings.numBlocks = comm->getSize();
     }
+    settings.sfcSort = vm.count("sfcSort");
     if (vm.count("sfcResolution")) {
         settings.sfcResolution = vm["sfcResolution"].as<IndexType>();
     }
@@ -257,6 +297,9 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     if (vm.count("multiLevelRounds")) {
         settings.multiLevelRounds = vm["multiLevelRounds"].as<IndexType>();
     }
+    if (vm.count("crossRankMatchingRounds")) {
+        settings.crossRankMatchingRounds = vm["crossRankMatchingRounds"].as<IndexType>();
+    }
     if (vm.count("minBorderNodes")) {
         settings.minBorderNodes = vm["minBorderNodes"].as<IndexType>();
     }
@@ -299,6 +342,41 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     if (vm.count("pixeledSideLen")) {
         settings.pixeledSideLen = vm["pixeledSideLen"].as<IndexType>();
     }
+    if (vm.count("spectralDimensions")) {
+        settings.spectralDimensions = vm["spectralDimensions"].as<IndexType>();
+        if (settings.spectralDimensions < 1) {
+            std::cout << "The spectral embedding needs at least one dimension but spectralDimensions is " << settings.spectralDimensions << std::endl;
+            settings.isValid = false;
+        }
+    }
+    if (vm.count("spectralTolerance")) {
+        settings.spectralTolerance = vm["spectralTolerance"].as<double>();
+    }
+    if (vm.count("spectralMaxIterations")) {
+        settings.spectralMaxIterations = vm["spectralMaxIterations"].as<IndexType>();
+    }
+    if (vm.count("spectralCoarsestSize")) {
+        settings.spectralCoarsestSize = vm["spectralCoarsestSize"].as<IndexType>();
+    }
+    if (vm.count("spectralKMeans")) {
+        settings.spectralKMeans = vm["spectralKMeans"].as<bool>();
+    }
+    if (vm.count("vCycles")) {
+        settings.vCycles = vm["vCycles"].as<IndexType>();
+        if (settings.vCycles < 1) {
+            std::cout << "At least one V-cycle is needed but vCycles is " << settings.vCycles << std::endl;
+            settings.isValid = false;
+        }
+    }
+    if (vm.count("vCycleCoarsestSize")) {
+        settings.vCycleCoarsestSize = vm["vCycleCoarsestSize"].as<IndexType>();
+    }
+    if (vm.count("vCycleRefinementRounds")) {
+        settings.vCycleRefinementRounds = vm["vCycleRefinementRounds"].as<IndexType>();
+    }
+    if (vm.count("vCycleKMeans")) {
+        settings.vCycleKMeans = vm["vCycleKMeans"].as<bool>();
+    }
     if (vm.count("minSamplingNodes")) {
         settings.minSamplingNodes = vm["minSamplingNodes"].as<IndexType>();
     }
@@ -314,6 +392,15 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     if (vm.count("maxKMeansIterations")) {
         settings.maxKMeansIterations = vm["maxKMeansIterations"].as<IndexType>();
     }
+    if (vm.count("migrationPenalty")) {
+        settings.migrationPenalty = vm["migrationPenalty"].as<double>();
+    }
+    if (vm.count("migrationBudget")) {
+        settings.migrationBudget = vm["migrationBudget"].as<double>();
+    }
+    if (vm.count("yinyangGroups")) {
+        settings.yinyangGroups = vm["yinyangGroups"].as<IndexType>();
+    }
     if (vm.count("hierLevels")) {  
         std::stringstream ss( vm["hierLevels"].as<std::string>() );
         std::string item;
@@ -350,6 +437,38 @@ Settings interpretSettings(cxxopts::ParseResult vm) {
     if (vm.count("metricsDetail")) {
         settings.metricsDetail = vm["metricsDetail"].as<std::string>();
     }
+    if (vm.count("generatePoints")) {
+        settings.numPoints = vm["generatePoints"].as<IndexType>();
+    }
+    if (vm.count("pointDistribution")) {
+        settings.pointDistribution = vm["pointDistribution"].as<ITI::PointDistribution>();
+    }
+    if (vm.count("generateAdjacency")) {
+        settings.generateAdjacency = true;
+        if (settings.pointDistribution != ITI::PointDistribution::uniform) {
+            std::cout << "The adjacency can only be created for uniformly distributed points." << std::endl;
+            settings.isValid = false;
+        }
+    }
+    if (vm.count("streaming")) {
+        settings.streaming = true;
+    }
+    if (vm.count("streamChunkSize")) {
+        settings.streamChunkSize = vm["streamChunkSize"].as<IndexType>();
+    }
+    if (vm.count("streamSampleSize")) {
+        settings.streamSampleSize = vm["streamSampleSize"].as<IndexType>();
+    }
+    if (vm.count("streamPasses")) {
+        settings.streamPasses = vm["streamPasses"].as<IndexType>();
+    }
+    if (vm.count("numThreads")) {
+        settings.numThreads = vm["numThreads"].as<IndexType>();
+        if( settings.numThreads<1 ){
+            std::cout << "Number of threads must be positive but is " << settings.numThreads << std::endl;
+            settings.isValid = false;
+        }
+    }
 
     /*** consistency checks ***/
     if (vm.count("previousPartition")) {
@@ -16,6 +16,14 @@
 #include <set>
 #include <list>
 #include <queue>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <exception>
+
+#if defined(__GLIBCXX__) && defined(_OPENMP)
+#include <parallel/algorithm>
+#endif
 
 #include "Point.h"
 
@@ -173,6 +181,50 @@ public:
         }
     }
 
+    /** Finds the k elements closest to the query point in the subtree of this cell.
+     *
+     * Children are visited in the order of their minimal distance to the query and a subtree is
+     * skipped if it cannot contain an element closer than the current k-th candidate.
+     *
+     * @param[in] query The query point.
+     * @param[in] k The number of neighbors to find.
+     * @param[in,out] best Max-heap of (distance, element) pairs, holds the best candidates found so far, at most k.
+     */
+    void getKNearestNeighbors(const Point<ValueType> &query, const count k, std::priority_queue<std::pair<ValueType, index>> &best) const {
+        if (k == 0) {
+            return;
+        }
+        if (best.size() == k && distances(query).first > best.top().first) {
+            return;
+        }
+
+        if (this->isLeaf) {
+            const count cSize = content.size();
+            for (index i = 0; i < cSize; i++) {
+                const std::pair<ValueType, index> candidate(distance(query, i), content[i]);
+                if (best.size() < k) {
+                    best.push(candidate);
+                } else if (candidate < best.top()) {
+                    best.pop();
+                    best.push(candidate);
+                }
+            }
+        } else {
+            std::vector<std::pair<ValueType, index>> childOrder(children.size());
+            for (index i = 0; i < children.size(); i++) {
+                childOrder[i] = std::make_pair(children[i]->distances(query).first, i);
+            }
+            std::sort(childOrder.begin(), childOrder.end());
+
+            for (const std::pair<ValueType, index>& child : childOrder) {
+                if (best.size() == k && child.first > best.top().first) {
+                    break;
+                }
+                children[child.second]->getKNearestNeighbors(query, k, best);
+            }
+        }
+    }
+
     virtual void addContent(index input, const Point<ValueType> &coords) {
         assert(content.size() == positions.size());
         assert(this->responsible(coords));
@@ -535,6 +587,73 @@ public:
         }
     }
 
+    /** Inserts all points at once into this cell, which must be an empty leaf.
+     *
+     * The points are sorted by their Morton key relative to this cell. Then the tree is built
+     * top-down: every inner node distributes its range of points to its children with a stable
+     * counting sort and the subtrees are built as OpenMP tasks. The content of every leaf is in Morton order.
+     *
+     * Cells that split at their midpoint, as the quadtree cells, get the same tree as when calling
+     * addContent for every point. Cells whose split depends on their points, as KDNodeEuclidean
+     * splitting at the median, are split with all points of the cell instead of the first capacity+1,
+     * so the tree usually differs from the incrementally built one.
+     *
+     * @param[in] newContent The elements to insert.
+     * @param[in] newPositions The position of every element, must lie inside this cell.
+     */
+    void bulkLoad(const std::vector<index> &newContent, const std::vector<Point<ValueType>> &newPositions) {
+        SCAI_REGION("SpatialCell.bulkLoad");
+        const count n = newContent.size();
+        if (newPositions.size() != n) {
+            throw std::invalid_argument("Got " + std::to_string(n) + " elements but " + std::to_string(newPositions.size()) + " positions.");
+        }
+        if (!this->isLeaf || content.size() > 0) {
+            throw std::logic_error("Bulk loading is only possible into an empty cell.");
+        }
+
+        std::vector<std::pair<uint64_t, index>> keys(n);
+        bool allInside = true;
+        #pragma omp parallel for schedule(static) reduction(&&:allInside)
+        for (index i = 0; i < n; i++) {
+            allInside = allInside && responsible(newPositions[i]);
+            keys[i] = std::make_pair(mortonKey(newPositions[i]), i);
+        }
+        if (!allInside) {
+            throw std::invalid_argument("Not all points lie inside the cell.");
+        }
+
+        {
+            SCAI_REGION("SpatialCell.bulkLoad.sort");
+            //the keys are unique because of the index, so the parallel sort gives the same order
+#if defined(__GLIBCXX__) && defined(_OPENMP)
+            __gnu_parallel::sort(keys.begin(), keys.end());
+#else
+            std::sort(keys.begin(), keys.end());
+#endif
+        }
+
+        std::vector<index> order(n);
+        #pragma omp parallel for schedule(static)
+        for (index i = 0; i < n; i++) {
+            order[i] = keys[i].second;
+        }
+        std::vector<std::pair<uint64_t, index>>().swap(keys);
+
+        std::vector<index> buffer(n);
+        //exceptions must not leave the tasks, the first one is rethrown after the parallel region
+        std::exception_ptr error;
+        #pragma omp parallel
+        {
+            #pragma omp single nowait
+            {
+                buildSubtree(newContent.data(), newPositions.data(), order.data(), buffer.data(), n, error);
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
     count reindexContent(count offset) {
         if (this->isLeaf)
         {
@@ -803,6 +922,41 @@ public:
     }
 
 
+    /** Appends all leaves of the subtree of this cell in depth-first order.
+     * For an indexed tree, this is the order of increasing leaf IDs.
+     */
+    void getLeaves(std::vector<const SpatialCell*> &leaves) const {
+        if (this->isLeaf) {
+            leaves.push_back(this);
+        } else {
+            for (index i = 0; i < children.size(); i++) {
+                children[i]->getLeaves(leaves);
+            }
+        }
+    }
+
+    /** Appends all leaves of the subtree of this cell, except \p cell itself, whose closed box
+     * intersects the closed box of \p cell. Use isAdjacent to keep only the leaves sharing a face.
+     */
+    void getTouchingLeaves(const SpatialCell &cell, std::vector<const SpatialCell*> &result) const {
+        const count dim = minCoords.getDimensions();
+        for (index d = 0; d < dim; d++) {
+            if (maxCoords[d] < cell.minCoords[d] || minCoords[d] > cell.maxCoords[d]) {
+                return;
+            }
+        }
+
+        if (this->isLeaf) {
+            if (this != &cell) {
+                result.push_back(this);
+            }
+        } else {
+            for (index i = 0; i < children.size(); i++) {
+                children[i]->getTouchingLeaves(cell, result);
+            }
+        }
+    }
+
     /* Checks if two cells are adjacent and share an area. If they have an edge or a corner in common
      * then the test is false.
     */
@@ -869,6 +1023,14 @@ public:
         return minCoords.getDimensions();
     }
 
+    const Point<ValueType>& getMinCoords() const {
+        return minCoords;
+    }
+
+    const Point<ValueType>& getMaxCoords() const {
+        return maxCoords;
+    }
+
 
 //-------------------------------------------------------------------------------------
 
@@ -888,6 +1050,124 @@ protected:
 private:
     static const unsigned coarsenLimit = 4;
     static const index none = std::numeric_limits<index>::max();
+    static const count bulkTaskCutoff = 4096;
+
+    /** Builds the subtree of this leaf from the points order[0..n-1], see bulkLoad.
+     * buffer must have space for n entries. Does not throw, a failure is stored in \p error and stops this subtree.
+     */
+    void buildSubtree(const index* allContent, const Point<ValueType>* allPositions, index* order, index* buffer, const count n, std::exception_ptr &error) {
+        assert(this->isLeaf);
+        assert(content.size() == 0);
+
+        if (n <= capacity || !splittable()) {
+            content.reserve(n);
+            positions.reserve(n);
+            for (index i = 0; i < n; i++) {
+                content.push_back(allContent[order[i]]);
+                positions.push_back(allPositions[order[i]]);
+            }
+            return;
+        }
+
+        //split() may need the positions, e.g., to split at the median
+        positions.reserve(n);
+        for (index i = 0; i < n; i++) {
+            positions.push_back(allPositions[order[i]]);
+        }
+        try {
+            split();
+        } catch (...) {
+            recordError(error, std::current_exception());
+            return;
+        }
+        std::vector<Point<ValueType>>().swap(positions);
+
+        const count numChildren = children.size();
+        std::vector<index> offset(numChildren+1, 0);
+        {
+            std::vector<index> childOf(n);
+            for (index i = 0; i < n; i++) {
+                const Point<ValueType> &pos = allPositions[order[i]];
+                index c = 0;
+                while (c < numChildren && !children[c]->responsible(pos)) {
+                    c++;
+                }
+                if (c == numChildren) {
+                    recordError(error, std::make_exception_ptr(std::runtime_error("Tree structure inconsistent: No responsible child found.")));
+                    return;
+                }
+                childOf[i] = c;
+                offset[c+1]++;
+            }
+            std::partial_sum(offset.begin(), offset.end(), offset.begin());
+
+            //stable, so every child range stays in Morton order
+            std::vector<index> nextPos(offset.begin(), offset.end()-1);
+            for (index i = 0; i < n; i++) {
+                buffer[nextPos[childOf[i]]++] = order[i];
+            }
+            std::copy(buffer, buffer+n, order);
+        }
+        subTreeSize = n;
+
+        for (index c = 0; c < numChildren; c++) {
+            SpatialCell* child = children[c].get();
+            index* childOrder = order + offset[c];
+            index* childBuffer = buffer + offset[c];
+            const count childN = offset[c+1] - offset[c];
+            #pragma omp task firstprivate(child, childOrder, childBuffer, childN) if(childN > bulkTaskCutoff)
+            child->buildSubtree(allContent, allPositions, childOrder, childBuffer, childN, error);
+        }
+        #pragma omp taskwait
+    }
+
+    /** Keeps the first of the errors of concurrent buildSubtree tasks. */
+    static void recordError(std::exception_ptr &error, std::exception_ptr newError) {
+        #pragma omp critical(SpatialCellBuildError)
+        {
+            if (!error) {
+                error = newError;
+            }
+        }
+    }
+
+    /** False if the cell is too small to be split at the midpoint in floating point precision.
+     * Stops the recursion for many identical points.
+     */
+    bool splittable() const {
+        const count dim = minCoords.getDimensions();
+        for (index d = 0; d < dim; d++) {
+            const ValueType middle = minCoords[d] + (maxCoords[d] - minCoords[d]) / 2;
+            if (!(minCoords[d] < middle && middle < maxCoords[d])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** The Morton key of the point relative to the box of this cell. Bit d of every group of
+     * dim bits belongs to dimension d, the same order as the children in a theoretical split.
+     */
+    uint64_t mortonKey(const Point<ValueType> &point) const {
+        const count dim = minCoords.getDimensions();
+        const count bitsPerDim = std::min<count>(64/dim, 31);
+        const uint64_t cellsPerDim = uint64_t(1) << bitsPerDim;
+
+        std::vector<uint64_t> cell(dim);
+        for (index d = 0; d < dim; d++) {
+            const double relative = double(point[d] - minCoords[d]) / double(maxCoords[d] - minCoords[d]);
+            const double scaled = std::max(0.0, relative) * cellsPerDim;
+            cell[d] = std::min<uint64_t>(uint64_t(scaled), cellsPerDim-1);
+        }
+
+        uint64_t key = 0;
+        for (count b = bitsPerDim; b > 0; b--) {
+            for (count d = dim; d > 0; d--) {
+                key = (key << 1) | ((cell[d-1] >> (b-1)) & 1);
+            }
+        }
+        return key;
+    }
 
 };
 
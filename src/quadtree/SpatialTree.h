@@ -25,10 +25,64 @@ public:
         return root->removeContent(content, coords);
     }
 
+    /** Inserts all points at once into an empty tree, see SpatialCell::bulkLoad.
+     * Element i has position positions[i].
+     */
+    void bulkLoad(const std::vector<Point<ValueType>> &positions) {
+        std::vector<index> content(positions.size());
+        std::iota(content.begin(), content.end(), 0);
+        root->bulkLoad(content, positions);
+    }
+
+    void bulkLoad(const std::vector<index> &content, const std::vector<Point<ValueType>> &positions) {
+        root->bulkLoad(content, positions);
+    }
+
     void getElementsInCircle(const Point<ValueType> query, const ValueType radius, std::vector<index> &circleDenizens) const {
         root->getElementsInCircle(query, radius, circleDenizens);
     }
 
+    /** Batched version of getElementsInCircle, the queries are processed in parallel.
+     * results[i] holds the elements within radius of queries[i].
+     */
+    void getElementsInCircles(const std::vector<Point<ValueType>> &queries, const ValueType radius, std::vector<std::vector<index>> &results) const {
+        SCAI_REGION("SpatialTree.getElementsInCircles");
+        const count numQueries = queries.size();
+        results.clear();
+        results.resize(numQueries);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (index i = 0; i < numQueries; i++) {
+            root->getElementsInCircle(queries[i], radius, results[i]);
+        }
+    }
+
+    /** The k elements closest to the query, sorted by increasing distance.
+     * Returns fewer elements if the tree holds less than k.
+     */
+    void getKNearestNeighbors(const Point<ValueType> &query, const count k, std::vector<index> &neighbors) const {
+        std::priority_queue<std::pair<ValueType, index>> best;
+        root->getKNearestNeighbors(query, k, best);
+
+        neighbors.resize(best.size());
+        for (index i = neighbors.size(); i > 0; i--) {
+            neighbors[i-1] = best.top().second;
+            best.pop();
+        }
+    }
+
+    /** Batched version of getKNearestNeighbors, the queries are processed in parallel.
+     */
+    void getKNearestNeighbors(const std::vector<Point<ValueType>> &queries, const count k, std::vector<std::vector<index>> &results) const {
+        SCAI_REGION("SpatialTree.getKNearestNeighbors");
+        const count numQueries = queries.size();
+        results.clear();
+        results.resize(numQueries);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (index i = 0; i < numQueries; i++) {
+            getKNearestNeighbors(queries[i], k, results[i]);
+        }
+    }
+
     count getElementsProbabilistically(Point<ValueType> query, std::function<ValueType(ValueType)> prob, std::vector<index> &circleDenizens) {
         return root->getElementsProbabilistically(query, prob, circleDenizens);
     }
@@ -100,6 +154,108 @@ public:
         return root->template getSubTreeAsGraph<IndexType>( graphNgbrsCells, coords );
     }
 
+    /** Returns the leaves of the tree as a graph: two leaves are connected if they share a face
+     * (see SpatialCell::isAdjacent). Produces the same graph as getTreeAsGraph, with leaves numbered
+     * in depth-first order, but without the neighbor sets for all tree nodes.
+     * The neighbors of every leaf are found with a query on the tree and all leaves are
+     * processed in parallel, so this is suitable for large trees.
+     *
+     * @param[out] coords The centers of the leaves, coords[d][i] is the d-th coordinate of leaf i.
+     */
+    template<typename IndexType>
+    scai::lama::CSRSparseMatrix<ValueType> getLeafGraph( std::vector<std::vector<ValueType>>& coords ) const {
+        SCAI_REGION("SpatialTree.getLeafGraph");
+        if (!root->isIndexed()) {
+            throw std::runtime_error("Call indexSubtree first.");
+        }
+
+        std::vector<const SpatialCell<ValueType>*> leaves;
+        leaves.reserve(root->countLeaves());
+        root->getLeaves(leaves);
+        const IndexType N = leaves.size();
+        const count dimension = root->getDimensions();
+
+        //the root has the largest ID after indexSubtree
+        std::vector<IndexType> leafIndex(root->getID()+1, -1);
+        for (IndexType i = 0; i < N; i++) {
+            leafIndex[leaves[i]->getID()] = i;
+        }
+
+        auto getNeighbors = [&](const IndexType i, std::vector<IndexType> &ngbrs, std::vector<const SpatialCell<ValueType>*> &touching) {
+            ngbrs.clear();
+            touching.clear();
+            root->getTouchingLeaves(*leaves[i], touching);
+            for (const SpatialCell<ValueType>* other : touching) {
+                if (leaves[i]->isAdjacent(*other)) {
+                    ngbrs.push_back(leafIndex[other->getID()]);
+                }
+            }
+            std::sort(ngbrs.begin(), ngbrs.end());
+        };
+
+        //first pass: count the degrees, second pass: fill the rows
+        scai::hmemo::HArray<IndexType> csrIA;
+        scai::hmemo::HArray<IndexType> csrJA;
+        scai::hmemo::HArray<ValueType> csrValues;
+        {
+            scai::hmemo::WriteOnlyAccess<IndexType> ia( csrIA, N+1 );
+            ia[0] = 0;
+
+            #pragma omp parallel
+            {
+                std::vector<IndexType> ngbrs;
+                std::vector<const SpatialCell<ValueType>*> touching;
+                #pragma omp for schedule(dynamic, 256)
+                for (IndexType i = 0; i < N; i++) {
+                    getNeighbors(i, ngbrs, touching);
+                    ia[i+1] = ngbrs.size();
+                }
+            }
+            for (IndexType i = 0; i < N; i++) {
+                ia[i+1] += ia[i];
+            }
+            const IndexType nnzValues = ia[N];
+
+            scai::hmemo::WriteOnlyAccess<IndexType> ja( csrJA, nnzValues );
+            scai::hmemo::WriteOnlyAccess<ValueType> values( csrValues, nnzValues );
+
+            //exceptions must not leave the parallel region, changed degrees are counted and checked after it
+            IndexType changedDegrees = 0;
+            #pragma omp parallel reduction(+:changedDegrees)
+            {
+                std::vector<IndexType> ngbrs;
+                std::vector<const SpatialCell<ValueType>*> touching;
+                #pragma omp for schedule(dynamic, 256)
+                for (IndexType i = 0; i < N; i++) {
+                    getNeighbors(i, ngbrs, touching);
+                    if (IndexType(ngbrs.size()) != ia[i+1]-ia[i]) {
+                        changedDegrees++;
+                        continue;
+                    }
+                    std::copy(ngbrs.begin(), ngbrs.end(), ja.get()+ia[i]);
+                    std::fill(values.get()+ia[i], values.get()+ia[i+1], 1);
+                }
+            }
+            SCAI_ASSERT_EQ_ERROR( changedDegrees, 0, "Degree of " << changedDegrees << " leaves changed." );
+        }
+
+        coords.resize(dimension);
+        for (count d = 0; d < dimension; d++) {
+            coords[d].resize(N);
+        }
+        #pragma omp parallel for schedule(static)
+        for (IndexType i = 0; i < N; i++) {
+            const Point<ValueType> &minCoords = leaves[i]->getMinCoords();
+            const Point<ValueType> &maxCoords = leaves[i]->getMaxCoords();
+            for (count d = 0; d < dimension; d++) {
+                coords[d][i] = minCoords[d] + ValueType(maxCoords[d] - minCoords[d])/ 2;
+            }
+        }
+
+        scai::lama::CSRStorage<ValueType> localMatrix( N, N, csrIA, csrJA, csrValues );
+        return scai::lama::CSRSparseMatrix<ValueType>( std::move(localMatrix) );
+    }
+
     /* Given several tree (thus, a forest) we create the corresponding graph. \sa SpatialCell::getSubTreeAsGraph()
     */
 
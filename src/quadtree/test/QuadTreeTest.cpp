@@ -888,6 +888,166 @@ TYPED_TEST(QuadTreeTest, testQuadNodeCartesianDistances) {
     EXPECT_LE(distanceQueryToCell, minDistance);
 }
 
+TYPED_TEST(QuadTreeTest, testBulkLoad_2D) {
+    using ValueType = TypeParam;
+
+    const count n = 2000;
+    const index capacity = 10;
+    Point<ValueType> min(0.0, 0.0);
+    Point<ValueType> max(1.0, 1.0);
+
+    std::vector<Point<ValueType>> positions(n);
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<ValueType> dist(0.0, 1.0);
+
+    QuadTreeCartesianEuclid<ValueType> quad(min, max, true, capacity);
+    for (index i = 0; i < n; i++) {
+        //clustered, so that the tree is not balanced
+        const ValueType scale = (i % 2 == 0) ? 1.0 : 0.01;
+        positions[i] = Point<ValueType>(dist(generator)*scale, dist(generator)*scale);
+        quad.addContent(i, positions[i]);
+    }
+
+    QuadTreeCartesianEuclid<ValueType> bulkQuad(min, max, true, capacity);
+    bulkQuad.bulkLoad(positions);
+
+    //the tree must be the same as if built incrementally
+    EXPECT_EQ( bulkQuad.size(), n );
+    EXPECT_EQ( bulkQuad.countNodes(), quad.countNodes() );
+    EXPECT_EQ( bulkQuad.countLeaves(), quad.countLeaves() );
+    EXPECT_EQ( bulkQuad.height(), quad.height() );
+    EXPECT_TRUE( bulkQuad.getRoot()->isConsistent() );
+
+    std::vector<index> elements = bulkQuad.getElements();
+    std::sort(elements.begin(), elements.end());
+    for (index i = 0; i < n; i++) {
+        EXPECT_EQ( elements[i], i );
+    }
+
+    quad.indexSubtree(0);
+    bulkQuad.indexSubtree(0);
+    for (index i = 0; i < n; i++) {
+        EXPECT_EQ( bulkQuad.getCellID(positions[i]), quad.getCellID(positions[i]) );
+    }
+
+    //loading into a non-empty tree or points outside of the tree must fail
+    EXPECT_THROW( bulkQuad.bulkLoad(positions), std::logic_error );
+    QuadTreeCartesianEuclid<ValueType> smallQuad(min, Point<ValueType>(0.5, 0.5), true, capacity);
+    EXPECT_THROW( smallQuad.bulkLoad(positions), std::invalid_argument );
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(QuadTreeTest, testBatchedQueries_3D) {
+    using ValueType = TypeParam;
+
+    const count n = 3000;
+    const count numQueries = 100;
+    const count k = 7;
+    const ValueType radius = 0.1;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<ValueType> dist(0.0, 1.0);
+    auto randomPoint = [&]() {
+        return Point<ValueType>(dist(generator), dist(generator), dist(generator));
+    };
+
+    std::vector<Point<ValueType>> positions(n);
+    std::generate(positions.begin(), positions.end(), randomPoint);
+    std::vector<Point<ValueType>> queries(numQueries);
+    std::generate(queries.begin(), queries.end(), randomPoint);
+
+    QuadTreeCartesianEuclid<ValueType> quad(Point<ValueType>(0.0, 0.0, 0.0), Point<ValueType>(1.0, 1.0, 1.0), true, 20);
+    quad.bulkLoad(positions);
+
+    std::vector<std::vector<index>> inCircle;
+    quad.getElementsInCircles(queries, radius, inCircle);
+    std::vector<std::vector<index>> nearest;
+    quad.getKNearestNeighbors(queries, k, nearest);
+    ASSERT_EQ( inCircle.size(), numQueries );
+    ASSERT_EQ( nearest.size(), numQueries );
+
+    for (index q = 0; q < numQueries; q++) {
+        //brute force
+        std::vector<std::pair<ValueType, index>> distances(n);
+        std::vector<index> expectedInCircle;
+        for (index i = 0; i < n; i++) {
+            distances[i] = std::make_pair(queries[q].distance(positions[i]), i);
+            if (distances[i].first < radius) {
+                expectedInCircle.push_back(i);
+            }
+        }
+        std::sort(distances.begin(), distances.end());
+
+        std::sort(inCircle[q].begin(), inCircle[q].end());
+        EXPECT_EQ( inCircle[q], expectedInCircle );
+
+        ASSERT_EQ( nearest[q].size(), k );
+        for (index j = 0; j < k; j++) {
+            EXPECT_EQ( nearest[q][j], distances[j].second );
+        }
+    }
+
+    //more neighbors than points
+    std::vector<index> all;
+    quad.getKNearestNeighbors(queries[0], n+10, all);
+    EXPECT_EQ( all.size(), n );
+}
+//-------------------------------------------------------------------------------------------------
+
+TYPED_TEST(QuadTreeTest, testGetLeafGraph_2D) {
+    using ValueType = TypeParam;
+
+    const count n = 500;
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<ValueType> dist(0.0, 1.0);
+
+    QuadTreeCartesianEuclid<ValueType> quad(Point<ValueType>(0.0, 0.0), Point<ValueType>(1.0, 1.0), true, 1);
+    for (index i = 0; i < n; i++) {
+        quad.addContent(i, Point<ValueType>(dist(generator), dist(generator)));
+    }
+    const index treeSize = quad.indexSubtree(0);
+
+    std::vector<std::vector<ValueType>> coords;
+    scai::lama::CSRSparseMatrix<ValueType> graph = quad.template getLeafGraph<IndexType>( coords );
+    EXPECT_TRUE( graph.isConsistent() );
+
+    std::vector<const SpatialCell<ValueType>*> leaves;
+    quad.getRoot()->getLeaves(leaves);
+    const IndexType N = leaves.size();
+    ASSERT_EQ( graph.getNumRows(), N );
+    ASSERT_EQ( coords.size(), 2 );
+    ASSERT_EQ( coords[0].size(), N );
+
+    //compare with all pairs of leaves
+    const scai::lama::CSRStorage<ValueType>& localStorage = graph.getLocalStorage();
+    const scai::hmemo::ReadAccess<IndexType> ia(localStorage.getIA());
+    const scai::hmemo::ReadAccess<IndexType> ja(localStorage.getJA());
+
+    for (IndexType i = 0; i < N; i++) {
+        std::vector<IndexType> expected;
+        for (IndexType j = 0; j < N; j++) {
+            if (j != i && leaves[i]->isAdjacent(*leaves[j])) {
+                expected.push_back(j);
+            }
+        }
+        std::vector<IndexType> actual(ja.get()+ia[i], ja.get()+ia[i+1]);
+        EXPECT_EQ( actual, expected ) << "for leaf " << i;
+
+        for (int d = 0; d < 2; d++) {
+            EXPECT_GT( coords[d][i], leaves[i]->getMinCoords()[d] );
+            EXPECT_LT( coords[d][i], leaves[i]->getMaxCoords()[d] );
+        }
+    }
+
+    //same graph as the extraction via the neighbor sets
+    std::vector< std::set<std::shared_ptr<const SpatialCell<ValueType>>>> graphNgbrsCells( treeSize );
+    std::vector<std::vector<ValueType>> treeCoords( 2 );
+    scai::lama::CSRSparseMatrix<ValueType> treeGraph = quad.template getTreeAsGraph<IndexType>( graphNgbrsCells, treeCoords );
+    EXPECT_EQ( treeGraph.getNumRows(), N );
+    EXPECT_EQ( treeGraph.getNumValues(), graph.getNumValues() );
+}
+//-------------------------------------------------------------------------------------------------
+
 TYPED_TEST(QuadTreeTest, DISABLED_benchCartesianQuadProbabilisticQueryUniform) {
     using ValueType = TypeParam;
 
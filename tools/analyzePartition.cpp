@@ -12,6 +12,7 @@
 #include "../src/Settings.h"
 #include "../src/parseArgs.h"
 #include "../src/AuxiliaryFunctions.h"
+#include "../src/Telemetry.h"
 
 using ITI::Settings;
 using ITI::IndexType;
@@ -124,22 +125,29 @@ int main(int argc, char** argv) {
         std::cout<<"WARNING: the number of block in the partition and the number of mpi processes differ. Some metrics will not be calculated." << std::endl;
     }
     
-    if( settings.metricsDetail=="mappingALL" ) {
-        settings.metricsDetail="all";
-        metrics.getMetrics(graph, part, nodeWeights, settings );
-        settings.metricsDetail="mapping";
-        //abuse fileFormat for the PEgraph format
-        if( vm.count("PEgraphFormat"))
-            settings.fileFormat= vm["PEgraphFormat"].as<ITI::Format>();
-
-        metrics.getMetrics(graph, part, nodeWeights, settings );
-        //metrics.getMappingMetrics( graph, part, PEgraph );
-        //metrics.getAllMetrics( graph, part, nodeWeights, settings );
-    }else{
-        metrics.getMetrics(graph, part, nodeWeights, settings );
+    {
+        ITI::Telemetry::ScopedTimer metricsTimer("metrics");
+        if( settings.metricsDetail=="mappingALL" ) {
+            settings.metricsDetail="all";
+            metrics.getMetrics(graph, part, nodeWeights, settings );
+            settings.metricsDetail="mapping";
+            //abuse fileFormat for the PEgraph format
+            if( vm.count("PEgraphFormat"))
+                settings.fileFormat= vm["PEgraphFormat"].as<ITI::Format>();
+
+            metrics.getMetrics(graph, part, nodeWeights, settings );
+            //metrics.getMappingMetrics( graph, part, PEgraph );
+            //metrics.getAllMetrics( graph, part, nodeWeights, settings );
+        }else{
+            metrics.getMetrics(graph, part, nodeWeights, settings );
+        }
     }
 
     if (comm->getRank() == 0) {
         metrics.print(std::cout);//TODO: adapt this
     }
+
+    if (settings.outFile != "-") {
+        ITI::Telemetry::writeJSON(settings.outFile + ".telemetry.json", comm, metrics.MM);
+    }
 }